@@ -0,0 +1,68 @@
+// Decode throughput of the authoring Opcode tables against the Decode tables.
+//
+// The stream is random bytes walked like the CPU walks code: the opcode picks its table,
+// its length moves PC, so every decode depends on the previous one as in a real fetch loop.
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <opcodes.hpp>
+
+namespace
+{
+
+constexpr std::size_t STREAM = 1 << 20; // 1 MiB of code
+constexpr int PASSES = 20;
+
+struct Cost
+{
+    std::uint8_t length;
+    std::uint8_t cycles;
+};
+
+template<typename Lookup>
+void measure(const char* layout, const std::size_t bytes, const std::vector<std::uint8_t>& code, Lookup&& lookup)
+{
+    std::uint64_t decodes = 0, cycles = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < PASSES; ++pass) {
+        for (std::size_t pc = 0; pc + 3 < code.size();) {
+            const bool cb = code[pc] == 0xCB;
+            const std::uint8_t op = cb ? code[pc + 1] : code[pc];
+            const bool taken = pc & 1;
+            const Cost cost = lookup(op, cb, taken);
+            pc += cost.length ? cost.length : 1; // unused opcodes have no length
+            cycles += cost.cycles;
+            ++decodes;
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-12s %6zu B %4zu lines %6.1f Mdecode/s (%llu cycles)\n", layout, bytes, (bytes + 63) / 64,
+        decodes / seconds / 1e6, static_cast<unsigned long long>(cycles));
+}
+
+} // namespace
+
+int main()
+{
+    using namespace LR35902;
+
+    std::mt19937 random{1};
+    std::vector<std::uint8_t> code(STREAM);
+    for (std::uint8_t& byte : code)
+        byte = static_cast<std::uint8_t>(random());
+
+    measure("Opcode AoS", sizeof(opcodes) + sizeof(cb_opcodes), code, [](const std::uint8_t op, const bool cb, const bool taken) {
+        const Opcode& entry = (cb ? cb_opcodes : opcodes)[op];
+        const int cycles = taken || !entry.cycles_no_action ? entry.cycles_action : entry.cycles_no_action;
+        return Cost{static_cast<std::uint8_t>(entry.length), static_cast<std::uint8_t>(cycles)};
+    });
+    measure("Decode SoA", sizeof(Decode::timing), code, [](const std::uint8_t op, const bool cb, const bool taken) {
+        return Cost{Decode::length(op, cb), Decode::cycles(op, cb, taken)};
+    });
+}
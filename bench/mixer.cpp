@@ -0,0 +1,57 @@
+// Mixer throughput per kernel: mixing the 8 planar streams and resampling 65536 Hz to
+// 48 kHz, in blocks of one video frame of input.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include <APU/apu.hpp>
+#include <APU/mixer.hpp>
+
+namespace
+{
+
+using namespace LR35902;
+using namespace LR35902::APU;
+
+constexpr std::size_t FRAMES = 1097; // CHANNEL_RATE / 59.73 Hz
+constexpr int BLOCKS = 20000;
+
+template<typename SampleT>
+void measure(const char* kernel, const MixerKernels kernels)
+{
+    Mixer<SampleT> mixer{CHANNEL_RATE, 48000, kernels};
+    const auto ring = std::make_unique<AudioRing<SampleT>>();
+    std::vector<std::int16_t> planar(8 * FRAMES);
+    for (std::size_t i = 0; i < planar.size(); ++i)
+        planar[i] = static_cast<std::int16_t>(static_cast<int>(i * 7919 % 20000) - 10000);
+    std::vector<StereoFrame<SampleT>> sink(AudioRing<SampleT>::CAPACITY);
+
+    std::size_t made = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int block = 0; block < BLOCKS; ++block) {
+        made += mixer.process(planar, FRAMES, *ring);
+        ring->try_pop(sink.data(), sink.size());
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-7s %-4s %8.2f M output frames/s %7.2f us per video frame\n", kernel,
+        sizeof(SampleT) == 2 ? "s16" : "f32", made / seconds / 1e6, seconds / BLOCKS * 1e6);
+}
+
+} // namespace
+
+int main()
+{
+    measure<float>("Scalar", mixer_kernels<Kernel::Scalar>());
+    measure<std::int16_t>("Scalar", mixer_kernels<Kernel::Scalar>());
+#if UTILITY_SIMD_X86
+    measure<float>("SSE2", mixer_kernels<Kernel::SSE2>());
+    measure<std::int16_t>("SSE2", mixer_kernels<Kernel::SSE2>());
+    if (utility::cpu().avx2 && utility::cpu().fma) {
+        measure<float>("AVX2", mixer_kernels<Kernel::AVX2>());
+        measure<std::int16_t>("AVX2", mixer_kernels<Kernel::AVX2>());
+    }
+#endif
+}
@@ -97,6 +97,12 @@ public:
         return m_value;
     }
 
+    // The register word is one savestate region
+    template <typename Layout>
+    auto describe(Layout & layout) {
+        layout.region(m_value);
+    }
+
 private:
     Repr m_value{}; // actually holds a value unlike register_t which is strictly type info
 };
@@ -140,6 +146,17 @@ public:
         return std::get<INDEX>.template read<SubRegister>();
     }
 
+    /**
+     * @brief Lists every register word with the savestate layout, one region each.
+     *
+     * The tuple itself is not trivially copyable so it can't be one region. The return type
+     * is deduced so that checking a call (a requires expression) instantiates the body.
+     */
+    template <typename Layout>
+    auto describe(Layout & layout) {
+        std::apply([&](auto & ... words) { (words.describe(layout), ...); }, registers);
+    }
+
 private:
     std::tuple<RegisterLists...> registers{};
 };
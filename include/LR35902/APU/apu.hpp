@@ -0,0 +1,739 @@
+#ifndef LR35902_APU_APU_HPP
+#define LR35902_APU_APU_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../types.hpp"
+#include "../io.hpp"
+#include "../state.hpp"
+#include "../scheduler.hpp"
+#include "../savestate.hpp"
+#include "channels.hpp"
+#include "blip.hpp"
+
+namespace LR35902::APU
+{
+
+static constexpr std::uint64_t CLOCK_RATE = 4194304;
+static constexpr Cycle SEQUENCER_PERIOD = 8192; // 512 Hz, DIV bit 12 (bit 4 of DIV) falling edge
+
+/** @brief What the blip buffers collect
+ * @details
+ * Stereo mixes every channel into one left/right pair at the host rate, ready to play.
+ * Channels keeps one left/right pair per channel (NR50/NR51 already applied) at an
+ * intermediate rate, for a host side Mixer that adds per channel volume and resamples.
+ */
+enum class Output : std::uint8_t
+{
+    Stereo,
+    Channels,
+};
+
+static constexpr std::uint32_t CHANNEL_RATE = 65536; // CLOCK_RATE / 64, suggested rate for Output::Channels
+
+/** @brief The four sound channels behind NR10-NR52 and wave RAM, synthesized lazily.
+ * @details
+ * Nothing runs per cycle or per sample. The channels are only brought up to date
+ * (catch_up()) when their output could change in a way the timers do not predict: a
+ * write to a sound register, a frame sequencer step (Event::DIV, 512 Hz) or the front end
+ * collecting samples with end_frame(). Catching up walks each audible channel from one
+ * change of its level to the next and hands each change to the left/right BlipBuffers
+ * (see Output), which do the band limiting and resampling. The square channels jump over
+ * the steps that keep the level, so they cost 2 changes per duty cycle whatever the
+ * frequency (at most 262144 a second), and the wave channel one per run of equal samples
+ * (at most 32 per loop, 2097152 a second at the highest frequency with every sample
+ * different). The noise channel's LFSR can change the output on any step and is walked
+ * step by step, up to 524288 steps a second at the shortest period. Silent channels (off,
+ * DAC off or volume 0) skip their whole span in O(1); a silent noise channel still
+ * advances its LFSR, in at most one sequence length.
+ *
+ * NR50/NR51 are applied per channel when a level changes, so a panning or master volume
+ * write is just one more set of deltas.
+ *
+ * mute(true) is for runs that never consume sound. It keeps only what the CPU can observe:
+ * length counters and sweep overflow switching channels off (NR52 bits 0-3) and the
+ * envelope volume a later unmute resumes from. No channel is stepped and no sample is
+ * produced. Frame sequencer ticks are not fired one by one but applied in bulk on the
+ * next register write, and Event::DIV is only scheduled for the tick at which a length
+ * counter runs out (or, while a sweep is running, the next sweep tick). A muted APU with
+ * no length-enabled channel has no event at all.
+ *
+ * The sequencer follows DIV: it assumes DIV counts from cycle 0 and observes DIV writes,
+ * which restart its tick grid at the write (with the extra tick the reset causes when it
+ * clears bit 12 while set).
+ */
+class AudioProcessor
+{
+public:
+    static constexpr int SCALE = 64; // 4 channels * 15 * 8 master volume * SCALE fits in int16
+
+    AudioProcessor(Scheduler& scheduler, SystemState& system, const std::uint32_t sample_rate = 48000, const Output output = Output::Stereo)
+    : m_scheduler{scheduler}
+    , m_io{system.io}
+    , m_sample_rate{sample_rate}
+    , m_output{output}
+    , m_time{scheduler.now()}
+    , m_frame_start{scheduler.now()}
+    {
+        const std::size_t buffers = output == Output::Channels ? 8 : 2;
+        m_blips.reserve(buffers);
+        for (std::size_t i = 0; i < buffers; ++i)
+            m_blips.emplace_back(CLOCK_RATE, sample_rate, sample_rate / 2);
+
+        observe<IO::NR10, IO::NR11, IO::NR12, IO::NR13, IO::NR14,
+                IO::NR21, IO::NR22, IO::NR23, IO::NR24,
+                IO::NR30, IO::NR31, IO::NR32, IO::NR33, IO::NR34,
+                IO::NR41, IO::NR42, IO::NR43, IO::NR44,
+                IO::NR50, IO::NR51, IO::NR52>();
+        observe_wave(std::make_index_sequence<16>{});
+        m_io.observe<IO::DIV, &AudioProcessor::on_div>(*this);
+
+        for (std::size_t i = 0; i < m_wave3.ram.size(); ++i)
+            m_wave3.ram[i] = m_io.read(static_cast<Addr>(IO::Regions::WRAM::min() + i));
+        m_nr50 = m_io.value<IO::NR50>();
+        m_nr51 = m_io.value<IO::NR51>();
+        if (m_io.get<IO::NR52::Enable>()) {
+            start_sequencer();
+            reschedule();
+        }
+    }
+
+    AudioProcessor(const AudioProcessor&) = delete; // observers point at this
+    AudioProcessor& operator=(const AudioProcessor&) = delete;
+
+    // Event::DIV handler, `at` is the deadline that expired
+    inline void on_event(const Cycle at) noexcept
+    {
+        if (m_muted) {
+            sequencer_to(at);
+            reschedule();
+            return;
+        }
+        catch_up(at);
+        tick(at);
+        reschedule();
+    }
+
+    /** @brief Stops (or resumes) producing sound while keeping NR52 and the registers exact.
+     * @details
+     * Samples already synthesized stay readable. Unmuting resumes every playing channel
+     * from now with its current volume.
+     */
+    inline void mute(const bool muted) noexcept
+    {
+        if (muted == m_muted)
+            return;
+        const Cycle now = m_scheduler.now();
+        if (muted) {
+            catch_up(now);
+            for (std::size_t ch = 0; ch < 4; ++ch)
+                level(ch, 0, now);
+            close_frame(now);
+            m_muted = true;
+            m_time = UNSYNTHESIZED;
+        } else {
+            sequencer_to(now);
+            m_muted = false;
+            m_time = m_frame_start = now;
+            restart(m_square1, CH1, now);
+            restart(m_square2, CH2, now);
+            restart(m_wave3, CH3, now);
+            restart(m_noise, CH4, now);
+        }
+        reschedule();
+    }
+
+    [[nodiscard]] inline bool muted() const noexcept { return m_muted; }
+
+    /** @brief Synthesizes up to now() and makes the samples readable.
+     * @details
+     * Call once per video frame or whenever the host wants audio. Samples nobody reads are
+     * dropped oldest first once about half a second is buffered.
+     */
+    inline void end_frame() noexcept
+    {
+        if (m_muted)
+            return;
+        catch_up(m_scheduler.now());
+        close_frame(m_time);
+    }
+
+    [[nodiscard]] inline std::uint32_t sample_rate() const noexcept { return m_sample_rate; }
+    [[nodiscard]] inline Output output() const noexcept { return m_output; }
+
+    // Sample frames (one sample per buffer) ready to read
+    [[nodiscard]] inline std::size_t available() const noexcept
+    {
+        std::size_t frames = m_blips[0].available();
+        for (const BlipBuffer& blip : m_blips)
+            frames = std::min(frames, blip.available());
+        return frames;
+    }
+
+    // Output::Stereo: interleaved L, R. Returns the number of pairs written.
+    inline std::size_t read(std::span<std::int16_t> out) noexcept
+    {
+        const std::size_t pairs = std::min(out.size() / 2, available());
+        m_blips[0].read(out.data(), pairs, 2);
+        m_blips[1].read(out.data() + 1, pairs, 2);
+        return pairs;
+    }
+
+    /** @brief Output::Channels: up to `frames` samples of each of the 8 streams.
+     * @details
+     * Returns the number n of samples read per stream, at most planar.size() / 8. They are
+     * packed into 8 consecutive blocks of n: CH1 left, CH1 right, CH2 left, ... CH4 right,
+     * which is the layout Mixer::process(planar, n, ...) takes.
+     */
+    inline std::size_t read_channels(std::span<std::int16_t> planar, const std::size_t frames) noexcept
+    {
+        const std::size_t n = std::min({frames, planar.size() / 8, available()});
+        for (std::size_t i = 0; i < 8; ++i)
+            m_blips[i].read(planar.data() + i * n, n);
+        return n;
+    }
+
+    /** @brief Channels (wave RAM included) and the frame sequencer position.
+     * @details
+     * Buffered samples and the mute setting are host side. After a load the buffers are
+     * emptied and synthesis continues exactly where the saved machine was, or from now
+     * (as after unmuting) when the state was saved muted.
+     */
+    void describe(StateLayout& layout)
+    {
+        layout.regions(m_square1, m_sweep, m_square2, m_wave3, m_noise, m_nr50, m_nr51,
+            m_powered, m_div_origin, m_first_tick, m_next_tick, m_time);
+        layout.after_load<&AudioProcessor::loaded>(*this);
+    }
+
+private:
+    static constexpr std::size_t CH1 = 0, CH2 = 1, CH3 = 2, CH4 = 3;
+    static constexpr Cycle MAX_FRAME = CLOCK_RATE / 16; // frame closed automatically past this
+    static constexpr Cycle UNSYNTHESIZED = Scheduler::NEVER; // m_time while muted
+
+    template<typename... RegisterTs>
+    inline void observe() noexcept
+    {
+        (m_io.observe<RegisterTs, &AudioProcessor::on_write<RegisterTs>>(*this), ...);
+    }
+
+    template<std::size_t... Is>
+    inline void observe_wave(std::index_sequence<Is...>) noexcept
+    {
+        (m_io.observe<IO::WaveRAM<Is>, &AudioProcessor::on_wave<Is>>(*this), ...);
+    }
+
+    // --- register writes ---
+
+    template<std::size_t IndexV>
+    inline void on_wave(const Data, const Data now) noexcept
+    {
+        sync(m_scheduler.now());
+        m_wave3.ram[IndexV] = now;
+    }
+
+    template<typename RegisterT>
+    inline void on_write(const Data old, const Data now) noexcept
+    {
+        const Cycle at = m_scheduler.now();
+        sync(at);
+
+        if constexpr (std::is_same_v<RegisterT, IO::NR52>) {
+            power(IO::NR52::Enable::get(now), at);
+            return;
+        }
+        if (!m_powered) {
+            m_io.store<RegisterT>(old); // registers are read only while powered off
+            return;
+        }
+        write<RegisterT>(now, at);
+        update_status();
+        if (m_muted)
+            reschedule(); // a trigger or length write moves the next observable tick
+    }
+
+    inline void loaded() noexcept
+    {
+        const Cycle now = m_scheduler.now();
+        sequencer_to(now);
+        for (BlipBuffer& blip : m_blips)
+            blip.clear();
+        m_levels.fill(0);
+        if (m_muted) {
+            m_time = UNSYNTHESIZED;
+        } else if (m_time > now) {
+            // saved muted, the waveforms have no position to continue from
+            m_time = m_frame_start = now;
+            restart(m_square1, CH1, now);
+            restart(m_square2, CH2, now);
+            restart(m_wave3, CH3, now);
+            restart(m_noise, CH4, now);
+        } else {
+            m_frame_start = m_time;
+            level(CH1, m_square1.level(), m_time);
+            level(CH2, m_square2.level(), m_time);
+            level(CH3, m_wave3.level(), m_time);
+            level(CH4, m_noise.level(), m_time);
+        }
+        reschedule();
+    }
+
+    // DIV reset: bit 12 falling (if set) is a tick, then the tick grid restarts at the write
+    inline void on_div(const Data, const Data) noexcept
+    {
+        const Cycle at = m_scheduler.now();
+        sync(at);
+        if (m_powered && ((at - m_div_origin) & (SEQUENCER_PERIOD / 2)))
+            tick(at);
+        // keep the step of the next tick, which is now one period after the reset
+        m_first_tick = 1 + m_first_tick - m_next_tick;
+        m_next_tick = 1;
+        m_div_origin = at;
+        reschedule();
+    }
+
+    // Everything before `at` has happened
+    inline void sync(const Cycle at) noexcept
+    {
+        if (m_muted)
+            sequencer_to(at);
+        else
+            catch_up(at);
+    }
+
+    template<typename RegisterT>
+    inline void write(const Data value, const Cycle at) noexcept
+    {
+        using namespace IO;
+        // channel 1
+        if constexpr (std::is_same_v<RegisterT, NR10>) {
+            m_sweep.write(value);
+        } else if constexpr (std::is_same_v<RegisterT, NR11>) {
+            m_square1.duty = value >> 6;
+            m_square1.length.load(value & 0x3F);
+        } else if constexpr (std::is_same_v<RegisterT, NR12>) {
+            dac(m_square1, CH1, value & 0xF8, at);
+        } else if constexpr (std::is_same_v<RegisterT, NR13>) {
+            m_square1.frequency = (m_square1.frequency & 0x700) | value;
+        } else if constexpr (std::is_same_v<RegisterT, NR14>) {
+            m_square1.frequency = (m_square1.frequency & 0xFF) | (value & 0b111) << 8;
+            m_square1.length.enabled = value & 0x40;
+            if (value & 0x80) {
+                trigger(m_square1, m_io.value<NR12>(), at);
+                if (!m_sweep.trigger(m_square1.frequency))
+                    m_square1.on = false;
+                level(CH1, m_square1.level(), at);
+            }
+        }
+        // channel 2
+        else if constexpr (std::is_same_v<RegisterT, NR21>) {
+            m_square2.duty = value >> 6;
+            m_square2.length.load(value & 0x3F);
+        } else if constexpr (std::is_same_v<RegisterT, NR22>) {
+            dac(m_square2, CH2, value & 0xF8, at);
+        } else if constexpr (std::is_same_v<RegisterT, NR23>) {
+            m_square2.frequency = (m_square2.frequency & 0x700) | value;
+        } else if constexpr (std::is_same_v<RegisterT, NR24>) {
+            m_square2.frequency = (m_square2.frequency & 0xFF) | (value & 0b111) << 8;
+            m_square2.length.enabled = value & 0x40;
+            if (value & 0x80) {
+                trigger(m_square2, m_io.value<NR22>(), at);
+                level(CH2, m_square2.level(), at);
+            }
+        }
+        // channel 3
+        else if constexpr (std::is_same_v<RegisterT, NR30>) {
+            dac(m_wave3, CH3, value & 0x80, at);
+        } else if constexpr (std::is_same_v<RegisterT, NR31>) {
+            m_wave3.length.load(value);
+        } else if constexpr (std::is_same_v<RegisterT, NR32>) {
+            m_wave3.volume = (value >> 5) & 0b11;
+            level(CH3, m_wave3.level(), at);
+        } else if constexpr (std::is_same_v<RegisterT, NR33>) {
+            m_wave3.frequency = (m_wave3.frequency & 0x700) | value;
+        } else if constexpr (std::is_same_v<RegisterT, NR34>) {
+            m_wave3.frequency = (m_wave3.frequency & 0xFF) | (value & 0b111) << 8;
+            m_wave3.length.enabled = value & 0x40;
+            if (value & 0x80) {
+                m_wave3.on = m_wave3.dac;
+                m_wave3.length.trigger();
+                m_wave3.position = 0;
+                m_wave3.next = at + m_wave3.period();
+                level(CH3, m_wave3.level(), at);
+            }
+        }
+        // channel 4
+        else if constexpr (std::is_same_v<RegisterT, NR41>) {
+            m_noise.length.load(value & 0x3F);
+        } else if constexpr (std::is_same_v<RegisterT, NR42>) {
+            dac(m_noise, CH4, value & 0xF8, at);
+        } else if constexpr (std::is_same_v<RegisterT, NR43>) {
+            m_noise.nr43 = value;
+        } else if constexpr (std::is_same_v<RegisterT, NR44>) {
+            m_noise.length.enabled = value & 0x40;
+            if (value & 0x80) {
+                m_noise.lfsr = 0x7FFF;
+                trigger(m_noise, m_io.value<NR42>(), at);
+                level(CH4, m_noise.level(), at);
+            }
+        }
+        // mixer
+        else if constexpr (std::is_same_v<RegisterT, NR50> || std::is_same_v<RegisterT, NR51>) {
+            std::array<Gain, 4> before;
+            for (std::size_t ch = 0; ch < 4; ++ch)
+                before[ch] = gain(ch);
+            m_nr50 = m_io.value<NR50>();
+            m_nr51 = m_io.value<NR51>();
+            for (std::size_t ch = 0; ch < 4; ++ch) {
+                const Gain after = gain(ch);
+                add(ch, at, m_levels[ch] * (after.left - before[ch].left), m_levels[ch] * (after.right - before[ch].right));
+            }
+        }
+    }
+
+    template<typename ChannelT>
+    inline void trigger(ChannelT& channel, const Data nrx2, const Cycle at) noexcept
+    {
+        channel.on = channel.dac;
+        channel.length.trigger();
+        channel.envelope.reload(nrx2);
+        channel.next = at + channel.period();
+    }
+
+    // NRx2 upper 5 bits (NR30 bit 7) power the channel's DAC; off also switches the channel off
+    template<typename ChannelT>
+    inline void dac(ChannelT& channel, const std::size_t index, const bool on, const Cycle at) noexcept
+    {
+        channel.dac = on;
+        if (!on)
+            channel.on = false;
+        level(index, channel.level(), at);
+    }
+
+    inline void power(const bool on, const Cycle at) noexcept
+    {
+        if (on == m_powered)
+            return;
+        m_powered = on;
+        if (on) {
+            start_sequencer();
+            reschedule();
+            return;
+        }
+
+        m_scheduler.cancel(Event::DIV);
+        // lengths survive on DMG, everything else is cleared
+        const auto lengths = std::tuple{m_square1.length.counter, m_square2.length.counter, m_wave3.length.counter, m_noise.length.counter};
+        m_square1 = Square{};
+        m_square2 = Square{};
+        m_wave3 = Wave{.ram = m_wave3.ram}; // wave RAM is not cleared
+        m_noise = Noise{};
+        m_sweep = Sweep{};
+        std::tie(m_square1.length.counter, m_square2.length.counter, m_wave3.length.counter, m_noise.length.counter) = lengths;
+        for (std::size_t ch = 0; ch < 4; ++ch)
+            level(ch, 0, at);
+        clear<IO::NR10, IO::NR11, IO::NR12, IO::NR13, IO::NR14,
+              IO::NR21, IO::NR22, IO::NR23, IO::NR24,
+              IO::NR30, IO::NR31, IO::NR32, IO::NR33, IO::NR34,
+              IO::NR41, IO::NR42, IO::NR43, IO::NR44, IO::NR50, IO::NR51>();
+        m_nr50 = m_nr51 = 0;
+        update_status();
+    }
+
+    template<typename... RegisterTs>
+    inline void clear() noexcept
+    {
+        (m_io.store<RegisterTs>(0), ...);
+    }
+
+    // NR52 bits 0-3
+    inline void update_status() noexcept
+    {
+        m_io.set<IO::NR52::CH1>(m_square1.on);
+        m_io.set<IO::NR52::CH2>(m_square2.on);
+        m_io.set<IO::NR52::CH3>(m_wave3.on);
+        m_io.set<IO::NR52::CH4>(m_noise.on);
+    }
+
+    // --- frame sequencer ---
+
+    /* Sequencer tick k happens at cycle m_div_origin + k * SEQUENCER_PERIOD. Its step
+     * (0-7) counts from the first tick after power on. Steps 0, 2, 4, 6 clock lengths, 2 and 6 the sweep,
+     * 7 the envelopes. */
+    static constexpr Data LENGTH_STEPS = 0b0101'0101;
+    static constexpr Data SWEEP_STEPS = 0b0100'0100;
+    static constexpr Data ENVELOPE_STEPS = 0b1000'0000;
+
+    // Step 0 happens on the first DIV bit 12 falling edge after power on
+    inline void start_sequencer() noexcept
+    {
+        m_powered = true;
+        m_first_tick = (m_scheduler.now() - m_div_origin) / SEQUENCER_PERIOD + 1;
+        m_next_tick = m_first_tick;
+    }
+
+    [[nodiscard]] inline unsigned step(const std::uint64_t tick) const noexcept
+    {
+        return static_cast<unsigned>((tick - m_first_tick) & 7);
+    }
+
+    // Ticks in [m_next_tick, m_next_tick + ticks) whose step is in `steps`
+    [[nodiscard]] inline std::uint64_t count(const std::uint64_t ticks, const Data steps) const noexcept
+    {
+        std::uint64_t n = ticks / 8 * static_cast<std::uint64_t>(std::popcount(steps));
+        const unsigned first = step(m_next_tick);
+        for (std::uint64_t i = 0; i < ticks % 8; ++i)
+            n += steps >> ((first + i) & 7) & 1;
+        return n;
+    }
+
+    // The sweep can still change channel 1 (and switch it off on overflow)
+    [[nodiscard]] inline bool sweeping() const noexcept
+    {
+        return m_square1.on && m_sweep.enabled && m_sweep.period;
+    }
+
+    // Next event: every tick while audible, the next observable tick while muted
+    inline void reschedule() noexcept
+    {
+        if (!m_powered) {
+            m_scheduler.cancel(Event::DIV);
+            return;
+        }
+        if (!m_muted) {
+            m_scheduler.schedule(Event::DIV, cycle(m_next_tick));
+            return;
+        }
+
+        std::uint64_t tick = std::min({expiry(m_square1), expiry(m_square2), expiry(m_wave3), expiry(m_noise)});
+        if (sweeping()) {
+            std::uint64_t next = m_next_tick;
+            while (!(SWEEP_STEPS >> step(next) & 1))
+                ++next;
+            tick = std::min(tick, next);
+        }
+
+        if (tick == NO_TICK)
+            m_scheduler.cancel(Event::DIV);
+        else
+            m_scheduler.schedule(Event::DIV, cycle(tick));
+    }
+
+    [[nodiscard]] inline Cycle cycle(const std::uint64_t tick) const noexcept
+    {
+        return m_div_origin + tick * SEQUENCER_PERIOD;
+    }
+
+    static constexpr std::uint64_t NO_TICK = std::numeric_limits<std::uint64_t>::max();
+
+    // Tick at which the channel's length counter switches it off (length ticks are every other tick)
+    template<typename ChannelT>
+    [[nodiscard]] inline std::uint64_t expiry(const ChannelT& channel) const noexcept
+    {
+        if (!channel.on || !channel.length.enabled || !channel.length.counter)
+            return NO_TICK;
+        return m_next_tick + (step(m_next_tick) & 1) + 2 * (channel.length.counter - 1);
+    }
+
+    // Muted: applies every tick up to and including `at` at once
+    inline void sequencer_to(const Cycle at) noexcept
+    {
+        const std::uint64_t last = (at - m_div_origin) / SEQUENCER_PERIOD;
+        if (!m_powered || last < m_next_tick)
+            return;
+
+        if (sweeping()) {
+            // the sweep changes the frequency each time, walk the ticks (128 Hz at most)
+            while (m_next_tick <= last)
+                sequencer_tick(m_next_tick++);
+        } else {
+            const std::uint64_t ticks = last + 1 - m_next_tick;
+            if (m_square1.on) {
+                // the sweep timer runs while channel 1 is on, up to (not including) its length expiry
+                const std::uint64_t end = std::min(last + 1, expiry(m_square1));
+                m_sweep.skip(count(end - m_next_tick, SWEEP_STEPS));
+            }
+            const std::uint64_t lengths = count(ticks, LENGTH_STEPS);
+            const std::uint64_t envelopes = count(ticks, ENVELOPE_STEPS);
+            if (m_square1.length.skip(lengths)) m_square1.on = false;
+            if (m_square2.length.skip(lengths)) m_square2.on = false;
+            if (m_wave3.length.skip(lengths)) m_wave3.on = false;
+            if (m_noise.length.skip(lengths)) m_noise.on = false;
+            m_square1.envelope.skip(envelopes);
+            m_square2.envelope.skip(envelopes);
+            m_noise.envelope.skip(envelopes);
+            m_next_tick = last + 1;
+        }
+        update_status();
+    }
+
+    // Applies the next tick at `at` and hands the new levels on
+    inline void tick(const Cycle at) noexcept
+    {
+        sequencer_tick(m_next_tick++);
+        level(CH1, m_square1.level(), at);
+        level(CH2, m_square2.level(), at);
+        level(CH3, m_wave3.level(), at);
+        level(CH4, m_noise.level(), at);
+        update_status();
+    }
+
+    inline void sequencer_tick(const std::uint64_t tick) noexcept
+    {
+        const unsigned step = this->step(tick);
+
+        if (step % 2 == 0) {
+            if (m_square1.length.clock()) m_square1.on = false;
+            if (m_square2.length.clock()) m_square2.on = false;
+            if (m_wave3.length.clock()) m_wave3.on = false;
+            if (m_noise.length.clock()) m_noise.on = false;
+        }
+        if (step == 2 || step == 6) {
+            if (m_square1.on && !m_sweep.clock(m_square1.frequency))
+                m_square1.on = false;
+        }
+        if (step == 7) {
+            m_square1.envelope.clock();
+            m_square2.envelope.clock();
+            m_noise.envelope.clock();
+        }
+    }
+
+    // --- synthesis ---
+
+    // Runs every channel up to `until`, closing blip frames so none exceeds MAX_FRAME
+    inline void catch_up(const Cycle until) noexcept
+    {
+        while (until > m_time) {
+            const Cycle end = std::min(until, m_frame_start + MAX_FRAME);
+            run(m_square1, CH1, end);
+            run(m_square2, CH2, end);
+            run(m_wave3, CH3, end);
+            run(m_noise, CH4, end);
+            m_time = end;
+            if (end - m_frame_start >= MAX_FRAME)
+                close_frame(end);
+        }
+    }
+
+    // Unmute: the waveform restarts at its current position
+    template<typename ChannelT>
+    inline void restart(ChannelT& channel, const std::size_t index, const Cycle at) noexcept
+    {
+        channel.next = at + channel.period();
+        level(index, channel.level(), at);
+    }
+
+    template<typename ChannelT>
+    inline void run(ChannelT& channel, const std::size_t index, const Cycle until) noexcept
+    {
+        if (!channel.on || channel.next > until)
+            return;
+        const Cycle period = channel.period();
+        if (channel.silent()) {
+            const Cycle steps = (until - channel.next) / period + 1;
+            channel.skip(steps);
+            channel.next += steps * period;
+            return;
+        }
+        while (channel.next <= until) {
+            // a duty or wave RAM write changes level() without handing it on, the next step does
+            const Cycle holds = channel.level() == m_levels[index] ? channel.holds() : 0;
+            const Cycle change = channel.next + holds * period;
+            if (change > until) {
+                const Cycle steps = (until - channel.next) / period + 1;
+                channel.skip(steps);
+                channel.next += steps * period;
+                return;
+            }
+            channel.skip(holds + 1);
+            level(index, channel.level(), change);
+            channel.next = change + period;
+        }
+    }
+
+    struct Gain
+    {
+        int left = 0;
+        int right = 0;
+    };
+
+    // NR51 routes the channel to each side, NR50 sets that side's master volume (1-8)
+    [[nodiscard]] inline Gain gain(const std::size_t channel) const noexcept
+    {
+        return Gain{
+            (m_nr51 >> (channel + 4) & 1) * ((m_nr50 >> 4 & 0b111) + 1) * SCALE,
+            (m_nr51 >> channel & 1) * ((m_nr50 & 0b111) + 1) * SCALE};
+    }
+
+    inline void level(const std::size_t channel, const Data level, const Cycle at) noexcept
+    {
+        if (m_muted)
+            return;
+        const int delta = level - m_levels[channel];
+        if (delta == 0)
+            return;
+        m_levels[channel] = level;
+        const Gain g = gain(channel);
+        add(channel, at, delta * g.left, delta * g.right);
+    }
+
+    inline void add(const std::size_t channel, const Cycle at, const int left, const int right) noexcept
+    {
+        const std::size_t pair = m_output == Output::Channels ? 2 * channel : 0;
+        if (left)
+            m_blips[pair].add_delta(at - m_frame_start, left);
+        if (right)
+            m_blips[pair + 1].add_delta(at - m_frame_start, right);
+    }
+
+    inline void close_frame(const Cycle at) noexcept
+    {
+        for (BlipBuffer& blip : m_blips) {
+            blip.end_frame(at - m_frame_start);
+            // keep room for the next frame when nobody is reading
+            const std::size_t room = blip.samples_for(MAX_FRAME) + BlipBuffer::WIDTH;
+            if (blip.max_frame() < MAX_FRAME)
+                blip.discard(room);
+        }
+        m_frame_start = at;
+    }
+
+    Scheduler& m_scheduler;
+    IO::RegisterBank& m_io;
+    const std::uint32_t m_sample_rate;
+    const Output m_output;
+
+    Square m_square1{};
+    Sweep m_sweep{};
+    Square m_square2{};
+    Wave m_wave3{};
+    Noise m_noise{};
+    Data m_nr50 = 0;
+    Data m_nr51 = 0;
+
+    bool m_powered = false;
+    bool m_muted = false;
+    Cycle m_div_origin = 0;         // last DIV reset
+    std::uint64_t m_first_tick = 0; // sequencer step 0
+    std::uint64_t m_next_tick = 0;  // first tick not applied yet
+
+    std::array<int, 4> m_levels{}; // last level handed to the blip buffers per channel
+    std::vector<BlipBuffer> m_blips; // L, R (Stereo) or CH1 L, CH1 R, ... CH4 R (Channels)
+    Cycle m_time;         // channels are synthesized up to here (UNSYNTHESIZED while muted)
+    Cycle m_frame_start;  // blip buffer time 0
+};
+
+} // namespace LR35902::APU
+
+#endif // LR35902_APU_APU_HPP
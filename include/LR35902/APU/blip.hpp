@@ -0,0 +1,177 @@
+#ifndef LR35902_APU_BLIP_HPP
+#define LR35902_APU_BLIP_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <numbers>
+#include <vector>
+
+namespace LR35902::APU
+{
+
+/** @brief Band-limited step synthesis ("blip buffer") from clock time to a host sample rate.
+ * @details
+ * A channel never produces samples. It reports each change of its output level as a delta
+ * at the clock cycle it happened (add_delta()). Each delta is spread over WIDTH output
+ * samples with a windowed sinc kernel chosen by the sub-sample phase of that cycle, so the
+ * step is band-limited to the output rate with no aliasing. Reading integrates the deltas
+ * back into levels and removes DC with a one pole high-pass, like the capacitor on the
+ * real output.
+ *
+ * The cost is WIDTH multiply-adds per level change plus one add per output sample,
+ * independent of the emulated clock rate.
+ *
+ * Times passed to add_delta() are relative to the start of the current frame and
+ * end_frame() moves that start forward, making the samples before it readable.
+ */
+class BlipBuffer
+{
+public:
+    static constexpr std::size_t PHASE_BITS = 5;
+    static constexpr std::size_t PHASES = 1 << PHASE_BITS;
+    static constexpr std::size_t WIDTH = 16; // kernel taps, even
+    static constexpr int DELTA_BITS = 15;    // kernel phases sum to 1 << DELTA_BITS
+    static constexpr int BASS_SHIFT = 9;     // high-pass corner ~ rate / 2^BASS_SHIFT / 2pi
+
+    BlipBuffer(const std::uint64_t clock_rate, const std::uint32_t sample_rate, const std::size_t capacity)
+    : m_factor{(static_cast<std::uint64_t>(sample_rate) << FRAC_BITS) / clock_rate}
+    , m_capacity{capacity}
+    , m_samples(capacity + WIDTH, 0)
+    {}
+
+    // Output samples for `clocks` clock cycles, rounded up (how much a frame needs)
+    [[nodiscard]] std::size_t samples_for(const std::uint64_t clocks) const noexcept
+    {
+        return static_cast<std::size_t>((clocks * m_factor + m_offset + (ONE - 1)) >> FRAC_BITS);
+    }
+
+    // Longest frame (in clocks) that still fits behind the samples already available
+    [[nodiscard]] std::uint64_t max_frame() const noexcept
+    {
+        return ((m_capacity - m_available) << FRAC_BITS) / m_factor;
+    }
+
+    // `delta` is the change of the output level at `time` clocks into the frame
+    void add_delta(const std::uint64_t time, const int delta) noexcept
+    {
+        const std::uint64_t fixed = time * m_factor + m_offset;
+        const std::size_t sample = m_available + static_cast<std::size_t>(fixed >> FRAC_BITS);
+        const std::size_t phase = static_cast<std::size_t>(fixed >> (FRAC_BITS - PHASE_BITS)) & (PHASES - 1);
+        if (sample + WIDTH > m_samples.size())
+            return; // frame longer than max_frame(), the caller lost track
+        const std::array<std::int32_t, WIDTH>& kernel = KERNEL[phase];
+        std::int64_t* out = m_samples.data() + sample;
+        for (std::size_t i = 0; i < WIDTH; ++i)
+            out[i] += static_cast<std::int64_t>(kernel[i]) * delta;
+        m_end = std::max(m_end, sample + WIDTH);
+    }
+
+    // The frame ends `clocks` after its start; its samples become readable
+    void end_frame(const std::uint64_t clocks) noexcept
+    {
+        const std::uint64_t fixed = clocks * m_factor + m_offset;
+        m_available = std::min(m_capacity, m_available + static_cast<std::size_t>(fixed >> FRAC_BITS));
+        m_offset = fixed & (ONE - 1);
+    }
+
+    [[nodiscard]] std::size_t available() const noexcept { return m_available; }
+
+    // Reads up to count samples into out[0], out[stride], ...
+    std::size_t read(std::int16_t* out, const std::size_t count, const std::size_t stride = 1) noexcept
+    {
+        const std::size_t n = std::min(count, m_available);
+        std::int64_t sum = m_integrator;
+        for (std::size_t i = 0; i < n; ++i) {
+            sum += m_samples[i];
+            const std::int64_t level = sum >> DELTA_BITS;
+            out[i * stride] = static_cast<std::int16_t>(std::clamp<std::int64_t>(level, INT16_MIN, INT16_MAX));
+            sum -= level << (DELTA_BITS - BASS_SHIFT);
+        }
+        m_integrator = sum;
+        remove(n);
+        return n;
+    }
+
+    // Drops the oldest samples (nobody is reading)
+    void discard(const std::size_t count) noexcept
+    {
+        const std::size_t n = std::min(count, m_available);
+        std::int64_t sum = m_integrator;
+        for (std::size_t i = 0; i < n; ++i) {
+            sum += m_samples[i];
+            sum -= (sum >> DELTA_BITS) << (DELTA_BITS - BASS_SHIFT);
+        }
+        m_integrator = sum;
+        remove(n);
+    }
+
+    // Drops everything, buffered samples and the frame in progress
+    void clear() noexcept
+    {
+        // samples past m_end are always 0
+        std::fill_n(m_samples.begin(), std::max(m_end, m_available), 0);
+        m_offset = 0;
+        m_available = 0;
+        m_end = 0;
+        m_integrator = 0;
+    }
+
+private:
+    static constexpr int FRAC_BITS = 32;
+    static constexpr std::uint64_t ONE = std::uint64_t{1} << FRAC_BITS;
+
+    using Kernel = std::array<std::array<std::int32_t, WIDTH>, PHASES>;
+
+    // Blackman windowed sinc, cut off a little below Nyquist, each phase summing to exactly 1
+    static Kernel make_kernel()
+    {
+        constexpr double CUTOFF = 0.9;
+        Kernel kernel{};
+        for (std::size_t phase = 0; phase < PHASES; ++phase) {
+            std::array<double, WIDTH> taps{};
+            double total = 0;
+            for (std::size_t i = 0; i < WIDTH; ++i) {
+                const double x = static_cast<double>(i) - (WIDTH / 2 - 1) - static_cast<double>(phase) / PHASES;
+                const double w = (x + WIDTH / 2.0) / WIDTH; // window position 0..1
+                const double window = 0.42 - 0.5 * std::cos(2 * std::numbers::pi * w) + 0.08 * std::cos(4 * std::numbers::pi * w);
+                const double sinc = x == 0 ? 1.0 : std::sin(std::numbers::pi * CUTOFF * x) / (std::numbers::pi * CUTOFF * x);
+                taps[i] = sinc * window;
+                total += taps[i];
+            }
+            int sum = 0;
+            for (std::size_t i = 0; i < WIDTH; ++i) {
+                kernel[phase][i] = static_cast<std::int32_t>(std::lround(taps[i] / total * (1 << DELTA_BITS)));
+                sum += kernel[phase][i];
+            }
+            kernel[phase][WIDTH / 2 - 1] += (1 << DELTA_BITS) - sum; // rounding error into the peak
+        }
+        return kernel;
+    }
+
+    inline static const Kernel KERNEL = make_kernel();
+
+    void remove(const std::size_t n) noexcept
+    {
+        // deltas already added past the readable samples move along with them
+        const std::size_t end = std::max(m_end, m_available);
+        std::copy(m_samples.begin() + static_cast<std::ptrdiff_t>(n), m_samples.begin() + static_cast<std::ptrdiff_t>(end), m_samples.begin());
+        std::fill(m_samples.begin() + static_cast<std::ptrdiff_t>(end - n), m_samples.begin() + static_cast<std::ptrdiff_t>(end), 0);
+        m_available -= n;
+        m_end = end - n;
+    }
+
+    const std::uint64_t m_factor; // output samples per clock, 32.32 fixed point
+    const std::size_t m_capacity;
+    std::uint64_t m_offset = 0;   // fraction of a sample the current frame starts at
+    std::size_t m_available = 0;
+    std::size_t m_end = 0;        // one past the last sample holding a delta
+    std::int64_t m_integrator = 0;
+    std::vector<std::int64_t> m_samples;
+};
+
+} // namespace LR35902::APU
+
+#endif // LR35902_APU_BLIP_HPP
@@ -0,0 +1,297 @@
+#ifndef LR35902_APU_CHANNELS_HPP
+#define LR35902_APU_CHANNELS_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+#include "../types.hpp"
+#include "../scheduler.hpp"
+
+namespace LR35902::APU
+{
+
+/** @brief NRx2 volume envelope, clocked at 64 Hz by the frame sequencer */
+struct Envelope
+{
+    Data volume = 0;
+    Data period = 0;
+    Data timer = 0;
+    bool up = false;
+
+    // Trigger: reloads from NRx2
+    inline constexpr void reload(const Data nrx2) noexcept
+    {
+        volume = nrx2 >> 4;
+        up = nrx2 & 0b1000;
+        period = nrx2 & 0b111;
+        timer = period;
+    }
+
+    inline constexpr void clock() noexcept
+    {
+        if (period == 0 || --timer != 0)
+            return;
+        timer = period;
+        if (up && volume < 15)
+            ++volume;
+        else if (!up && volume > 0)
+            --volume;
+    }
+
+    // `ticks` clocks at once
+    inline constexpr void skip(const std::uint64_t ticks) noexcept
+    {
+        if (period == 0 || ticks < timer) {
+            if (period)
+                timer = static_cast<Data>(timer - ticks);
+            return;
+        }
+        const std::uint64_t rest = ticks - timer;
+        const std::uint64_t changes = 1 + rest / period;
+        timer = static_cast<Data>(period - rest % period);
+        volume = up ? static_cast<Data>(std::min<std::uint64_t>(15, volume + changes))
+                    : static_cast<Data>(volume - std::min<std::uint64_t>(volume, changes));
+    }
+};
+
+/** @brief Length counter: the channel switches off when it reaches 0, clocked at 256 Hz */
+template<unsigned MaxV>
+struct Length
+{
+    static constexpr unsigned MAX = MaxV;
+
+    unsigned counter = 0;
+    bool enabled = false;
+    std::array<Data, 3> padding{};
+
+    inline constexpr void load(const unsigned length) noexcept { counter = MAX - length; }
+
+    // True when the channel has to be switched off
+    [[nodiscard]] inline constexpr bool clock() noexcept
+    {
+        return enabled && counter && --counter == 0;
+    }
+
+    // `ticks` clocks at once, true when the counter ran out
+    [[nodiscard]] inline constexpr bool skip(const std::uint64_t ticks) noexcept
+    {
+        if (!enabled || !counter || !ticks)
+            return false;
+        if (counter <= ticks) {
+            counter = 0;
+            return true;
+        }
+        counter -= static_cast<unsigned>(ticks);
+        return false;
+    }
+
+    inline constexpr void trigger() noexcept
+    {
+        if (counter == 0)
+            counter = MAX;
+    }
+};
+
+/* Every channel is a timer that steps its waveform each period() cycles. `next` is the
+ * absolute cycle of the next step. level() is the 4 bit DAC input after the step and
+ * holds() the number of steps from here on that leave it unchanged, so synthesis can
+ * jump straight to the next step that changes it.
+ *
+ * Channels are saved, compared and hashed as raw bytes, so every struct here spells out
+ * its padding as zeroed `padding` members instead of leaving it to the compiler. */
+
+/** @brief Channels 1 and 2 */
+struct Square
+{
+    static constexpr std::array<Data, 4> DUTY { 0b0000'0001, 0b1000'0001, 0b1000'0111, 0b0111'1110 };
+
+    bool on = false;
+    bool dac = false;
+    Data duty = 0;
+    Data position = 0;
+    unsigned frequency = 0;
+    Length<64> length{};
+    Envelope envelope{};
+    std::array<Data, 4> padding{};
+    Cycle next = 0;
+
+    [[nodiscard]] inline constexpr Cycle period() const noexcept { return (2048 - frequency) * 4; }
+    [[nodiscard]] inline constexpr bool silent() const noexcept { return !on || envelope.volume == 0; }
+    [[nodiscard]] inline constexpr Data level() const noexcept
+    {
+        return on && high(position) ? envelope.volume : 0;
+    }
+
+    // Every duty cycle has both levels, so this is at most 7
+    [[nodiscard]] inline constexpr Cycle holds() const noexcept
+    {
+        Cycle steps = 0;
+        while (steps < 7 && high(position + steps + 1) == high(position))
+            ++steps;
+        return steps;
+    }
+
+    [[nodiscard]] inline constexpr bool high(const unsigned at) const noexcept { return DUTY[duty] >> (at & 7) & 1; }
+
+    inline constexpr void step() noexcept { position = (position + 1) & 7; }
+    inline constexpr void skip(const Cycle steps) noexcept { position = static_cast<Data>((position + steps) & 7); }
+};
+
+/** @brief Channel 1 frequency sweep, clocked at 128 Hz */
+struct Sweep
+{
+    unsigned shadow = 0;
+    Data period = 0;
+    Data timer = 0;
+    Data shift = 0;
+    bool negate = false;
+    bool enabled = false;
+    std::array<Data, 3> padding{};
+
+    inline constexpr void write(const Data nr10) noexcept
+    {
+        period = (nr10 >> 4) & 0b111;
+        negate = nr10 & 0b1000;
+        shift = nr10 & 0b111;
+    }
+
+    [[nodiscard]] inline constexpr unsigned target() const noexcept
+    {
+        const unsigned delta = shadow >> shift;
+        return negate ? shadow - delta : shadow + delta;
+    }
+
+    // Trigger: false if the first overflow check already switches the channel off
+    [[nodiscard]] inline constexpr bool trigger(const unsigned frequency) noexcept
+    {
+        shadow = frequency;
+        timer = period ? period : 8;
+        enabled = period || shift;
+        return !shift || target() <= 2047;
+    }
+
+    // `ticks` clocks at once, only valid while no clock could compute a new frequency
+    inline constexpr void skip(const std::uint64_t ticks) noexcept
+    {
+        const Data reload = period ? period : 8;
+        if (ticks < timer) {
+            timer = static_cast<Data>(timer - ticks);
+            return;
+        }
+        timer = static_cast<Data>(reload - (ticks - timer) % reload);
+    }
+
+    // Returns false on overflow. `frequency` receives the new frequency when it changes.
+    [[nodiscard]] inline constexpr bool clock(unsigned& frequency) noexcept
+    {
+        if (--timer != 0)
+            return true;
+        timer = period ? period : 8;
+        if (!enabled || !period)
+            return true;
+        const unsigned next = target();
+        if (next > 2047)
+            return false;
+        if (shift) {
+            shadow = frequency = next;
+            return target() <= 2047;
+        }
+        return true;
+    }
+};
+
+/** @brief Channel 3, plays the 32 4 bit samples of wave RAM */
+struct Wave
+{
+    static constexpr std::array<Data, 4> SHIFT { 4, 0, 1, 2 }; // NR32 output level
+
+    std::array<Data, 16> ram{}; // wave RAM, kept here so the channel is plain data
+    bool on = false;
+    bool dac = false;
+    Data volume = 0; // NR32 bits 5-6
+    Data position = 0;
+    unsigned frequency = 0;
+    Length<256> length{};
+    Cycle next = 0;
+
+    [[nodiscard]] inline constexpr Cycle period() const noexcept { return (2048 - frequency) * 2; }
+    [[nodiscard]] inline constexpr bool silent() const noexcept { return !on || volume == 0; }
+    [[nodiscard]] inline constexpr Data level() const noexcept
+    {
+        return on ? sample(position) : 0;
+    }
+
+    // Runs of equal samples (after the volume shift) are one step. A flat wave holds for a whole loop.
+    [[nodiscard]] inline constexpr Cycle holds() const noexcept
+    {
+        Cycle steps = 0;
+        while (steps < 31 && sample(position + steps + 1) == sample(position))
+            ++steps;
+        return steps;
+    }
+
+    [[nodiscard]] inline constexpr Data sample(const unsigned at) const noexcept
+    {
+        const Data byte = ram[(at & 31) / 2];
+        return (at & 1 ? byte & 0x0F : byte >> 4) >> SHIFT[volume];
+    }
+
+    inline constexpr void step() noexcept { position = (position + 1) & 31; }
+    inline constexpr void skip(const Cycle steps) noexcept { position = static_cast<Data>((position + steps) & 31); }
+};
+
+/** @brief Channel 4, a 15 (or 7) bit LFSR */
+struct Noise
+{
+    static constexpr std::array<Cycle, 8> DIVISOR { 8, 16, 32, 48, 64, 80, 96, 112 };
+
+    std::uint16_t lfsr = 0x7FFF;
+    bool on = false;
+    bool dac = false;
+    Length<64> length{};
+    Envelope envelope{};
+    Data nr43 = 0;
+    std::array<Data, 7> padding{};
+    Cycle next = 0;
+
+    [[nodiscard]] inline constexpr Cycle period() const noexcept { return DIVISOR[nr43 & 0b111] << (nr43 >> 4); }
+    [[nodiscard]] inline constexpr bool silent() const noexcept { return !on || envelope.volume == 0; }
+    [[nodiscard]] inline constexpr Data level() const noexcept
+    {
+        return on && !(lfsr & 1) ? envelope.volume : 0;
+    }
+
+    // Any step can change the output bit, the LFSR is stepped one by one while audible
+    [[nodiscard]] inline constexpr Cycle holds() const noexcept { return 0; }
+
+    inline constexpr void step() noexcept
+    {
+        if ((nr43 >> 4) >= 14)
+            return; // shift 14 and 15 receive no clocks
+        const std::uint16_t bit = (lfsr ^ (lfsr >> 1)) & 1;
+        lfsr = static_cast<std::uint16_t>((lfsr >> 1) | (bit << 14));
+        if (nr43 & 0b1000)
+            lfsr = static_cast<std::uint16_t>((lfsr & ~0x40) | (bit << 6));
+    }
+
+    /* A silent channel keeps shifting, so an envelope that brings the volume back up
+     * continues the sequence where the hardware would. The low 7 bits (all 15 in 15 bit
+     * mode) repeat every 127 (32767) steps; in 7 bit mode the upper bits only depend on
+     * the last 8 steps, so at most 8 + 32767 steps are walked. */
+    inline constexpr void skip(Cycle steps) noexcept
+    {
+        if ((nr43 >> 4) >= 14)
+            return;
+        const Cycle sequence = nr43 & 0b1000 ? 127 : 32767;
+        if (steps > 8 + sequence)
+            steps = 8 + (steps - 8) % sequence;
+        while (steps--)
+            step();
+    }
+};
+
+} // namespace LR35902::APU
+
+#endif // LR35902_APU_CHANNELS_HPP
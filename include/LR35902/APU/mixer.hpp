@@ -0,0 +1,288 @@
+#ifndef LR35902_APU_MIXER_HPP
+#define LR35902_APU_MIXER_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <numbers>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include <utility/simd.hpp>
+#include <utility/spsc_ring.hpp>
+
+/***
+ * Mixer kernels. Every kernel provides:
+ *   - accumulate(in, n, gain, acc)   acc[i] += gain * in[i], int16 in, float acc
+ *   - dot2(l, r, taps, out)          out = { sum l[i] * taps[i], sum r[i] * taps[i] }, TAPS long
+ *
+ * The SIMD kernels handle whole vectors and fall back to Scalar for the tail.
+ */
+
+namespace LR35902::APU
+{
+
+namespace Kernel
+{
+
+static constexpr std::size_t TAPS = 32;
+
+struct Scalar
+{
+    static void accumulate(const std::int16_t* in, const std::size_t n, const float gain, float* acc) noexcept
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            acc[i] += gain * static_cast<float>(in[i]);
+    }
+
+    static void dot2(const float* l, const float* r, const float* taps, float* out) noexcept
+    {
+        float sl = 0, sr = 0;
+        for (std::size_t i = 0; i < TAPS; ++i) {
+            sl += l[i] * taps[i];
+            sr += r[i] * taps[i];
+        }
+        out[0] = sl;
+        out[1] = sr;
+    }
+};
+
+#if UTILITY_SIMD_X86
+
+struct SSE2
+{
+    static void accumulate(const std::int16_t* in, const std::size_t n, const float gain, float* acc) noexcept
+    {
+        const __m128 g = _mm_set1_ps(gain);
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            // sign extend by unpacking into the high half and shifting back down
+            const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+            const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+            _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(g, _mm_cvtepi32_ps(lo))));
+            _mm_storeu_ps(acc + i + 4, _mm_add_ps(_mm_loadu_ps(acc + i + 4), _mm_mul_ps(g, _mm_cvtepi32_ps(hi))));
+        }
+        Scalar::accumulate(in + i, n - i, gain, acc + i);
+    }
+
+    static void dot2(const float* l, const float* r, const float* taps, float* out) noexcept
+    {
+        __m128 sl = _mm_setzero_ps(), sr = _mm_setzero_ps();
+        for (std::size_t i = 0; i < TAPS; i += 4) {
+            const __m128 t = _mm_loadu_ps(taps + i);
+            sl = _mm_add_ps(sl, _mm_mul_ps(_mm_loadu_ps(l + i), t));
+            sr = _mm_add_ps(sr, _mm_mul_ps(_mm_loadu_ps(r + i), t));
+        }
+        // both horizontal sums at once
+        const __m128 a = _mm_add_ps(_mm_unpacklo_ps(sl, sr), _mm_unpackhi_ps(sl, sr)); // l0+l2, r0+r2, l1+l3, r1+r3
+        const __m128 b = _mm_add_ps(a, _mm_movehl_ps(a, a));
+        _mm_storel_pi(reinterpret_cast<__m64*>(out), b);
+    }
+};
+
+struct AVX2
+{
+    __attribute__((target("avx2,fma")))
+    static void accumulate(const std::int16_t* in, const std::size_t n, const float gain, float* acc) noexcept
+    {
+        const __m256 g = _mm256_set1_ps(gain);
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            const __m256i s = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+            _mm256_storeu_ps(acc + i, _mm256_fmadd_ps(g, _mm256_cvtepi32_ps(s), _mm256_loadu_ps(acc + i)));
+        }
+        Scalar::accumulate(in + i, n - i, gain, acc + i);
+    }
+
+    __attribute__((target("avx2,fma")))
+    static void dot2(const float* l, const float* r, const float* taps, float* out) noexcept
+    {
+        __m256 sl = _mm256_setzero_ps(), sr = _mm256_setzero_ps();
+        for (std::size_t i = 0; i < TAPS; i += 8) {
+            const __m256 t = _mm256_loadu_ps(taps + i);
+            sl = _mm256_fmadd_ps(_mm256_loadu_ps(l + i), t, sl);
+            sr = _mm256_fmadd_ps(_mm256_loadu_ps(r + i), t, sr);
+        }
+        const __m128 l4 = _mm_add_ps(_mm256_castps256_ps128(sl), _mm256_extractf128_ps(sl, 1));
+        const __m128 r4 = _mm_add_ps(_mm256_castps256_ps128(sr), _mm256_extractf128_ps(sr, 1));
+        const __m128 a = _mm_add_ps(_mm_unpacklo_ps(l4, r4), _mm_unpackhi_ps(l4, r4));
+        const __m128 b = _mm_add_ps(a, _mm_movehl_ps(a, a));
+        _mm_storel_pi(reinterpret_cast<__m64*>(out), b);
+    }
+};
+
+#endif // UTILITY_SIMD_X86
+
+} // namespace Kernel
+
+// One interleaved stereo sample; the ring moves whole frames so L/R never split
+template<typename SampleT>
+struct StereoFrame
+{
+    SampleT left;
+    SampleT right;
+};
+
+// ~0.34 s at 48 kHz
+template<typename SampleT>
+using AudioRing = utility::SpscRing<StereoFrame<SampleT>, 1 << 14>;
+
+struct MixerKernels
+{
+    void (*accumulate)(const std::int16_t*, std::size_t, float, float*) noexcept;
+    void (*dot2)(const float*, const float*, const float*, float*) noexcept;
+};
+
+template<typename KernelT>
+[[nodiscard]] constexpr MixerKernels mixer_kernels() noexcept
+{
+    return MixerKernels{&KernelT::accumulate, &KernelT::dot2};
+}
+
+[[nodiscard]] inline MixerKernels select_mixer_kernels() noexcept
+{
+    return UTILITY_SIMD_SELECT(mixer_kernels<Kernel::Scalar>(), mixer_kernels<Kernel::SSE2>(),
+        mixer_kernels<Kernel::AVX2>(), utility::cpu().avx2 && utility::cpu().fma);
+}
+
+inline const MixerKernels MIXER_KERNELS = select_mixer_kernels();
+
+/** @brief Host side mixer for Output::Channels: per channel volume, then resampling.
+ * @details
+ * The 8 streams of AudioProcessor::read_channels() (already panned and scaled by
+ * NR50/NR51) are summed into left/right with a host volume per channel, so a front end
+ * can mute or solo channels. The sum is resampled to the output rate with a polyphase
+ * windowed sinc filter: PHASES sub-sample positions of TAPS taps each, cut off just
+ * below the lower of the two Nyquist frequencies. One output frame is two TAPS long dot
+ * products against the filter phase nearest its position.
+ *
+ * The kernel (Scalar, SSE2 or AVX2+FMA) is picked once through CPUID.
+ *
+ * SampleT is std::int16_t (clamped) or float (-1..1). Frames are pushed interleaved into
+ * an SPSC ring that the host audio callback drains, e.g. AudioRing<float>.
+ */
+template<typename SampleT>
+class Mixer
+{
+    static_assert(std::is_same_v<SampleT, std::int16_t> || std::is_same_v<SampleT, float>, "Mixer output is s16 or f32.");
+
+public:
+    static constexpr std::size_t TAPS = Kernel::TAPS;
+    static constexpr std::size_t PHASE_BITS = 8;
+    static constexpr std::size_t PHASES = 1 << PHASE_BITS;
+
+    Mixer(const std::uint32_t input_rate, const std::uint32_t output_rate, const MixerKernels kernels = MIXER_KERNELS)
+    : m_kernels{kernels}
+    , m_step{(static_cast<std::uint64_t>(input_rate) << FRAC_BITS) / output_rate}
+    , m_filter(PHASES * TAPS)
+    , m_left(TAPS - 1, 0.0f)
+    , m_right(TAPS - 1, 0.0f)
+    {
+        m_volume.fill(1.0f);
+        design(std::min(1.0, static_cast<double>(output_rate) / input_rate));
+    }
+
+    // Host volume of channel 0-3 (1 = as mixed by NR50/NR51, 0 = muted)
+    void volume(const std::size_t channel, const float gain) noexcept { m_volume[channel] = gain; }
+
+    /** @brief Mixes and resamples `frames` samples of each planar stream into `ring`.
+     * @details
+     * `planar` is laid out as AudioProcessor::read_channels() writes it: 8 blocks of
+     * `frames` samples back to back; a shorter span is rejected and nothing is mixed.
+     * Output frames that do not fit in the ring are dropped. Returns the number of output
+     * frames made.
+     */
+    template<typename RingT>
+    std::size_t process(std::span<const std::int16_t> planar, const std::size_t frames, RingT& ring)
+    {
+        if (planar.size() / 8 < frames)
+            return 0;
+
+        // mix onto the filter history
+        const std::size_t base = m_left.size();
+        m_left.resize(base + frames, 0.0f);
+        m_right.resize(base + frames, 0.0f);
+        for (std::size_t ch = 0; ch < 4; ++ch) {
+            const float gain = m_volume[ch] * SCALE;
+            if (gain == 0.0f)
+                continue;
+            m_kernels.accumulate(planar.data() + (2 * ch) * frames, frames, gain, m_left.data() + base);
+            m_kernels.accumulate(planar.data() + (2 * ch + 1) * frames, frames, gain, m_right.data() + base);
+        }
+
+        // resample: output frame k reads input [position, position + TAPS)
+        m_out.clear();
+        const std::size_t inputs = m_left.size();
+        while ((m_position >> FRAC_BITS) + TAPS <= inputs) {
+            const std::size_t index = static_cast<std::size_t>(m_position >> FRAC_BITS);
+            const std::size_t phase = static_cast<std::size_t>(m_position >> (FRAC_BITS - PHASE_BITS)) & (PHASES - 1);
+            std::array<float, 2> out;
+            m_kernels.dot2(m_left.data() + index, m_right.data() + index, m_filter.data() + phase * TAPS, out.data());
+            m_out.push_back(StereoFrame<SampleT>{convert(out[0]), convert(out[1])});
+            m_position += m_step;
+        }
+
+        // keep only the history the next call still needs
+        const std::size_t consumed = std::min(static_cast<std::size_t>(m_position >> FRAC_BITS), inputs);
+        m_left.erase(m_left.begin(), m_left.begin() + static_cast<std::ptrdiff_t>(consumed));
+        m_right.erase(m_right.begin(), m_right.begin() + static_cast<std::ptrdiff_t>(consumed));
+        m_position -= static_cast<std::uint64_t>(consumed) << FRAC_BITS;
+
+        m_dropped += m_out.size() - ring.try_push(m_out.data(), m_out.size());
+        return m_out.size();
+    }
+
+    // Output frames that did not fit into the ring
+    [[nodiscard]] std::uint64_t dropped() const noexcept { return m_dropped; }
+
+private:
+    static constexpr int FRAC_BITS = 32;
+    static constexpr float SCALE = 1.0f / 32768.0f; // streams are int16, work in -1..1
+
+    // Blackman windowed sinc per phase, each phase normalized to unity gain
+    void design(const double ratio)
+    {
+        const double cutoff = 0.91 * ratio; // of the input Nyquist frequency
+        for (std::size_t phase = 0; phase < PHASES; ++phase) {
+            float* taps = m_filter.data() + phase * TAPS;
+            double total = 0;
+            std::array<double, TAPS> h{};
+            for (std::size_t i = 0; i < TAPS; ++i) {
+                const double x = static_cast<double>(i) - (TAPS / 2 - 1) - static_cast<double>(phase) / PHASES;
+                const double w = (x + TAPS / 2.0) / TAPS;
+                const double window = 0.42 - 0.5 * std::cos(2 * std::numbers::pi * w) + 0.08 * std::cos(4 * std::numbers::pi * w);
+                const double arg = std::numbers::pi * cutoff * x;
+                h[i] = (x == 0 ? 1.0 : std::sin(arg) / arg) * window;
+                total += h[i];
+            }
+            for (std::size_t i = 0; i < TAPS; ++i)
+                taps[i] = static_cast<float>(h[i] / total);
+        }
+    }
+
+    [[nodiscard]] static SampleT convert(const float sample) noexcept
+    {
+        if constexpr (std::is_same_v<SampleT, float>)
+            return std::clamp(sample, -1.0f, 1.0f);
+        else
+            return static_cast<std::int16_t>(std::lrint(std::clamp(sample * 32768.0f, -32768.0f, 32767.0f)));
+    }
+
+    const MixerKernels m_kernels;
+    const std::uint64_t m_step; // input samples per output sample, 32.32 fixed point
+    std::uint64_t m_position = 0;
+    std::uint64_t m_dropped = 0;
+    std::array<float, 4> m_volume{};
+    std::vector<float> m_filter; // PHASES x TAPS
+    std::vector<float> m_left;   // mixed input not yet consumed, starting with TAPS - 1 of history
+    std::vector<float> m_right;
+    std::vector<StereoFrame<SampleT>> m_out;
+};
+
+} // namespace LR35902::APU
+
+#endif // LR35902_APU_MIXER_HPP
@@ -0,0 +1,156 @@
+#ifndef LR35902_MMU_OAM_HPP
+#define LR35902_MMU_OAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <span>
+
+#include "../types.hpp"
+#include "../mmu.hpp"
+#include "../savestate.hpp"
+#include "../PPU/tiles.hpp"
+
+namespace LR35902::MMU
+{
+
+/** @brief Object attribute memory (0xFE00-0xFE9F) with a per-line index of the objects on each line
+ * @details
+ * For every visible line two 40 bit masks (one per object height) record which entries
+ * intersect it. Only a write to an entry's Y byte moves it between lines, so the index is
+ * updated incrementally there and rebuilt once when an OAM DMA completes. The OAM scan of
+ * a line then visits only the objects actually on it instead of all 40.
+ */
+class ObjectAttributeMemory
+{
+public:
+    using Region = MemoryRegions::OAM;
+    static constexpr std::size_t SIZE = 0xA0;
+
+    [[nodiscard]] inline constexpr static bool for_me(const Addr addr) noexcept { return Region::isMember(addr); }
+
+    inline constexpr void write(const Addr addr, const Data data) noexcept
+    {
+        const std::size_t offset = addr - Region::min();
+        if (offset % 4 == 0 && m_data[offset] != data) {
+            const std::size_t index = offset / 4;
+            unlink(index);
+            m_data[offset] = data;
+            link(index);
+        } else {
+            m_data[offset] = data;
+        }
+        if (m_forward.notify)
+            m_forward.notify(m_forward.context, addr, data);
+    }
+
+    [[nodiscard]] inline constexpr Data read(const Addr addr) const noexcept
+    {
+        return m_data[addr - Region::min()];
+    }
+
+    // OAM DMA completion: all 160 bytes replaced at once
+    inline constexpr void dma(std::span<const Data, SIZE> source) noexcept
+    {
+        std::copy(source.begin(), source.end(), m_data.begin());
+        rebuild();
+        if (m_forward.notify)
+            for (std::size_t offset = 0; offset < SIZE; ++offset)
+                m_forward.notify(m_forward.context, static_cast<Addr>(Region::min() + offset), m_data[offset]);
+    }
+
+    [[nodiscard]] inline constexpr PPU::ObjectRAM data() const noexcept { return m_data; }
+
+    /** @brief OAM scan of line ly, equal to PPU::select_objects(data(), ly, tall) */
+    [[nodiscard]] inline constexpr PPU::LineObjects select(const Data ly, const bool tall) const noexcept
+    {
+        PPU::LineObjects line{};
+        if (ly >= PPU::HEIGHT)
+            return line;
+        // lowest bit first is OAM order, which is what the 10 object limit keeps
+        for (std::uint64_t bits = (tall ? m_tall : m_small)[ly]; bits && line.count < PPU::OBJ_PER_LINE; bits &= bits - 1)
+            line.objects[line.count++] = PPU::object(m_data, static_cast<std::size_t>(std::countr_zero(bits)));
+        PPU::sort_by_priority(line);
+        return line;
+    }
+
+    /** @brief Calls (object.*Method)(addr, data) after every write, a DMA as 160 of them
+     * @details
+     * One target; a second call replaces the first, stop_forwarding() removes it.
+     */
+    template<auto Method, typename T>
+    inline constexpr void forward(T& object) noexcept
+    {
+        m_forward = Forward{&object, [](void* context, const Addr addr, const Data data) {
+            (static_cast<T*>(context)->*Method)(addr, data);
+        }};
+    }
+
+    inline constexpr void stop_forwarding() noexcept { m_forward = Forward{}; }
+
+    // The line index is rebuilt after a load
+    void describe(StateLayout& layout)
+    {
+        layout.region(m_data);
+        layout.after_load<&ObjectAttributeMemory::rebuild>(*this);
+    }
+
+private:
+    using Lines = std::array<std::uint64_t, PPU::HEIGHT>;
+
+    struct Forward
+    {
+        void* context = nullptr;
+        void (*notify)(void* context, Addr addr, Data data) = nullptr;
+    };
+
+
+    // Visible lines [first, last) covered by an object at OAM y with the given height
+    static constexpr void span(const Data y, const unsigned height, std::size_t& first, std::size_t& last) noexcept
+    {
+        const int top = static_cast<int>(y) - 16;
+        first = static_cast<std::size_t>(std::clamp(top, 0, static_cast<int>(PPU::HEIGHT)));
+        last = static_cast<std::size_t>(std::clamp(top + static_cast<int>(height), 0, static_cast<int>(PPU::HEIGHT)));
+    }
+
+    static constexpr void mark(Lines& lines, const Data y, const unsigned height, const std::uint64_t bit, const bool set) noexcept
+    {
+        std::size_t first, last;
+        span(y, height, first, last);
+        for (std::size_t ly = first; ly < last; ++ly)
+            lines[ly] = set ? (lines[ly] | bit) : (lines[ly] & ~bit);
+    }
+
+    inline constexpr void link(const std::size_t index) noexcept
+    {
+        const std::uint64_t bit = std::uint64_t{1} << index;
+        mark(m_small, m_data[4 * index], 8, bit, true);
+        mark(m_tall, m_data[4 * index], 16, bit, true);
+    }
+
+    inline constexpr void unlink(const std::size_t index) noexcept
+    {
+        const std::uint64_t bit = std::uint64_t{1} << index;
+        mark(m_small, m_data[4 * index], 8, bit, false);
+        mark(m_tall, m_data[4 * index], 16, bit, false);
+    }
+
+    inline constexpr void rebuild() noexcept
+    {
+        m_small.fill(0);
+        m_tall.fill(0);
+        for (std::size_t index = 0; index < PPU::OBJ_COUNT; ++index)
+            link(index);
+    }
+
+    std::array<Data, SIZE> m_data{};
+    Lines m_small{}; // 8x8 objects
+    Lines m_tall{};  // 8x16 objects
+    Forward m_forward{};
+};
+
+} // namespace LR35902::MMU
+
+#endif // LR35902_MMU_OAM_HPP
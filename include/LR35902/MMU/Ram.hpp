@@ -1,6 +1,8 @@
 #ifndef LR35902_MMU_RAM_HPP
 #define LR35902_MMU_RAM_HPP
 
+#include "../savestate.hpp"
+
 template<typename RegionT>
 class RAM
 {
@@ -17,6 +19,8 @@ public:
         return m_data[addr-Region::min()];
     }
 
+    inline void describe(LR35902::StateLayout& layout) { layout.region(m_data); }
+
 private:
     std::array<Data, Region::DISTANCE> m_data;
 };
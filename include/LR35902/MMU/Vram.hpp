@@ -0,0 +1,111 @@
+#ifndef LR35902_MMU_VRAM_HPP
+#define LR35902_MMU_VRAM_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <span>
+
+#include "../types.hpp"
+#include "../mmu.hpp"
+#include "../savestate.hpp"
+
+namespace LR35902::MMU
+{
+
+/** @brief Video RAM (0x8000-0x9FFF) with per-tile dirty tracking
+ * @details
+ * Every write to tile data (0x8000-0x97FF) sets the tile's bit in a dirty bitmap so the
+ * PPU tile cache only re-decodes tiles that actually changed. Tile maps are not tracked.
+ * CGB has 2 banks selected through VBK.
+ */
+template<std::size_t BanksV = 1>
+class VideoRAM
+{
+public:
+    using Region = MemoryRegions::VRAM;
+    static constexpr std::size_t BANKS = BanksV;
+    static constexpr std::size_t SIZE = 0x2000;
+    static constexpr std::size_t TILES = 384; // per bank
+    static constexpr std::size_t DIRTY_WORDS = BANKS * TILES / 64;
+
+    [[nodiscard]] inline constexpr static bool for_me(const Addr addr) noexcept { return Region::isMember(addr); }
+
+    inline constexpr void write(const Addr addr, const Data data) noexcept
+    {
+        const std::size_t offset = addr - Region::min();
+        m_data[m_bank][offset] = data;
+        if (offset < TILES * 16) {
+            const std::size_t tile = m_bank * TILES + offset / 16;
+            m_dirty[tile / 64] |= std::uint64_t{1} << (tile % 64);
+        }
+        if (m_forward.notify && m_bank == 0)
+            m_forward.notify(m_forward.context, addr, data);
+    }
+
+    [[nodiscard]] inline constexpr Data read(const Addr addr) const noexcept
+    {
+        return m_data[m_bank][addr - Region::min()];
+    }
+
+    // VBK, only bit 0 is used
+    inline constexpr void select(const Data vbk) noexcept
+    {
+        m_bank = (vbk & 1) % BANKS;
+    }
+
+    [[nodiscard]] inline constexpr std::span<const Data, SIZE> bank(const std::size_t index) const noexcept
+    {
+        return m_data[index];
+    }
+
+    // Consumers clear the bits they have handled
+    [[nodiscard]] inline constexpr std::span<std::uint64_t, DIRTY_WORDS> dirty() noexcept
+    {
+        return m_dirty;
+    }
+
+    /** @brief Calls (object.*Method)(addr, data) after every write to bank 0
+     * @details
+     * Keeps a copy of bank 0 elsewhere current, e.g. a PPU::RenderThread's shadow VRAM.
+     * One target; a second call replaces the first, stop_forwarding() removes it.
+     */
+    template<auto Method, typename T>
+    inline constexpr void forward(T& object) noexcept
+    {
+        m_forward = Forward{&object, [](void* context, const Addr addr, const Data data) {
+            (static_cast<T*>(context)->*Method)(addr, data);
+        }};
+    }
+
+    inline constexpr void stop_forwarding() noexcept { m_forward = Forward{}; }
+
+    void describe(StateLayout& layout)
+    {
+        layout.regions(m_data, m_bank);
+        layout.after_load<&VideoRAM::loaded>(*this);
+    }
+
+private:
+    struct Forward
+    {
+        void* context = nullptr;
+        void (*notify)(void* context, Addr addr, Data data) = nullptr;
+    };
+
+    // Every tile may differ from what the consumers decoded
+    inline constexpr void loaded() noexcept { m_dirty.fill(~std::uint64_t{0}); }
+
+    std::array<std::array<Data, SIZE>, BANKS> m_data{};
+    std::array<std::uint64_t, DIRTY_WORDS> m_dirty = [] {
+        std::array<std::uint64_t, DIRTY_WORDS> dirty{};
+        dirty.fill(~std::uint64_t{0}); // nothing is decoded yet
+        return dirty;
+    }();
+    std::size_t m_bank = 0;
+    Forward m_forward{};
+};
+
+} // namespace LR35902::MMU
+
+#endif // LR35902_MMU_VRAM_HPP
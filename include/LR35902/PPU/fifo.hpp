@@ -0,0 +1,229 @@
+#ifndef LR35902_PPU_FIFO_HPP
+#define LR35902_PPU_FIFO_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+#include "tiles.hpp"
+#include "scanline.hpp"
+
+namespace LR35902::PPU
+{
+
+/** @brief Dot-by-dot pixel FIFO model of mode 3.
+ * @details
+ * A background/window fetcher (tile number, low plane, high plane, push; 2 dots each)
+ * feeds an 8+ pixel FIFO that shifts one pixel per dot. LCDC, SCX, SCY, WX and the
+ * palettes are read through a pointer to the live registers at the moment the hardware
+ * reads them, so writes made in the middle of mode 3 show up mid-line.
+ *
+ * The model is advanced lazily: the front end only calls advance() when a register is
+ * about to change during mode 3 and finish() at the end of the mode.
+ */
+class PixelFifo
+{
+public:
+    // `objects` is the OAM scan result for live.LY
+    void begin(VideoRAM vram, const LineObjects& objects, const LineRegisters& live) noexcept
+    {
+        m_vram = vram.data();
+        m_regs = &live;
+        m_objects = objects;
+        m_next_object = 0;
+
+        m_x = 0;
+        m_discard = live.SCX % 8;
+        m_stall = 0;
+        m_window = false;
+        m_bg = {};
+        m_obj = {};
+        m_fetch = {};
+    }
+
+    void advance(std::size_t dots) noexcept
+    {
+        while (dots-- && !done())
+            tick();
+    }
+
+    void finish(Line& out) noexcept
+    {
+        while (!done())
+            tick();
+        out = m_line;
+    }
+
+    [[nodiscard]] bool done() const noexcept { return m_x >= WIDTH; }
+
+private:
+    enum class Step : std::uint8_t { Tile, Low, High, Push };
+
+    struct Fetcher
+    {
+        Step step = Step::Tile;
+        bool odd = false;   // the fetcher runs at half the dot clock
+        unsigned column = 0;
+        std::size_t row = 0;
+        Data lo = 0;
+        Data hi = 0;
+    };
+
+    struct BackgroundFifo
+    {
+        std::array<Data, 16> pixels{};
+        std::size_t head = 0;
+        std::size_t size = 0;
+
+        void push(const Data pixel) noexcept { pixels[(head + size++) % 16] = pixel; }
+        Data pop() noexcept { --size; return pixels[head++ % 16]; }
+        void clear() noexcept { head = 0; size = 0; }
+    };
+
+    struct ObjectPixel
+    {
+        Data color = 0;
+        Data attr = 0;
+    };
+
+    // Slot i holds the object pixel for screen x + i
+    struct ObjectFifo
+    {
+        std::array<ObjectPixel, 8> pixels{};
+        std::size_t head = 0;
+
+        ObjectPixel& at(const std::size_t i) noexcept { return pixels[(head + i) % 8]; }
+        ObjectPixel pop() noexcept
+        {
+            const ObjectPixel pixel = pixels[head % 8];
+            pixels[head++ % 8] = {};
+            return pixel;
+        }
+    };
+
+    void tick() noexcept
+    {
+        if (m_stall) {
+            --m_stall;
+            return;
+        }
+        fetch();
+        if (m_bg.size)
+            shift();
+    }
+
+    void fetch() noexcept
+    {
+        const LineRegisters& regs = *m_regs;
+        if (m_fetch.step != Step::Push && (m_fetch.odd = !m_fetch.odd))
+            return;
+
+        switch (m_fetch.step) {
+        case Step::Tile: {
+            std::size_t map;
+            unsigned column, y;
+            if (m_window) {
+                map = map_offset(regs.LCDC & LCDCBit::WinMap);
+                column = m_fetch.column;
+                y = regs.window_line;
+            } else {
+                map = map_offset(regs.LCDC & LCDCBit::BGMap);
+                column = regs.SCX / 8 + m_fetch.column;
+                y = (regs.LY + regs.SCY) & 0xFF;
+            }
+            const Data tile = vram()[map + (y / 8) * 32 + (column & 31)];
+            m_fetch.row = tile_row_offset(regs.LCDC, tile, y % 8);
+            m_fetch.step = Step::Low;
+            break;
+        }
+        case Step::Low:
+            m_fetch.lo = vram()[m_fetch.row];
+            m_fetch.step = Step::High;
+            break;
+        case Step::High:
+            m_fetch.hi = vram()[m_fetch.row + 1];
+            m_fetch.step = Step::Push;
+            break;
+        case Step::Push:
+            if (m_bg.size)
+                break;
+            for (unsigned x = 0; x < 8; ++x)
+                m_bg.push(pixel(m_fetch.lo, m_fetch.hi, x));
+            ++m_fetch.column;
+            m_fetch.step = Step::Tile;
+            break;
+        }
+    }
+
+    void shift() noexcept
+    {
+        const LineRegisters& regs = *m_regs;
+
+        if (m_discard) {
+            m_bg.pop();
+            --m_discard;
+            return;
+        }
+
+        // window start: restart the fetcher on the window map
+        if (!m_window && window_visible(regs) && m_x + 7 >= regs.WX) {
+            m_window = true;
+            m_bg.clear();
+            m_fetch = {};
+            m_discard = m_x + 7 - regs.WX; // only non-zero for WX < 7
+            return;
+        }
+
+        // object fetch, the whole pipeline stalls while the object row is read
+        if ((regs.LCDC & LCDCBit::OBJEnable) && m_next_object < m_objects.count
+            && m_objects.objects[m_next_object].x <= m_x + 8) {
+            load(m_objects.objects[m_next_object++]);
+            m_stall = 6;
+            return;
+        }
+
+        const bool enabled = regs.LCDC & LCDCBit::BGEnable;
+        const Data bg = enabled ? m_bg.pop() : (m_bg.pop(), Data{0});
+        const ObjectPixel obj = m_obj.pop();
+
+        Data color = enabled ? shade(regs.BGP, bg) : Data{0};
+        if (obj.color && (regs.LCDC & LCDCBit::OBJEnable) && (!(obj.attr & OBJAttr::Priority) || bg == 0))
+            color = shade((obj.attr & OBJAttr::Palette) ? regs.OBP1 : regs.OBP0, obj.color);
+        m_line[m_x++] = color;
+    }
+
+    // Merge an object row into the object FIFO. Earlier objects keep their opaque pixels.
+    void load(const Object& obj) noexcept
+    {
+        const auto [lo, hi] = object_row(vram(), obj, m_regs->LY, m_regs->LCDC & LCDCBit::OBJSize);
+        for (unsigned px = 0; px < 8; ++px) {
+            const int slot = obj.x - 8 + static_cast<int>(px) - static_cast<int>(m_x);
+            if (slot < 0 || slot >= 8)
+                continue;
+            ObjectPixel& dst = m_obj.at(static_cast<std::size_t>(slot));
+            const Data color = pixel(lo, hi, px);
+            if (dst.color == 0 && color != 0)
+                dst = {color, obj.attr};
+        }
+    }
+
+    [[nodiscard]] VideoRAM vram() const noexcept { return VideoRAM{m_vram, VideoRAM::extent}; }
+
+    const Data* m_vram = nullptr;
+    const LineRegisters* m_regs = nullptr;
+    LineObjects m_objects{};
+    std::size_t m_next_object = 0;
+
+    unsigned m_x = 0;
+    unsigned m_discard = 0;
+    unsigned m_stall = 0;
+    bool m_window = false;
+    Fetcher m_fetch{};
+    BackgroundFifo m_bg{};
+    ObjectFifo m_obj{};
+    Line m_line{};
+};
+
+} // namespace LR35902::PPU
+
+#endif // LR35902_PPU_FIFO_HPP
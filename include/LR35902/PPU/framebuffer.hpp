@@ -0,0 +1,212 @@
+#ifndef LR35902_PPU_FRAMEBUFFER_HPP
+#define LR35902_PPU_FRAMEBUFFER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <span>
+
+#include "tiles.hpp"
+#include "scanline.hpp"
+#include "palettes.hpp"
+
+namespace LR35902::PPU
+{
+
+enum class PixelFormat : std::uint8_t
+{
+    Shade,    // 1 byte per pixel, the 2 bit DMG shade (0 = lightest)
+    Gray8,    // 1 byte per pixel, 0xFF = white
+    RGBA8888, // 4 bytes per pixel, bytes R, G, B, A in memory order
+    RGB565,   // 2 bytes per pixel, native endian uint16_t
+};
+
+[[nodiscard]] constexpr std::size_t bytes_per_pixel(const PixelFormat format) noexcept
+{
+    switch (format) {
+    case PixelFormat::Shade:    return 1;
+    case PixelFormat::Gray8:    return 1;
+    case PixelFormat::RGBA8888: return 4;
+    case PixelFormat::RGB565:   return 2;
+    }
+    return 4;
+}
+
+struct Color
+{
+    Data r, g, b;
+};
+
+// Host colors for shades 0-3
+using ShadeColors = std::array<Color, 4>;
+
+static constexpr ShadeColors GRAYS { Color{0xFF, 0xFF, 0xFF}, {0xAA, 0xAA, 0xAA}, {0x55, 0x55, 0x55}, {0x00, 0x00, 0x00} };
+
+/** @brief A completed frame as seen by a consumer, valid until the next acquire() */
+struct FrameView
+{
+    std::span<const std::byte> pixels;
+    PixelFormat format;
+    std::size_t pitch;    // bytes per row
+    std::uint64_t number; // frames published before this one
+};
+
+/** @brief Three preallocated, 64 byte aligned frames shared by one producer and one consumer.
+ * @details
+ * The producer (PPU or RenderThread) converts each line straight into the back buffer and
+ * publish() swaps it with the ready buffer. acquire() swaps the ready buffer with the front
+ * buffer when a newer frame exists. Both swaps are one atomic exchange of a packed index, so
+ * neither side ever blocks or copies a frame: a slow consumer just skips frames (counted by
+ * overwritten()) and a fast one sees the same frame again.
+ */
+class FrameBuffers
+{
+public:
+    static constexpr std::size_t BUFFERS = 3;
+    static constexpr std::size_t ALIGNMENT = 64;
+    static constexpr std::size_t MAX_BYTES = WIDTH * HEIGHT * 4;
+
+    explicit FrameBuffers(const PixelFormat format = PixelFormat::Shade, const ShadeColors& colors = GRAYS) noexcept
+    : m_format{format}
+    , m_pitch{WIDTH * bytes_per_pixel(format)}
+    {
+        palette(colors);
+    }
+
+    FrameBuffers(const FrameBuffers&) = delete;
+    FrameBuffers& operator=(const FrameBuffers&) = delete;
+
+    [[nodiscard]] PixelFormat format() const noexcept { return m_format; }
+    [[nodiscard]] std::size_t pitch() const noexcept { return m_pitch; }
+
+    // Producer side. Takes effect from the next line written.
+    void palette(const ShadeColors& colors) noexcept
+    {
+        for (std::size_t shade = 0; shade < 4; ++shade) {
+            const Color c = colors[shade];
+            const Data gray = static_cast<Data>((c.r * 77 + c.g * 150 + c.b * 29) >> 8);
+            const std::uint16_t rgb565 = static_cast<std::uint16_t>((c.r >> 3) << 11 | (c.g >> 2) << 5 | (c.b >> 3));
+            switch (m_format) {
+            case PixelFormat::Shade:    m_lut[shade] = static_cast<std::uint32_t>(shade); break;
+            case PixelFormat::Gray8:    m_lut[shade] = gray; break;
+            case PixelFormat::RGB565:   m_lut[shade] = rgb565; break;
+            case PixelFormat::RGBA8888: {
+                const std::array<Data, 4> rgba { c.r, c.g, c.b, 0xFF };
+                std::memcpy(&m_lut[shade], rgba.data(), 4);
+                break;
+            }
+            }
+        }
+    }
+
+    // Producer side: converts one line of shades into row `ly` of the back buffer
+    void line(const std::size_t ly, const Line& shades) noexcept
+    {
+        std::byte* row = m_buffers[m_back].pixels.data() + ly * m_pitch;
+        switch (m_format) {
+        case PixelFormat::Shade:
+            std::memcpy(row, shades.data(), WIDTH);
+            break;
+        case PixelFormat::Gray8:
+            convert<std::uint8_t>(shades, row);
+            break;
+        case PixelFormat::RGB565:
+            convert<std::uint16_t>(shades, row);
+            break;
+        case PixelFormat::RGBA8888:
+            convert<std::uint32_t>(shades, row);
+            break;
+        }
+    }
+
+    // Producer side: CGB line of palette entry indices (0-63), gathered from the pre-converted LUTs
+    void line(const std::size_t ly, const Line& entries, const ColorPalettes& palettes) noexcept
+    {
+        std::byte* row = m_buffers[m_back].pixels.data() + ly * m_pitch;
+        switch (m_format) {
+        case PixelFormat::Shade:
+            std::memcpy(row, entries.data(), WIDTH);
+            break;
+        case PixelFormat::Gray8:
+            palettes.resolve(entries.data(), WIDTH, reinterpret_cast<Data*>(row));
+            break;
+        case PixelFormat::RGB565:
+            palettes.resolve(entries.data(), WIDTH, reinterpret_cast<std::uint16_t*>(row));
+            break;
+        case PixelFormat::RGBA8888:
+            palettes.resolve(entries.data(), WIDTH, reinterpret_cast<std::uint32_t*>(row));
+            break;
+        }
+    }
+
+    // Producer side: the back buffer holds a complete frame
+    void publish() noexcept
+    {
+        m_buffers[m_back].number = m_published++;
+        const std::uint8_t old = m_ready.exchange(static_cast<std::uint8_t>(m_back | FRESH), std::memory_order_acq_rel);
+        m_back = old & INDEX;
+        m_overwritten += (old & FRESH) != 0;
+    }
+
+    // Producer side: frames replaced by a newer one before the consumer acquired them
+    [[nodiscard]] std::uint64_t overwritten() const noexcept { return m_overwritten; }
+
+    // Consumer side: latest completed frame, or the previously acquired one if nothing newer exists
+    [[nodiscard]] FrameView acquire() noexcept
+    {
+        if (m_ready.load(std::memory_order_relaxed) & FRESH) {
+            const std::uint8_t old = m_ready.exchange(static_cast<std::uint8_t>(m_front), std::memory_order_acq_rel);
+            m_front = old & INDEX;
+        }
+        const Buffer& front = m_buffers[m_front];
+        return FrameView{std::span<const std::byte>{front.pixels.data(), HEIGHT * m_pitch}, m_format, m_pitch, front.number};
+    }
+
+    // Consumer side: a frame newer than the last acquire() is ready
+    [[nodiscard]] bool fresh() const noexcept
+    {
+        return m_ready.load(std::memory_order_acquire) & FRESH;
+    }
+
+private:
+    static constexpr std::uint8_t INDEX = 0b011;
+    static constexpr std::uint8_t FRESH = 0b100;
+
+    struct alignas(ALIGNMENT) Buffer
+    {
+        std::array<std::byte, MAX_BYTES> pixels{};
+        std::uint64_t number = 0;
+    };
+
+    template<typename Pixel>
+    void convert(const Line& shades, std::byte* row) const noexcept
+    {
+        for (std::size_t x = 0; x < WIDTH; ++x) {
+            const Pixel pixel = static_cast<Pixel>(m_lut[shades[x] & 0b11]);
+            std::memcpy(row + x * sizeof(Pixel), &pixel, sizeof(Pixel));
+        }
+    }
+
+    const PixelFormat m_format;
+    const std::size_t m_pitch;
+    std::array<std::uint32_t, 4> m_lut{};
+
+    std::array<Buffer, BUFFERS> m_buffers{};
+
+    // producer
+    std::size_t m_back = 0;
+    std::uint64_t m_published = 0;
+    std::uint64_t m_overwritten = 0;
+
+    // shared: index of the ready buffer | FRESH
+    alignas(ALIGNMENT) std::atomic<std::uint8_t> m_ready{1};
+
+    // consumer
+    alignas(ALIGNMENT) std::size_t m_front = 2;
+};
+
+} // namespace LR35902::PPU
+
+#endif // LR35902_PPU_FRAMEBUFFER_HPP
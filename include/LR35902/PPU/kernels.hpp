@@ -0,0 +1,187 @@
+#ifndef LR35902_PPU_KERNELS_HPP
+#define LR35902_PPU_KERNELS_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include <utility/simd.hpp>
+
+#include "tiles.hpp"
+
+/***
+ * Line kernels used by the scanline renderer. Every kernel provides:
+ *   - decode(lo, hi, tiles, out)   planar 2bpp rows -> one color index (0-3) per byte, 8 per tile
+ *   - palette(index, n, bgp, out)  color index -> shade through a DMG palette register
+ *   - blend(dst, src, mask, n)     dst = mask ? src : dst (mask bytes are 0x00 or 0xFF)
+ *
+ * The SIMD kernels handle whole groups of tiles and fall back to Scalar for the tail.
+ */
+
+namespace LR35902::PPU::Kernel
+{
+
+struct Scalar
+{
+    // spread[b][i] = bit (7 - i) of b
+    static constexpr std::array<std::array<Data, 8>, 256> spread = [] {
+        std::array<std::array<Data, 8>, 256> spread{};
+        for (unsigned b = 0; b < 256; ++b)
+            for (unsigned i = 0; i < 8; ++i)
+                spread[b][i] = (b >> (7 - i)) & 1;
+        return spread;
+    }();
+
+    static void decode(const Data* lo, const Data* hi, const std::size_t tiles, Data* out) noexcept
+    {
+        for (std::size_t t = 0; t < tiles; ++t) {
+            std::uint64_t l, h;
+            std::memcpy(&l, spread[lo[t]].data(), 8);
+            std::memcpy(&h, spread[hi[t]].data(), 8);
+            const std::uint64_t row = l | (h << 1); // no byte carries into its neighbour
+            std::memcpy(out + 8 * t, &row, 8);
+        }
+    }
+
+    static void palette(const Data* index, const std::size_t n, const Data bgp, Data* out) noexcept
+    {
+        const std::array<Data, 4> lut { shade(bgp, 0), shade(bgp, 1), shade(bgp, 2), shade(bgp, 3) };
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = lut[index[i] & 0b11];
+    }
+
+    static void blend(Data* dst, const Data* src, const Data* mask, const std::size_t n) noexcept
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            dst[i] = static_cast<Data>((src[i] & mask[i]) | (dst[i] & ~mask[i]));
+    }
+};
+
+#if UTILITY_SIMD_X86
+
+struct SSE2
+{
+    // 2 tiles (16 pixels) per iteration. Each plane byte is replicated 8 times with the
+    // unpack ladder, tested against its pixel's bit and turned into 0/1 (lo) and 0/2 (hi).
+    static void decode(const Data* lo, const Data* hi, const std::size_t tiles, Data* out) noexcept
+    {
+        const __m128i bits = _mm_setr_epi8(
+            char(0x80), 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+            char(0x80), 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+        const __m128i one = _mm_set1_epi8(1);
+        const __m128i two = _mm_set1_epi8(2);
+
+        std::size_t t = 0;
+        for (; t + 2 <= tiles; t += 2) {
+            __m128i l = _mm_cvtsi32_si128(lo[t] | lo[t + 1] << 8);
+            __m128i h = _mm_cvtsi32_si128(hi[t] | hi[t + 1] << 8);
+            l = _mm_unpacklo_epi8(l, l);  // l0 l0 l1 l1
+            h = _mm_unpacklo_epi8(h, h);
+            l = _mm_unpacklo_epi16(l, l); // l0 x4 l1 x4
+            h = _mm_unpacklo_epi16(h, h);
+            l = _mm_unpacklo_epi32(l, l); // l0 x8 l1 x8
+            h = _mm_unpacklo_epi32(h, h);
+            const __m128i pl = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(l, bits), bits), one);
+            const __m128i ph = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(h, bits), bits), two);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8 * t), _mm_or_si128(pl, ph));
+        }
+        Scalar::decode(lo + t, hi + t, tiles - t, out + 8 * t);
+    }
+
+    // No byte shuffle in SSE2: select each of the 4 shades with a compare mask
+    static void palette(const Data* index, const std::size_t n, const Data bgp, Data* out) noexcept
+    {
+        __m128i shades[4];
+        for (Data c = 0; c < 4; ++c)
+            shades[c] = _mm_set1_epi8(static_cast<char>(shade(bgp, c)));
+
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            const __m128i idx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(index + i));
+            __m128i r = _mm_setzero_si128();
+            for (Data c = 0; c < 4; ++c)
+                r = _mm_or_si128(r, _mm_and_si128(_mm_cmpeq_epi8(idx, _mm_set1_epi8(static_cast<char>(c))), shades[c]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), r);
+        }
+        Scalar::palette(index + i, n - i, bgp, out + i);
+    }
+
+    static void blend(Data* dst, const Data* src, const Data* mask, const std::size_t n) noexcept
+    {
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+            const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(_mm_and_si128(m, s), _mm_andnot_si128(m, d)));
+        }
+        Scalar::blend(dst + i, src + i, mask + i, n - i);
+    }
+};
+
+struct AVX2
+{
+    // 4 tiles (32 pixels) per iteration. The 4 plane bytes are broadcast to both lanes and
+    // vpshufb replicates byte k into pixels 8k-8k+7.
+    __attribute__((target("avx2")))
+    static void decode(const Data* lo, const Data* hi, const std::size_t tiles, Data* out) noexcept
+    {
+        const __m256i bits = _mm256_set1_epi64x(0x0102040810204080LL);
+        const __m256i spread = _mm256_setr_epi8(
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+        const __m256i one = _mm256_set1_epi8(1);
+        const __m256i two = _mm256_set1_epi8(2);
+
+        std::size_t t = 0;
+        for (; t + 4 <= tiles; t += 4) {
+            std::int32_t l4, h4;
+            std::memcpy(&l4, lo + t, 4);
+            std::memcpy(&h4, hi + t, 4);
+            const __m256i l = _mm256_shuffle_epi8(_mm256_set1_epi32(l4), spread);
+            const __m256i h = _mm256_shuffle_epi8(_mm256_set1_epi32(h4), spread);
+            const __m256i pl = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(l, bits), bits), one);
+            const __m256i ph = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(h, bits), bits), two);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 8 * t), _mm256_or_si256(pl, ph));
+        }
+        Scalar::decode(lo + t, hi + t, tiles - t, out + 8 * t);
+    }
+
+    // The palette is a 4 entry table, vpshufb does the whole lookup
+    __attribute__((target("avx2")))
+    static void palette(const Data* index, const std::size_t n, const Data bgp, Data* out) noexcept
+    {
+        const char s0 = static_cast<char>(shade(bgp, 0)), s1 = static_cast<char>(shade(bgp, 1));
+        const char s2 = static_cast<char>(shade(bgp, 2)), s3 = static_cast<char>(shade(bgp, 3));
+        const __m256i lut = _mm256_setr_epi8(
+            s0, s1, s2, s3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            s0, s1, s2, s3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+        std::size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            const __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_shuffle_epi8(lut, idx));
+        }
+        Scalar::palette(index + i, n - i, bgp, out + i);
+    }
+
+    __attribute__((target("avx2")))
+    static void blend(Data* dst, const Data* src, const Data* mask, const std::size_t n) noexcept
+    {
+        std::size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+            const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            const __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_blendv_epi8(d, s, m));
+        }
+        Scalar::blend(dst + i, src + i, mask + i, n - i);
+    }
+};
+
+#endif // UTILITY_SIMD_X86
+
+} // namespace LR35902::PPU::Kernel
+
+#endif // LR35902_PPU_KERNELS_HPP
@@ -0,0 +1,176 @@
+#ifndef LR35902_PPU_PALETTES_HPP
+#define LR35902_PPU_PALETTES_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include <utility/simd.hpp>
+
+#include "../types.hpp"
+#include "../io.hpp"
+#include "../savestate.hpp"
+#include "kernels.hpp"
+
+namespace LR35902::PPU
+{
+
+/** @brief CGB palette RAM (BGPI/BGPD, OBPI/OBPD) with every color pre-converted for the host.
+ * @details
+ * 8 BG + 8 OBJ palettes of 4 colors are 64 entries. A CGB line is produced as one byte per
+ * pixel holding the entry index (palette * 4 + color, OBJ entries from 32), so the final
+ * stage is a gather from the host LUTs instead of a 15 bit -> 24 bit conversion per pixel.
+ * An entry is re-converted only when one of its two bytes is written.
+ *
+ * Color correction approximates the CGB LCD (desaturated, green shifted) instead of
+ * scaling each 5 bit channel linearly.
+ */
+class ColorPalettes
+{
+public:
+    static constexpr std::size_t ENTRIES = 64;
+    static constexpr std::size_t OBJ_BASE = 32;
+
+    explicit ColorPalettes(IO::RegisterBank& io) noexcept
+    : m_io{io}
+    {
+        m_io.observe<IO::BGPI, &ColorPalettes::on_index<IO::BGPI, IO::BGPD, 0>>(*this);
+        m_io.observe<IO::BGPD, &ColorPalettes::on_data<IO::BGPI, IO::BGPD, 0>>(*this);
+        m_io.observe<IO::OBPI, &ColorPalettes::on_index<IO::OBPI, IO::OBPD, 1>>(*this);
+        m_io.observe<IO::OBPD, &ColorPalettes::on_data<IO::OBPI, IO::OBPD, 1>>(*this);
+        m_ram.fill(0xFF); // white, as after power on
+        convert_all();
+    }
+
+    ColorPalettes(const ColorPalettes&) = delete; // observers point at this
+    ColorPalettes& operator=(const ColorPalettes&) = delete;
+
+    void correction(const bool enabled) noexcept
+    {
+        m_correct = enabled;
+        convert_all();
+    }
+
+    // Palette RAM only, the LUTs are converted again after a load
+    void describe(StateLayout& layout)
+    {
+        layout.region(m_ram);
+        layout.after_load<&ColorPalettes::convert_all>(*this);
+    }
+
+    [[nodiscard]] const std::array<std::uint32_t, ENTRIES>& rgba() const noexcept { return m_rgba; }
+    [[nodiscard]] const std::array<std::uint16_t, ENTRIES>& rgb565() const noexcept { return m_rgb565; }
+    [[nodiscard]] const std::array<Data, ENTRIES>& gray() const noexcept { return m_gray; }
+
+    // out[i] = rgba()[index[i]]
+    void resolve(const Data* index, const std::size_t n, std::uint32_t* out) const noexcept
+    {
+        std::size_t i = 0;
+#if UTILITY_SIMD_X86
+        if (s_avx2)
+            i = gather_avx2(index, n, out);
+#endif
+        for (; i < n; ++i)
+            out[i] = m_rgba[index[i] & (ENTRIES - 1)];
+    }
+
+    // out[i] = rgb565()[index[i]]
+    void resolve(const Data* index, const std::size_t n, std::uint16_t* out) const noexcept
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = m_rgb565[index[i] & (ENTRIES - 1)];
+    }
+
+    // out[i] = gray()[index[i]]
+    void resolve(const Data* index, const std::size_t n, Data* out) const noexcept
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = m_gray[index[i] & (ENTRIES - 1)];
+    }
+
+private:
+    // BGPI/OBPI changed: BGPD/OBPD reads the byte at the new index
+    template<typename IndexRegister, typename DataRegister, std::size_t Set>
+    void on_index(const Data, const Data) noexcept
+    {
+        const std::size_t byte = m_io.get<typename IndexRegister::Index>();
+        m_io.store<DataRegister>(m_ram[Set * ENTRIES + byte]);
+    }
+
+    template<typename IndexRegister, typename DataRegister, std::size_t Set>
+    void on_data(const Data, const Data now) noexcept
+    {
+        const std::size_t byte = m_io.get<typename IndexRegister::Index>();
+        m_ram[Set * ENTRIES + byte] = now;
+        convert(Set * OBJ_BASE + byte / 2);
+
+        if (m_io.get<typename IndexRegister::AutoIncrement>()) {
+            const std::size_t next = (byte + 1) % ENTRIES;
+            m_io.set<typename IndexRegister::Index>(static_cast<Data>(next));
+            m_io.store<DataRegister>(m_ram[Set * ENTRIES + next]);
+        }
+    }
+
+    void convert_all() noexcept
+    {
+        for (std::size_t entry = 0; entry < ENTRIES; ++entry)
+            convert(entry);
+    }
+
+    // entry: 0-31 BG, 32-63 OBJ. Two little endian bytes: 0bbbbbgg gggrrrrr
+    void convert(const std::size_t entry) noexcept
+    {
+        const std::size_t byte = (entry / OBJ_BASE) * ENTRIES + (entry % OBJ_BASE) * 2;
+        const unsigned color = m_ram[byte] | m_ram[byte + 1] << 8;
+        const unsigned r5 = color & 0x1F;
+        const unsigned g5 = (color >> 5) & 0x1F;
+        const unsigned b5 = (color >> 10) & 0x1F;
+
+        unsigned r, g, b;
+        if (m_correct) {
+            r = std::min(960u, r5 * 26 + g5 * 4 + b5 * 2) >> 2;
+            g = std::min(960u, g5 * 24 + b5 * 8) >> 2;
+            b = std::min(960u, r5 * 6 + g5 * 4 + b5 * 22) >> 2;
+        } else {
+            r = r5 << 3 | r5 >> 2;
+            g = g5 << 3 | g5 >> 2;
+            b = b5 << 3 | b5 >> 2;
+        }
+
+        const std::array<Data, 4> rgba { Data(r), Data(g), Data(b), 0xFF };
+        std::memcpy(&m_rgba[entry], rgba.data(), 4);
+        m_rgb565[entry] = static_cast<std::uint16_t>((r >> 3) << 11 | (g >> 2) << 5 | (b >> 3));
+        m_gray[entry] = static_cast<Data>((r * 77 + g * 150 + b * 29) >> 8);
+    }
+
+#if UTILITY_SIMD_X86
+    // 8 pixels per iteration: widen 8 indices to 32 bit and gather straight from the LUT
+    __attribute__((target("avx2")))
+    std::size_t gather_avx2(const Data* index, const std::size_t n, std::uint32_t* out) const noexcept
+    {
+        const __m256i mask = _mm256_set1_epi32(ENTRIES - 1);
+        const int* lut = reinterpret_cast<const int*>(m_rgba.data());
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            const __m256i idx = _mm256_and_si256(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(index + i))), mask);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_i32gather_epi32(lut, idx, 4));
+        }
+        return i;
+    }
+
+    static inline const bool s_avx2 = utility::cpu().avx2;
+#endif
+
+    IO::RegisterBank& m_io;
+    bool m_correct = false;
+    std::array<Data, 2 * ENTRIES> m_ram{}; // BG bytes 0x00-0x3F, OBJ 0x40-0x7F
+    std::array<std::uint32_t, ENTRIES> m_rgba{};
+    std::array<std::uint16_t, ENTRIES> m_rgb565{};
+    std::array<Data, ENTRIES> m_gray{};
+};
+
+} // namespace LR35902::PPU
+
+#endif // LR35902_PPU_PALETTES_HPP
@@ -0,0 +1,455 @@
+#ifndef LR35902_PPU_PPU_HPP
+#define LR35902_PPU_PPU_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+#include "../types.hpp"
+#include "../mmu.hpp"
+#include "../state.hpp"
+#include "../scheduler.hpp"
+#include "../interrupts.hpp"
+#include "../savestate.hpp"
+#include "../MMU/Vram.hpp"
+#include "../MMU/Oam.hpp"
+#include "tiles.hpp"
+#include "scanline.hpp"
+#include "tile_cache.hpp"
+#include "fifo.hpp"
+#include "render_thread.hpp"
+#include "framebuffer.hpp"
+
+namespace LR35902::PPU
+{
+
+/** @brief STAT bits 0-1 */
+enum class Mode : Data
+{
+    HBlank   = 0,
+    VBlank   = 1,
+    OAMScan  = 2,
+    Transfer = 3,
+};
+
+/** @brief How mode 3 is drawn
+ * @details
+ * Line renders the whole line from the registers latched when mode 3 starts (fast, see
+ * Scanline). Fifo runs the dot accurate PixelFifo so writes made during mode 3 take effect
+ * mid-line. Auto uses Line and switches to Fifo for the frames after the game was seen
+ * writing a fetcher register during mode 3.
+ */
+enum class Renderer : std::uint8_t
+{
+    Auto,
+    Line,
+    Fifo,
+};
+
+static constexpr Cycle LINE_DOTS = 456;
+static constexpr Cycle OAM_SCAN_DOTS = 80;
+static constexpr Cycle TRANSFER_DOTS = 172; // minimum, see PixelProcessor::transfer_length()
+static constexpr Data LINES = 154;          // 144 visible + 10 VBlank
+
+/** @brief Mode timing, LY and STAT interrupts behind the LCD registers in IO::RegisterBank.
+ * @details
+ * The front end owns everything both renderers share: the mode state machine driven by
+ * Event::PPU, LY/LYC, STAT interrupt line, VBlank interrupt and the LCD on/off switch in
+ * LCDC. It never reads registers on a schedule; observers on the bank keep the live
+ * LineRegisters copy current and it writes back the read only parts of LY and STAT.
+ * Each line it hands mode 3 to the active Renderer and the finished line is converted
+ * straight into the back buffer of `output`, published at VBlank.
+ *
+ * With a RenderThread attached through offload() lines drawn by the line renderer are only
+ * recorded here and drawn on the render thread; FIFO lines are passed through finished.
+ * The render thread then owns publishing to its own FrameBuffers.
+ *
+ * Headless runs can skip pixel generation for frames nobody consumes (frame_skip(),
+ * render_on_demand()) without changing any timing. With LCDC.7 off no Event::PPU is
+ * scheduled at all, so the PPU costs nothing until the LCD is switched back on.
+ *
+ * Auto keeps using Fifo until FIFO_HOLD_FRAMES frames in a row had no mode 3 writes, so
+ * a game that splits the screen every other frame does not flip back and forth.
+ */
+class PixelProcessor
+{
+public:
+    using Vram = MMU::VideoRAM<>;
+    using Oam = MMU::ObjectAttributeMemory;
+
+    static constexpr std::size_t FIFO_HOLD_FRAMES = 60;
+
+    PixelProcessor(Scheduler& scheduler, Interrupts& interrupts, SystemState& system,
+        Vram& vram, Oam& oam, FrameBuffers& output, const Renderer renderer = Renderer::Auto) noexcept
+    : m_scheduler{scheduler}
+    , m_interrupts{interrupts}
+    , m_io{system.io}
+    , m_vram{vram}
+    , m_oam{oam}
+    , m_output{output}
+    , m_policy{renderer}
+    , m_active{renderer == Renderer::Fifo ? Renderer::Fifo : Renderer::Line}
+    {
+        m_io.observe<IO::LCDC, &PixelProcessor::on_lcdc>(*this);
+        m_io.observe<IO::STAT, &PixelProcessor::on_stat>(*this);
+        m_io.observe<IO::LYC, &PixelProcessor::on_lyc>(*this);
+        m_io.observe<IO::SCY, &PixelProcessor::on_register<&LineRegisters::SCY>>(*this);
+        m_io.observe<IO::SCX, &PixelProcessor::on_register<&LineRegisters::SCX>>(*this);
+        m_io.observe<IO::BGP, &PixelProcessor::on_register<&LineRegisters::BGP>>(*this);
+        m_io.observe<IO::OBP0, &PixelProcessor::on_register<&LineRegisters::OBP0>>(*this);
+        m_io.observe<IO::OBP1, &PixelProcessor::on_register<&LineRegisters::OBP1>>(*this);
+        m_io.observe<IO::WX, &PixelProcessor::on_register<&LineRegisters::WX>>(*this);
+        m_io.observe<IO::WY, &PixelProcessor::on_wy>(*this);
+
+        m_live.LCDC = m_io.value<IO::LCDC>();
+        m_live.SCY = m_io.value<IO::SCY>();
+        m_live.SCX = m_io.value<IO::SCX>();
+        m_live.BGP = m_io.value<IO::BGP>();
+        m_live.OBP0 = m_io.value<IO::OBP0>();
+        m_live.OBP1 = m_io.value<IO::OBP1>();
+        m_live.WY = m_io.value<IO::WY>();
+        m_live.WX = m_io.value<IO::WX>();
+        if (m_io.get<IO::LCDC::LCDDisplayEnable>())
+            start();
+    }
+
+    PixelProcessor(const PixelProcessor&) = delete; // observers point at this
+    PixelProcessor& operator=(const PixelProcessor&) = delete;
+
+    // Event::PPU handler, `at` is the deadline that expired
+    inline void on_event(const Cycle at) noexcept
+    {
+        switch (m_mode) {
+        case Mode::OAMScan:  enter_transfer(at); break;
+        case Mode::Transfer: enter_hblank(); break;
+        case Mode::HBlank:   next_line(); break;
+        case Mode::VBlank:   next_line(); break;
+        }
+    }
+
+    [[nodiscard]] inline constexpr Mode mode() const noexcept { return m_mode; }
+    [[nodiscard]] inline constexpr std::uint64_t frames() const noexcept { return m_frames; }
+
+    // Renderer used for the current frame (never Auto)
+    [[nodiscard]] inline constexpr Renderer active() const noexcept { return m_active; }
+
+    // Takes effect at the next frame
+    inline constexpr void renderer(const Renderer renderer) noexcept { m_policy = renderer; }
+
+    // Frame skip: only every (skip + 1)th frame is drawn and published
+    inline constexpr void frame_skip(const unsigned skip) noexcept { m_skip = skip; }
+
+    // Render on demand: a frame is only drawn if request_frame() was called before it started
+    inline constexpr void render_on_demand(const bool enabled) noexcept { m_on_demand = enabled; }
+    inline constexpr void request_frame() noexcept { m_requested = true; }
+
+    // The current frame produces pixels
+    [[nodiscard]] inline constexpr bool drawing() const noexcept { return m_draw; }
+
+    /** @brief Moves line rendering to `thread` (nullptr renders on the calling thread again).
+     * @details
+     * Switch during VBlank so each frame has a single producer.
+     * The thread's shadow VRAM/OAM is synced here, after which VRAM and OAM forward every
+     * write (OAM DMA included) to thread->vram() / thread->oam() themselves.
+     */
+    inline void offload(RenderThread* thread) noexcept
+    {
+        m_offload = thread;
+        if (m_offload) {
+            m_offload->sync(m_vram.bank(0), m_oam.data());
+            m_vram.forward<&RenderThread::vram>(*m_offload);
+            m_oam.forward<&RenderThread::oam>(*m_offload);
+        } else {
+            m_vram.stop_forwarding();
+            m_oam.stop_forwarding();
+        }
+    }
+
+    /** @brief Mode timing, LY and the live registers; describe VRAM and OAM before this.
+     * @details
+     * Renderer choice, frame skip and the render thread are host settings and are kept.
+     * The FIFO is not saved: a load inside mode 3 restarts the line's FIFO, so that one
+     * line misses the mid-line writes made before the load point. Frames on screen are
+     * whatever was drawn before the load until the next one is published.
+     */
+    void describe(StateLayout& layout)
+    {
+        layout.regions(m_live, m_mode, m_stat_line, m_window, m_line_start, m_transfer_start,
+            m_mode3_writes, m_clean_frames, m_frames);
+        layout.after_load<&PixelProcessor::loaded>(*this);
+    }
+
+private:
+    inline void loaded() noexcept
+    {
+        if (m_offload)
+            m_offload->sync(m_vram.bank(0), m_oam.data());
+        if (m_mode == Mode::Transfer && m_draw && m_active == Renderer::Fifo)
+            m_fifo.begin(m_vram.bank(0), m_oam.select(m_live.LY, m_io.get<IO::LCDC::OBJSize>()), m_live);
+    }
+
+    // A register the background/window fetcher or pixel mixer reads during mode 3 is about to change
+    inline void fetcher_write() noexcept
+    {
+        if (m_mode != Mode::Transfer)
+            return;
+        m_mode3_writes = true;
+        if (m_draw && m_active == Renderer::Fifo)
+            catch_up();
+    }
+
+    template<Data LineRegisters::*Member>
+    inline void on_register(const Data, const Data now) noexcept
+    {
+        fetcher_write();
+        m_live.*Member = now;
+    }
+
+    inline void on_wy(const Data, const Data now) noexcept
+    {
+        m_live.WY = now;
+    }
+
+    inline void on_lcdc(const Data old, const Data now) noexcept
+    {
+        fetcher_write();
+        m_live.LCDC = now;
+        const bool was_on = IO::LCDC::LCDDisplayEnable::get(old);
+        const bool on = IO::LCDC::LCDDisplayEnable::get(now);
+        if (on && !was_on)
+            start();
+        else if (!on && was_on)
+            stop();
+    }
+
+    inline void on_stat(const Data, const Data) noexcept
+    {
+        update_stat();
+    }
+
+    inline void on_lyc(const Data, const Data) noexcept
+    {
+        status();
+        update_stat();
+    }
+
+    // Read only parts of LY and STAT as the CPU sees them
+    inline void status() noexcept
+    {
+        m_io.store<IO::LY>(m_live.LY);
+        m_io.set<IO::STAT::Mode>(static_cast<Data>(m_mode));
+        m_io.set<IO::STAT::Coincidence>(m_live.LY == m_io.value<IO::LYC>());
+    }
+
+    // Raises STAT on a rising edge of the OR of all enabled sources ("STAT blocking")
+    inline void update_stat() noexcept
+    {
+        const bool line = m_io.get<IO::LCDC::LCDDisplayEnable>() && (
+               (m_io.get<IO::STAT::HBlankInterrupt>() && m_mode == Mode::HBlank)
+            || (m_io.get<IO::STAT::VBlankInterrupt>() && m_mode == Mode::VBlank)
+            || (m_io.get<IO::STAT::OAMInterrupt>() && m_mode == Mode::OAMScan)
+            || (m_io.get<IO::STAT::LYCInterrupt>() && m_io.get<IO::STAT::Coincidence>()));
+        if (line && !m_stat_line)
+            m_interrupts.request(Interrupt::STAT);
+        m_stat_line = line;
+    }
+
+    // LCD switched on: line 0 starts immediately
+    inline void start() noexcept
+    {
+        m_live.LY = 0;
+        m_live.window_line = 0;
+        m_line_start = m_scheduler.now();
+        begin_frame();
+        enter(Mode::OAMScan, m_line_start + OAM_SCAN_DOTS);
+    }
+
+    // LCD switched off: LY resets and the PPU stays idle in mode 0 until switched on
+    inline void stop() noexcept
+    {
+        m_scheduler.cancel(Event::PPU);
+        m_live.LY = 0;
+        m_live.window_line = 0;
+        m_mode = Mode::HBlank;
+        m_stat_line = false;
+        status();
+        if (m_draw)
+            blank();
+    }
+
+    // The LCD shows white while it is off
+    inline void blank() noexcept
+    {
+        const Line white{};
+        for (Data ly = 0; ly < HEIGHT; ++ly) {
+            if (m_offload) {
+                LineRegisters regs = m_live;
+                regs.LY = ly;
+                m_offload->line(regs, white);
+            } else {
+                m_output.line(ly, white);
+            }
+        }
+        if (!m_offload)
+            m_output.publish();
+    }
+
+    /** @brief Decides whether the frame starting now produces pixels.
+     * @details
+     * A skipped frame runs the exact same mode timing, OAM scan (for the mode 3 object
+     * penalty), LY/STAT updates and interrupts. Only tile fetching, the FIFO and publishing
+     * are left out.
+     */
+    inline constexpr void begin_frame() noexcept
+    {
+        if (m_on_demand) {
+            m_draw = std::exchange(m_requested, false);
+            return;
+        }
+        m_draw = m_skipped >= m_skip;
+        m_skipped = m_draw ? 0 : m_skipped + 1;
+    }
+
+    inline void enter(const Mode mode, const Cycle until) noexcept
+    {
+        m_mode = mode;
+        m_scheduler.schedule(Event::PPU, until);
+        status();
+        update_stat();
+    }
+
+    // Approximate mode 3 length: fine scroll discard, window restart and object fetches
+    [[nodiscard]] inline Cycle transfer_length(const LineObjects& objects) const noexcept
+    {
+        Cycle length = TRANSFER_DOTS + m_live.SCX % 8;
+        if (m_window)
+            length += 6;
+        if (m_io.get<IO::LCDC::OBJEnable>())
+            length += 6 * objects.count;
+        return length;
+    }
+
+    inline void enter_transfer(const Cycle at) noexcept
+    {
+        m_window = window_visible(m_live);
+        m_transfer_start = at;
+
+        // the OAM scan happens whether or not objects are enabled, the FIFO checks LCDC.1 live
+        const LineObjects objects = m_oam.select(m_live.LY, m_io.get<IO::LCDC::OBJSize>());
+
+        if (!m_draw) {
+            // timing only
+        } else if (m_active == Renderer::Fifo) {
+            m_fifo.begin(m_vram.bank(0), objects, m_live);
+        } else if (m_offload) {
+            m_offload->line(m_live);
+        } else {
+            m_cache.refresh(m_vram);
+            render_cached_line(m_cache, m_vram.bank(0), objects, m_live, m_line);
+            m_output.line(m_live.LY, m_line);
+        }
+        enter(Mode::Transfer, at + transfer_length(objects));
+    }
+
+    // Runs the FIFO up to the current dot so a register write lands on the right pixel
+    inline void catch_up() noexcept
+    {
+        const Cycle now = m_scheduler.now();
+        if (now > m_transfer_start) {
+            m_fifo.advance(now - m_transfer_start);
+            m_transfer_start = now;
+        }
+    }
+
+    inline void enter_hblank() noexcept
+    {
+        if (m_draw && m_active == Renderer::Fifo) {
+            m_fifo.finish(m_line);
+            if (m_offload)
+                m_offload->line(m_live, m_line);
+            else
+                m_output.line(m_live.LY, m_line);
+        }
+        if (m_window)
+            ++m_live.window_line;
+        enter(Mode::HBlank, m_line_start + LINE_DOTS);
+    }
+
+    inline void next_line() noexcept
+    {
+        m_line_start += LINE_DOTS;
+        ++m_live.LY;
+
+        if (m_live.LY == HEIGHT) {
+            m_interrupts.request(Interrupt::VBlank);
+            if (m_draw && !m_offload)
+                m_output.publish();
+            end_frame();
+            enter(Mode::VBlank, m_line_start + LINE_DOTS);
+        } else if (m_live.LY == LINES) {
+            m_live.LY = 0;
+            m_live.window_line = 0;
+            begin_frame();
+            enter(Mode::OAMScan, m_line_start + OAM_SCAN_DOTS);
+        } else if (m_live.LY > HEIGHT) {
+            enter(Mode::VBlank, m_line_start + LINE_DOTS);
+        } else {
+            enter(Mode::OAMScan, m_line_start + OAM_SCAN_DOTS);
+        }
+    }
+
+    // Picks the renderer for the next frame
+    inline void end_frame() noexcept
+    {
+        ++m_frames;
+        m_clean_frames = m_mode3_writes ? 0 : m_clean_frames + 1;
+        m_mode3_writes = false;
+
+        switch (m_policy) {
+        case Renderer::Line: m_active = Renderer::Line; break;
+        case Renderer::Fifo: m_active = Renderer::Fifo; break;
+        case Renderer::Auto:
+            if (m_clean_frames == 0)
+                m_active = Renderer::Fifo;
+            else if (m_clean_frames >= FIFO_HOLD_FRAMES)
+                m_active = Renderer::Line;
+            break;
+        }
+    }
+
+    Scheduler& m_scheduler;
+    Interrupts& m_interrupts;
+    IO::RegisterBank& m_io;
+    Vram& m_vram;
+    Oam& m_oam;
+    FrameBuffers& m_output;
+
+    LineRegisters m_live{}; // current register values, read live by the FIFO
+    Mode m_mode = Mode::HBlank;
+    bool m_stat_line = false;
+    bool m_window = false;  // window shows on the current line
+    Cycle m_line_start = 0;
+    Cycle m_transfer_start = 0;
+
+    Renderer m_policy;
+    Renderer m_active;
+    bool m_mode3_writes = false;
+    std::size_t m_clean_frames = 0;
+    std::uint64_t m_frames = 0;
+
+    bool m_draw = true;
+    bool m_on_demand = false;
+    bool m_requested = false;
+    unsigned m_skip = 0;
+    unsigned m_skipped = 0;
+
+    RenderThread* m_offload = nullptr;
+    PixelFifo m_fifo{};
+    TileCache<> m_cache{};
+    Line m_line{};
+};
+
+} // namespace LR35902::PPU
+
+#endif // LR35902_PPU_PPU_HPP
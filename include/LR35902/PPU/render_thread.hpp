@@ -0,0 +1,233 @@
+#ifndef LR35902_PPU_RENDER_THREAD_HPP
+#define LR35902_PPU_RENDER_THREAD_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <stop_token>
+#include <thread>
+
+#include <utility/spsc_ring.hpp>
+
+#include "../types.hpp"
+#include "../MMU/Vram.hpp"
+#include "../MMU/Oam.hpp"
+#include "tiles.hpp"
+#include "scanline.hpp"
+#include "tile_cache.hpp"
+#include "framebuffer.hpp"
+
+namespace LR35902::PPU
+{
+
+/** @brief Renders scanlines on a separate thread from records produced by the emulation thread.
+ * @details
+ * The render thread keeps its own copy of VRAM and OAM. The emulation thread forwards every
+ * VRAM/OAM write as a 4 byte Delta and, at the start of each mode 3, pushes a LineRecord
+ * holding the latched registers and the number of deltas that precede it. The render
+ * thread applies exactly that many deltas before drawing the line, so it sees memory as it
+ * was when the line was latched no matter how far behind it runs.
+ *
+ * Lines drawn by the pixel FIFO are already final and are passed through as pixels.
+ * Finished lines go straight into the back buffer of `output`, which is published after
+ * line 143, so the render thread is the only producer of those FrameBuffers.
+ *
+ * Both queues are SPSC rings. The producer only blocks when a ring is full, i.e. when the
+ * render thread is a whole ring behind.
+ */
+class RenderThread
+{
+public:
+    static constexpr std::size_t RECORDS = 512;      // > 3 frames of lines
+    static constexpr std::size_t DELTAS = 1 << 14;   // a full VRAM + OAM sync fits
+    static constexpr std::size_t RENDERED = 256;
+    static constexpr std::uint16_t OAM_OFFSET = 0x2000;
+
+    explicit RenderThread(FrameBuffers& output)
+    : m_output{output}
+    , m_thread{[this](std::stop_token stop) { run(stop); }}
+    {}
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    ~RenderThread()
+    {
+        m_thread.request_stop();
+        wake();
+    }
+
+    // --- emulation thread ---
+
+    // offset into 0x8000-0x9FFF
+    void vram(const Addr addr, const Data data) noexcept
+    {
+        delta(Delta{static_cast<std::uint16_t>(addr - 0x8000), data});
+    }
+
+    // offset into 0xFE00-0xFE9F
+    void oam(const Addr addr, const Data data) noexcept
+    {
+        delta(Delta{static_cast<std::uint16_t>(addr - 0xFE00 + OAM_OFFSET), data});
+    }
+
+    // Copies the whole of VRAM and OAM, needed once when attaching to a running PPU
+    void sync(VideoRAM vram, ObjectRAM oam) noexcept
+    {
+        for (std::size_t i = 0; i < vram.size(); ++i)
+            delta(Delta{static_cast<std::uint16_t>(i), vram[i]});
+        for (std::size_t i = 0; i < oam.size(); ++i)
+            delta(Delta{static_cast<std::uint16_t>(OAM_OFFSET + i), oam[i]});
+    }
+
+    // Start of mode 3 for a line drawn by the line renderer
+    void line(const LineRegisters& regs) noexcept
+    {
+        record(Kind::Line, regs);
+    }
+
+    // A line the emulation thread already drew (pixel FIFO)
+    void line(const LineRegisters& regs, const Line& pixels) noexcept
+    {
+        m_rendered.push(pixels);
+        record(Kind::Rendered, regs);
+    }
+
+    // Number of frames published so far
+    [[nodiscard]] std::uint64_t frames() const noexcept
+    {
+        return m_frames.load(std::memory_order_acquire);
+    }
+
+    // Blocks until everything submitted so far is drawn (savestates, shutdown of a session)
+    void flush() const noexcept
+    {
+        while (!m_records.empty())
+            std::this_thread::yield();
+        while (m_busy.load(std::memory_order_acquire))
+            std::this_thread::yield();
+    }
+
+private:
+    enum class Kind : std::uint8_t
+    {
+        Line,       // draw regs.LY from the shadow memory
+        Rendered,   // copy the next Line from m_rendered
+        Deltas,     // only apply deltas (the delta ring filled up mid-line)
+    };
+
+    struct Delta
+    {
+        std::uint16_t offset; // VRAM 0x0000-0x1FFF, OAM OAM_OFFSET + 0x00-0x9F
+        Data value;
+    };
+
+    struct LineRecord
+    {
+        LineRegisters regs;
+        std::uint16_t deltas;
+        Kind kind;
+    };
+
+    void delta(const Delta delta) noexcept
+    {
+        if (m_pending == std::numeric_limits<std::uint16_t>::max())
+            record(Kind::Deltas, LineRegisters{});
+        if (!m_deltas.try_push(delta)) {
+            record(Kind::Deltas, LineRegisters{});
+            m_deltas.push(delta);
+        }
+        ++m_pending;
+    }
+
+    void record(const Kind kind, const LineRegisters& regs) noexcept
+    {
+        m_records.push(LineRecord{regs, m_pending, kind});
+        m_pending = 0;
+        wake();
+    }
+
+    void wake() noexcept
+    {
+        m_submitted.fetch_add(1, std::memory_order_release);
+        m_submitted.notify_one();
+    }
+
+    // --- render thread ---
+
+    void run(const std::stop_token stop)
+    {
+        for (;;) {
+            const std::uint32_t seen = m_submitted.load(std::memory_order_acquire);
+            // read before draining: everything submitted before the stop is drawn below
+            const bool stopping = stop.stop_requested();
+            m_busy.store(true, std::memory_order_release);
+            while (const auto record = m_records.try_pop())
+                draw(*record);
+            m_busy.store(false, std::memory_order_release);
+
+            if (stopping)
+                return;
+            m_submitted.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+    void draw(const LineRecord& record)
+    {
+        // deltas and rendered lines are pushed before their record, acquiring the record
+        // makes them visible so the pops below cannot fail
+        for (std::uint16_t i = 0; i < record.deltas; ++i) {
+            const Delta delta = *m_deltas.try_pop();
+            if (delta.offset < OAM_OFFSET)
+                m_vram.write(static_cast<Addr>(0x8000 + delta.offset), delta.value);
+            else
+                m_oam.write(static_cast<Addr>(0xFE00 + delta.offset - OAM_OFFSET), delta.value);
+        }
+
+        const Data ly = record.regs.LY;
+        switch (record.kind) {
+        case Kind::Deltas:
+            return;
+        case Kind::Line:
+            m_cache.refresh(m_vram);
+            render_cached_line(m_cache, m_vram.bank(0), m_oam.select(ly, record.regs.LCDC & LCDCBit::OBJSize), record.regs, m_line);
+            break;
+        case Kind::Rendered:
+            m_line = *m_rendered.try_pop();
+            break;
+        }
+
+        m_output.line(ly, m_line);
+        if (ly == HEIGHT - 1) {
+            m_output.publish();
+            m_frames.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    FrameBuffers& m_output;
+
+    // emulation thread
+    std::uint16_t m_pending = 0; // deltas pushed since the last record
+
+    // shared
+    utility::SpscRing<LineRecord, RECORDS> m_records;
+    utility::SpscRing<Delta, DELTAS> m_deltas;
+    utility::SpscRing<Line, RENDERED> m_rendered;
+    std::atomic<std::uint32_t> m_submitted{0};
+    std::atomic<bool> m_busy{false};
+    std::atomic<std::uint64_t> m_frames{0};
+
+    // render thread
+    MMU::VideoRAM<> m_vram{};
+    MMU::ObjectAttributeMemory m_oam{};
+    TileCache<> m_cache{};
+    Line m_line{};
+
+    std::jthread m_thread; // last: started after and joined before everything above
+};
+
+} // namespace LR35902::PPU
+
+#endif // LR35902_PPU_RENDER_THREAD_HPP
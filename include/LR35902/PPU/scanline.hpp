@@ -0,0 +1,263 @@
+#ifndef LR35902_PPU_SCANLINE_HPP
+#define LR35902_PPU_SCANLINE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include <utility/simd.hpp>
+
+#include "tiles.hpp"
+#include "kernels.hpp"
+#include "tile_cache.hpp"
+
+namespace LR35902::PPU
+{
+
+// One shade (0-3) per pixel
+using Line = std::array<Data, WIDTH>;
+
+/** @brief Everything a line depends on besides VRAM and OAM, latched at the start of mode 3 */
+struct LineRegisters
+{
+    Data LCDC;
+    Data SCY;
+    Data SCX;
+    Data LY;
+    Data WY;
+    Data WX;
+    Data BGP;
+    Data OBP0;
+    Data OBP1;
+    Data window_line; // internal window line counter, only advances on lines that show the window
+};
+
+// On DMG LCDC.0 blanks the window together with the background
+[[nodiscard]] constexpr bool window_visible(const LineRegisters& regs) noexcept
+{
+    return (regs.LCDC & LCDCBit::BGEnable)
+        && (regs.LCDC & LCDCBit::WinEnable)
+        && regs.WY <= regs.LY
+        && regs.WX <= 166;
+}
+
+namespace Reference
+{
+
+/** @brief Pixel at a time renderer that mirrors the hardware description directly.
+ * @details
+ * Slow on purpose. It is the oracle the line renderers are verified against.
+ */
+inline void render(VideoRAM vram, ObjectRAM oam, const LineRegisters& regs, Line& out) noexcept
+{
+    const bool bg = regs.LCDC & LCDCBit::BGEnable;
+    const bool window = window_visible(regs);
+    const bool tall = regs.LCDC & LCDCBit::OBJSize;
+    const LineObjects objects = (regs.LCDC & LCDCBit::OBJEnable) ? select_objects(oam, regs.LY, tall) : LineObjects{};
+
+    for (unsigned x = 0; x < WIDTH; ++x) {
+        Data index = 0;
+        if (bg) {
+            unsigned px, py;
+            std::size_t map;
+            if (window && x + 7 >= regs.WX) {
+                px = x + 7 - regs.WX;
+                py = regs.window_line;
+                map = map_offset(regs.LCDC & LCDCBit::WinMap);
+            } else {
+                px = (x + regs.SCX) & 0xFF;
+                py = (regs.LY + regs.SCY) & 0xFF;
+                map = map_offset(regs.LCDC & LCDCBit::BGMap);
+            }
+            const Data tile = vram[map + (py / 8) * 32 + px / 8];
+            const std::size_t row = tile_row_offset(regs.LCDC, tile, py % 8);
+            index = pixel(vram[row], vram[row + 1], px % 8);
+        }
+
+        Data color = bg ? shade(regs.BGP, index) : 0;
+        for (std::size_t i = 0; i < objects.count; ++i) {
+            const Object& obj = objects.objects[i];
+            const unsigned px = x + 8 - obj.x;
+            if (px >= 8)
+                continue;
+            const auto [lo, hi] = object_row(vram, obj, regs.LY, tall);
+            const Data c = pixel(lo, hi, px);
+            if (c == 0)
+                continue;
+            if (!(obj.attr & OBJAttr::Priority) || index == 0)
+                color = shade((obj.attr & OBJAttr::Palette) ? regs.OBP1 : regs.OBP0, c);
+            break;
+        }
+        out[x] = color;
+    }
+}
+
+} // namespace Reference
+
+/** @brief Whole-line renderer built on a Kernel (see kernels.hpp).
+ * @details
+ * The background row is fetched as 21 tiles, decoded in one pass and SCX is applied as an
+ * offset into the decoded row. The window overwrites the tail of the row the same way.
+ * Objects are drawn into a line sized buffer from lowest to highest priority, then
+ * blended over the background in one pass.
+ *
+ * Tile rows either come straight from VRAM through Kernel::decode or, when a TileCache is
+ * passed, are copied pre-decoded from the cache.
+ */
+template<typename KernelT>
+struct Scanline
+{
+    using Kernel = KernelT;
+
+    static constexpr std::size_t ROW_TILES = WIDTH / 8 + 1; // one extra tile for fine scroll
+
+    static void render(VideoRAM vram, ObjectRAM oam, const LineRegisters& regs, Line& out) noexcept
+    {
+        const LineObjects objects = (regs.LCDC & LCDCBit::OBJEnable)
+            ? select_objects(oam, regs.LY, regs.LCDC & LCDCBit::OBJSize)
+            : LineObjects{};
+        draw(Decoded{}, vram, objects, regs, out);
+    }
+
+    // `objects` is the OAM scan result for regs.LY, see MMU::ObjectAttributeMemory::select()
+    template<std::size_t Banks>
+    static void render(const TileCache<Banks>& cache, VideoRAM vram, const LineObjects& objects, const LineRegisters& regs, Line& out) noexcept
+    {
+        draw(Cached<Banks>{cache}, vram, objects, regs, out);
+    }
+
+private:
+    // Tile rows decoded from VRAM on every fetch
+    struct Decoded
+    {
+        // Decodes `count` pixels of a map row starting `skip` pixels into tile column `column`
+        void row(VideoRAM vram, const Data lcdc, const std::size_t map, const unsigned column,
+            const unsigned y, const unsigned skip, Data* out, const std::size_t count) const noexcept
+        {
+            alignas(32) std::array<Data, ROW_TILES + 3> lo{};
+            alignas(32) std::array<Data, ROW_TILES + 3> hi{};
+            alignas(32) std::array<Data, (ROW_TILES + 3) * 8> row;
+
+            const std::size_t tiles = (skip + count + 7) / 8;
+            for (std::size_t t = 0; t < tiles; ++t) {
+                const Data tile = vram[map + ((column + t) & 31)];
+                const std::size_t offset = tile_row_offset(lcdc, tile, y);
+                lo[t] = vram[offset];
+                hi[t] = vram[offset + 1];
+            }
+            Kernel::decode(lo.data(), hi.data(), tiles, row.data());
+            std::memcpy(out, row.data() + skip, count);
+        }
+
+        std::array<Data, 8> object(VideoRAM vram, const Object& obj, const Data ly, const bool tall) const noexcept
+        {
+            const auto [lo, hi] = object_row(vram, obj, ly, tall);
+            std::array<Data, 8> row;
+            Kernel::decode(&lo, &hi, 1, row.data());
+            return row;
+        }
+    };
+
+    // Tile rows copied from a TileCache
+    template<std::size_t Banks>
+    struct Cached
+    {
+        void row(VideoRAM vram, const Data lcdc, const std::size_t map, const unsigned column,
+            const unsigned y, const unsigned skip, Data* out, const std::size_t count) const noexcept
+        {
+            alignas(32) std::array<Data, (ROW_TILES + 1) * 8> row;
+
+            const std::size_t tiles = (skip + count + 7) / 8;
+            for (std::size_t t = 0; t < tiles; ++t) {
+                const Data tile = vram[map + ((column + t) & 31)];
+                std::memcpy(row.data() + 8 * t, cache.row(0, tile_id(lcdc, tile), y), 8);
+            }
+            std::memcpy(out, row.data() + skip, count);
+        }
+
+        std::array<Data, 8> object(VideoRAM, const Object& obj, const Data ly, const bool tall) const noexcept
+        {
+            using Flip = typename TileCache<Banks>::Flip;
+            const auto [tile, y] = object_tile_row(obj, ly, tall);
+            std::array<Data, 8> row;
+            std::memcpy(row.data(), cache.row(0, tile, y, (obj.attr & OBJAttr::FlipX) ? Flip::X : Flip::None), 8);
+            return row;
+        }
+
+        const TileCache<Banks>& cache;
+    };
+
+    template<typename Tiles>
+    static void draw(const Tiles& tiles, VideoRAM vram, const LineObjects& line, const LineRegisters& regs, Line& out) noexcept
+    {
+        alignas(32) std::array<Data, WIDTH> index{};
+
+        if (regs.LCDC & LCDCBit::BGEnable) {
+            const unsigned y = (regs.LY + regs.SCY) & 0xFF;
+            tiles.row(vram, regs.LCDC, map_offset(regs.LCDC & LCDCBit::BGMap) + (y / 8) * 32,
+                regs.SCX / 8, y % 8, regs.SCX % 8, index.data(), WIDTH);
+
+            if (window_visible(regs)) {
+                const int start = regs.WX - 7;
+                const unsigned first = static_cast<unsigned>(std::max(start, 0));
+                const unsigned skip = static_cast<unsigned>(static_cast<int>(first) - start);
+                tiles.row(vram, regs.LCDC, map_offset(regs.LCDC & LCDCBit::WinMap) + (regs.window_line / 8) * 32,
+                    0, regs.window_line % 8, skip, index.data() + first, WIDTH - first);
+            }
+            Kernel::palette(index.data(), WIDTH, regs.BGP, out.data());
+        } else {
+            out.fill(0);
+        }
+
+        if (regs.LCDC & LCDCBit::OBJEnable)
+            objects(tiles, vram, line, regs, index, out);
+    }
+
+    template<typename Tiles>
+    static void objects(const Tiles& tiles, VideoRAM vram, const LineObjects& line, const LineRegisters& regs,
+        const std::array<Data, WIDTH>& index, Line& out) noexcept
+    {
+        const bool tall = regs.LCDC & LCDCBit::OBJSize;
+        if (line.count == 0)
+            return;
+
+        alignas(32) std::array<Data, WIDTH> color{};
+        alignas(32) std::array<Data, WIDTH> mask{};
+        for (std::size_t i = line.count; i-- > 0;) {
+            const Object& obj = line.objects[i];
+            const std::array<Data, 8> row = tiles.object(vram, obj, regs.LY, tall);
+            const Data palette = (obj.attr & OBJAttr::Palette) ? regs.OBP1 : regs.OBP0;
+            for (unsigned px = 0; px < 8; ++px) {
+                const unsigned x = obj.x + px - 8u;
+                if (x >= WIDTH || row[px] == 0)
+                    continue;
+                color[x] = shade(palette, row[px]);
+                // a hidden object pixel still hides lower priority objects
+                const bool visible = !(obj.attr & OBJAttr::Priority) || index[x] == 0;
+                mask[x] = visible ? 0xFF : 0x00;
+            }
+        }
+        Kernel::blend(out.data(), color.data(), mask.data(), WIDTH);
+    }
+};
+
+using LineRenderer = void (*)(VideoRAM, ObjectRAM, const LineRegisters&, Line&) noexcept;
+using CachedLineRenderer = void (*)(const TileCache<>&, VideoRAM, const LineObjects&, const LineRegisters&, Line&) noexcept;
+
+// Best line renderer for the host, picked once through CPUID
+template<typename Renderer = LineRenderer>
+[[nodiscard]] inline Renderer select_line_renderer() noexcept
+{
+    return UTILITY_SIMD_SELECT(static_cast<Renderer>(&Scanline<Kernel::Scalar>::render),
+        static_cast<Renderer>(&Scanline<Kernel::SSE2>::render),
+        static_cast<Renderer>(&Scanline<Kernel::AVX2>::render), utility::cpu().avx2);
+}
+
+inline const LineRenderer render_line = select_line_renderer<LineRenderer>();
+inline const CachedLineRenderer render_cached_line = select_line_renderer<CachedLineRenderer>();
+
+} // namespace LR35902::PPU
+
+#endif // LR35902_PPU_SCANLINE_HPP
@@ -0,0 +1,80 @@
+#ifndef LR35902_PPU_TILE_CACHE_HPP
+#define LR35902_PPU_TILE_CACHE_HPP
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <utility>
+
+#include "tiles.hpp"
+
+namespace LR35902::PPU
+{
+
+/** @brief Every tile in VRAM pre-decoded to one color index per byte, once per flip variant.
+ * @details
+ * Games change a handful of tiles per frame while the renderer reads every visible tile on
+ * every line. refresh() re-decodes only the tiles the VRAM dirty bitmap reports, after which
+ * fetching a tile row is an 8 byte copy with X/Y flips already applied.
+ *
+ * 384 tiles per bank * 4 variants * 64 bytes = 96 KiB per bank.
+ */
+template<std::size_t BanksV = 1>
+class TileCache
+{
+public:
+    static constexpr std::size_t BANKS = BanksV;
+    static constexpr std::size_t TILES = 384; // per bank
+
+    enum Flip : std::uint8_t { None = 0, X = 1, Y = 2, XY = 3 };
+
+    using Tile = std::array<std::array<Data, 64>, 4>; // [flip][y * 8 + x]
+
+    // Re-decodes dirty tiles and clears their bits. vram provides bank(i) and dirty().
+    template<typename Vram>
+    constexpr void refresh(Vram& vram) noexcept
+    {
+        static_assert(Vram::BANKS == BANKS && Vram::TILES == TILES, "TileCache does not match VRAM layout.");
+
+        auto dirty = vram.dirty();
+        for (std::size_t word = 0; word < dirty.size(); ++word) {
+            for (std::uint64_t bits = std::exchange(dirty[word], 0); bits; bits &= bits - 1) {
+                const std::size_t id = word * 64 + static_cast<std::size_t>(std::countr_zero(bits));
+                decode(vram.bank(id / TILES), id % TILES, m_tiles[id]);
+            }
+        }
+    }
+
+    [[nodiscard]] constexpr const Data* row(const std::size_t bank, const std::size_t tile,
+        const unsigned y, const Flip flip = None) const noexcept
+    {
+        return m_tiles[bank * TILES + tile][flip].data() + y * 8;
+    }
+
+private:
+    static constexpr void decode(std::span<const Data, 0x2000> vram, const std::size_t tile, Tile& out) noexcept
+    {
+        auto& plain = out[None];
+        for (unsigned y = 0; y < 8; ++y) {
+            const std::size_t offset = tile * TILE_SIZE + y * 2;
+            for (unsigned x = 0; x < 8; ++x)
+                plain[y * 8 + x] = pixel(vram[offset], vram[offset + 1], x);
+        }
+        for (unsigned y = 0; y < 8; ++y) {
+            for (unsigned x = 0; x < 8; ++x) {
+                const Data c = plain[y * 8 + x];
+                out[X][y * 8 + (7 - x)] = c;
+                out[Y][(7 - y) * 8 + x] = c;
+                out[XY][(7 - y) * 8 + (7 - x)] = c;
+            }
+        }
+    }
+
+    std::array<Tile, BANKS * TILES> m_tiles{};
+};
+
+} // namespace LR35902::PPU
+
+#endif // LR35902_PPU_TILE_CACHE_HPP
@@ -0,0 +1,177 @@
+#ifndef LR35902_PPU_TILES_HPP
+#define LR35902_PPU_TILES_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <span>
+
+#include "../types.hpp"
+
+namespace LR35902::PPU
+{
+
+static constexpr std::size_t WIDTH = 160;
+static constexpr std::size_t HEIGHT = 144;
+
+static constexpr std::size_t TILE_SIZE = 16;   // 8 rows * 2 bytes
+static constexpr std::size_t OBJ_COUNT = 40;
+static constexpr std::size_t OBJ_PER_LINE = 10;
+
+// Views into memory, offsets are relative to the start of the region
+using VideoRAM = std::span<const Data, 0x2000>; // 0x8000-0x9FFF
+using ObjectRAM = std::span<const Data, 0xA0>;  // 0xFE00-0xFE9F
+
+/** @brief LCDC bits (see IO::LCDC for the full description) */
+namespace LCDCBit
+{
+static constexpr Data BGEnable  = 0b0000'0001;
+static constexpr Data OBJEnable = 0b0000'0010;
+static constexpr Data OBJSize   = 0b0000'0100;
+static constexpr Data BGMap     = 0b0000'1000;
+static constexpr Data TileData  = 0b0001'0000;
+static constexpr Data WinEnable = 0b0010'0000;
+static constexpr Data WinMap    = 0b0100'0000;
+static constexpr Data LCDEnable = 0b1000'0000;
+} // namespace LCDCBit
+
+/** @brief OAM entry attribute bits */
+namespace OBJAttr
+{
+static constexpr Data Palette  = 0b0001'0000; // OBP0/OBP1
+static constexpr Data FlipX    = 0b0010'0000;
+static constexpr Data FlipY    = 0b0100'0000;
+static constexpr Data Priority = 0b1000'0000; // BG colors 1-3 are drawn over the object
+} // namespace OBJAttr
+
+// VRAM offset of the 32x32 tile map selected by an LCDC map bit
+[[nodiscard]] constexpr std::size_t map_offset(const bool high) noexcept
+{
+    return high ? 0x1C00 : 0x1800;
+}
+
+// VRAM offset of row `y` of BG/window tile `index` honoring the LCDC addressing mode
+[[nodiscard]] constexpr std::size_t tile_row_offset(const Data lcdc, const Data index, const unsigned y) noexcept
+{
+    if (lcdc & LCDCBit::TileData)
+        return index * TILE_SIZE + y * 2;
+    return 0x1000 + static_cast<std::int8_t>(index) * static_cast<std::ptrdiff_t>(TILE_SIZE) + y * 2;
+}
+
+// Tile number (0-383) of BG/window tile `index`: 0x8000 addressing is unsigned, 0x8800 is signed from 0x9000
+[[nodiscard]] constexpr std::size_t tile_id(const Data lcdc, const Data index) noexcept
+{
+    if (lcdc & LCDCBit::TileData)
+        return index;
+    return static_cast<std::size_t>(256 + static_cast<std::int8_t>(index));
+}
+
+// Color index (0-3) of pixel x (0 = leftmost) of a 2bpp planar row
+[[nodiscard]] constexpr Data pixel(const Data lo, const Data hi, const unsigned x) noexcept
+{
+    const unsigned bit = 7 - x;
+    return static_cast<Data>((((hi >> bit) & 1) << 1) | ((lo >> bit) & 1));
+}
+
+// Shade (0-3) a DMG palette register assigns to color index c
+[[nodiscard]] constexpr Data shade(const Data palette, const Data c) noexcept
+{
+    return (palette >> (2 * c)) & 0b11;
+}
+
+[[nodiscard]] constexpr Data reverse(Data b) noexcept
+{
+    b = static_cast<Data>((b & 0xF0) >> 4 | (b & 0x0F) << 4);
+    b = static_cast<Data>((b & 0xCC) >> 2 | (b & 0x33) << 2);
+    b = static_cast<Data>((b & 0xAA) >> 1 | (b & 0x55) << 1);
+    return b;
+}
+
+/** @brief One OAM entry as the PPU sees it */
+struct Object
+{
+    Data y;     // screen y + 16
+    Data x;     // screen x + 8
+    Data tile;
+    Data attr;
+    Data index; // position in OAM, breaks X ties on DMG
+};
+
+struct ObjectTileRow
+{
+    std::size_t tile;
+    unsigned y;
+};
+
+// Tile and row an object shows on line ly with FlipY applied. Object tiles always use 0x8000 addressing.
+[[nodiscard]] constexpr ObjectTileRow object_tile_row(const Object& obj, const Data ly, const bool tall) noexcept
+{
+    const unsigned height = tall ? 16 : 8;
+    unsigned y = static_cast<unsigned>(ly + 16 - obj.y);
+    if (obj.attr & OBJAttr::FlipY)
+        y = height - 1 - y;
+    const std::size_t tile = tall ? (obj.tile & 0xFE) + y / 8 : obj.tile;
+    return {tile, y % 8};
+}
+
+// Planar row of an object on line ly, flips applied
+[[nodiscard]] constexpr std::array<Data, 2> object_row(VideoRAM vram, const Object& obj, const Data ly, const bool tall) noexcept
+{
+    const auto [tile, y] = object_tile_row(obj, ly, tall);
+    const std::size_t offset = tile * TILE_SIZE + y * 2;
+    Data lo = vram[offset];
+    Data hi = vram[offset + 1];
+    if (obj.attr & OBJAttr::FlipX) {
+        lo = reverse(lo);
+        hi = reverse(hi);
+    }
+    return {lo, hi};
+}
+
+struct LineObjects
+{
+    std::array<Object, OBJ_PER_LINE> objects;
+    std::size_t count = 0;
+};
+
+// Drawing priority on DMG: the object with the smaller X wins, ties go to the lower OAM index.
+// Insertion sort keeps OAM order for equal X and is the fastest option for 10 entries.
+constexpr void sort_by_priority(LineObjects& line) noexcept
+{
+    for (std::size_t i = 1; i < line.count; ++i) {
+        const Object obj = line.objects[i];
+        std::size_t j = i;
+        for (; j > 0 && line.objects[j - 1].x > obj.x; --j)
+            line.objects[j] = line.objects[j - 1];
+        line.objects[j] = obj;
+    }
+}
+
+// OAM entry i as the PPU sees it
+[[nodiscard]] constexpr Object object(ObjectRAM oam, const std::size_t i) noexcept
+{
+    return Object{oam[4 * i], oam[4 * i + 1], oam[4 * i + 2], oam[4 * i + 3], static_cast<Data>(i)};
+}
+
+/** @brief OAM scan: the first 10 objects (in OAM order) intersecting ly, sorted by drawing priority.
+ * @details
+ * Scans all 40 entries. MMU::ObjectAttributeMemory::select() gives the same result from
+ * its per-line index.
+ */
+[[nodiscard]] constexpr LineObjects select_objects(ObjectRAM oam, const Data ly, const bool tall) noexcept
+{
+    const unsigned height = tall ? 16 : 8;
+    LineObjects line{};
+    for (std::size_t i = 0; i < OBJ_COUNT && line.count < OBJ_PER_LINE; ++i) {
+        const Data y = oam[4 * i];
+        if (ly + 16u < y || ly + 16u >= y + height)
+            continue;
+        line.objects[line.count++] = object(oam, i);
+    }
+    sort_by_priority(line);
+    return line;
+}
+
+} // namespace LR35902::PPU
+
+#endif // LR35902_PPU_TILES_HPP
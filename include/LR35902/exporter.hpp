@@ -0,0 +1,445 @@
+#ifndef LR35902_EXPORTER_HPP
+#define LR35902_EXPORTER_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <utility/spsc_ring.hpp>
+
+#include "types.hpp"
+#include "PPU/framebuffer.hpp"
+
+namespace LR35902::Export
+{
+
+enum class VideoContainer : std::uint8_t
+{
+    Y4M,    // YUV4MPEG2, 4:4:4 planes, BT.601 limited range
+    RawRGB, // packed R, G, B bytes, 160x144 per frame
+};
+
+enum class AudioContainer : std::uint8_t
+{
+    WAV,    // s16le header + samples; sizes are patched on close if the fd is seekable
+    RawS16, // interleaved native endian int16_t
+};
+
+// What the emulation thread does when every pooled buffer is queued
+enum class Backpressure : std::uint8_t
+{
+    Drop,  // discard the frame / samples and count them
+    Block, // wait for the writer thread to return a buffer
+};
+
+struct Options
+{
+    int video_fd = -1; // -1: no video
+    VideoContainer video = VideoContainer::Y4M;
+    PPU::ShadeColors colors = PPU::GRAYS; // only used for PixelFormat::Shade frames
+
+    int audio_fd = -1; // -1: no audio
+    AudioContainer audio = AudioContainer::WAV;
+    std::uint32_t sample_rate = 48000;
+    std::uint16_t channels = 2;
+
+    Backpressure policy = Backpressure::Block;
+};
+
+namespace impl
+{
+
+// SIGPIPE is sent to the thread that wrote; blocked there, a closed reader is an EPIPE write
+inline void block_sigpipe() noexcept
+{
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+}
+
+// Writes all of data, retrying partial writes and EINTR. Returns 0 or errno.
+inline int write_all(const int fd, const std::byte* data, std::size_t size) noexcept
+{
+    while (size) {
+        const ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return 0;
+}
+
+inline int write_all(const int fd, const std::string_view text) noexcept
+{
+    return write_all(fd, reinterpret_cast<const std::byte*>(text.data()), text.size());
+}
+
+template<std::size_t CapacityV>
+struct Packet
+{
+    std::size_t size = 0;
+    PPU::PixelFormat format{};
+    alignas(utility::CACHE_LINE) std::array<std::byte, CapacityV> data{};
+};
+
+/** @brief Frames in any PixelFormat -> Y4M or RGB24, on the writer thread */
+class VideoEncoder
+{
+public:
+    static constexpr std::size_t PACKET = PPU::FrameBuffers::MAX_BYTES;
+    static constexpr std::size_t PACKETS = 8;
+
+    explicit VideoEncoder(const Options& options) noexcept
+    : m_container{options.video}
+    , m_colors{options.colors}
+    {}
+
+    [[nodiscard]] int begin(const int fd) noexcept
+    {
+        if (m_container != VideoContainer::Y4M)
+            return 0;
+        // 4194304 Hz / 70224 cycles per frame = ~59.73 fps
+        return write_all(fd, "YUV4MPEG2 W160 H144 F4194304:70224 Ip A1:1 C444\n");
+    }
+
+    [[nodiscard]] int encode(const int fd, const Packet<PACKET>& packet) noexcept
+    {
+        constexpr std::size_t PIXELS = PPU::WIDTH * PPU::HEIGHT;
+        const std::size_t bpp = PPU::bytes_per_pixel(packet.format);
+        std::byte* out = m_scratch.data();
+
+        if (m_container == VideoContainer::Y4M) {
+            constexpr std::string_view FRAME = "FRAME\n";
+            std::memcpy(out, FRAME.data(), FRAME.size());
+            std::byte* y = out + FRAME.size();
+            std::byte* u = y + PIXELS;
+            std::byte* v = u + PIXELS;
+            for (std::size_t i = 0; i < PIXELS; ++i) {
+                const PPU::Color c = color(packet.data.data() + i * bpp, packet.format);
+                const int r = c.r, g = c.g, b = c.b;
+                y[i] = static_cast<std::byte>(16 + ((66 * r + 129 * g + 25 * b + 128) >> 8));
+                u[i] = static_cast<std::byte>(128 + ((-38 * r - 74 * g + 112 * b + 128) >> 8));
+                v[i] = static_cast<std::byte>(128 + ((112 * r - 94 * g - 18 * b + 128) >> 8));
+            }
+            return write_all(fd, out, FRAME.size() + 3 * PIXELS);
+        }
+
+        for (std::size_t i = 0; i < PIXELS; ++i) {
+            const PPU::Color c = color(packet.data.data() + i * bpp, packet.format);
+            out[3 * i + 0] = static_cast<std::byte>(c.r);
+            out[3 * i + 1] = static_cast<std::byte>(c.g);
+            out[3 * i + 2] = static_cast<std::byte>(c.b);
+        }
+        return write_all(fd, out, 3 * PIXELS);
+    }
+
+    [[nodiscard]] int end(const int) noexcept { return 0; }
+
+private:
+    [[nodiscard]] PPU::Color color(const std::byte* pixel, const PPU::PixelFormat format) const noexcept
+    {
+        switch (format) {
+        case PPU::PixelFormat::Shade:
+            return m_colors[static_cast<std::size_t>(pixel[0]) & 0b11];
+        case PPU::PixelFormat::Gray8: {
+            const Data gray = static_cast<Data>(pixel[0]);
+            return PPU::Color{gray, gray, gray};
+        }
+        case PPU::PixelFormat::RGBA8888:
+            return PPU::Color{static_cast<Data>(pixel[0]), static_cast<Data>(pixel[1]), static_cast<Data>(pixel[2])};
+        case PPU::PixelFormat::RGB565: {
+            std::uint16_t p;
+            std::memcpy(&p, pixel, sizeof(p));
+            const unsigned r = p >> 11, g = (p >> 5) & 0x3F, b = p & 0x1F;
+            return PPU::Color{static_cast<Data>(r << 3 | r >> 2), static_cast<Data>(g << 2 | g >> 4), static_cast<Data>(b << 3 | b >> 2)};
+        }
+        }
+        return PPU::Color{};
+    }
+
+    const VideoContainer m_container;
+    const PPU::ShadeColors m_colors;
+    std::array<std::byte, 6 + 3 * PPU::WIDTH * PPU::HEIGHT> m_scratch{};
+};
+
+/** @brief s16 PCM -> WAV or raw, on the writer thread */
+class AudioEncoder
+{
+public:
+    static constexpr std::size_t PACKET = 16 * 1024;
+    static constexpr std::size_t PACKETS = 16;
+
+    explicit AudioEncoder(const Options& options) noexcept
+    : m_container{options.audio}
+    , m_rate{options.sample_rate}
+    , m_channels{options.channels}
+    {}
+
+    [[nodiscard]] int begin(const int fd) noexcept
+    {
+        if (m_container != AudioContainer::WAV)
+            return 0;
+        // unknown length: 0xFFFFFFFF is what ffmpeg and sox expect from a pipe
+        const std::array<std::byte, HEADER> header = wav_header(0xFFFFFFFF);
+        return write_all(fd, header.data(), header.size());
+    }
+
+    [[nodiscard]] int encode(const int fd, const Packet<PACKET>& packet) noexcept
+    {
+        m_bytes += packet.size;
+        return write_all(fd, packet.data.data(), packet.size);
+    }
+
+    // Patches the RIFF and data sizes into the header when writing to a file
+    [[nodiscard]] int end(const int fd) noexcept
+    {
+        if (m_container != AudioContainer::WAV || ::lseek(fd, 0, SEEK_CUR) < 0)
+            return 0;
+        const std::uint32_t size = static_cast<std::uint32_t>(std::min<std::uint64_t>(m_bytes, 0xFFFFFFFF - HEADER));
+        const std::array<std::byte, HEADER> header = wav_header(size);
+        return ::pwrite(fd, header.data(), header.size(), 0) == static_cast<ssize_t>(header.size()) ? 0 : errno;
+    }
+
+private:
+    static constexpr std::size_t HEADER = 44;
+
+    [[nodiscard]] std::array<std::byte, HEADER> wav_header(const std::uint32_t data_size) const noexcept
+    {
+        std::array<std::byte, HEADER> header{};
+        std::size_t at = 0;
+        const auto text = [&](const std::string_view s) {
+            std::memcpy(header.data() + at, s.data(), 4);
+            at += 4;
+        };
+        const auto le = [&](const std::uint32_t value, const std::size_t bytes) {
+            for (std::size_t i = 0; i < bytes; ++i)
+                header[at++] = static_cast<std::byte>(value >> (8 * i));
+        };
+        const std::uint32_t block = m_channels * 2u;
+        text("RIFF"); le(data_size == 0xFFFFFFFF ? data_size : data_size + HEADER - 8, 4); text("WAVE");
+        text("fmt "); le(16, 4); le(1, 2); le(m_channels, 2); le(m_rate, 4); le(m_rate * block, 4); le(block, 2); le(16, 2);
+        text("data"); le(data_size, 4);
+        return header;
+    }
+
+    const AudioContainer m_container;
+    const std::uint32_t m_rate;
+    const std::uint16_t m_channels;
+    std::uint64_t m_bytes = 0;
+};
+
+/** @brief One fd drained by one writer thread from a bounded pool of preallocated packets.
+ * @details
+ * The emulation thread takes a free packet, copies into it and queues it; the writer thread
+ * encodes, writes and returns it. Both directions are SPSC rings so neither side locks, and
+ * no memory is allocated after construction. Each stream has its own thread so a consumer
+ * reading two pipes in lockstep (ffmpeg with separate video and audio inputs) can never
+ * deadlock on one of them.
+ *
+ * After a write error the stream keeps recycling packets but stops writing; error() returns
+ * the errno. SIGPIPE is blocked on the writer thread, so a reader that went away shows up
+ * as EPIPE instead of killing the process; callers need not ignore it.
+ */
+template<typename EncoderT>
+class StreamWriter
+{
+public:
+    using Packet = impl::Packet<EncoderT::PACKET>;
+
+    StreamWriter(const int fd, const Backpressure policy, const Options& options)
+    : m_fd{fd}
+    , m_policy{policy}
+    , m_encoder{options}
+    , m_packets{std::make_unique<std::array<Packet, EncoderT::PACKETS>>()}
+    {
+        for (Packet& packet : *m_packets)
+            m_free.push(&packet);
+        m_thread = std::jthread{[this](std::stop_token stop) { run(stop); }};
+    }
+
+    StreamWriter(const StreamWriter&) = delete;
+    StreamWriter& operator=(const StreamWriter&) = delete;
+
+    // Drains everything queued, finishes the container and joins
+    ~StreamWriter()
+    {
+        m_thread.request_stop();
+        wake();
+    }
+
+    // --- emulation thread ---
+
+    // nullptr when dropping under Backpressure::Drop
+    [[nodiscard]] Packet* acquire() noexcept
+    {
+        for (;;) {
+            if (const auto packet = m_free.try_pop())
+                return *packet;
+            if (m_policy == Backpressure::Drop)
+                return nullptr;
+            std::this_thread::yield();
+        }
+    }
+
+    void submit(Packet* packet) noexcept
+    {
+        m_queue.push(packet); // never full: it holds at most every packet
+        wake();
+    }
+
+    [[nodiscard]] int error() const noexcept { return m_error.load(std::memory_order_relaxed); }
+
+private:
+    void wake() noexcept
+    {
+        m_submitted.fetch_add(1, std::memory_order_release);
+        m_submitted.notify_one();
+    }
+
+    // --- writer thread ---
+
+    void run(const std::stop_token stop)
+    {
+        impl::block_sigpipe();
+        fail(m_encoder.begin(m_fd));
+        for (;;) {
+            const std::uint32_t seen = m_submitted.load(std::memory_order_acquire);
+            // read before draining: everything submitted before the stop is written below
+            const bool stopping = stop.stop_requested();
+            while (const auto packet = m_queue.try_pop()) {
+                if (!error())
+                    fail(m_encoder.encode(m_fd, **packet));
+                m_free.push(*packet);
+            }
+            if (stopping)
+                break;
+            m_submitted.wait(seen, std::memory_order_acquire);
+        }
+        if (!error())
+            fail(m_encoder.end(m_fd));
+    }
+
+    void fail(const int code) noexcept
+    {
+        if (code)
+            m_error.store(code, std::memory_order_relaxed);
+    }
+
+    const int m_fd;
+    const Backpressure m_policy;
+
+    // writer thread
+    EncoderT m_encoder;
+
+    std::unique_ptr<std::array<Packet, EncoderT::PACKETS>> m_packets;
+    utility::SpscRing<Packet*, EncoderT::PACKETS> m_queue; // emulation -> writer
+    utility::SpscRing<Packet*, EncoderT::PACKETS> m_free;  // writer -> emulation
+    std::atomic<std::uint32_t> m_submitted{0};
+    std::atomic<int> m_error{0};
+
+    std::jthread m_thread; // last: started after and joined before everything above
+};
+
+} // namespace impl
+
+/** @brief Streams frames and PCM audio to file descriptors (files, or pipes into ffmpeg).
+ * @details
+ * The emulation thread only copies into pooled buffers; conversion and every write(2)
+ * happen on one writer thread per stream. With Backpressure::Drop a slow consumer loses
+ * whole frames or sample chunks (see dropped_frames()/dropped_samples()) instead of
+ * stalling emulation. The fds are not closed; close them after destroying the Exporter so
+ * the reader sees EOF only once everything is written.
+ */
+class Exporter
+{
+public:
+    explicit Exporter(const Options& options)
+    {
+        if (options.video_fd >= 0)
+            m_video.emplace(options.video_fd, options.policy, options);
+        if (options.audio_fd >= 0)
+            m_audio.emplace(options.audio_fd, options.policy, options);
+    }
+
+    Exporter(const Exporter&) = delete;
+    Exporter& operator=(const Exporter&) = delete;
+
+    // Typically `if (buffers.fresh()) exporter.frame(buffers.acquire());`. False if dropped.
+    bool frame(const PPU::FrameView& view) noexcept
+    {
+        if (!m_video)
+            return true;
+        auto* packet = m_video->acquire();
+        if (!packet) {
+            ++m_dropped_frames;
+            return false;
+        }
+        const std::size_t size = std::min(view.pixels.size(), packet->data.size());
+        std::memcpy(packet->data.data(), view.pixels.data(), size);
+        packet->size = size;
+        packet->format = view.format;
+        m_video->submit(packet);
+        return true;
+    }
+
+    // Interleaved samples. Returns how many were queued (all of them unless dropping).
+    std::size_t audio(std::span<const std::int16_t> samples) noexcept
+    {
+        if (!m_audio)
+            return samples.size();
+        constexpr std::size_t CHUNK = impl::AudioEncoder::PACKET / sizeof(std::int16_t);
+        std::size_t queued = 0;
+        while (queued < samples.size()) {
+            auto* packet = m_audio->acquire();
+            if (!packet)
+                break;
+            const std::size_t count = std::min(CHUNK, samples.size() - queued);
+            std::memcpy(packet->data.data(), samples.data() + queued, count * sizeof(std::int16_t));
+            packet->size = count * sizeof(std::int16_t);
+            m_audio->submit(packet);
+            queued += count;
+        }
+        m_dropped_samples += samples.size() - queued;
+        return queued;
+    }
+
+    [[nodiscard]] std::uint64_t dropped_frames() const noexcept { return m_dropped_frames; }
+    [[nodiscard]] std::uint64_t dropped_samples() const noexcept { return m_dropped_samples; }
+
+    // errno of the first failed write on either stream, 0 if none
+    [[nodiscard]] int error() const noexcept
+    {
+        if (m_video && m_video->error())
+            return m_video->error();
+        return m_audio ? m_audio->error() : 0;
+    }
+
+private:
+    std::uint64_t m_dropped_frames = 0;
+    std::uint64_t m_dropped_samples = 0;
+    std::optional<impl::StreamWriter<impl::VideoEncoder>> m_video;
+    std::optional<impl::StreamWriter<impl::AudioEncoder>> m_audio;
+};
+
+} // namespace LR35902::Export
+
+#endif // LR35902_EXPORTER_HPP
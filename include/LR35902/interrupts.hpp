@@ -0,0 +1,173 @@
+#ifndef LR35902_INTERRUPTS_HPP
+#define LR35902_INTERRUPTS_HPP
+
+#include <bit>
+#include <cstdint>
+
+#include "types.hpp"
+#include "mmu.hpp"
+#include "scheduler.hpp"
+#include "savestate.hpp"
+
+namespace LR35902
+{
+
+/** @brief Interrupt sources in priority order (bit index into IF/IE)
+ * @details
+ * ---------------------
+ * BIT      VECTOR      SOURCE
+ * ---------------------
+ * 0        0x0040      VBlank
+ * 1        0x0048      LCD STAT
+ * 2        0x0050      Timer
+ * 3        0x0058      Serial
+ * 4        0x0060      Joypad
+ */
+enum class Interrupt : std::uint8_t
+{
+    VBlank = 0,
+    STAT   = 1,
+    Timer  = 2,
+    Serial = 3,
+    Joypad = 4,
+};
+
+[[nodiscard]] constexpr Addr vector(const Interrupt interrupt) noexcept
+{
+    return Addr{0x0040} + Addr{8} * static_cast<Addr>(interrupt);
+}
+
+/** @brief IF (0xFF0F) and IE (0xFFFF)
+ * @details
+ * The interrupt lines are only re-evaluated when they can change: a component raising a
+ * request, the CPU acknowledging one, or a write to IF/IE. Whenever an interrupt becomes
+ * pending Event::Interrupt is scheduled for now, which stops the CPU run loop at the
+ * current instruction boundary. That includes one joining others that were already
+ * pending, which is what ends STOP (see Sleep). The CPU itself never polls IF & IE.
+ */
+class Interrupts
+{
+public:
+    using RegionIF = MMU::MemoryRegions::IF;
+    using RegionIE = MMU::MemoryRegions::IE;
+
+    static constexpr Data MASK = 0b0001'1111;
+
+    constexpr explicit Interrupts(Scheduler& scheduler) noexcept
+    : m_scheduler{scheduler}
+    {}
+
+    [[nodiscard]] inline constexpr bool for_me(const Addr addr) const noexcept
+    {
+        return RegionIF::isMember(addr) || RegionIE::isMember(addr);
+    }
+
+    inline constexpr void write(const Addr addr, const Data data) noexcept
+    {
+        if (RegionIF::isMember(addr))
+            m_IF = data & MASK;
+        else
+            m_IE = data;
+        update();
+    }
+
+    [[nodiscard]] inline constexpr Data read(const Addr addr) const noexcept
+    {
+        // upper 3 bits of IF are unused and always read back as 1
+        return RegionIF::isMember(addr) ? Data(m_IF | ~MASK) : m_IE;
+    }
+
+    inline constexpr void request(const Interrupt interrupt) noexcept
+    {
+        m_IF |= bit(interrupt);
+        update();
+    }
+
+    inline constexpr void acknowledge(const Interrupt interrupt) noexcept
+    {
+        m_IF &= ~bit(interrupt);
+        update();
+    }
+
+    // Cached IF & IE, only recomputed by update()
+    [[nodiscard]] inline constexpr bool pending() const noexcept { return m_pending != 0; }
+    [[nodiscard]] inline constexpr bool pending(const Interrupt interrupt) const noexcept { return (m_pending & bit(interrupt)) != 0; }
+
+    // Highest priority pending interrupt. Only valid when pending()
+    [[nodiscard]] inline constexpr Interrupt highest() const noexcept
+    {
+        return static_cast<Interrupt>(std::countr_zero(m_pending));
+    }
+
+    // Call when the CPU can start servicing again (EI taking effect, leaving HALT)
+    inline constexpr void recheck() noexcept
+    {
+        if (pending())
+            m_scheduler.schedule(Event::Interrupt, m_scheduler.now());
+    }
+
+    void describe(StateLayout& layout) { layout.regions(m_IF, m_IE, m_pending); }
+
+private:
+    [[nodiscard]] static constexpr Data bit(const Interrupt interrupt) noexcept
+    {
+        return Data(1u << static_cast<unsigned>(interrupt));
+    }
+
+    inline constexpr void update() noexcept
+    {
+        const Data pending = m_IF & m_IE & MASK;
+        if (pending & ~m_pending)
+            m_scheduler.schedule(Event::Interrupt, m_scheduler.now());
+        else if (!pending)
+            m_scheduler.cancel(Event::Interrupt);
+        m_pending = pending;
+    }
+
+    Scheduler& m_scheduler;
+    Data m_IF = 0;
+    Data m_IE = 0;
+    Data m_pending = 0;
+};
+
+/** @brief HALT and STOP, the CPU waiting for an interrupt
+ * @details
+ * HALT ends on any pending interrupt (IF & IE), even with IME off. STOP only ends once
+ * Joypad is pending, whatever else already is. Entering either rechecks the lines: an
+ * interrupt that was already pending was announced before the CPU slept.
+ */
+class Sleep
+{
+public:
+    inline constexpr void halt(Interrupts& interrupts) noexcept
+    {
+        m_halt = true;
+        interrupts.recheck();
+    }
+
+    inline constexpr void stop(Interrupts& interrupts) noexcept
+    {
+        m_stop = true;
+        interrupts.recheck();
+    }
+
+    [[nodiscard]] inline constexpr bool halted() const noexcept { return m_halt || m_stop; }
+
+    // Called when Event::Interrupt fires
+    inline constexpr void wake(const Interrupts& interrupts) noexcept
+    {
+        if (!interrupts.pending())
+            return;
+        m_halt = false;
+        if (interrupts.pending(Interrupt::Joypad))
+            m_stop = false;
+    }
+
+private:
+    bool m_halt = false;
+    bool m_stop = false;
+};
+
+} // namespace LR35902
+
+#endif // LR35902_INTERRUPTS_HPP
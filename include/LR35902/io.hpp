@@ -0,0 +1,409 @@
+#ifndef LR35902_IO_HPP
+#define LR35902_IO_HPP
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <tuple>
+#include <type_traits>
+
+#include "types.hpp"
+#include "mmu.hpp"
+#include "savestate.hpp"
+
+namespace LR35902::IO
+{
+
+/** @brief Compile time description of one IO register
+ * @details
+ * WRITABLE   bits the CPU can change, the rest of a write is dropped
+ * READ_ONES  unused or write-only bits, they read back as 1
+ * STROBE     the write itself is the event (DIV reset, DMA start, ...) so observers are
+ *            told about every write, not only about changes
+ */
+template<typename RegionT, Data WritableV = 0xFF, Data ReadOnesV = 0x00, bool StrobeV = false>
+struct Register
+{
+    using Region = RegionT;
+    static constexpr Addr ADDR = Region::min();
+    static constexpr Data WRITABLE = WritableV;
+    static constexpr Data READ_ONES = ReadOnesV;
+    static constexpr bool STROBE = StrobeV;
+};
+
+/** @brief Bits `MaskV` of register `RegisterT`. Single bit fields are bool. */
+template<typename RegisterT, Data MaskV>
+struct Field
+{
+    static_assert(MaskV != 0, "Field needs at least one bit.");
+
+    using Register = RegisterT;
+    using value_type = std::conditional_t<std::popcount(MaskV) == 1, bool, Data>;
+
+    static constexpr Data MASK = MaskV;
+    static constexpr unsigned SHIFT = std::countr_zero(MaskV);
+
+    [[nodiscard]] static constexpr value_type get(const Data reg) noexcept
+    {
+        return static_cast<value_type>((reg & MASK) >> SHIFT);
+    }
+
+    [[nodiscard]] static constexpr Data set(const Data reg, const value_type value) noexcept
+    {
+        return static_cast<Data>((reg & ~MASK) | ((static_cast<Data>(value) << SHIFT) & MASK));
+    }
+};
+
+namespace Regions = MMU::MemoryRegions;
+
+// https://gbdev.io/pandocs/ - masks as seen on DMG/CGB
+
+struct JPAD : Register<Regions::JPAD, 0x30, 0xC0>
+{
+    using SelectButtons = Field<JPAD, 0b0010'0000>;
+    using SelectDPad    = Field<JPAD, 0b0001'0000>;
+    using Keys          = Field<JPAD, 0b0000'1111>; // 0 = pressed
+};
+
+struct SerTxRx : Register<Regions::SerTxRx> {};
+
+struct SerCtrl : Register<Regions::SerCtrl, 0x83, 0x7C>
+{
+    using Transfer = Field<SerCtrl, 0b1000'0000>;
+    using Speed    = Field<SerCtrl, 0b0000'0010>; // CGB
+    using Clock    = Field<SerCtrl, 0b0000'0001>; // 1 = internal
+};
+
+struct DIV  : Register<Regions::DIV, 0x00, 0x00, true> {};
+struct TIMA : Register<Regions::TIMA, 0xFF, 0x00, true> {}; // strobe: the stored byte is stale, see Timer
+struct TMA  : Register<Regions::TMA> {};
+
+struct TAC : Register<Regions::TAC, 0x07, 0xF8>
+{
+    using Enable = Field<TAC, 0b0000'0100>;
+    using Clock  = Field<TAC, 0b0000'0011>;
+};
+
+struct IF : Register<Regions::IF, 0x1F, 0xE0> {};
+
+struct NR10 : Register<Regions::NR10, 0x7F, 0x80> {};
+struct NR11 : Register<Regions::NR11, 0xFF, 0x3F, true> {}; // strobe: every write reloads the length
+struct NR12 : Register<Regions::NR12> {};
+struct NR13 : Register<Regions::NR13, 0xFF, 0xFF> {};
+struct NR14 : Register<Regions::NR14, 0xC7, 0xBF, true> {};
+struct NR21 : Register<Regions::NR21, 0xFF, 0x3F, true> {};
+struct NR22 : Register<Regions::NR22> {};
+struct NR23 : Register<Regions::NR23, 0xFF, 0xFF> {};
+struct NR24 : Register<Regions::NR24, 0xC7, 0xBF, true> {};
+struct NR30 : Register<Regions::NR30, 0x80, 0x7F> {};
+struct NR31 : Register<Regions::NR31, 0xFF, 0xFF, true> {};
+struct NR32 : Register<Regions::NR32, 0x60, 0x9F> {};
+struct NR33 : Register<Regions::NR33, 0xFF, 0xFF> {};
+struct NR34 : Register<Regions::NR34, 0xC7, 0xBF, true> {};
+struct NR41 : Register<Regions::NR41, 0x3F, 0xFF, true> {};
+struct NR42 : Register<Regions::NR42> {};
+struct NR43 : Register<Regions::NR43> {};
+struct NR44 : Register<Regions::NR44, 0xC0, 0xBF, true> {};
+struct NR50 : Register<Regions::NR50> {};
+struct NR51 : Register<Regions::NR51> {};
+
+struct NR52 : Register<Regions::NR52, 0x80, 0x70>
+{
+    using Enable = Field<NR52, 0b1000'0000>;
+    using CH4    = Field<NR52, 0b0000'1000>; // read only, channel is on
+    using CH3    = Field<NR52, 0b0000'0100>;
+    using CH2    = Field<NR52, 0b0000'0010>;
+    using CH1    = Field<NR52, 0b0000'0001>;
+};
+
+/** @brief LCDC - LCD Control Register (0=OFF; 1=ON)
+ * @details
+ * ---------------------
+ * ADDR     BIT     OPTION(0/1)     Description
+ * ---------------------
+ * FF40     0       OFF/ON          BGDisplay, BG Display (for CGB)
+ *          1       OFF/ON          OBJEnable, OBJ (sprite) display enable
+ *          2       8x8/8x16        OBJSize, OBJ (sprite) size
+ *          3       9800/9C00       BGTileMapSelect, BG tile map at 9800-9BFF/9C00-9FFF
+ *          4       8800/8000       BGTileDataSelect, BG and Window tile data at 8800-97FF
+ *                                  (signed tile numbers)/8000-8FFF (unsigned)
+ *          5       OFF/ON          WinDisplayEnable, Window Display Enable
+ *          6       9800/9C00       WinTileMapSelect, Window tile map at 9800-9BFF/9C00-9FFF
+ *          7       OFF/ON          LCDDisplayEnable, LCD Display Enable (1->0 during VBlank
+ *                                  only. White when disabled)
+ * 
+ * LCDC[0] Performs different actions for different GameBoy Types
+ *  - SGB and set to 0
+ *      - background becomes blank (white)
+ *      - window may still be displayed (LCDC.5)
+ *      - sprites may still be displayed (LCDC.1)
+ *  - CGB (SGB mode)
+ *      - background becomes blank (white)
+ *      - window becomes blank(white) LCDC.5 is ignored
+ *      - sprites may still be displayed (LCDC.1)
+ *  - CGB (CGB mode)
+ *      - Background and window lose priority
+ *      - sprites will always be displayed on top of background and window
+ *          - ignores priority of OAM and BG Map attributes
+ */
+struct LCDC : Register<Regions::LCDC>
+{
+    using BGDisplay        = Field<LCDC, 0b0000'0001>;
+    using OBJEnable        = Field<LCDC, 0b0000'0010>;
+    using OBJSize          = Field<LCDC, 0b0000'0100>;
+    using BGTileMapSelect  = Field<LCDC, 0b0000'1000>;
+    using BGTileDataSelect = Field<LCDC, 0b0001'0000>;
+    using WinDisplayEnable = Field<LCDC, 0b0010'0000>;
+    using WinTileMapSelect = Field<LCDC, 0b0100'0000>;
+    using LCDDisplayEnable = Field<LCDC, 0b1000'0000>;
+};
+
+struct STAT : Register<Regions::STAT, 0x78, 0x80>
+{
+    using LYCInterrupt    = Field<STAT, 0b0100'0000>;
+    using OAMInterrupt    = Field<STAT, 0b0010'0000>;
+    using VBlankInterrupt = Field<STAT, 0b0001'0000>;
+    using HBlankInterrupt = Field<STAT, 0b0000'1000>;
+    using Coincidence     = Field<STAT, 0b0000'0100>; // read only, LY == LYC
+    using Mode            = Field<STAT, 0b0000'0011>; // read only
+};
+
+struct SCY  : Register<Regions::SCY> {};
+struct SCX  : Register<Regions::SCX> {};
+struct LY   : Register<Regions::LY, 0x00> {};
+struct LYC  : Register<Regions::LYC> {};
+struct DMA  : Register<Regions::DMA, 0xFF, 0x00, true> {};
+struct BGP  : Register<Regions::BGP> {};
+struct OBP0 : Register<Regions::OBP0> {};
+struct OBP1 : Register<Regions::OBP1> {};
+struct WY   : Register<Regions::WY> {};
+struct WX   : Register<Regions::WX> {};
+
+struct KEY1 : Register<Regions::KEY1, 0x01, 0x7E>
+{
+    using CurrentSpeed = Field<KEY1, 0b1000'0000>; // read only
+    using Prepare      = Field<KEY1, 0b0000'0001>;
+};
+
+struct VBK   : Register<Regions::VBK, 0x01, 0xFE> {};
+struct HDMA1 : Register<Regions::HDMA1, 0xFF, 0xFF> {};
+struct HDMA2 : Register<Regions::HDMA2, 0xF0, 0xFF> {};
+struct HDMA3 : Register<Regions::HDMA3, 0x1F, 0xFF> {};
+struct HDMA4 : Register<Regions::HDMA4, 0xF0, 0xFF> {};
+struct HDMA5 : Register<Regions::HDMA5, 0xFF, 0x00, true> {};
+struct RP    : Register<Regions::RP, 0xC1, 0x3C> {};
+
+struct BGPI : Register<Regions::BGPI, 0xBF, 0x40>
+{
+    using AutoIncrement = Field<BGPI, 0b1000'0000>;
+    using Index         = Field<BGPI, 0b0011'1111>;
+};
+
+struct BGPD  : Register<Regions::BGPD, 0xFF, 0x00, true> {};
+
+struct OBPI : Register<Regions::OBPI, 0xBF, 0x40>
+{
+    using AutoIncrement = Field<OBPI, 0b1000'0000>;
+    using Index         = Field<OBPI, 0b0011'1111>;
+};
+
+struct OBPD  : Register<Regions::OBPD, 0xFF, 0x00, true> {};
+
+struct OPRI  : Register<Regions::OPRI, 0x01, 0xFE> {};
+struct SVBK  : Register<Regions::SVBK, 0x07, 0xF8> {};
+struct PCM12 : Register<Regions::PCM12, 0x00> {};
+struct PCM34 : Register<Regions::PCM34, 0x00> {};
+
+// Wave RAM is plain storage, described byte by byte
+template<std::size_t IndexV>
+struct WaveRAM : Register<Regions::Singular<static_cast<Addr>(Regions::WRAM::min() + IndexV)>> {};
+
+namespace impl
+{
+
+template<std::size_t... Is>
+auto wave_ram(std::index_sequence<Is...>) -> std::tuple<WaveRAM<Is>...>;
+
+} // namespace impl
+
+using WaveRegisters = decltype(impl::wave_ram(std::make_index_sequence<16>{}));
+
+using Registers = decltype(std::tuple_cat(
+    std::tuple<
+        JPAD, SerTxRx, SerCtrl, DIV, TIMA, TMA, TAC, IF,
+        NR10, NR11, NR12, NR13, NR14, NR21, NR22, NR23, NR24,
+        NR30, NR31, NR32, NR33, NR34, NR41, NR42, NR43, NR44, NR50, NR51, NR52,
+        LCDC, STAT, SCY, SCX, LY, LYC, DMA, BGP, OBP0, OBP1, WY, WX,
+        KEY1, VBK, HDMA1, HDMA2, HDMA3, HDMA4, HDMA5, RP, BGPI, BGPD, OBPI, OBPD, OPRI, SVBK, PCM12, PCM34>{},
+    WaveRegisters{}));
+
+namespace impl
+{
+
+struct Description
+{
+    Data writable = 0x00;
+    Data read_ones = 0xFF;
+    bool strobe = false;
+};
+
+template<typename RegisterT>
+[[nodiscard]] constexpr std::size_t offset() noexcept
+{
+    static_assert(Regions::IOPorts::isMember(RegisterT::ADDR), "RegisterT is not an IO port.");
+    return RegisterT::ADDR - Regions::IOPorts::min();
+}
+
+inline constexpr std::array<Description, 0x80> DESCRIPTIONS = [] {
+    std::array<Description, 0x80> descriptions{};
+    std::apply([&descriptions](auto... registers) {
+        ((descriptions[offset<decltype(registers)>()] = Description{
+            decltype(registers)::WRITABLE,
+            decltype(registers)::READ_ONES,
+            decltype(registers)::STROBE}), ...);
+    }, Registers{});
+    return descriptions;
+}();
+
+} // namespace impl
+
+/** @brief 0xFF00-0xFF7F as an MMU component, described by Registers
+ * @details
+ * CPU writes go through write(): the WRITABLE mask is applied and the observers of that
+ * register are called with the old and new value when it changed (on every write for
+ * STROBE registers). Components keep whatever they derive from a register up to date in
+ * their observer instead of re-reading it, e.g. the PPU reschedules on LCDC and the timer
+ * on TAC.
+ *
+ * Hardware side updates (LY, STAT mode, NR52 channel bits) use set()/store(), which bypass
+ * the mask and do not notify.
+ *
+ * A register whose value follows from the clock (DIV, TIMA) is not stored at all: its
+ * owner registers a source with derive() and read() asks it for the value, so nothing has
+ * to count per cycle to keep the stored byte current.
+ *
+ * Addresses without a description read 0xFF and ignore writes. Components that own an
+ * address outright (Interrupts for IF) sit before the bank in the MMU.
+ */
+class RegisterBank
+{
+public:
+    using Region = Regions::IOPorts;
+    static constexpr std::size_t SIZE = 0x80;
+    static constexpr std::size_t OBSERVERS = 4; // per register
+
+    struct Observer
+    {
+        void* context = nullptr;
+        void (*notify)(void* context, Data old, Data now) = nullptr;
+    };
+
+    struct Source
+    {
+        const void* context = nullptr;
+        Data (*read)(const void* context) = nullptr;
+    };
+
+    [[nodiscard]] inline constexpr static bool for_me(const Addr addr) noexcept { return Region::isMember(addr); }
+
+    [[nodiscard]] inline constexpr Data read(const Addr addr) const noexcept
+    {
+        const std::size_t offset = addr - Region::min();
+        const Source& source = m_sources[offset];
+        const Data data = source.read ? source.read(source.context) : m_data[offset];
+        return data | impl::DESCRIPTIONS[offset].read_ones;
+    }
+
+    inline constexpr void write(const Addr addr, const Data data) noexcept
+    {
+        const std::size_t offset = addr - Region::min();
+        const impl::Description description = impl::DESCRIPTIONS[offset];
+        const Data old = m_data[offset];
+        const Data now = static_cast<Data>((old & ~description.writable) | (data & description.writable));
+        m_data[offset] = now;
+        if (now == old && !description.strobe)
+            return;
+        for (const Observer& observer : m_observers[offset]) {
+            if (!observer.notify)
+                break;
+            observer.notify(observer.context, old, now);
+        }
+    }
+
+    // Raw value (no READ_ONES)
+    template<typename RegisterT>
+    [[nodiscard]] inline constexpr Data value() const noexcept
+    {
+        return m_data[impl::offset<RegisterT>()];
+    }
+
+    // Hardware side write of a whole register
+    template<typename RegisterT>
+    inline constexpr void store(const Data data) noexcept
+    {
+        m_data[impl::offset<RegisterT>()] = data;
+    }
+
+    template<typename FieldT>
+    [[nodiscard]] inline constexpr typename FieldT::value_type get() const noexcept
+    {
+        return FieldT::get(value<typename FieldT::Register>());
+    }
+
+    // Hardware side write of a field
+    template<typename FieldT>
+    inline constexpr void set(const typename FieldT::value_type v) noexcept
+    {
+        Data& reg = m_data[impl::offset<typename FieldT::Register>()];
+        reg = FieldT::set(reg, v);
+    }
+
+    /** @brief Calls (object.*Method)(old, now) after CPU writes to RegisterT
+     * @details
+     * Observers are called in registration order. Registering more than OBSERVERS on one
+     * register is a programming error: it aborts, or fails to compile in a constant
+     * expression.
+     */
+    template<typename RegisterT, auto Method, typename T>
+    inline constexpr void observe(T& object) noexcept
+    {
+        for (Observer& observer : m_observers[impl::offset<RegisterT>()]) {
+            if (observer.notify)
+                continue;
+            observer.context = &object;
+            observer.notify = [](void* context, const Data old, const Data now) {
+                (static_cast<T*>(context)->*Method)(old, now);
+            };
+            return;
+        }
+        std::abort(); // more than OBSERVERS observers on this register
+    }
+
+    /** @brief CPU reads of RegisterT return (object.*Method)() instead of the stored value
+     * @details
+     * For registers derived from the clock. Writes are still stored and observed as usual;
+     * value() keeps returning the stored byte. One source per register, a second one
+     * replaces the first.
+     */
+    template<typename RegisterT, auto Method, typename T>
+    inline constexpr void derive(const T& object) noexcept
+    {
+        m_sources[impl::offset<RegisterT>()] = Source{&object, [](const void* context) -> Data {
+            return (static_cast<const T*>(context)->*Method)();
+        }};
+    }
+
+    // Register values only; observers and sources are wiring
+    void describe(StateLayout& layout) { layout.region(m_data); }
+
+private:
+    std::array<Data, SIZE> m_data{};
+    std::array<std::array<Observer, OBSERVERS>, SIZE> m_observers{};
+    std::array<Source, SIZE> m_sources{};
+};
+
+} // namespace LR35902::IO
+
+#endif // LR35902_IO_HPP
@@ -0,0 +1,97 @@
+#ifndef LR35902_JOYPAD_HPP
+#define LR35902_JOYPAD_HPP
+
+#include <cstdint>
+
+#include "types.hpp"
+#include "io.hpp"
+#include "state.hpp"
+#include "interrupts.hpp"
+#include "savestate.hpp"
+
+namespace LR35902
+{
+
+/** @brief Host button state, one bit per button (1 = pressed)
+ * @details
+ * The low nibble is the d-pad and the high nibble the buttons, each in JPAD bit order, so
+ * a selected group is just one nibble.
+ */
+namespace Buttons
+{
+    inline constexpr Data Right  = 0b0000'0001;
+    inline constexpr Data Left   = 0b0000'0010;
+    inline constexpr Data Up     = 0b0000'0100;
+    inline constexpr Data Down   = 0b0000'1000;
+    inline constexpr Data A      = 0b0001'0000;
+    inline constexpr Data B      = 0b0010'0000;
+    inline constexpr Data Select = 0b0100'0000;
+    inline constexpr Data Start  = 0b1000'0000;
+}
+
+/** @brief JPAD (0xFF00) key lines and the Joypad interrupt
+ * @details
+ * The key bits of JPAD are kept current in the bank whenever they can change: when the
+ * host changes the buttons and when the CPU changes the group selection. A line going
+ * low (a selected button pressed, or a group with a pressed button selected) requests
+ * the Joypad interrupt. Nothing is polled.
+ */
+class Joypad
+{
+public:
+    Joypad(Interrupts& interrupts, SystemState& system) noexcept
+    : m_interrupts{interrupts}
+    , m_io{system.io}
+    {
+        m_io.observe<IO::JPAD, &Joypad::on_select>(*this);
+        update();
+    }
+
+    Joypad(const Joypad&) = delete; // observers point at this
+    Joypad& operator=(const Joypad&) = delete;
+
+    // Sets the whole button state (see Buttons)
+    inline void buttons(const Data pressed) noexcept
+    {
+        if (pressed == m_pressed)
+            return;
+        m_pressed = pressed;
+        update();
+    }
+
+    [[nodiscard]] inline Data buttons() const noexcept { return m_pressed; }
+
+    void describe(StateLayout& layout) { layout.regions(m_pressed, m_low); }
+
+private:
+    inline void on_select(const Data, const Data) noexcept { update(); }
+
+    // Selected lines that are low (pressed), JPAD bit order
+    [[nodiscard]] inline Data lines() const noexcept
+    {
+        Data low = 0;
+        if (!m_io.get<IO::JPAD::SelectDPad>())
+            low |= m_pressed & 0x0F;
+        if (!m_io.get<IO::JPAD::SelectButtons>())
+            low |= m_pressed >> 4;
+        return low;
+    }
+
+    inline void update() noexcept
+    {
+        const Data low = lines();
+        m_io.set<IO::JPAD::Keys>(static_cast<Data>(~low & 0x0F));
+        if (low & ~m_low)
+            m_interrupts.request(Interrupt::Joypad);
+        m_low = low;
+    }
+
+    Interrupts& m_interrupts;
+    IO::RegisterBank& m_io;
+    Data m_pressed = 0;
+    Data m_low = 0;
+};
+
+} // namespace LR35902
+
+#endif // LR35902_JOYPAD_HPP
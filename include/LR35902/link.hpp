@@ -0,0 +1,452 @@
+#ifndef LR35902_LINK_HPP
+#define LR35902_LINK_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <span>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include <utility/spsc_ring.hpp>
+
+#include "types.hpp"
+
+namespace LR35902::Link
+{
+
+// The host creates the channel, the guest attaches to it
+enum class Role : std::uint8_t
+{
+    Host,
+    Guest,
+};
+
+enum class Transport : std::uint8_t
+{
+    Auto,         // shared memory when the platform has it, the socket otherwise
+    SharedMemory, // POSIX shm object "/<name>", two SPSC rings
+    Socket,       // Unix domain stream socket at socket_path()
+};
+
+struct Options
+{
+    std::string name = "gboysims-link";
+    Role role = Role::Host;
+    Transport transport = Transport::Auto;
+    std::chrono::milliseconds timeout{10'000}; // waiting for the other side to show up
+
+    [[nodiscard]] std::string shm_name() const { return "/" + name; }
+    [[nodiscard]] std::string socket_path() const { return "/tmp/" + name + ".sock"; }
+};
+
+/** @brief One unit of the serial protocol, see Serial */
+struct Message
+{
+    enum class Kind : std::uint8_t
+    {
+        Sync,  // end of quantum `value`
+        Start, // the sender's internal clock started a transfer of `byte`
+        Reply, // the sender's side of the last Start
+    };
+
+    Kind kind = Kind::Sync;
+    Data byte = 0xFF;
+    std::uint64_t value = 0;
+};
+
+static_assert(sizeof(Message) == 16);
+
+namespace impl
+{
+
+inline constexpr std::uint32_t MAGIC = 0x4C4E4B31; // "LNK1"
+
+// One direction of the shared memory channel
+struct Direction
+{
+    utility::SpscRing<Message, 256> ring;
+    alignas(utility::CACHE_LINE) std::atomic<std::uint32_t> doorbell{0}; // bumped after every push
+    std::atomic<std::uint32_t> sleeping{0};                              // consumer waits on doorbell
+    std::atomic<std::uint32_t> closed{0};                                // producer went away
+};
+
+struct Shared
+{
+    std::atomic<std::uint32_t> ready{0};    // MAGIC once the host constructed the rest
+    std::atomic<std::uint32_t> attached{0}; // set by the guest
+    std::array<Direction, 2> directions;    // [0] host to guest, [1] guest to host
+};
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free && std::atomic<std::size_t>::is_always_lock_free,
+    "Shared memory atomics must be address free.");
+
+// Process shared futex on Linux, a yield elsewhere
+inline void wait(std::atomic<std::uint32_t>& word, const std::uint32_t expected) noexcept
+{
+#if defined(__linux__)
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT, expected, nullptr, nullptr, 0);
+#else
+    if (word.load() == expected)
+        std::this_thread::yield();
+#endif
+}
+
+inline void wake(std::atomic<std::uint32_t>& word) noexcept
+{
+#if defined(__linux__)
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+// Sends all of data, retrying partial writes and EINTR. Returns 0 or errno.
+inline int send_all(const int fd, const std::byte* data, std::size_t size) noexcept
+{
+    while (size) {
+        const ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno;
+        }
+        data += sent;
+        size -= static_cast<std::size_t>(sent);
+    }
+    return 0;
+}
+
+// Receives exactly size bytes. Returns 0 or errno (EPIPE when the peer closed).
+inline int receive_all(const int fd, std::byte* data, std::size_t size) noexcept
+{
+    while (size) {
+        const ssize_t received = ::recv(fd, data, size, 0);
+        if (received < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno;
+        }
+        if (received == 0)
+            return EPIPE;
+        data += received;
+        size -= static_cast<std::size_t>(received);
+    }
+    return 0;
+}
+
+} // namespace impl
+
+/** @brief Byte channel between two emulator processes, the wire of the link cable.
+ * @details
+ * The constructor blocks until the other side is there (or Options::timeout passed);
+ * error() tells whether that worked. send() never blocks for long and receive() blocks
+ * until a message arrives or the peer is gone (EPIPE).
+ *
+ * Shared memory is a mapping of impl::Shared: one SPSC ring per direction. The consumer
+ * spins briefly (on multi core hosts) and then sleeps on a process shared futex that the producer only wakes
+ * when the consumer said it sleeps, so a busy exchange makes no system calls at all.
+ * The socket is the fallback where shm_open() is missing or not permitted; it costs a
+ * system call per batch either way.
+ *
+ * The host removes the shm object and socket file again when the cable is destroyed.
+ */
+class Cable
+{
+public:
+    static constexpr std::size_t SPINS = 4096; // polls before the consumer sleeps, multi core only
+
+    explicit Cable(const Options& options)
+    : m_options{options}
+    {
+        const auto deadline = std::chrono::steady_clock::now() + options.timeout;
+        if (options.role == Role::Host)
+            host(deadline);
+        else
+            guest(deadline);
+    }
+
+    ~Cable()
+    {
+        if (m_shared) {
+            impl::Direction& out = m_shared->directions[outgoing()];
+            out.closed.store(1);
+            out.doorbell.fetch_add(1);
+            impl::wake(out.doorbell);
+            ::munmap(m_shared, sizeof(impl::Shared));
+            if (m_options.role == Role::Host)
+                ::shm_unlink(m_options.shm_name().c_str());
+        }
+        if (m_fd >= 0)
+            ::close(m_fd);
+        if (m_options.role == Role::Host && m_transport == Transport::Socket)
+            ::unlink(m_options.socket_path().c_str());
+    }
+
+    Cable(const Cable&) = delete; // owns the mapping / socket
+    Cable& operator=(const Cable&) = delete;
+
+    // errno of connecting, 0 when connected
+    [[nodiscard]] int error() const noexcept { return m_error; }
+
+    // Transport in use (never Auto once connected)
+    [[nodiscard]] Transport transport() const noexcept { return m_transport; }
+
+    [[nodiscard]] Role role() const noexcept { return m_options.role; }
+
+    // Returns 0 or errno (EPIPE: the peer is gone)
+    int send(std::span<const Message> messages) noexcept
+    {
+        if (m_error)
+            return m_error;
+        if (!m_shared)
+            return impl::send_all(m_fd, reinterpret_cast<const std::byte*>(messages.data()), messages.size_bytes());
+
+        impl::Direction& out = m_shared->directions[outgoing()];
+        const impl::Direction& in = m_shared->directions[incoming()];
+        while (!messages.empty()) {
+            const std::size_t pushed = out.ring.try_push(messages.data(), messages.size());
+            messages = messages.subspan(pushed);
+            if (!messages.empty()) {
+                if (in.closed.load())
+                    return EPIPE;
+                std::this_thread::yield(); // the peer is a whole ring behind
+            }
+        }
+        out.doorbell.fetch_add(1);
+        if (out.sleeping.load())
+            impl::wake(out.doorbell);
+        return 0;
+    }
+
+    // Blocks for the next message. Returns 0 or errno (EPIPE: the peer is gone)
+    int receive(Message& message) noexcept
+    {
+        if (m_error)
+            return m_error;
+        if (!m_shared)
+            return impl::receive_all(m_fd, reinterpret_cast<std::byte*>(&message), sizeof(Message));
+
+        impl::Direction& in = m_shared->directions[incoming()];
+        for (std::size_t spin = 0; spin < m_spins; ++spin)
+            if (in.ring.try_pop(&message, 1))
+                return 0;
+        for (;;) {
+            in.sleeping.store(1);
+            const std::uint32_t bell = in.doorbell.load();
+            if (in.ring.try_pop(&message, 1)) {
+                in.sleeping.store(0);
+                return 0;
+            }
+            if (in.closed.load())
+                return EPIPE;
+            impl::wait(in.doorbell, bell);
+            in.sleeping.store(0);
+        }
+    }
+
+private:
+    using Deadline = std::chrono::steady_clock::time_point;
+
+    [[nodiscard]] std::size_t outgoing() const noexcept { return m_options.role == Role::Host ? 0 : 1; }
+    [[nodiscard]] std::size_t incoming() const noexcept { return 1 - outgoing(); }
+
+    void host(const Deadline deadline)
+    {
+        if (m_options.transport != Transport::Socket) {
+            m_error = create_shared(deadline);
+            // only fall back when there is no shared memory, not when the guest is late
+            if (!m_error || m_transport == Transport::SharedMemory || m_options.transport == Transport::SharedMemory)
+                return;
+        }
+        m_error = listen(deadline);
+    }
+
+    void guest(const Deadline deadline)
+    {
+        // the host may not be up yet, keep trying whatever transport it could pick
+        for (;;) {
+            if (m_options.transport != Transport::Socket) {
+                m_error = open_shared(deadline);
+                if (!m_error || (m_options.transport == Transport::SharedMemory && m_error != ENOENT))
+                    return;
+            }
+            if (m_options.transport != Transport::SharedMemory) {
+                m_error = connect();
+                if (!m_error || (m_options.transport == Transport::Socket && m_error != ENOENT && m_error != ECONNREFUSED))
+                    return;
+            }
+            if (std::chrono::steady_clock::now() >= deadline) {
+                m_error = ETIMEDOUT;
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+    }
+
+    // --- shared memory ---
+
+    int create_shared(const Deadline deadline)
+    {
+        const std::string name = m_options.shm_name();
+        int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0 && errno == EEXIST) {
+            ::shm_unlink(name.c_str()); // left behind by a host that crashed
+            fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        }
+        if (fd < 0)
+            return errno;
+        if (const int error = map(fd, true)) {
+            ::shm_unlink(name.c_str());
+            return error;
+        }
+        m_shared = new (m_shared) impl::Shared{};
+        m_shared->ready.store(impl::MAGIC);
+        m_transport = Transport::SharedMemory;
+
+        while (!m_shared->attached.load()) {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return ETIMEDOUT; // the destructor unmaps and unlinks
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+        return 0;
+    }
+
+    int open_shared(const Deadline deadline)
+    {
+        const int fd = ::shm_open(m_options.shm_name().c_str(), O_RDWR, 0600);
+        if (fd < 0)
+            return errno;
+        struct stat info{};
+        if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(impl::Shared)) {
+            ::close(fd);
+            return ENOENT; // created but not sized yet
+        }
+        if (const int error = map(fd, false))
+            return error;
+        while (m_shared->ready.load() != impl::MAGIC) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                ::munmap(m_shared, sizeof(impl::Shared));
+                m_shared = nullptr;
+                return ETIMEDOUT;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+        m_shared->attached.store(1);
+        m_transport = Transport::SharedMemory;
+        return 0;
+    }
+
+    // Maps (and for the host sizes) the shm object, closing fd either way
+    int map(const int fd, const bool size)
+    {
+        if (size && ::ftruncate(fd, sizeof(impl::Shared)) != 0) {
+            const int error = errno;
+            ::close(fd);
+            return error;
+        }
+        void* memory = ::mmap(nullptr, sizeof(impl::Shared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        const int error = errno;
+        ::close(fd);
+        if (memory == MAP_FAILED)
+            return error;
+        m_shared = static_cast<impl::Shared*>(memory);
+        return 0;
+    }
+
+    // --- socket ---
+
+    [[nodiscard]] int address(sockaddr_un& addr) const noexcept
+    {
+        const std::string path = m_options.socket_path();
+        if (path.size() >= sizeof(addr.sun_path))
+            return ENAMETOOLONG;
+        addr = sockaddr_un{};
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        return 0;
+    }
+
+    int listen(const Deadline deadline)
+    {
+        sockaddr_un addr;
+        if (const int error = address(addr))
+            return error;
+        const int server = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (server < 0)
+            return errno;
+        ::unlink(addr.sun_path);
+        m_transport = Transport::Socket; // from here on the destructor removes the file
+        if (::bind(server, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(server, 1) != 0) {
+            const int error = errno;
+            ::close(server);
+            return error;
+        }
+
+        pollfd pending{server, POLLIN, 0};
+        for (;;) {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            const int ready = ::poll(&pending, 1, static_cast<int>(std::max<std::int64_t>(0, left.count())));
+            if (ready < 0 && errno == EINTR)
+                continue;
+            if (ready <= 0) {
+                const int error = ready == 0 ? ETIMEDOUT : errno;
+                ::close(server);
+                return error;
+            }
+            break;
+        }
+        m_fd = ::accept4(server, nullptr, nullptr, SOCK_CLOEXEC);
+        const int error = m_fd < 0 ? errno : 0;
+        ::close(server);
+        return error;
+    }
+
+    int connect()
+    {
+        sockaddr_un addr;
+        if (const int error = address(addr))
+            return error;
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            return errno;
+        if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+            const int error = errno;
+            ::close(fd);
+            return error;
+        }
+        m_fd = fd;
+        m_transport = Transport::Socket;
+        return 0;
+    }
+
+    const Options m_options;
+    Transport m_transport = Transport::Auto;
+    int m_error = 0;
+    impl::Shared* m_shared = nullptr;
+    int m_fd = -1;
+    // spinning on one core only delays the peer it waits for
+    const std::size_t m_spins = std::thread::hardware_concurrency() > 1 ? SPINS : 0;
+};
+
+} // namespace LR35902::Link
+
+#endif // LR35902_LINK_HPP
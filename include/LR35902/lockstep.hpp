@@ -0,0 +1,1231 @@
+#ifndef LR35902_LOCKSTEP_HPP
+#define LR35902_LOCKSTEP_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <utility/simd.hpp>
+
+#include "types.hpp"
+#include "opcodes.hpp"
+#include "movie.hpp"
+
+// Lane code is always inlined so each kernel below compiles all of it for its own target
+#define LR35902_LANE_INLINE [[gnu::always_inline]] inline
+
+namespace LR35902::Lockstep
+{
+
+static constexpr std::size_t WIDTH = 32; // lanes per block, one AVX2 register of bytes
+
+namespace impl
+{
+
+// Aligned explicitly: without AVX enabled GCC would align them to 16 bytes, while code in the
+// AVX2 kernel assumes full alignment
+using Bytes = Data __attribute__((vector_size(WIDTH), aligned(WIDTH)));
+using Words = std::uint16_t __attribute__((vector_size(2 * WIDTH), aligned(2 * WIDTH)));
+using ByteMask = std::int8_t __attribute__((vector_size(WIDTH), aligned(WIDTH)));         // Bytes comparisons, -1 = true
+using WordMask = std::int16_t __attribute__((vector_size(2 * WIDTH), aligned(2 * WIDTH))); // Words comparisons
+
+namespace Flag
+{
+    inline constexpr Data Z = 0x80;
+    inline constexpr Data N = 0x40;
+    inline constexpr Data H = 0x20;
+    inline constexpr Data C = 0x10;
+}
+
+// Slots of Registers::r, in operand encoding order with F where (HL) would be
+namespace Reg
+{
+    inline constexpr std::size_t B = 0, C = 1, D = 2, E = 3, H = 4, L = 5, F = 6, A = 7;
+}
+
+/***
+ * Lane helpers. Instructions are written once against a lane type and instantiated
+ * twice: with B/W = Data/std::uint16_t and M = bool for one lane (scalar execution) and
+ * with B/W = Bytes/Words and M = ByteMask for a block of WIDTH lanes (GCC vector
+ * extensions, lowered to AVX2 or SSE2 by the kernel that inlines them).
+ */
+LR35902_LANE_INLINE Words widen(const Bytes v) noexcept { return __builtin_convertvector(v, Words); }
+LR35902_LANE_INLINE std::uint16_t widen(const Data v) noexcept { return v; }
+LR35902_LANE_INLINE Bytes narrow(const Words v) noexcept { return __builtin_convertvector(v, Bytes); }
+LR35902_LANE_INLINE Data narrow(const std::uint16_t v) noexcept { return static_cast<Data>(v); }
+
+// `bit` in lanes where `m` holds, 0 elsewhere
+LR35902_LANE_INLINE Bytes bits(const ByteMask m, const Data bit) noexcept { return reinterpret_cast<const Bytes&>(m) & bit; }
+LR35902_LANE_INLINE Data bits(const bool m, const Data bit) noexcept { return m ? bit : 0; }
+
+LR35902_LANE_INLINE Bytes select(const ByteMask m, const Bytes a, const Bytes b) noexcept { return m ? a : b; }
+LR35902_LANE_INLINE Words select(const ByteMask m, const Words a, const Words b) noexcept
+{
+    return __builtin_convertvector(m, WordMask) ? a : b;
+}
+template<typename T>
+LR35902_LANE_INLINE T select(const bool m, const T a, const T b) noexcept { return m ? a : b; }
+
+LR35902_LANE_INLINE ByteMask narrow(const WordMask m) noexcept { return __builtin_convertvector(m, ByteMask); }
+LR35902_LANE_INLINE bool narrow(const bool m) noexcept { return m; }
+
+template<typename T>
+LR35902_LANE_INLINE T splat(const unsigned value) noexcept
+{
+    if constexpr (std::is_arithmetic_v<T>)
+        return static_cast<T>(value);
+    else
+        return T{} + static_cast<std::remove_cvref_t<decltype(std::declval<T>()[0])>>(value);
+}
+
+template<typename V>
+LR35902_LANE_INLINE bool any(const V mask) noexcept
+{
+    std::array<std::uint64_t, sizeof(V) / 8> words;
+    std::memcpy(words.data(), &mask, sizeof(V));
+    std::uint64_t set = 0;
+    for (const std::uint64_t word : words)
+        set |= word;
+    return set != 0;
+}
+
+LR35902_LANE_INLINE std::size_t count(const ByteMask mask) noexcept
+{
+    std::array<std::uint64_t, WIDTH / 8> words;
+    std::memcpy(words.data(), &mask, WIDTH);
+    std::size_t set = 0;
+    for (const std::uint64_t word : words)
+        set += static_cast<std::size_t>(std::popcount(word));
+    return set / 8;
+}
+
+// JPAD as read back: `written` select bits (4-5) and the selected key lines, low = pressed
+template<typename B>
+LR35902_LANE_INLINE B jpad(const B written, const B pressed) noexcept
+{
+    const B low = B(select((written & 0x10) == 0, B(pressed & 0x0F), splat<B>(0))
+        | select((written & 0x20) == 0, B(pressed >> 4), splat<B>(0)));
+    return B(0xC0 | (written & 0x30) | (~low & 0x0F));
+}
+
+// Registers of WIDTH lanes. Vector types lose their attributes as template arguments,
+// so the two register files are spelled out instead of templated.
+struct alignas(2 * WIDTH) Block
+{
+    Bytes r[8]{}; // see Reg
+    Words sp{};
+    Words pc{};   // stale while the lane is in a lockstep group, which keeps it
+    Bytes ime{};
+    Bytes taken{}; // 1 where the last branch was taken
+    ByteMask group{}; // lanes of the current lockstep group
+};
+
+struct Lane
+{
+    Data r[8]{};
+    std::uint16_t sp = 0;
+    std::uint16_t pc = 0;
+    Data ime = 0;
+    Data taken = 0;
+};
+
+// One decoded instruction, shared by every lane that executes it
+struct Fetch
+{
+    Data op = 0;
+    bool cb = false;
+    Data n8 = 0;         // immediate, or the opcode after 0xCB
+    std::uint16_t n16 = 0;
+    std::uint16_t next = 0;
+};
+
+enum class Outcome : std::uint8_t
+{
+    Next,   // PC is Fetch::next, left for the caller to set
+    Jump,   // PC set to the same target in every lane
+    Branch, // PC set per lane (conditional, RET, JP HL); `taken` is set
+    Halt,   // HALT or STOP
+    Lock,   // illegal opcode, the CPU hangs
+};
+
+/** @brief LR35902 instruction semantics over a lane type
+ * @details
+ * Lanes provides B, W and M plus set(reg, value[, cond]) (masked register write),
+ * read(addr) and write(addr, value[, cond]) with either one address for all lanes (Addr)
+ * or one per lane (W). Only the lanes selected by the Lanes object change.
+ */
+template<typename Lanes>
+class Core
+{
+    using B = typename Lanes::B;
+    using W = typename Lanes::W;
+    using M = typename Lanes::M;
+    using Regs = typename Lanes::Regs;
+
+public:
+    LR35902_LANE_INLINE explicit Core(Lanes& lanes) noexcept
+    : x{lanes}
+    , r{lanes.regs}
+    {}
+
+    LR35902_LANE_INLINE Outcome execute(const Fetch& f) noexcept
+    {
+        return f.cb ? prefixed(f.n8) : unprefixed(f);
+    }
+
+private:
+    LR35902_LANE_INLINE W pair(const std::size_t hi) const noexcept
+    {
+        return W(widen(r.r[hi]) << 8 | widen(r.r[hi + 1]));
+    }
+
+    LR35902_LANE_INLINE void pair(const std::size_t hi, const W value) noexcept
+    {
+        x.set(r.r[hi], narrow(W(value >> 8)));
+        x.set(r.r[hi + 1], narrow(value));
+    }
+
+    LR35902_LANE_INLINE W hl() const noexcept { return pair(Reg::H); }
+
+    // BC DE HL SP
+    LR35902_LANE_INLINE W rp(const unsigned p) const noexcept { return p == 3 ? r.sp : pair(2 * p); }
+    LR35902_LANE_INLINE void rp(const unsigned p, const W value) noexcept
+    {
+        if (p == 3)
+            x.set(r.sp, value);
+        else
+            pair(2 * p, value);
+    }
+
+    // B C D E H L (HL) A
+    LR35902_LANE_INLINE B get(const unsigned z) noexcept { return z == 6 ? x.read(hl()) : r.r[z]; }
+    LR35902_LANE_INLINE void put(const unsigned z, const B value) noexcept
+    {
+        if (z == 6)
+            x.write(hl(), value);
+        else
+            x.set(r.r[z], value);
+    }
+
+    LR35902_LANE_INLINE void flags(const B value) noexcept { x.set(r.r[Reg::F], value); }
+
+    // NZ Z NC C
+    LR35902_LANE_INLINE M condition(const unsigned cc) const noexcept
+    {
+        const B f = r.r[Reg::F];
+        switch (cc) {
+        case 0: return (f & Flag::Z) == 0;
+        case 1: return (f & Flag::Z) != 0;
+        case 2: return (f & Flag::C) == 0;
+        default: return (f & Flag::C) != 0;
+        }
+    }
+
+    LR35902_LANE_INLINE void push(const W value) noexcept
+    {
+        const W sp = r.sp;
+        x.write(W(sp - 1), narrow(W(value >> 8)));
+        x.write(W(sp - 2), narrow(value));
+        x.set(r.sp, W(sp - 2));
+    }
+
+    LR35902_LANE_INLINE void push(const W value, const M cond) noexcept
+    {
+        const W sp = r.sp;
+        x.write(W(sp - 1), narrow(W(value >> 8)), cond);
+        x.write(W(sp - 2), narrow(value), cond);
+        x.set(r.sp, W(sp - 2), cond);
+    }
+
+    // Reads the top of the stack; the caller moves SP
+    LR35902_LANE_INLINE W top() noexcept
+    {
+        const W sp = r.sp;
+        return W(widen(x.read(W(sp + 1))) << 8 | widen(x.read(sp)));
+    }
+
+    LR35902_LANE_INLINE Outcome jump(const std::uint16_t target) noexcept
+    {
+        x.set(r.pc, splat<W>(target));
+        return Outcome::Jump;
+    }
+
+    LR35902_LANE_INLINE Outcome branch(const M taken, const std::uint16_t target, const std::uint16_t next) noexcept
+    {
+        x.set(r.pc, select(taken, splat<W>(target), splat<W>(next)));
+        x.set(r.taken, bits(taken, 1));
+        return Outcome::Branch;
+    }
+
+    LR35902_LANE_INLINE Outcome ret() noexcept
+    {
+        x.set(r.pc, top());
+        x.set(r.sp, W(r.sp + 2));
+        x.set(r.taken, splat<B>(1));
+        return Outcome::Branch;
+    }
+
+    // ADD ADC SUB SBC AND XOR OR CP
+    LR35902_LANE_INLINE void alu(const unsigned op, const B v) noexcept
+    {
+        const B a = r.r[Reg::A];
+        const B f = r.r[Reg::F];
+        const B carry = op == 1 || op == 3 ? B((f >> 4) & 1) : splat<B>(0);
+        switch (op) {
+        case 0:
+        case 1: {
+            const W sum = W(widen(a) + widen(v) + widen(carry));
+            const B res = narrow(sum);
+            x.set(r.r[Reg::A], res);
+            flags(B(bits(res == 0, Flag::Z) | (((a ^ v ^ res) << 1) & Flag::H) | (narrow(W(sum >> 4)) & Flag::C)));
+            break;
+        }
+        case 2:
+        case 3:
+        case 7: {
+            const W diff = W(widen(a) - widen(v) - widen(carry));
+            const B res = narrow(diff);
+            if (op != 7)
+                x.set(r.r[Reg::A], res);
+            flags(B(bits(res == 0, Flag::Z) | Flag::N | (((a ^ v ^ res) << 1) & Flag::H)
+                | (narrow(W(diff >> 4)) & Flag::C)));
+            break;
+        }
+        case 4: {
+            const B res = B(a & v);
+            x.set(r.r[Reg::A], res);
+            flags(B(bits(res == 0, Flag::Z) | Flag::H));
+            break;
+        }
+        case 5:
+        case 6: {
+            const B res = op == 5 ? B(a ^ v) : B(a | v);
+            x.set(r.r[Reg::A], res);
+            flags(bits(res == 0, Flag::Z));
+            break;
+        }
+        }
+    }
+
+    // RLCA RRCA RLA RRA DAA CPL SCF CCF
+    LR35902_LANE_INLINE void accumulator(const unsigned y) noexcept
+    {
+        const B a = r.r[Reg::A];
+        const B f = r.r[Reg::F];
+        switch (y) {
+        case 0:
+            x.set(r.r[Reg::A], B((a << 1) | (a >> 7)));
+            flags(B((a >> 3) & Flag::C));
+            break;
+        case 1:
+            x.set(r.r[Reg::A], B((a >> 1) | (a << 7)));
+            flags(B((a << 4) & Flag::C));
+            break;
+        case 2:
+            x.set(r.r[Reg::A], B((a << 1) | ((f >> 4) & 1)));
+            flags(B((a >> 3) & Flag::C));
+            break;
+        case 3:
+            x.set(r.r[Reg::A], B((a >> 1) | ((f << 3) & 0x80)));
+            flags(B((a << 4) & Flag::C));
+            break;
+        case 4: {
+            const M n = (f & Flag::N) != 0;
+            const M high = (f & Flag::C) != 0 || (!n && a > 0x99);
+            const M low = (f & Flag::H) != 0 || (!n && (a & 0x0F) > 0x09);
+            const B adjust = B(bits(high, 0x60) | bits(low, 0x06));
+            const B res = select(n, B(a - adjust), B(a + adjust));
+            x.set(r.r[Reg::A], res);
+            flags(B(bits(res == 0, Flag::Z) | (f & Flag::N) | bits(high, Flag::C)));
+            break;
+        }
+        case 5:
+            x.set(r.r[Reg::A], B(~a));
+            flags(B(f | Flag::N | Flag::H));
+            break;
+        case 6:
+            flags(B((f & Flag::Z) | Flag::C));
+            break;
+        case 7:
+            flags(B((f & Flag::Z) | ((f ^ Flag::C) & Flag::C)));
+            break;
+        }
+    }
+
+    // SP + e8 as ADD SP,e8 and LD HL,SP+e8 compute it
+    LR35902_LANE_INLINE W offset_sp(const Data e) noexcept
+    {
+        const std::uint16_t extended = static_cast<std::uint16_t>(static_cast<std::int8_t>(e));
+        const W sp = r.sp;
+        const W res = W(sp + extended);
+        const W carries = W(sp ^ extended ^ res);
+        flags(B(narrow(W((carries & 0x10) << 1)) | narrow(W((carries >> 4) & Flag::C))));
+        return res;
+    }
+
+    LR35902_LANE_INLINE Outcome unprefixed(const Fetch& f) noexcept
+    {
+        const unsigned op = f.op;
+        const unsigned y = (op >> 3) & 7, z = op & 7, p = y >> 1, q = y & 1;
+        switch (op >> 6) {
+        case 0:
+            switch (z) {
+            case 0:
+                switch (y) {
+                case 0: return Outcome::Next;
+                case 1: // LD (a16),SP
+                    x.write(f.n16, narrow(r.sp));
+                    x.write(static_cast<Addr>(f.n16 + 1), narrow(W(r.sp >> 8)));
+                    return Outcome::Next;
+                case 2: return Outcome::Halt; // STOP
+                case 3: return jump(static_cast<std::uint16_t>(f.next + static_cast<std::int8_t>(f.n8)));
+                default:
+                    return branch(condition(y - 4), static_cast<std::uint16_t>(f.next + static_cast<std::int8_t>(f.n8)), f.next);
+                }
+            case 1:
+                if (q == 0)
+                    rp(p, splat<W>(f.n16));
+                else {
+                    const W a = hl(), v = rp(p);
+                    const W res = W(a + v);
+                    const W carries = W(a ^ v ^ res);
+                    const W out = W(((a & v) | ((a | v) & ~res)) >> 11);
+                    pair(Reg::H, res);
+                    flags(B((r.r[Reg::F] & Flag::Z) | narrow(W((carries >> 7) & Flag::H)) | narrow(W(out & Flag::C))));
+                }
+                return Outcome::Next;
+            case 2: {
+                const W address = p == 0 ? pair(Reg::B) : p == 1 ? pair(Reg::D) : hl();
+                if (q == 0)
+                    x.write(address, r.r[Reg::A]);
+                else
+                    x.set(r.r[Reg::A], x.read(address));
+                if (p == 2)
+                    pair(Reg::H, W(address + 1));
+                else if (p == 3)
+                    pair(Reg::H, W(address - 1));
+                return Outcome::Next;
+            }
+            case 3:
+                rp(p, q == 0 ? W(rp(p) + 1) : W(rp(p) - 1));
+                return Outcome::Next;
+            case 4: {
+                const B res = B(get(y) + 1);
+                put(y, res);
+                flags(B(bits(res == 0, Flag::Z) | bits((res & 0x0F) == 0, Flag::H) | (r.r[Reg::F] & Flag::C)));
+                return Outcome::Next;
+            }
+            case 5: {
+                const B res = B(get(y) - 1);
+                put(y, res);
+                flags(B(bits(res == 0, Flag::Z) | Flag::N | bits((res & 0x0F) == 0x0F, Flag::H) | (r.r[Reg::F] & Flag::C)));
+                return Outcome::Next;
+            }
+            case 6:
+                put(y, splat<B>(f.n8));
+                return Outcome::Next;
+            default:
+                accumulator(y);
+                return Outcome::Next;
+            }
+        case 1:
+            if (op == 0x76)
+                return Outcome::Halt;
+            put(y, get(z));
+            return Outcome::Next;
+        case 2:
+            alu(y, get(z));
+            return Outcome::Next;
+        default:
+            switch (z) {
+            case 0:
+                switch (y) {
+                case 4:
+                    x.write(static_cast<Addr>(0xFF00 | f.n8), r.r[Reg::A]);
+                    return Outcome::Next;
+                case 5:
+                    x.set(r.sp, offset_sp(f.n8));
+                    return Outcome::Next;
+                case 6:
+                    x.set(r.r[Reg::A], x.read(static_cast<Addr>(0xFF00 | f.n8)));
+                    return Outcome::Next;
+                case 7:
+                    pair(Reg::H, offset_sp(f.n8));
+                    return Outcome::Next;
+                default: { // RET cc
+                    const M taken = condition(y);
+                    x.set(r.pc, select(taken, top(), splat<W>(f.next)));
+                    x.set(r.sp, W(r.sp + 2), taken);
+                    x.set(r.taken, bits(taken, 1));
+                    return Outcome::Branch;
+                }
+                }
+            case 1:
+                if (q == 0) {
+                    const W value = top();
+                    x.set(r.sp, W(r.sp + 2));
+                    if (p == 3) {
+                        x.set(r.r[Reg::A], narrow(W(value >> 8)));
+                        x.set(r.r[Reg::F], B(narrow(value) & 0xF0));
+                    }
+                    else
+                        rp(p, value);
+                    return Outcome::Next;
+                }
+                switch (p) {
+                case 0: return ret();
+                case 1:
+                    x.set(r.ime, splat<B>(1));
+                    return ret();
+                case 2:
+                    x.set(r.pc, hl());
+                    x.set(r.taken, splat<B>(1));
+                    return Outcome::Branch;
+                default:
+                    x.set(r.sp, hl());
+                    return Outcome::Next;
+                }
+            case 2:
+                switch (y) {
+                case 4:
+                    x.write(W(0xFF00 | widen(r.r[Reg::C])), r.r[Reg::A]);
+                    return Outcome::Next;
+                case 5:
+                    x.write(f.n16, r.r[Reg::A]);
+                    return Outcome::Next;
+                case 6:
+                    x.set(r.r[Reg::A], x.read(W(0xFF00 | widen(r.r[Reg::C]))));
+                    return Outcome::Next;
+                case 7:
+                    x.set(r.r[Reg::A], x.read(f.n16));
+                    return Outcome::Next;
+                default:
+                    return branch(condition(y), f.n16, f.next);
+                }
+            case 3:
+                switch (y) {
+                case 0: return jump(f.n16);
+                case 6:
+                    x.set(r.ime, splat<B>(0));
+                    return Outcome::Next;
+                case 7:
+                    x.set(r.ime, splat<B>(1));
+                    return Outcome::Next;
+                default: return Outcome::Lock; // 0xCB is decoded by the caller
+                }
+            case 4:
+                if (y >= 4)
+                    return Outcome::Lock;
+                else {
+                    const M taken = condition(y);
+                    push(splat<W>(f.next), taken);
+                    return branch(taken, f.n16, f.next);
+                }
+            case 5:
+                if (q == 0) {
+                    push(p == 3 ? W(widen(r.r[Reg::A]) << 8 | widen(r.r[Reg::F])) : rp(p));
+                    return Outcome::Next;
+                }
+                if (p != 0)
+                    return Outcome::Lock;
+                push(splat<W>(f.next));
+                return jump(f.n16);
+            case 6:
+                alu(y, splat<B>(f.n8));
+                return Outcome::Next;
+            default:
+                push(splat<W>(f.next));
+                return jump(static_cast<std::uint16_t>(y * 8));
+            }
+        }
+    }
+
+    LR35902_LANE_INLINE Outcome prefixed(const unsigned op) noexcept
+    {
+        const unsigned y = (op >> 3) & 7, z = op & 7;
+        const B v = get(z);
+        const B f = r.r[Reg::F];
+        const Data bit = static_cast<Data>(1u << y);
+        switch (op >> 6) {
+        case 0: {
+            B res, carry;
+            switch (y) {
+            case 0: res = B((v << 1) | (v >> 7)); carry = B((v >> 3) & Flag::C); break;
+            case 1: res = B((v >> 1) | (v << 7)); carry = B((v << 4) & Flag::C); break;
+            case 2: res = B((v << 1) | ((f >> 4) & 1)); carry = B((v >> 3) & Flag::C); break;
+            case 3: res = B((v >> 1) | ((f << 3) & 0x80)); carry = B((v << 4) & Flag::C); break;
+            case 4: res = B(v << 1); carry = B((v >> 3) & Flag::C); break;
+            case 5: res = B((v >> 1) | (v & 0x80)); carry = B((v << 4) & Flag::C); break;
+            case 6: res = B((v << 4) | (v >> 4)); carry = splat<B>(0); break;
+            default: res = B(v >> 1); carry = B((v << 4) & Flag::C); break;
+            }
+            put(z, res);
+            flags(B(bits(res == 0, Flag::Z) | carry));
+            break;
+        }
+        case 1:
+            flags(B(bits((v & bit) == 0, Flag::Z) | Flag::H | (f & Flag::C)));
+            break;
+        case 2:
+            put(z, B(v & static_cast<Data>(~bit)));
+            break;
+        default:
+            put(z, B(v | bit));
+            break;
+        }
+        return Outcome::Next;
+    }
+
+    Lanes& x;
+    Regs& r;
+};
+
+} // namespace impl
+
+/** @brief Many instances of one ROM stepped in lockstep, WIDTH lanes per SIMD instruction
+ * @details
+ * Registers are structure-of-arrays blocks of WIDTH lanes and the per-lane memory
+ * (0x8000-0xFFFF) is interleaved, byte `addr` of every lane side by side, so lanes that
+ * access the same address (immediate addresses, and pointers that are still equal) load
+ * or store one contiguous vector; other addresses are gathered lane by lane. The ROM is
+ * shared.
+ *
+ * At every frame boundary lanes are grouped by PC and cycle. A group of at least
+ * `min_group` lanes runs in lockstep: each instruction is fetched and decoded once and
+ * executed on every block of the group, masked to the group's lanes. When a branch sends
+ * lanes to different PCs the larger side stays in the group and the others finish the
+ * frame on the scalar path, which runs the same instruction code one lane at a time.
+ * Everyone is regrouped at the next frame boundary. stats() shows how much ran each way.
+ *
+ * Only the CPU and memory are replicated. No peripheral runs in the lanes, the registers
+ * code polls are derived from the lane's cycle count instead: a frame boundary is the
+ * start of VBlank (LY 144), LY and STAT's mode and coincidence bits follow the PPU's line
+ * timing (the shortest mode 3, LY and mode 0 while LCDC bit 7 is clear) and DIV counts
+ * every 256 cycles since it was last written. JPAD reads the lane's buttons(), the other
+ * I/O registers are plain memory. VBlank is requested at every frame boundary as the
+ * only interrupt source (interrupts are taken there, halted lanes wake there). The ROM is
+ * mapped flat, without a memory bank controller. Outside run_frame() the derived
+ * registers read as of the last frame boundary.
+ */
+template<std::size_t LanesV = 256>
+class Engine
+{
+public:
+    static constexpr std::size_t LANES = LanesV;
+    static constexpr std::size_t BLOCKS = LANES / WIDTH;
+    static constexpr Addr RAM_BASE = 0x8000;
+    static constexpr std::size_t RAM_SIZE = 0x8000;
+    static constexpr Cycle FRAME_CYCLES = Movie::FRAME_CYCLES;
+
+    static_assert(LANES % WIDTH == 0, "lanes come in whole blocks");
+
+    struct Registers
+    {
+        Data A, F, B, C, D, E, H, L;
+        std::uint16_t SP, PC;
+        bool IME;
+    };
+
+    enum class State : std::uint8_t
+    {
+        Running,
+        Halted, // until an enabled interrupt is requested
+        Locked, // illegal opcode
+    };
+
+    struct Stats
+    {
+        std::uint64_t lockstep = 0; // instructions executed, counted per lane
+        std::uint64_t scalar = 0;
+    };
+
+    using Execute = impl::Outcome (*)(Engine&, const impl::Fetch&);
+
+    // One step of a lockstep group, compiled for each instruction set
+    struct Kernels
+    {
+        Execute execute;
+    };
+
+    [[nodiscard]] static Kernels generic_kernels() noexcept { return {&execute_generic}; }
+
+    [[nodiscard]] static Kernels select_kernels() noexcept
+    {
+        return UTILITY_SIMD_SELECT(generic_kernels(), generic_kernels(), Kernels{&execute_avx2}, utility::cpu().avx2);
+    }
+
+    inline static const Kernels KERNELS = select_kernels();
+
+    // Every lane starts where the DMG boot program leaves off (PC = 0x0100)
+    explicit Engine(const std::span<const std::uint8_t> rom, const std::size_t min_group = WIDTH / 4,
+        const Kernels kernels = KERNELS)
+    : m_rom{rom}
+    , m_min_group{std::max<std::size_t>(min_group, 1)}
+    , m_kernels{kernels}
+    , m_blocks(BLOCKS)
+    , m_ram(std::make_unique<Data[]>(RAM_SIZE * LANES))
+    , m_buttons(LANES)
+    , m_cycles(LANES)
+    , m_div(LANES)
+    , m_state(LANES, State::Running)
+    {
+        constexpr Registers BOOT{0x01, 0xB0, 0x00, 0x13, 0x00, 0xD8, 0x01, 0x4D, 0xFFFE, 0x0100, false};
+        for (std::size_t lane = 0; lane < LANES; ++lane) {
+            registers(lane, BOOT);
+            ram(lane, JPAD) = impl::jpad<Data>(0x00, 0);
+            ram(lane, LCDC) = 0x91;
+        }
+    }
+
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
+
+    [[nodiscard]] std::uint64_t frames() const noexcept { return m_frames; }
+    [[nodiscard]] const Stats& stats() const noexcept { return m_stats; }
+    [[nodiscard]] State state(const std::size_t lane) const noexcept { return m_state[lane]; }
+
+    // Sets the lane's buttons (see Buttons)
+    void buttons(const std::size_t lane, const Data pressed) noexcept
+    {
+        m_buttons[lane] = pressed;
+        ram(lane, JPAD) = impl::jpad<Data>(ram(lane, JPAD), pressed);
+    }
+
+    [[nodiscard]] Registers registers(const std::size_t lane) const noexcept
+    {
+        const impl::Lane l = extract(lane);
+        return {l.r[impl::Reg::A], l.r[impl::Reg::F], l.r[impl::Reg::B], l.r[impl::Reg::C], l.r[impl::Reg::D],
+            l.r[impl::Reg::E], l.r[impl::Reg::H], l.r[impl::Reg::L], l.sp, l.pc, l.ime != 0};
+    }
+
+    void registers(const std::size_t lane, const Registers& regs) noexcept
+    {
+        impl::Lane l = extract(lane);
+        l.r[impl::Reg::B] = regs.B;
+        l.r[impl::Reg::C] = regs.C;
+        l.r[impl::Reg::D] = regs.D;
+        l.r[impl::Reg::E] = regs.E;
+        l.r[impl::Reg::H] = regs.H;
+        l.r[impl::Reg::L] = regs.L;
+        l.r[impl::Reg::F] = static_cast<Data>(regs.F & 0xF0);
+        l.r[impl::Reg::A] = regs.A;
+        l.sp = regs.SP;
+        l.pc = regs.PC;
+        l.ime = regs.IME;
+        insert(lane, l);
+    }
+
+    [[nodiscard]] Data read(const std::size_t lane, const Addr addr) const noexcept { return peek(lane, addr); }
+    void write(const std::size_t lane, const Addr addr, const Data data) noexcept { poke(lane, addr, data); }
+
+    // Runs every lane for one Movie::FRAME_CYCLES long frame
+    void run_frame()
+    {
+        std::vector<std::pair<std::uint64_t, std::uint16_t>> keys;
+        keys.reserve(LANES);
+        for (std::size_t lane = 0; lane < LANES; ++lane) {
+            begin_frame(lane);
+            if (m_state[lane] == State::Running)
+                keys.emplace_back(std::uint64_t{extract(lane).pc} << 32 | m_cycles[lane], static_cast<std::uint16_t>(lane));
+        }
+        std::sort(keys.begin(), keys.end());
+
+        m_scalar.clear();
+        for (std::size_t begin = 0, end; begin < keys.size(); begin = end) {
+            for (end = begin + 1; end < keys.size() && keys[end].first == keys[begin].first; ++end) {}
+            if (end - begin >= m_min_group)
+                lockstep(std::span{keys}.subspan(begin, end - begin));
+            else
+                for (std::size_t i = begin; i < end; ++i)
+                    m_scalar.push_back(keys[i].second);
+        }
+        // lanes split off by lockstep() are appended while this runs
+        for (std::size_t i = 0; i < m_scalar.size(); ++i)
+            scalar(m_scalar[i]);
+
+        for (std::size_t lane = 0; lane < LANES; ++lane)
+            m_cycles[lane] = m_state[lane] == State::Running ? static_cast<std::uint32_t>(m_cycles[lane] - FRAME_CYCLES) : 0;
+        ++m_frames;
+        m_now = 0;
+    }
+
+private:
+    static constexpr Addr JPAD = 0xFF00;
+    static constexpr Addr DIV = 0xFF04;
+    static constexpr Addr IF = 0xFF0F;
+    static constexpr Addr LCDC = 0xFF40;
+    static constexpr Addr STAT = 0xFF41;
+    static constexpr Addr LY = 0xFF44;
+    static constexpr Addr LYC = 0xFF45;
+    static constexpr Addr IE = 0xFFFF;
+
+    // The PPU's line timing (see PPU::LINE_DOTS), frame boundaries start line VBLANK_LINE
+    static constexpr std::uint32_t LINE_DOTS = 456;
+    static constexpr std::uint32_t OAM_SCAN_DOTS = 80;
+    static constexpr std::uint32_t TRANSFER_DOTS = 172;
+    static constexpr std::uint32_t VBLANK_LINE = 144;
+    static constexpr std::uint32_t LINES = 154;
+    static_assert(LINES * LINE_DOTS == FRAME_CYCLES, "a frame is a whole number of lines");
+
+    // A block of the current lockstep group
+    struct VectorLanes
+    {
+        using B = impl::Bytes;
+        using W = impl::Words;
+        using M = impl::ByteMask;
+        using Regs = impl::Block;
+
+        Regs& regs;
+        const M mask;
+        Engine& engine;
+        const std::size_t base; // first lane of the block
+
+        LR35902_LANE_INLINE void set(B& reg, const B value) const noexcept { reg = impl::select(mask, value, reg); }
+        LR35902_LANE_INLINE void set(W& reg, const W value) const noexcept { reg = impl::select(mask, value, reg); }
+        LR35902_LANE_INLINE void set(B& reg, const B value, const M cond) const noexcept { reg = impl::select(M(mask & cond), value, reg); }
+        LR35902_LANE_INLINE void set(W& reg, const W value, const M cond) const noexcept { reg = impl::select(M(mask & cond), value, reg); }
+
+        LR35902_LANE_INLINE B read(const Addr addr) const noexcept { return engine.load(base, addr); }
+        LR35902_LANE_INLINE B read(const W addr) const noexcept
+        {
+            if (!impl::any(addr != addr[0]))
+                return engine.load(base, addr[0]);
+            B out;
+            for (std::size_t i = 0; i < WIDTH; ++i)
+                out[i] = engine.peek(base + i, addr[i]);
+            return out;
+        }
+
+        LR35902_LANE_INLINE void write(const Addr addr, const B value) const noexcept { engine.store(base, addr, value, mask); }
+        LR35902_LANE_INLINE void write(const W addr, const B value) const noexcept { write(addr, value, M{} == 0); }
+        LR35902_LANE_INLINE void write(const W addr, const B value, const M cond) const noexcept
+        {
+            const M lanes = mask & cond;
+            if (!impl::any(addr != addr[0])) {
+                engine.store(base, addr[0], value, lanes);
+                return;
+            }
+            for (std::size_t i = 0; i < WIDTH; ++i)
+                if (lanes[i])
+                    engine.poke(base + i, addr[i], value[i]);
+        }
+    };
+
+    // One lane on the scalar path
+    struct ScalarLane
+    {
+        using B = Data;
+        using W = std::uint16_t;
+        using M = bool;
+        using Regs = impl::Lane;
+
+        Regs& regs;
+        Engine& engine;
+        const std::size_t lane;
+
+        LR35902_LANE_INLINE void set(B& reg, const B value) const noexcept { reg = value; }
+        LR35902_LANE_INLINE void set(W& reg, const W value) const noexcept { reg = value; }
+        LR35902_LANE_INLINE void set(B& reg, const B value, const M cond) const noexcept { if (cond) reg = value; }
+        LR35902_LANE_INLINE void set(W& reg, const W value, const M cond) const noexcept { if (cond) reg = value; }
+
+        LR35902_LANE_INLINE B read(const Addr addr) const noexcept { return engine.peek(lane, addr); }
+        LR35902_LANE_INLINE void write(const Addr addr, const B value) const noexcept { engine.poke(lane, addr, value); }
+        LR35902_LANE_INLINE void write(const Addr addr, const B value, const M cond) const noexcept
+        {
+            if (cond)
+                engine.poke(lane, addr, value);
+        }
+    };
+
+    // The lockstep group being run
+    struct Group
+    {
+        std::uint16_t pc = 0;
+        std::uint32_t cycles = 0;
+        std::size_t size = 0;
+        std::size_t leader = 0; // a lane of the group
+    };
+
+    [[nodiscard]] static std::size_t offset(Addr addr) noexcept
+    {
+        if (addr >= 0xE000 && addr < 0xFE00)
+            addr -= 0x2000; // echo of 0xC000-0xDDFF
+        return static_cast<std::size_t>(addr - RAM_BASE) * LANES;
+    }
+
+    [[nodiscard]] Data& ram(const std::size_t lane, const Addr addr) noexcept { return m_ram[offset(addr) + lane]; }
+
+    [[nodiscard]] static bool derived(const Addr addr) noexcept { return addr == DIV || addr == STAT || addr == LY; }
+
+    // Cycles since the first frame at the instruction being executed
+    [[nodiscard]] std::uint64_t now() const noexcept { return m_frames * FRAME_CYCLES + m_now; }
+
+    // DIV, STAT or LY of `lane` at the current instruction
+    [[nodiscard]] Data timed(const std::size_t lane, const Addr addr) const noexcept
+    {
+        if (addr == DIV)
+            return static_cast<Data>(static_cast<std::uint16_t>(now() - m_div[lane]) >> 8);
+
+        const bool on = m_ram[offset(LCDC) + lane] & 0x80;
+        const std::uint32_t line = (m_now / LINE_DOTS + VBLANK_LINE) % LINES;
+        const Data ly = on ? static_cast<Data>(line) : 0;
+        if (addr == LY)
+            return ly;
+
+        const std::uint32_t dot = m_now % LINE_DOTS;
+        Data mode = 0;
+        if (on && line >= VBLANK_LINE)
+            mode = 1;
+        else if (on && dot < OAM_SCAN_DOTS)
+            mode = 2;
+        else if (on && dot < OAM_SCAN_DOTS + TRANSFER_DOTS)
+            mode = 3;
+        const Data coincidence = ly == m_ram[offset(LYC) + lane] ? 0x04 : 0x00;
+        return static_cast<Data>(0x80 | (m_ram[offset(STAT) + lane] & 0x78) | coincidence | mode);
+    }
+
+    [[nodiscard]] Data peek(const std::size_t lane, const Addr addr) const noexcept
+    {
+        if (addr < RAM_BASE)
+            return addr < m_rom.size() ? m_rom[addr] : 0xFF;
+        if (derived(addr))
+            return timed(lane, addr);
+        return m_ram[offset(addr) + lane];
+    }
+
+    void poke(const std::size_t lane, const Addr addr, Data data) noexcept
+    {
+        if (addr < RAM_BASE)
+            return; // no memory bank controller
+        if (addr == JPAD)
+            data = impl::jpad<Data>(data, m_buttons[lane]);
+        if (addr == DIV)
+            m_div[lane] = static_cast<std::uint16_t>(now()); // any write clears the divider
+        ram(lane, addr) = data;
+    }
+
+    // `addr` of the WIDTH lanes from `base`
+    LR35902_LANE_INLINE impl::Bytes load(const std::size_t base, const Addr addr) const noexcept
+    {
+        if (addr < RAM_BASE)
+            return impl::splat<impl::Bytes>(peek(0, addr));
+        impl::Bytes out;
+        if (derived(addr)) {
+            for (std::size_t i = 0; i < WIDTH; ++i)
+                out[i] = timed(base + i, addr);
+            return out;
+        }
+        std::memcpy(&out, &m_ram[offset(addr) + base], WIDTH);
+        return out;
+    }
+
+    LR35902_LANE_INLINE void store(const std::size_t base, const Addr addr, impl::Bytes data, const impl::ByteMask lanes) noexcept
+    {
+        if (addr < RAM_BASE)
+            return;
+        if (addr == JPAD) {
+            impl::Bytes pressed;
+            std::memcpy(&pressed, &m_buttons[base], WIDTH);
+            data = impl::jpad(data, pressed);
+        }
+        if (derived(addr)) {
+            for (std::size_t i = 0; i < WIDTH; ++i)
+                if (lanes[i])
+                    poke(base + i, addr, data[i]);
+            return;
+        }
+        data = impl::select(lanes, data, load(base, addr));
+        std::memcpy(&m_ram[offset(addr) + base], &data, WIDTH);
+    }
+
+    [[nodiscard]] impl::Lane extract(const std::size_t lane) const noexcept
+    {
+        const impl::Block& block = m_blocks[lane / WIDTH];
+        const std::size_t i = lane % WIDTH;
+        impl::Lane l;
+        for (std::size_t k = 0; k < std::size(l.r); ++k)
+            l.r[k] = block.r[k][i];
+        l.sp = block.sp[i];
+        l.pc = block.pc[i];
+        l.ime = block.ime[i];
+        l.taken = block.taken[i];
+        return l;
+    }
+
+    void insert(const std::size_t lane, const impl::Lane& l) noexcept
+    {
+        impl::Block& block = m_blocks[lane / WIDTH];
+        const std::size_t i = lane % WIDTH;
+        for (std::size_t k = 0; k < std::size(l.r); ++k)
+            block.r[k][i] = l.r[k];
+        block.sp[i] = l.sp;
+        block.pc[i] = l.pc;
+        block.ime[i] = l.ime;
+        block.taken[i] = l.taken;
+    }
+
+    // Requests VBlank, wakes a halted lane and takes the highest enabled interrupt
+    void begin_frame(const std::size_t lane) noexcept
+    {
+        if (m_state[lane] == State::Locked)
+            return;
+        ram(lane, IF) |= 0x01;
+        const Data pending = ram(lane, IF) & ram(lane, IE) & 0x1F;
+        if (!pending)
+            return;
+        m_state[lane] = State::Running;
+        impl::Lane l = extract(lane);
+        if (!l.ime)
+            return;
+        const unsigned interrupt = static_cast<unsigned>(std::countr_zero(pending));
+        ram(lane, IF) &= static_cast<Data>(~(1u << interrupt));
+        l.ime = 0;
+        l.sp -= 2;
+        poke(lane, static_cast<Addr>(l.sp + 1), static_cast<Data>(l.pc >> 8));
+        poke(lane, l.sp, static_cast<Data>(l.pc));
+        l.pc = static_cast<std::uint16_t>(0x40 + 8 * interrupt);
+        insert(lane, l);
+        m_cycles[lane] += 20;
+    }
+
+    template<typename Read>
+    [[nodiscard]] static impl::Fetch decode(const std::uint16_t pc, Read&& read) noexcept
+    {
+        impl::Fetch f;
+        f.op = read(pc);
+        f.n8 = read(static_cast<Addr>(pc + 1));
+        f.n16 = static_cast<std::uint16_t>(f.n8 | read(static_cast<Addr>(pc + 2)) << 8);
+        f.cb = f.op == 0xCB;
+        f.next = static_cast<std::uint16_t>(pc + Decode::length(f.cb ? f.n8 : f.op, f.cb));
+        return f;
+    }
+
+    [[nodiscard]] static std::uint32_t cost(const impl::Fetch& f, const bool taken) noexcept
+    {
+        return Decode::cycles(f.cb ? f.n8 : f.op, f.cb, taken);
+    }
+
+    LR35902_LANE_INLINE impl::Outcome execute_blocks(const impl::Fetch& f) noexcept
+    {
+        impl::Outcome outcome = impl::Outcome::Next;
+        for (const std::size_t b : m_active) {
+            VectorLanes lanes{m_blocks[b], m_blocks[b].group, *this, b * WIDTH};
+            outcome = impl::Core<VectorLanes>{lanes}.execute(f);
+        }
+        return outcome;
+    }
+
+    static impl::Outcome execute_generic(Engine& engine, const impl::Fetch& f) noexcept { return engine.execute_blocks(f); }
+
+#if UTILITY_SIMD_X86
+    __attribute__((target("avx2")))
+    static impl::Outcome execute_avx2(Engine& engine, const impl::Fetch& f) noexcept { return engine.execute_blocks(f); }
+#endif
+
+    // Moves lane `lane` of the group to the scalar path at `cycles`
+    void leave(const std::size_t lane, const std::uint32_t cycles) noexcept
+    {
+        m_blocks[lane / WIDTH].group[lane % WIDTH] = 0;
+        m_cycles[lane] = cycles;
+        m_scalar.push_back(static_cast<std::uint16_t>(lane));
+    }
+
+    void active() noexcept
+    {
+        m_active.clear();
+        for (std::size_t b = 0; b < BLOCKS; ++b)
+            if (impl::any(m_blocks[b].group))
+                m_active.push_back(b);
+    }
+
+    // Lanes of the group at `pc` with `taken`
+    [[nodiscard]] std::size_t agreeing(const std::uint16_t pc, const Data taken) const noexcept
+    {
+        std::size_t n = 0;
+        for (const std::size_t b : m_active)
+            n += impl::count(m_blocks[b].group & impl::narrow(m_blocks[b].pc == pc) & (m_blocks[b].taken == taken));
+        return n;
+    }
+
+    void lockstep(const std::span<const std::pair<std::uint64_t, std::uint16_t>> lanes)
+    {
+        for (impl::Block& block : m_blocks)
+            block.group = impl::ByteMask{};
+        for (const auto& [key, lane] : lanes)
+            m_blocks[lane / WIDTH].group[lane % WIDTH] = -1;
+        active();
+        Group g{extract(lanes[0].second).pc, m_cycles[lanes[0].second], lanes.size(), lanes[0].second};
+
+        while (g.size && g.cycles < FRAME_CYCLES) {
+            m_now = g.cycles;
+            const impl::Fetch f = decode(g.pc, [&](const Addr addr) { return peek(g.leader, addr); });
+            if (g.pc >= RAM_BASE)
+                diverged_code(g, f);
+            const impl::Outcome outcome = m_kernels.execute(*this, f);
+            m_stats.lockstep += g.size;
+            switch (outcome) {
+            case impl::Outcome::Next:
+                g.pc = f.next;
+                g.cycles += cost(f, true);
+                break;
+            case impl::Outcome::Jump:
+                g.pc = m_blocks[g.leader / WIDTH].pc[g.leader % WIDTH];
+                g.cycles += cost(f, true);
+                break;
+            case impl::Outcome::Branch:
+                split(g, f);
+                break;
+            case impl::Outcome::Halt:
+            case impl::Outcome::Lock:
+                for (const std::size_t b : m_active)
+                    for (std::size_t i = 0; i < WIDTH; ++i)
+                        if (m_blocks[b].group[i]) {
+                            m_state[b * WIDTH + i] = outcome == impl::Outcome::Halt ? State::Halted : State::Locked;
+                            m_blocks[b].group[i] = 0;
+                        }
+                g.pc = f.next;
+                g.size = 0;
+                break;
+            }
+        }
+
+        // PC is only kept per lane when it is not the group's
+        for (const std::size_t b : m_active) {
+            m_blocks[b].pc = impl::select(m_blocks[b].group, impl::splat<impl::Words>(g.pc), m_blocks[b].pc);
+            for (std::size_t i = 0; i < WIDTH; ++i)
+                if (m_blocks[b].group[i])
+                    m_cycles[b * WIDTH + i] = g.cycles;
+        }
+        for (const auto& [key, lane] : lanes)
+            if (m_state[lane] != State::Running)
+                m_blocks[lane / WIDTH].pc[lane % WIDTH] = g.pc;
+    }
+
+    // Executing from RAM: lanes whose bytes at PC differ from the leader's leave the group
+    void diverged_code(Group& g, const impl::Fetch& f) noexcept
+    {
+        const std::size_t length = static_cast<std::uint16_t>(f.next - g.pc); // wraps past 0xFFFF
+        bool left = false;
+        for (const std::size_t b : m_active)
+            for (std::size_t i = 0; i < WIDTH; ++i) {
+                const std::size_t lane = b * WIDTH + i;
+                if (!m_blocks[b].group[i] || lane == g.leader)
+                    continue;
+                for (std::size_t k = 0; k < length; ++k)
+                    if (peek(lane, static_cast<Addr>(g.pc + k)) != peek(g.leader, static_cast<Addr>(g.pc + k))) {
+                        m_blocks[b].pc[i] = g.pc;
+                        leave(lane, g.cycles);
+                        --g.size;
+                        left = true;
+                        break;
+                    }
+            }
+        if (left)
+            active();
+    }
+
+    // After a per-lane branch: the larger side stays, the rest leave at their own cost
+    void split(Group& g, const impl::Fetch& f)
+    {
+        const std::size_t leader_block = g.leader / WIDTH, leader_i = g.leader % WIDTH;
+        std::uint16_t pc = m_blocks[leader_block].pc[leader_i];
+        Data taken = m_blocks[leader_block].taken[leader_i];
+        std::size_t kept = agreeing(pc, taken);
+        if (kept < g.size && 2 * kept < g.size) {
+            // the leader is in the minority, try the first lane that went elsewhere
+            for (const std::size_t b : m_active) {
+                const impl::ByteMask other = m_blocks[b].group & ~(impl::narrow(m_blocks[b].pc == pc) & (m_blocks[b].taken == taken));
+                if (!impl::any(other))
+                    continue;
+                std::size_t i = 0;
+                while (!other[i])
+                    ++i;
+                const std::uint16_t other_pc = m_blocks[b].pc[i];
+                const Data other_taken = m_blocks[b].taken[i];
+                if (const std::size_t n = agreeing(other_pc, other_taken); n > kept) {
+                    pc = other_pc;
+                    taken = other_taken;
+                    kept = n;
+                }
+                break;
+            }
+        }
+
+        if (kept < g.size) {
+            for (const std::size_t b : m_active) {
+                const impl::ByteMask keep = m_blocks[b].group & impl::narrow(m_blocks[b].pc == pc) & (m_blocks[b].taken == taken);
+                const impl::ByteMask gone = m_blocks[b].group & ~keep;
+                for (std::size_t i = 0; i < WIDTH && impl::any(gone); ++i)
+                    if (gone[i])
+                        leave(b * WIDTH + i, g.cycles + cost(f, m_blocks[b].taken[i] != 0));
+                m_blocks[b].group = keep;
+            }
+            active();
+            for (const std::size_t b : m_active) {
+                std::size_t i = 0;
+                while (!m_blocks[b].group[i])
+                    ++i;
+                g.leader = b * WIDTH + i;
+                break;
+            }
+        }
+        g.size = kept;
+        g.pc = pc;
+        g.cycles += cost(f, taken != 0);
+    }
+
+    void scalar(const std::size_t lane)
+    {
+        impl::Lane l = extract(lane);
+        ScalarLane x{l, *this, lane};
+        std::uint32_t cycles = m_cycles[lane];
+        while (cycles < FRAME_CYCLES) {
+            m_now = cycles;
+            const impl::Fetch f = decode(l.pc, [&](const Addr addr) { return peek(lane, addr); });
+            const impl::Outcome outcome = impl::Core<ScalarLane>{x}.execute(f);
+            ++m_stats.scalar;
+            if (outcome == impl::Outcome::Halt || outcome == impl::Outcome::Lock) {
+                m_state[lane] = outcome == impl::Outcome::Halt ? State::Halted : State::Locked;
+                l.pc = f.next;
+                break;
+            }
+            if (outcome == impl::Outcome::Next)
+                l.pc = f.next;
+            cycles += cost(f, outcome != impl::Outcome::Branch || l.taken);
+        }
+        insert(lane, l);
+        m_cycles[lane] = cycles;
+    }
+
+    std::span<const std::uint8_t> m_rom;
+    const std::size_t m_min_group;
+    const Kernels m_kernels;
+
+    std::vector<impl::Block> m_blocks;
+    std::unique_ptr<Data[]> m_ram; // RAM_SIZE * LANES, lane-interleaved
+    std::vector<Data> m_buttons;
+    std::vector<std::uint32_t> m_cycles; // into the current frame
+    std::vector<std::uint16_t> m_div;    // low bits of now() when DIV was last written
+    std::vector<State> m_state;
+
+    std::vector<std::size_t> m_active;   // blocks with lanes in the group
+    std::vector<std::uint16_t> m_scalar; // lanes to run on the scalar path this frame
+
+    Stats m_stats;
+    std::uint64_t m_frames = 0;
+    std::uint32_t m_now = 0; // into the current frame, of the instruction being executed
+};
+
+} // namespace LR35902::Lockstep
+
+#undef LR35902_LANE_INLINE
+
+#endif // LR35902_LOCKSTEP_HPP
@@ -13,7 +13,9 @@
 #include "arguments.hpp"
 #include "registers.hpp"
 #include "mmu.hpp"
+#include "interrupts.hpp"
 #include "options.hpp"
+#include "savestate.hpp"
 
 constexpr auto FORCE_READ_WRITE_FLAGS = false;
 
@@ -34,10 +36,13 @@ public:
 private:
     RegisterFile m_regs;
     Memory m_mmu;
+    Interrupts& m_interrupts;
+    bool m_IME = false;
+    Sleep m_sleep;
 
 public:
-    Micro(RegisterFile&& regs, Memory&& mmu)
-    : m_regs{regs}, m_mmu{mmu}
+    Micro(RegisterFile&& regs, Memory&& mmu, Interrupts& interrupts)
+    : m_regs{regs}, m_mmu{mmu}, m_interrupts{interrupts}
     {}
 
     constexpr bool NOP()
@@ -342,6 +347,7 @@ public:
     constexpr bool RETI()
     {
         m_IME = true;
+        m_interrupts.recheck();
         write(Args::PC{}, pop());
         flags("----"_sc);
         return true;
@@ -350,6 +356,7 @@ public:
     constexpr bool EI()
     {
         m_IME = true;
+        m_interrupts.recheck();
         flags("----"_sc);
         return true;
     }
@@ -386,23 +393,42 @@ public:
         return true;
     }
 
+    // Each register word is a region of its own; the memories describe themselves
+    void describe(StateLayout& layout)
+    {
+        m_regs.describe(layout);
+        layout.regions(m_IME, m_sleep);
+    }
+
+    // HALT and STOP do no work while waiting. Scheduler::run_until sees halted() and
+    // jumps the clock to the next scheduled event instead of stepping through the idle time.
+    // An interrupt that is already pending was announced before the CPU slept, so it is
+    // announced again (Event::Interrupt for now) or the clock would jump past it.
     constexpr bool STOP()
     {
-        m_stop = true;
+        m_sleep.stop(m_interrupts);
         flags("----"_sc);
         return true;
     }
 
     constexpr bool HALT()
     {
-        m_halt_begin = true;
-        m_halt = true;
-        if (m_IME)
-            ;
+        m_sleep.halt(m_interrupts);
         flags("----"_sc);
         return true;
     }
 
+    [[nodiscard]] constexpr bool halted() const
+    {
+        return m_sleep.halted();
+    }
+
+    // Dispatch target of Event::Interrupt, see Sleep for when HALT and STOP end
+    constexpr void on_interrupt()
+    {
+        m_sleep.wake(m_interrupts);
+    }
+
 //
 
 //     constexpr bool RLC(const Args::StdArg auto arg)
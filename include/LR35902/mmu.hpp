@@ -2,11 +2,11 @@
 
 #include <cstdint>
 #include <array>
+#include <stdexcept>
 
 #include <utility/interval.hpp>
 
-#include "SystemTypes.hpp"
-#include "state.hpp"
+#include "types.hpp"
 
 namespace LR35902
 {
@@ -32,7 +32,8 @@ namespace MemoryRegions
     using IRAM_0    = Span<0xC000, 0xD000>; // Internal / Working RAM
     using IRAM_N    = Span<0xD000, 0xE000>; // Internal / Working Ram (switchable 1-7 in CGB Mode)
     using Shadow    = Span<0xE000, 0xFE00>; // Shadow RAM (same as (0xC00-0xDDFF))
-    using NotUsable = Span<0xFE00, 0xFF00>; // Not Usable
+    using OAM       = Span<0xFE00, 0xFEA0>; // Object Attribute Memory (sprites)
+    using NotUsable = Span<0xFEA0, 0xFF00>; // Not Usable
     using IOPorts   = Span<0xFF00, 0xFF80>; // IO Ports
     using HRAM      = Span<0xFF80, 0xFFFF>; // High RAM
     
@@ -79,13 +80,13 @@ namespace MemoryRegions
     using SCX       = Singular<0xFF43>; // Viewport X Position
     
     using LY        = Singular<0xFF44>; // LCD Y Position
-    using LY        = Singular<0xFF45>; // LY Compare
+    using LYC       = Singular<0xFF45>; // LY Compare
     
     using DMA       = Singular<0xFF46>; // OAM DMA Source Address & Start
     using BGP       = Singular<0xFF47>; // BG Palette Data
     
     using OBP0      = Singular<0xFF48>; // OBJ Palette 0 Data
-    using OBP0      = Singular<0xFF49>; // OBJ Palette 1 Data
+    using OBP1      = Singular<0xFF49>; // OBJ Palette 1 Data
     
     using WY        = Singular<0xFF4A>; // Window Y Position
     using WX        = Singular<0xFF4B>; // Window X Position
@@ -103,6 +104,8 @@ namespace MemoryRegions
     
     using BGPI      = Singular<0xFF68>; // Background Color Palette Index
     using BGPD      = Singular<0xFF69>; // Background Color Palette Data
+    using OBPI      = Singular<0xFF6A>; // Object Color Palette Index
+    using OBPD      = Singular<0xFF6B>; // Object Color Palette Data
     
     using OPRI      = Singular<0xFF6C>; // Object Priority Mode
     
@@ -114,55 +117,6 @@ namespace MemoryRegions
     using IE        = Singular<0xFFFF>; // Interrupt Enable Register
 }
 
-/** @brief LCDC - LCD Control Register (0=OFF; 1=ON) 
- * @details
- * ---------------------
- * ADDR     BIT     OPTION(0/1)     Description
- * ---------------------
- * FF40     0       OFF/ON          BG Display (for CGB)
- *          1       OFF/ON          OBJ (sprite) display enable
- *          2       8x8/8x16        OBJ (sprite) size
- *          3       Low/High        BG Tile Map Display Select - TODO define Low and High
- *          4       Low/High        BG and Window Tile Map Display Select
- *          5       OFF/ON          Window Display Enable
- *          6       Low/High        Window Tile Map Display Select
- *          7       OFF/ON          LCD Display Enable (1->0 durring VBlank only. White when disabled)
- * 
- * LCDC[0] Performs different actions for different GameBoy Types
- *  - SGB and set to 0
- *      - background becomes blank (white)
- *      - window may still be displayed (LCDC.5)
- *      - sprites may still be displayed (LCDC.1)
- *  - CGB (SGB mode)
- *      - background becomes blank (white)
- *      - window becomes blank(white) LCDC.5 is ignored
- *      - sprites may still be displayed (LCDC.1)
- *  - CGB (CGB mode)
- *      - Background and window lose priority
- *      - sprites will always be displayed on top of background and window
- *          - ignores priority of OAM and BG Map attributes
- */
-struct LCDC
-{
-    using Region = MemoryRegions::LCDC;
-    inline constexpr bool for_me(const Addr addr) noexcept
-    {
-        return Region::isMember(addr);
-    }
-
-    inline constexpr void write(const Addr, const Data data) noexcept
-    {
-        systemState.LCDC.set(data);
-    }
-
-    inline constexpr Data read(const Addr) noexcept
-    {
-        return systemState.LCDC.get();
-    }
-
-    LR35902::SystemState& systemState;
-};
-
 
 
 template<typename RegionT, std::size_t CountV>
@@ -0,0 +1,334 @@
+#ifndef LR35902_MOVIE_HPP
+#define LR35902_MOVIE_HPP
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#include "types.hpp"
+#include "scheduler.hpp"
+#include "joypad.hpp"
+
+namespace LR35902::Movie
+{
+
+static constexpr Cycle FRAME_CYCLES = 70224; // 154 lines of 456 dots, one movie frame
+
+// Cartridge header global checksum (Header::RangeGlobalChecksum, 0x014E-0x014F, big endian)
+static constexpr std::size_t GLOBAL_CHECKSUM = 0x014E;
+
+[[nodiscard]] constexpr std::uint16_t global_checksum(const std::span<const std::uint8_t> rom) noexcept
+{
+    if (rom.size() < GLOBAL_CHECKSUM + 2)
+        return 0;
+    return static_cast<std::uint16_t>(rom[GLOBAL_CHECKSUM] << 8 | rom[GLOBAL_CHECKSUM + 1]);
+}
+
+/** @brief 64 bit hash of emulator state for desync checks
+ * @details
+ * Word at a time multiply/rotate with an xxHash64 style avalanche at the end. Not
+ * cryptographic; it only has to make two diverging runs differ.
+ */
+[[nodiscard]] inline std::uint64_t state_hash(const std::span<const std::byte> data, std::uint64_t seed = 0) noexcept
+{
+    constexpr std::uint64_t P1 = 0x9E3779B185EBCA87ull;
+    constexpr std::uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+    std::uint64_t h = seed ^ (data.size() * P1);
+    std::size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data.data() + i, 8);
+        h = std::rotl(h ^ (word * P2), 31) * P1;
+    }
+    for (; i < data.size(); ++i)
+        h = std::rotl(h ^ (static_cast<std::uint64_t>(data[i]) * P2), 11) * P1;
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P1;
+    return h ^ (h >> 32);
+}
+
+// What the first frame runs from
+enum class Start : std::uint8_t
+{
+    PowerOn, // boot ROM from cycle 0
+    State,   // a savestate, identified by Header::state_id (e.g. its state_hash())
+};
+
+struct Header
+{
+    std::uint16_t rom_checksum = 0;
+    Start start = Start::PowerOn;
+    std::uint64_t state_id = 0;
+    std::uint32_t hash_interval = 60; // frames between state hashes, 0 = none
+};
+
+enum class Error : std::uint8_t
+{
+    None,
+    Magic,     // not a movie
+    Version,   // written by a newer format
+    Truncated, // data ends inside a field
+    Corrupt,   // fields contradict each other
+};
+
+// A run of frames with the same buttons
+struct Run
+{
+    std::uint32_t frames = 0;
+    Data buttons = 0;
+};
+
+/** @brief Input movie: header, JPAD button runs and periodic state hashes.
+ * @details
+ * Frames are FRAME_CYCLES long and counted from the start state, so the movie needs no
+ * timestamps: input only changes at frame starts and only the changes are stored, as runs
+ * of identical frames. On disk (all little endian, counts as LEB128 varints):
+ *
+ *   "GBMV" u8 version  u8 start  u16 rom_checksum  u64 state_id  varint hash_interval
+ *   varint runs   { varint frames  u8 buttons } * runs
+ *   varint hashes { u64 hash } * hashes
+ *
+ * A minute of play with input changing every few frames is about a kilobyte. Hash k is
+ * the state after frame (k + 1) * hash_interval.
+ */
+class Recording
+{
+public:
+    static constexpr std::uint8_t VERSION = 1;
+    static constexpr std::array<char, 4> MAGIC { 'G', 'B', 'M', 'V' };
+
+    explicit Recording(const Header& header = {}) noexcept
+    : m_header{header}
+    {}
+
+    [[nodiscard]] const Header& header() const noexcept { return m_header; }
+    [[nodiscard]] std::uint64_t frames() const noexcept { return m_frames; }
+    [[nodiscard]] std::span<const Run> runs() const noexcept { return m_runs; }
+    [[nodiscard]] std::span<const std::uint64_t> hashes() const noexcept { return m_hashes; }
+
+    [[nodiscard]] bool for_rom(const std::span<const std::uint8_t> rom) const noexcept
+    {
+        return global_checksum(rom) == m_header.rom_checksum;
+    }
+
+    // Appends one frame played with `buttons`
+    void record(const Data buttons)
+    {
+        if (m_runs.empty() || m_runs.back().buttons != buttons || m_runs.back().frames == UINT32_MAX)
+            m_runs.push_back(Run{0, buttons});
+        ++m_runs.back().frames;
+        ++m_frames;
+    }
+
+    void hash(const std::uint64_t hash) { m_hashes.push_back(hash); }
+
+    [[nodiscard]] std::vector<std::byte> encode() const
+    {
+        std::vector<std::byte> out;
+        out.reserve(32 + m_runs.size() * 3 + m_hashes.size() * 8);
+        for (const char c : MAGIC)
+            out.push_back(static_cast<std::byte>(c));
+        out.push_back(static_cast<std::byte>(VERSION));
+        out.push_back(static_cast<std::byte>(m_header.start));
+        fixed(out, m_header.rom_checksum, 2);
+        fixed(out, m_header.state_id, 8);
+        varint(out, m_header.hash_interval);
+        varint(out, m_runs.size());
+        for (const Run& run : m_runs) {
+            varint(out, run.frames);
+            out.push_back(static_cast<std::byte>(run.buttons));
+        }
+        varint(out, m_hashes.size());
+        for (const std::uint64_t hash : m_hashes)
+            fixed(out, hash, 8);
+        return out;
+    }
+
+    // Replaces `movie` with the decoded data; `movie` is unspecified on error
+    [[nodiscard]] static Error decode(std::span<const std::byte> in, Recording& movie)
+    {
+        Reader reader{in};
+        for (const char c : MAGIC)
+            if (reader.byte() != static_cast<Data>(c))
+                return reader.error(Error::Magic);
+        if (const Data version = reader.byte(); !reader.ok || version == 0 || version > VERSION)
+            return reader.error(Error::Version);
+
+        const Data start = reader.byte();
+        movie = Recording{};
+        movie.m_header.start = static_cast<Start>(start);
+        movie.m_header.rom_checksum = static_cast<std::uint16_t>(reader.fixed(2));
+        movie.m_header.state_id = reader.fixed(8);
+        const std::uint64_t interval = reader.varint();
+        if (!reader.ok)
+            return Error::Truncated;
+        if (start > static_cast<Data>(Start::State) || interval > UINT32_MAX)
+            return Error::Corrupt;
+        movie.m_header.hash_interval = static_cast<std::uint32_t>(interval);
+
+        const std::uint64_t runs = reader.varint();
+        if (!reader.ok || runs > in.size())
+            return reader.error(Error::Corrupt);
+        movie.m_runs.resize(runs);
+        for (Run& run : movie.m_runs) {
+            const std::uint64_t frames = reader.varint();
+            run.buttons = reader.byte();
+            if (!reader.ok)
+                return Error::Truncated;
+            if (frames == 0 || frames > UINT32_MAX)
+                return Error::Corrupt;
+            run.frames = static_cast<std::uint32_t>(frames);
+            movie.m_frames += frames;
+        }
+
+        const std::uint64_t hashes = reader.varint();
+        if (!reader.ok || hashes > in.size())
+            return reader.error(Error::Corrupt);
+        if (hashes != (interval ? movie.m_frames / interval : 0))
+            return Error::Corrupt;
+        movie.m_hashes.resize(hashes);
+        for (std::uint64_t& hash : movie.m_hashes)
+            hash = reader.fixed(8);
+        return reader.ok ? Error::None : Error::Truncated;
+    }
+
+private:
+    static void fixed(std::vector<std::byte>& out, std::uint64_t value, const std::size_t bytes)
+    {
+        for (std::size_t i = 0; i < bytes; ++i, value >>= 8)
+            out.push_back(static_cast<std::byte>(value & 0xFF));
+    }
+
+    static void varint(std::vector<std::byte>& out, std::uint64_t value)
+    {
+        for (; value >= 0x80; value >>= 7)
+            out.push_back(static_cast<std::byte>(0x80 | (value & 0x7F)));
+        out.push_back(static_cast<std::byte>(value));
+    }
+
+    // Bounds checked little endian reader; `ok` turns false on the first overrun
+    struct Reader
+    {
+        std::span<const std::byte> in;
+        std::size_t at = 0;
+        bool ok = true;
+
+        [[nodiscard]] Error error(const Error otherwise) const noexcept { return ok ? otherwise : Error::Truncated; }
+
+        Data byte() noexcept
+        {
+            if (at >= in.size()) {
+                ok = false;
+                return 0;
+            }
+            return static_cast<Data>(in[at++]);
+        }
+
+        std::uint64_t fixed(const std::size_t bytes) noexcept
+        {
+            std::uint64_t value = 0;
+            for (std::size_t i = 0; i < bytes; ++i)
+                value |= static_cast<std::uint64_t>(byte()) << (8 * i);
+            return value;
+        }
+
+        std::uint64_t varint() noexcept
+        {
+            std::uint64_t value = 0;
+            for (unsigned shift = 0; shift < 64; shift += 7) {
+                const Data b = byte();
+                value |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+                if (!(b & 0x80))
+                    return value;
+            }
+            ok = false; // longer than 10 bytes
+            return 0;
+        }
+    };
+
+    Header m_header;
+    std::uint64_t m_frames = 0;
+    std::vector<Run> m_runs;
+    std::vector<std::uint64_t> m_hashes;
+};
+
+/** @brief Records or replays a movie through the Joypad, one frame at a time.
+ * @details
+ * The front end supplies how to run one frame (run_frame(), FRAME_CYCLES of emulation)
+ * and how to hash its state (hash() -> std::uint64_t). Both directions do the same per
+ * frame: set the frame's buttons, run it, and after every hash_interval-th frame take a
+ * hash. Nothing waits for host time, so a replay runs as fast as the emulation does and
+ * the joypad is only touched on frames where the input changes.
+ */
+class Player
+{
+public:
+    struct Result
+    {
+        std::uint64_t frames = 0; // frames played
+        bool desynced = false;
+        std::uint64_t hash = 0;   // index of the first mismatching hash when desynced
+    };
+
+    explicit Player(Joypad& joypad) noexcept
+    : m_joypad{joypad}
+    {}
+
+    /** @brief Plays the movie, stopping at the first hash mismatch or after `max_frames`
+     * @details
+     * With `verify` false no hash is taken at all (benchmark runs).
+     */
+    template<typename RunFrame, typename Hash>
+    Result play(const Recording& movie, RunFrame&& run_frame, Hash&& hash, const bool verify = true,
+        const std::uint64_t max_frames = UINT64_MAX)
+    {
+        Result result;
+        const std::uint32_t interval = verify ? movie.header().hash_interval : 0;
+        std::uint32_t until_hash = interval;
+        const std::span<const std::uint64_t> expected = movie.hashes();
+        for (const Run& run : movie.runs()) {
+            m_joypad.buttons(run.buttons);
+            for (std::uint32_t frame = 0; frame < run.frames; ++frame) {
+                if (result.frames == max_frames)
+                    return result;
+                run_frame();
+                ++result.frames;
+                if (interval && --until_hash == 0) {
+                    until_hash = interval;
+                    const std::size_t index = static_cast<std::size_t>(result.frames / interval - 1);
+                    if (index < expected.size() && hash() != expected[index]) {
+                        result.desynced = true;
+                        result.hash = index;
+                        return result;
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+    // Plays one frame with `buttons` and appends it (and a hash when one is due) to `movie`
+    template<typename RunFrame, typename Hash>
+    void record(Recording& movie, const Data buttons, RunFrame&& run_frame, Hash&& hash)
+    {
+        m_joypad.buttons(buttons);
+        run_frame();
+        movie.record(buttons);
+        const std::uint32_t interval = movie.header().hash_interval;
+        if (interval && movie.frames() % interval == 0)
+            movie.hash(hash());
+    }
+
+private:
+    Joypad& m_joypad;
+};
+
+} // namespace LR35902::Movie
+
+#endif // LR35902_MOVIE_HPP
@@ -2,6 +2,7 @@
 #include <string_view>
 #include <optional>
 #include <array>
+#include <cstddef>
 #include <cstdint>
 
 namespace LR35902
@@ -16,7 +17,9 @@ struct Opcode {
     const int cycles_no_action = 0;
 };
 
-// TODO: Remove name from Opcodes and only include when debugging.
+// Opcode is the authoring format only. It is ~40 bytes per entry because of `name`,
+// so the tables below are never indexed at run time. The decode loop reads the compact
+// structure-of-arrays in Decode and the disassembler reads Disassembly::names.
 
 // (C) means to dereference the offset given by C from the base address 0xFF00
 // (BC) means to dereference the address given by BC or other 16-bit registers
@@ -572,4 +575,86 @@ constexpr std::array<Opcode, 256> cb_opcodes {{
     {0xFF, true, "SET 7, A", 2, 8},
 }};
 
+namespace Decode
+{
+
+// Index into the decode tables: 0x000-0x0FF unprefixed, 0x100-0x1FF 0xCB prefixed
+[[nodiscard]] constexpr std::size_t index(const std::uint8_t code, const bool cb = false) noexcept
+{
+    return (static_cast<std::size_t>(cb) << 8) | code;
+}
+
+/** @brief Hot opcode metadata as structure-of-arrays, one byte per field.
+ * @details
+ * All of it fits in 1.5 KiB (24 cache lines) and a decode only touches one line per field.
+ * cycles_no_action is filled with cycles_action for unconditional instructions so that
+ * the decode loop can select the cost without checking whether the opcode branches.
+ */
+struct Timing
+{
+    std::array<std::uint8_t, 512> length;
+    std::array<std::uint8_t, 512> cycles_action;
+    std::array<std::uint8_t, 512> cycles_no_action;
+};
+
+namespace impl {
+constexpr void fill(Timing& timing, const std::array<Opcode, 256>& table, const bool cb)
+{
+    for (const Opcode& op : table) {
+        const std::size_t i = index(static_cast<std::uint8_t>(op.code), cb);
+        timing.length[i] = static_cast<std::uint8_t>(op.length);
+        timing.cycles_action[i] = static_cast<std::uint8_t>(op.cycles_action);
+        timing.cycles_no_action[i] = static_cast<std::uint8_t>(
+            op.cycles_no_action ? op.cycles_no_action : op.cycles_action);
+    }
+}
+
+consteval Timing make_timing()
+{
+    Timing timing{};
+    fill(timing, opcodes, false);
+    fill(timing, cb_opcodes, true);
+    return timing;
+}
+} // namespace impl
+
+inline constexpr Timing timing = impl::make_timing();
+
+static_assert(sizeof(Timing) == 3 * 512, "Decode tables must stay one byte per opcode per field.");
+static_assert(timing.length[index(0xC3)] == 3 && timing.cycles_action[index(0xC3)] == 16, "JP a16");
+static_assert(timing.cycles_no_action[index(0x20)] == 8, "JR NZ, s8 not taken");
+static_assert(timing.cycles_action[index(0x06, true)] == 16, "RLC (HL)");
+
+[[nodiscard]] constexpr std::uint8_t length(const std::uint8_t code, const bool cb = false) noexcept
+{
+    return timing.length[index(code, cb)];
+}
+
+[[nodiscard]] constexpr std::uint8_t cycles(const std::uint8_t code, const bool cb, const bool action) noexcept
+{
+    return action ? timing.cycles_action[index(code, cb)] : timing.cycles_no_action[index(code, cb)];
+}
+
+} // namespace Decode
+
+namespace Disassembly
+{
+
+// Cold table, only referenced by debugging / disassembly paths
+inline constexpr std::array<std::string_view, 512> names = [] {
+    std::array<std::string_view, 512> names{};
+    for (const Opcode& op : opcodes)
+        names[Decode::index(static_cast<std::uint8_t>(op.code), false)] = op.name;
+    for (const Opcode& op : cb_opcodes)
+        names[Decode::index(static_cast<std::uint8_t>(op.code), true)] = op.name;
+    return names;
+}();
+
+[[nodiscard]] constexpr std::string_view name(const std::uint8_t code, const bool cb = false) noexcept
+{
+    return names[Decode::index(code, cb)];
+}
+
+} // namespace Disassembly
+
 } // namespace LR35902
\ No newline at end of file
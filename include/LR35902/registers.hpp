@@ -3,6 +3,7 @@
 #include <CPU/registers.hpp>
 #include <sc/string_constant.hpp>
 #include <names.hpp>
+#include <savestate.hpp>
 
 namespace LR35902
 {
@@ -51,4 +52,7 @@ using RegisterFile = CPU::RegisterFile<Name::LR35902,
     CPU::RegisterDef<uint16_t, 16, LR35902::Register::PC>,
     CPU::RegisterDef<uint16_t, 16, LR35902::Register::SP>
 >;
+
+// Instantiates describe(): a register word the savestate can't copy as raw bytes fails here
+static_assert(requires(RegisterFile regs, StateLayout layout) { regs.describe(layout); });
 } // namespace LR35902
@@ -0,0 +1,433 @@
+#ifndef LR35902_REWIND_HPP
+#define LR35902_REWIND_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include <utility/simd.hpp>
+
+#include "savestate.hpp"
+
+namespace LR35902
+{
+
+// XOR delta coding of savestates against a keyframe, see Rewind
+namespace Delta
+{
+
+namespace Kernel
+{
+
+static constexpr std::size_t MIN_RUN = 4; // shorter equal runs stay inside the XOR bytes
+
+/***
+ * Delta kernels. Every kernel provides:
+ *   - same(a, b, n)    bytes before the first difference (n when equal)
+ *   - differ(a, b, n)  bytes before the first MIN_RUN equal bytes in a row, or before the
+ *                      equal bytes ending the range (n when they differ to the end)
+ *
+ * The SIMD kernels handle whole vectors and fall back to Scalar for the tail.
+ */
+struct Scalar
+{
+    static std::size_t same(const std::byte* a, const std::byte* b, const std::size_t n) noexcept
+    {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            std::uint64_t x, y;
+            std::memcpy(&x, a + i, 8);
+            std::memcpy(&y, b + i, 8);
+            if (const std::uint64_t diff = x ^ y)
+                return i + static_cast<std::size_t>((std::endian::native == std::endian::little
+                    ? std::countr_zero(diff) : std::countl_zero(diff)) / 8);
+        }
+        for (; i < n && a[i] == b[i]; ++i) {}
+        return i;
+    }
+
+    static std::size_t differ(const std::byte* a, const std::byte* b, const std::size_t n) noexcept
+    {
+        std::size_t end = 0, run = 0;
+        for (; end < n && run < MIN_RUN; ++end)
+            run = a[end] == b[end] ? run + 1 : 0;
+        return end - run;
+    }
+};
+
+#if UTILITY_SIMD_X86
+
+// Looks for MIN_RUN equal bytes in a row from a chunk's equal mask and the previous chunk's
+// last 3 equal bits (`carry`); `start` is relative to the chunk and may be -3..-1
+[[nodiscard]] inline bool run_start(const std::uint64_t equal, std::uint64_t& carry, std::ptrdiff_t& start, const unsigned bits) noexcept
+{
+    const std::uint64_t ext = equal << 3 | carry;
+    const std::uint64_t run = ext & ext >> 1 & ext >> 2 & ext >> 3;
+    if (run) {
+        start = static_cast<std::ptrdiff_t>(std::countr_zero(run)) - 3;
+        return true;
+    }
+    carry = equal >> (bits - 3);
+    return false;
+}
+
+// Equal bytes just before a chunk boundary, from run_start()'s carry
+[[nodiscard]] inline std::size_t streak(const std::uint64_t carry) noexcept
+{
+    return static_cast<std::size_t>(std::countl_one(static_cast<std::uint8_t>(carry << 5)));
+}
+
+struct SSE2
+{
+    static std::size_t same(const std::byte* a, const std::byte* b, const std::size_t n) noexcept
+    {
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            const unsigned equal = mask(a + i, b + i);
+            if (equal != 0xFFFF)
+                return i + static_cast<std::size_t>(std::countr_one(equal));
+        }
+        return i + Scalar::same(a + i, b + i, n - i);
+    }
+
+    static std::size_t differ(const std::byte* a, const std::byte* b, const std::size_t n) noexcept
+    {
+        std::uint64_t carry = 0;
+        std::ptrdiff_t start;
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+            if (run_start(mask(a + i, b + i), carry, start, 16))
+                return static_cast<std::size_t>(static_cast<std::ptrdiff_t>(i) + start);
+        const std::size_t back = std::min(i, streak(carry));
+        return i - back + Scalar::differ(a + i - back, b + i - back, n - i + back);
+    }
+
+    static unsigned mask(const std::byte* a, const std::byte* b) noexcept
+    {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+        const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+        return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)));
+    }
+};
+
+struct AVX2
+{
+    __attribute__((target("avx2")))
+    static std::size_t same(const std::byte* a, const std::byte* b, const std::size_t n) noexcept
+    {
+        std::size_t i = 0;
+        // two vectors per iteration: most of a snapshot is unchanged
+        for (; i + 64 <= n; i += 64) {
+            const __m256i x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            const __m256i y0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            const __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 32));
+            const __m256i y1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + 32));
+            const __m256i diff = _mm256_or_si256(_mm256_xor_si256(x0, y0), _mm256_xor_si256(x1, y1));
+            if (!_mm256_testz_si256(diff, diff))
+                break;
+        }
+        for (; i + 32 <= n; i += 32) {
+            const std::uint32_t equal = mask(a + i, b + i);
+            if (equal != 0xFFFFFFFFu)
+                return i + static_cast<std::size_t>(std::countr_one(equal));
+        }
+        return i + Scalar::same(a + i, b + i, n - i);
+    }
+
+    __attribute__((target("avx2")))
+    static std::size_t differ(const std::byte* a, const std::byte* b, const std::size_t n) noexcept
+    {
+        std::uint64_t carry = 0;
+        std::ptrdiff_t start;
+        std::size_t i = 0;
+        for (; i + 32 <= n; i += 32)
+            if (run_start(mask(a + i, b + i), carry, start, 32))
+                return static_cast<std::size_t>(static_cast<std::ptrdiff_t>(i) + start);
+        const std::size_t back = std::min(i, streak(carry));
+        return i - back + Scalar::differ(a + i - back, b + i - back, n - i + back);
+    }
+
+    __attribute__((target("avx2")))
+    static std::uint32_t mask(const std::byte* a, const std::byte* b) noexcept
+    {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+        const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+    }
+};
+
+#endif // UTILITY_SIMD_X86
+
+} // namespace Kernel
+
+struct DeltaKernels
+{
+    std::size_t (*same)(const std::byte*, const std::byte*, std::size_t) noexcept;
+    std::size_t (*differ)(const std::byte*, const std::byte*, std::size_t) noexcept;
+};
+
+template<typename KernelT>
+[[nodiscard]] constexpr DeltaKernels delta_kernels() noexcept
+{
+    return DeltaKernels{&KernelT::same, &KernelT::differ};
+}
+
+[[nodiscard]] inline DeltaKernels select_delta_kernels() noexcept
+{
+    return UTILITY_SIMD_SELECT(delta_kernels<Kernel::Scalar>(), delta_kernels<Kernel::SSE2>(),
+        delta_kernels<Kernel::AVX2>(), utility::cpu().avx2);
+}
+
+inline const DeltaKernels DELTA_KERNELS = select_delta_kernels();
+
+} // namespace Delta
+
+/** @brief Per-frame savestates for rewinding, XOR delta compressed against keyframes.
+ * @details
+ * record() once per frame snapshots the machine through its StateLayout, which must be
+ * complete when the Rewind is constructed. Every `keyframe_interval` frames the snapshot
+ * is a keyframe; the frames in between are stored as the XOR of their snapshot and the
+ * keyframe. XOR images are mostly zero, so each is run length coded as alternating runs:
+ *
+ *   { varint zeros  varint length  length XOR bytes } * until the snapshot size
+ *
+ * Keyframes are coded the same way against an all zero snapshot. Both the zero runs and
+ * the ends of the changed runs are found with SIMD compares (SSE2, or AVX2 when the CPU
+ * has it). Recording a frame is a snapshot and one encode pass, a few microseconds.
+ *
+ * Every delta refers to its keyframe only, so any frame decodes in at most two passes and
+ * rewinding any distance costs the same. A keyframe is also started early when a delta
+ * would be larger than its keyframe.
+ *
+ * Records live in one buffer of `budget` bytes, allocated up front and used as a ring.
+ * When it is full the oldest keyframe and its deltas are dropped together. With a 60
+ * frame interval a busy DMG game needs about 1 KB per frame (keyframes included), so the
+ * default 4 MiB holds roughly a minute at 60 fps.
+ */
+class Rewind
+{
+public:
+    static constexpr std::size_t BUDGET = 4 << 20;
+    static constexpr std::size_t KEYFRAME_INTERVAL = 60;
+
+    explicit Rewind(StateLayout& layout, const std::size_t budget = BUDGET, const std::size_t keyframe_interval = KEYFRAME_INTERVAL)
+    : m_layout{layout}
+    , m_interval{std::max<std::size_t>(keyframe_interval, 1)}
+    , m_ring(budget)
+    , m_now(layout.size())
+    , m_key(layout.size())
+    , m_zero(layout.size())
+    , m_restore(layout.size())
+    , m_code(2 * layout.size() + 32)
+    {}
+
+    // Frames that can be rewound (the latest record is frame 0)
+    [[nodiscard]] std::size_t frames() const noexcept { return m_entries.empty() ? 0 : m_entries.size() - 1; }
+
+    // Ring bytes held by records
+    [[nodiscard]] std::size_t used() const noexcept
+    {
+        std::size_t bytes = 0;
+        for (const Entry& entry : m_entries)
+            bytes += entry.size;
+        return bytes;
+    }
+
+    // Snapshots the machine as the newest frame; call once per frame
+    void record()
+    {
+        (void)m_layout.save_state(m_now);
+        bool key = m_entries.empty() || m_group >= m_interval;
+        std::size_t size = encode(key ? m_zero : m_key);
+        if (!key && size >= m_key_size) {
+            key = true;
+            size = encode(m_zero);
+        }
+        if (!make_room(size))
+            return; // larger than the whole budget
+        if (!key && m_group == 0) {
+            // its keyframe had to go, this frame starts the next group
+            key = true;
+            size = encode(m_zero);
+            if (!make_room(size))
+                return;
+        }
+        store(size, key);
+    }
+
+    /** @brief Loads the state of `frames` frames ago and drops every newer record.
+     * @details
+     * rewind(0) reloads the latest record. False (and nothing changes) when fewer frames
+     * are held or the layout no longer matches.
+     */
+    bool rewind(const std::size_t frames)
+    {
+        if (frames >= m_entries.size())
+            return false;
+        const std::size_t target = m_entries.size() - 1 - frames;
+        std::size_t key = target;
+        while (!m_entries[key].key)
+            --key;
+
+        const bool current_key = key + m_group == m_entries.size();
+        if (current_key)
+            std::memcpy(m_restore.data(), m_key.data(), m_key.size());
+        else
+            decode(m_entries[key], m_zero, m_restore);
+        if (target != key)
+            decode(m_entries[target], m_restore, m_restore);
+        if (m_layout.load_state(m_restore) != StateLayout::Error::None)
+            return false;
+
+        if (!current_key) {
+            decode(m_entries[key], m_zero, m_key);
+            m_key_size = m_entries[key].size;
+        }
+        m_entries.resize(target + 1);
+        m_group = target - key + 1;
+        m_head = m_entries.back().offset + m_entries.back().size;
+        return true;
+    }
+
+    void clear() noexcept
+    {
+        m_entries.clear();
+        m_head = 0;
+        m_group = 0;
+    }
+
+private:
+    static constexpr std::size_t NPOS = static_cast<std::size_t>(-1);
+
+    struct Entry
+    {
+        std::size_t offset;
+        std::size_t size;
+        bool key;
+    };
+
+    static std::byte* varint(std::byte* out, std::size_t value) noexcept
+    {
+        for (; value >= 0x80; value >>= 7)
+            *out++ = static_cast<std::byte>(0x80 | (value & 0x7F));
+        *out++ = static_cast<std::byte>(value);
+        return out;
+    }
+
+    static const std::byte* varint(const std::byte* in, std::size_t& value) noexcept
+    {
+        value = 0;
+        for (unsigned shift = 0;; shift += 7) {
+            const unsigned b = std::to_integer<unsigned>(*in++);
+            value |= static_cast<std::size_t>(b & 0x7F) << shift;
+            if (!(b & 0x80))
+                return in;
+        }
+    }
+
+    // Runs of m_now ^ base into m_code, returns the coded size
+    std::size_t encode(const std::vector<std::byte>& base) noexcept
+    {
+        const std::byte* now = m_now.data();
+        const std::byte* ref = base.data();
+        const std::size_t n = m_now.size();
+        std::byte* out = m_code.data();
+        for (std::size_t i = 0; i < n;) {
+            const std::size_t zeros = Delta::DELTA_KERNELS.same(now + i, ref + i, n - i);
+            i += zeros;
+            const std::size_t length = Delta::DELTA_KERNELS.differ(now + i, ref + i, n - i);
+            out = varint(out, zeros);
+            out = varint(out, length);
+            for (std::size_t k = 0; k < length; ++k)
+                out[k] = now[i + k] ^ ref[i + k];
+            out += length;
+            i += length;
+        }
+        return static_cast<std::size_t>(out - m_code.data());
+    }
+
+    // out = base ^ the entry's runs (out may be base)
+    void decode(const Entry& entry, const std::vector<std::byte>& base, std::vector<std::byte>& out) const noexcept
+    {
+        if (&out != &base)
+            std::memcpy(out.data(), base.data(), base.size());
+        const std::byte* in = m_ring.data() + entry.offset;
+        const std::byte* const end = in + entry.size;
+        for (std::size_t i = 0; in < end;) {
+            std::size_t zeros, length;
+            in = varint(in, zeros);
+            in = varint(in, length);
+            i += zeros;
+            for (std::size_t k = 0; k < length; ++k)
+                out[i + k] ^= in[k];
+            in += length;
+            i += length;
+        }
+    }
+
+    // Ring offset where `size` bytes fit without overwriting a record
+    [[nodiscard]] std::size_t place(const std::size_t size) const noexcept
+    {
+        if (m_entries.empty())
+            return size <= m_ring.size() ? 0 : NPOS;
+        const std::size_t tail = m_entries.front().offset;
+        if (m_head > tail) {
+            if (m_head + size <= m_ring.size())
+                return m_head;
+            return size <= tail ? 0 : NPOS; // wrap around
+        }
+        return m_head + size <= tail ? m_head : NPOS;
+    }
+
+    // Drops the oldest groups until `size` bytes fit (m_group is 0 if the current one went)
+    bool make_room(const std::size_t size)
+    {
+        while (place(size) == NPOS) {
+            if (m_entries.empty())
+                return false;
+            do {
+                m_entries.pop_front();
+            } while (!m_entries.empty() && !m_entries.front().key);
+            if (m_entries.empty())
+                clear();
+        }
+        return true;
+    }
+
+    void store(const std::size_t size, const bool key)
+    {
+        const std::size_t offset = place(size);
+        std::memcpy(m_ring.data() + offset, m_code.data(), size);
+        m_entries.push_back(Entry{offset, size, key});
+        m_head = offset + size;
+        if (key) {
+            std::swap(m_key, m_now);
+            m_key_size = size;
+            m_group = 1;
+        } else {
+            ++m_group;
+        }
+    }
+
+    StateLayout& m_layout;
+    const std::size_t m_interval;
+    std::vector<std::byte> m_ring;
+    std::deque<Entry> m_entries;
+    std::size_t m_head = 0;
+    std::size_t m_group = 0;    // records since (and including) the current keyframe
+    std::size_t m_key_size = 0; // coded size of the current keyframe
+
+    std::vector<std::byte> m_now;     // snapshot being recorded
+    std::vector<std::byte> m_key;     // current keyframe, decoded
+    std::vector<std::byte> m_zero;
+    std::vector<std::byte> m_restore;
+    std::vector<std::byte> m_code;
+};
+
+} // namespace LR35902
+
+#endif // LR35902_REWIND_HPP
@@ -0,0 +1,179 @@
+#ifndef LR35902_SAVESTATE_HPP
+#define LR35902_SAVESTATE_HPP
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace LR35902
+{
+
+/** @brief Fixed layout, versioned binary snapshot of the machine (save_state() / load_state()).
+ * @details
+ * Components list their state once, at setup, through describe(StateLayout&): each region
+ * is a member (array, POD struct or scalar) copied as raw bytes. Regions may not contain
+ * padding, so equal states save equal bytes; structs spell theirs out as zeroed members.
+ * The layout is then fixed, so every region has a known offset in the blob and saving or
+ * loading is one memcpy per region behind a 24 byte header:
+ *
+ *   "GBSS" u32 version  u64 layout  u64 size  { region bytes } * regions
+ *
+ * `layout` hashes the region count and sizes (and the host byte order), so a blob only
+ * loads into a machine built the same way; VERSION is bumped when a region changes
+ * meaning without changing size. Blobs are in host representation and are not meant to
+ * travel between builds.
+ *
+ * Only what the emulated machine can observe is saved. Caches derived from it (tile dirty
+ * bits, the OAM line index, palette LUTs) and host side state (frame buffers, buffered
+ * audio, observers, a link cable) are not; components rebuild them in their after_load()
+ * hooks, which run in registration order once every region is in place. Describe memories
+ * before the components that read them.
+ *
+ * The whole DMG state is about 17 KB, so a save or load is a few microseconds.
+ */
+class StateLayout
+{
+public:
+    static constexpr std::array<char, 4> MAGIC { 'G', 'B', 'S', 'S' };
+    static constexpr std::uint32_t VERSION = 2;
+
+    enum class Error : std::uint8_t
+    {
+        None,
+        Magic,   // not a savestate
+        Version, // written by another format version
+        Layout,  // written by a machine with different regions
+        Size,    // blob too short
+    };
+
+    struct Header
+    {
+        std::array<char, 4> magic;
+        std::uint32_t version;
+        std::uint64_t layout;
+        std::uint64_t size; // whole blob, header included
+    };
+
+    // Adds `bytes` to the layout; they must stay valid for the lifetime of the layout
+    void region(const std::span<std::byte> bytes)
+    {
+        m_regions.push_back(Region{bytes.data(), bytes.size()});
+        m_size += bytes.size();
+        m_layout = (m_layout ^ bytes.size()) * FNV_PRIME;
+    }
+
+    template<typename T>
+    void region(T& object)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "savestate regions are copied as raw bytes");
+        static_assert(std::has_unique_object_representations_v<T>, "savestate regions are compared and hashed as raw bytes, padding would leak in");
+        region(std::as_writable_bytes(std::span<T, 1>{&object, 1}));
+    }
+
+    template<typename... T>
+    void regions(T&... objects)
+    {
+        (region(objects), ...);
+    }
+
+    // Calls (object.*Method)() after every successful load_state()
+    template<auto Method, typename T>
+    void after_load(T& object)
+    {
+        m_hooks.push_back(Hook{&object, [](void* context) {
+            (static_cast<T*>(context)->*Method)();
+        }});
+    }
+
+    // Bytes a snapshot takes
+    [[nodiscard]] std::size_t size() const noexcept { return m_size; }
+
+    [[nodiscard]] std::uint64_t layout() const noexcept
+    {
+        return m_layout ^ (m_regions.size() << 1) ^ (std::endian::native == std::endian::little);
+    }
+
+    // Writes a snapshot to the front of `out`; false if it is shorter than size()
+    [[nodiscard]] bool save_state(const std::span<std::byte> out) const noexcept
+    {
+        if (out.size() < m_size)
+            return false;
+        const Header header{MAGIC, VERSION, layout(), m_size};
+        std::memcpy(out.data(), &header, sizeof(header));
+        std::byte* at = out.data() + sizeof(header);
+        for (const Region& region : m_regions) {
+            std::memcpy(at, region.data, region.size);
+            at += region.size;
+        }
+        return true;
+    }
+
+    [[nodiscard]] std::vector<std::byte> save_state() const
+    {
+        std::vector<std::byte> out(m_size);
+        (void)save_state(out);
+        return out;
+    }
+
+    // Restores every region from `in`; nothing is touched unless the result is Error::None
+    [[nodiscard]] Error load_state(const std::span<const std::byte> in) const noexcept
+    {
+        if (const Error error = check(in); error != Error::None)
+            return error;
+        const std::byte* at = in.data() + sizeof(Header);
+        for (const Region& region : m_regions) {
+            std::memcpy(region.data, at, region.size);
+            at += region.size;
+        }
+        for (const Hook& hook : m_hooks)
+            hook.loaded(hook.context);
+        return Error::None;
+    }
+
+    [[nodiscard]] Error check(const std::span<const std::byte> in) const noexcept
+    {
+        Header header;
+        if (in.size() < sizeof(header))
+            return Error::Size;
+        std::memcpy(&header, in.data(), sizeof(header));
+        if (header.magic != MAGIC)
+            return Error::Magic;
+        if (header.version != VERSION)
+            return Error::Version;
+        if (header.layout != layout() || header.size != m_size)
+            return Error::Layout;
+        if (in.size() < m_size)
+            return Error::Size;
+        return Error::None;
+    }
+
+private:
+    static constexpr std::uint64_t FNV_OFFSET = 0xCBF29CE484222325ull;
+    static constexpr std::uint64_t FNV_PRIME = 0x00000100000001B3ull;
+
+    struct Region
+    {
+        std::byte* data;
+        std::size_t size;
+    };
+
+    struct Hook
+    {
+        void* context = nullptr;
+        void (*loaded)(void* context) = nullptr;
+    };
+
+    std::vector<Region> m_regions;
+    std::vector<Hook> m_hooks;
+    std::size_t m_size = sizeof(Header);
+    std::uint64_t m_layout = FNV_OFFSET;
+};
+
+} // namespace LR35902
+
+#endif // LR35902_SAVESTATE_HPP
@@ -0,0 +1,230 @@
+#ifndef LR35902_SCHEDULER_HPP
+#define LR35902_SCHEDULER_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+#include "savestate.hpp"
+
+namespace LR35902
+{
+
+// Absolute number of T-cycles (4.194304 MHz) since power on.
+using Cycle = std::uint64_t;
+
+/** @brief Every component that needs to do something at a point in time owns exactly one event.
+ * @details
+ * Components are updated lazily. Nothing is ticked per cycle; instead each component computes
+ * when its next externally visible change happens and schedules that deadline here.
+ * Rescheduling an event replaces its previous deadline.
+ */
+enum class Event : std::uint8_t
+{
+    Interrupt,  // IF & IE became non-zero (raised by a component or a write to IF/IE)
+    PPU,        // Next PPU mode change (OAM scan, transfer, HBlank, VBlank)
+    Timer,      // TIMA overflow
+    DIV,        // DIV bit 12 falling edge (APU frame sequencer)
+    Serial,     // Serial transfer complete
+    DMA,        // OAM DMA complete
+
+    Count
+};
+
+static constexpr std::size_t EVENT_COUNT = static_cast<std::size_t>(Event::Count);
+
+/** @brief Fixed capacity indexed min-heap of event deadlines keyed by absolute cycle.
+ * @details
+ * There is at most one deadline per Event so the heap never allocates and an event can
+ * be moved in O(log EVENT_COUNT). The CPU runs uninterrupted until next() and only then
+ * are the expired events dispatched.
+ */
+class Scheduler
+{
+public:
+    static constexpr Cycle NEVER = std::numeric_limits<Cycle>::max();
+
+    [[nodiscard]] constexpr Cycle now() const noexcept { return m_now; }
+    constexpr void advance(const Cycle cycles) noexcept { m_now += cycles; }
+
+    // Deadline of the earliest event (NEVER when nothing is scheduled)
+    [[nodiscard]] constexpr Cycle next() const noexcept
+    {
+        return m_size ? m_deadline[index(m_heap[0])] : NEVER;
+    }
+
+    [[nodiscard]] constexpr bool expired() const noexcept { return next() <= m_now; }
+
+    [[nodiscard]] constexpr bool scheduled(const Event event) const noexcept
+    {
+        return m_position[index(event)] != NPOS;
+    }
+
+    [[nodiscard]] constexpr Cycle deadline(const Event event) const noexcept
+    {
+        return scheduled(event) ? m_deadline[index(event)] : NEVER;
+    }
+
+    // Schedule (or move) event to the absolute cycle `at`
+    constexpr void schedule(const Event event, const Cycle at) noexcept
+    {
+        const std::size_t e = index(event);
+        if (m_position[e] == NPOS) {
+            m_deadline[e] = at;
+            m_heap[m_size] = event;
+            m_position[e] = m_size;
+            sift_up(m_size++);
+            return;
+        }
+
+        const Cycle old = std::exchange(m_deadline[e], at);
+        if (at < old)
+            sift_up(m_position[e]);
+        else
+            sift_down(m_position[e]);
+    }
+
+    // Schedule event `delay` cycles from now
+    constexpr void schedule_in(const Event event, const Cycle delay) noexcept
+    {
+        schedule(event, m_now + delay);
+    }
+
+    constexpr void cancel(const Event event) noexcept
+    {
+        const std::size_t e = index(event);
+        if (m_position[e] == NPOS)
+            return;
+        remove(m_position[e]);
+    }
+
+    /** @brief Fires every expired event in deadline order.
+     * @details
+     * Events due at the same cycle fire in Event order, so an interrupt raised for that
+     * cycle is seen first and runs never depend on the order they were scheduled in.
+     * dispatch(Event, Cycle deadline) is called with the event already removed so that the
+     * handler may reschedule it. Handlers run with now() at or past their deadline and must
+     * use the passed deadline (not now()) as the base for periodic events to avoid drift.
+     */
+    template<typename Dispatch>
+    constexpr void fire(Dispatch&& dispatch)
+    {
+        while (expired()) {
+            const Event event = m_heap[0];
+            const Cycle at = m_deadline[index(event)];
+            remove(0);
+            dispatch(event, at);
+        }
+    }
+
+    // The heap is plain arrays, so the whole scheduler is one region
+    void describe(StateLayout& layout) { layout.region(*this); }
+
+    /** @brief Runs the cpu until `end` stopping only at scheduled deadlines.
+     * @details
+     * cpu.step() executes one instruction and returns the number of cycles it took.
+     * IF/IE are never polled here. Anything that can make an interrupt pending schedules
+     * Event::Interrupt which ends the inner loop like any other deadline.
+     *
+     * While cpu.halted() (HALT/STOP) only a scheduled event can wake the cpu, so the clock
+     * jumps straight to the next deadline. Lazily updated components derive their state
+     * from now() and catch up in that single step.
+     *
+     * next() is read again after every step: an instruction may schedule an event for now
+     * (EI, HALT and a pending interrupt), which must end the loop before the next one.
+     */
+    template<typename Cpu, typename Dispatch>
+    constexpr void run_until(const Cycle end, Cpu& cpu, Dispatch&& dispatch)
+    {
+        while (m_now < end) {
+            while (m_now < std::min(end, next())) {
+                if (cpu.halted()) {
+                    m_now = std::min(end, next());
+                    break;
+                }
+                m_now += cpu.step();
+            }
+            fire(dispatch);
+        }
+    }
+
+private:
+    static constexpr std::size_t NPOS = EVENT_COUNT;
+    // The scheduler is saved as raw bytes: round the heap up so no padding follows it
+    static constexpr std::size_t HEAP = (EVENT_COUNT + alignof(Cycle) - 1) / alignof(Cycle) * alignof(Cycle);
+
+    [[nodiscard]] static constexpr std::size_t index(const Event event) noexcept
+    {
+        return static_cast<std::size_t>(event);
+    }
+
+    [[nodiscard]] constexpr bool before(const std::size_t a, const std::size_t b) const noexcept
+    {
+        const std::size_t x = index(m_heap[a]), y = index(m_heap[b]);
+        return m_deadline[x] < m_deadline[y] || (m_deadline[x] == m_deadline[y] && x < y);
+    }
+
+    constexpr void swap(const std::size_t a, const std::size_t b) noexcept
+    {
+        std::swap(m_heap[a], m_heap[b]);
+        m_position[index(m_heap[a])] = a;
+        m_position[index(m_heap[b])] = b;
+    }
+
+    constexpr void sift_up(std::size_t pos) noexcept
+    {
+        while (pos > 0) {
+            const std::size_t parent = (pos - 1) / 2;
+            if (!before(pos, parent))
+                break;
+            swap(pos, parent);
+            pos = parent;
+        }
+    }
+
+    constexpr void sift_down(std::size_t pos) noexcept
+    {
+        for (;;) {
+            const std::size_t left = 2 * pos + 1;
+            const std::size_t right = left + 1;
+            std::size_t least = pos;
+            if (left < m_size && before(left, least))
+                least = left;
+            if (right < m_size && before(right, least))
+                least = right;
+            if (least == pos)
+                break;
+            swap(pos, least);
+            pos = least;
+        }
+    }
+
+    constexpr void remove(const std::size_t pos) noexcept
+    {
+        const Event event = m_heap[pos];
+        const std::size_t last = --m_size;
+        if (pos != last) {
+            swap(pos, last);
+            sift_down(pos);
+            sift_up(pos);
+        }
+        m_position[index(event)] = NPOS;
+    }
+
+    Cycle m_now = 0;
+    std::size_t m_size = 0;
+    std::array<Event, HEAP> m_heap{};
+    std::array<Cycle, EVENT_COUNT> m_deadline{};
+    std::array<std::size_t, EVENT_COUNT> m_position = [] {
+        std::array<std::size_t, EVENT_COUNT> position{};
+        position.fill(NPOS);
+        return position;
+    }();
+};
+
+} // namespace LR35902
+
+#endif // LR35902_SCHEDULER_HPP
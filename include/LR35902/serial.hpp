@@ -0,0 +1,255 @@
+#ifndef LR35902_SERIAL_HPP
+#define LR35902_SERIAL_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <vector>
+
+#include "types.hpp"
+#include "io.hpp"
+#include "state.hpp"
+#include "scheduler.hpp"
+#include "interrupts.hpp"
+#include "link.hpp"
+#include "savestate.hpp"
+
+namespace LR35902
+{
+
+/** @brief SB/SC (0xFF01/0xFF02) transfers, to a local peer or over a Link::Cable.
+ * @details
+ * A transfer is one event, never eight bit clocks: a write of SC with bit 7 set and the
+ * internal clock schedules Event::Serial for the cycle the eighth bit would be shifted,
+ * and completing it swaps the bytes, clears SC bit 7 and requests the Serial interrupt.
+ *
+ * Without a cable the other side is a Peer, by default an unplugged port that shifts in
+ * 0xFF. instant(true) completes internal clock transfers on the SC write itself, for
+ * test ROMs and scripted peers that do not care about transfer time. An external clock
+ * transfer without a cable never completes, as on hardware.
+ *
+ * With a cable both instances run in lockstep quanta of `quantum` cycles instead of per
+ * bit. At the end of every quantum each side sends what happened in it (a transfer its
+ * clock started, its answers to the other side's transfers) followed by a Sync, then
+ * waits for the other side's batch of the same quantum. The side whose clock runs sends
+ * Start with the byte and the cycles left until the transfer ends; a side waiting with
+ * SC bit 7 set and the external clock takes the byte, answers with its own SB in the
+ * next batch and completes at the same point of the shared timeline. The master needs
+ * that answer one quantum later, so with quantum at most half the transfer time (2048
+ * at 8192 Hz) both sides complete exactly on time; a longer quantum or the CGB fast
+ * clock delays the master until the answer arrives. Both instances only act on quantum
+ * boundaries, so a linked run is deterministic whatever the host scheduling.
+ *
+ * A side that is not waiting answers 0xFF, as does a failed cable (error() then holds
+ * the errno and the port is unplugged).
+ */
+class Serial
+{
+public:
+    static constexpr Cycle BIT_CYCLES = 512;     // 8192 Hz
+    static constexpr Cycle FAST_BIT_CYCLES = 16; // CGB SC bit 1, 262144 Hz
+    static constexpr Cycle QUANTUM = 2048;       // default lockstep quantum
+    static constexpr Data UNPLUGGED = 0xFF;
+
+    // Local other end: receives the byte sent and returns the byte it sends back
+    struct Peer
+    {
+        void* context = nullptr;
+        Data (*exchange)(void* context, Data sent) = nullptr;
+    };
+
+    Serial(Scheduler& scheduler, Interrupts& interrupts, SystemState& system) noexcept
+    : m_scheduler{scheduler}
+    , m_interrupts{interrupts}
+    , m_io{system.io}
+    {
+        m_io.observe<IO::SerCtrl, &Serial::on_control>(*this);
+    }
+
+    Serial(const Serial&) = delete; // observers point at this
+    Serial& operator=(const Serial&) = delete;
+
+    // Event::Serial handler, `at` is the deadline that expired
+    inline void on_event(const Cycle at)
+    {
+        if (m_cable && at >= m_boundary)
+            exchange();
+        if (m_transfer && m_received && at >= m_complete_at)
+            complete();
+        reschedule();
+    }
+
+    inline void attach(const Peer peer) noexcept { m_peer = peer; }
+
+    // Cable-less internal clock transfers complete on the SC write
+    inline void instant(const bool instant) noexcept { m_instant = instant; }
+
+    /** @brief Plugs in a connected cable (nullptr unplugs).
+     * @details
+     * Both instances must use the same quantum; the first quantum ends `quantum` cycles
+     * after this call. The cable is not owned and must outlive the connection.
+     */
+    inline void connect(Link::Cable* cable, const Cycle quantum = QUANTUM) noexcept
+    {
+        m_cable = cable && !cable->error() ? cable : nullptr;
+        m_error = cable ? cable->error() : 0;
+        m_quantum = std::max<Cycle>(quantum, 1);
+        m_boundary = m_scheduler.now() + m_quantum;
+        m_sequence = 0;
+        m_outbox.clear();
+        reschedule();
+    }
+
+    [[nodiscard]] inline bool connected() const noexcept { return m_cable != nullptr; }
+
+    // errno of the cable failure that unplugged the port, 0 if none
+    [[nodiscard]] inline int error() const noexcept { return m_error; }
+
+    // The transfer in progress; the peer and the cable are host side and stay as they are
+    void describe(StateLayout& layout)
+    {
+        layout.regions(m_transfer, m_master, m_sent, m_received, m_outgoing, m_incoming, m_complete_at);
+    }
+
+private:
+    // --- register writes ---
+
+    inline void on_control(const Data, const Data now)
+    {
+        if (!IO::SerCtrl::Transfer::get(now)) {
+            m_transfer = false; // the CPU aborted the transfer
+            reschedule();
+            return;
+        }
+        if (m_transfer || !IO::SerCtrl::Clock::get(now))
+            return; // already running, or waiting for the other side's clock
+
+        const Cycle at = m_scheduler.now();
+        m_transfer = true;
+        m_master = true;
+        m_sent = false;
+        m_complete_at = at + 8 * (IO::SerCtrl::Speed::get(now) ? FAST_BIT_CYCLES : BIT_CYCLES);
+        m_outgoing = m_io.value<IO::SerTxRx>();
+        if (m_cable) {
+            m_received = false; // the Start goes out at the end of this quantum
+        } else {
+            m_incoming = m_peer.exchange ? m_peer.exchange(m_peer.context, m_outgoing) : UNPLUGGED;
+            m_received = true;
+            if (m_instant) {
+                complete();
+                return;
+            }
+        }
+        reschedule();
+    }
+
+    inline void complete() noexcept
+    {
+        m_transfer = false;
+        m_io.store<IO::SerTxRx>(m_incoming);
+        m_io.set<IO::SerCtrl::Transfer>(false);
+        m_interrupts.request(Interrupt::Serial);
+    }
+
+    // --- cable ---
+
+    // End of quantum m_sequence: send this side's batch, then apply the other side's
+    inline void exchange()
+    {
+        const Cycle at = m_boundary;
+        if (m_transfer && m_master && !m_sent) {
+            m_outbox.push_back(Link::Message{Link::Message::Kind::Start, m_outgoing, m_complete_at > at ? m_complete_at - at : 0});
+            m_sent = true;
+        }
+        m_outbox.push_back(Link::Message{Link::Message::Kind::Sync, 0, m_sequence});
+        int error = m_cable->send(m_outbox);
+        m_outbox.clear();
+
+        for (Link::Message message; !error;) {
+            error = m_cable->receive(message);
+            if (error)
+                break;
+            if (message.kind == Link::Message::Kind::Sync) {
+                if (message.value != m_sequence)
+                    error = EPROTO;
+                break;
+            }
+            if (message.kind == Link::Message::Kind::Start)
+                m_outbox.push_back(Link::Message{Link::Message::Kind::Reply, respond(message, at), 0});
+            else if (m_transfer && m_master && !m_received) {
+                m_incoming = message.byte;
+                m_received = true;
+            }
+        }
+
+        if (error)
+            unplug(error);
+        ++m_sequence;
+        m_boundary += m_quantum;
+    }
+
+    // The other side's clock started a transfer; returns the byte this side shifts out
+    [[nodiscard]] inline Data respond(const Link::Message& start, const Cycle at) noexcept
+    {
+        const Data control = m_io.value<IO::SerCtrl>();
+        if (m_transfer || !IO::SerCtrl::Transfer::get(control) || IO::SerCtrl::Clock::get(control))
+            return UNPLUGGED; // not waiting for an external clock
+        m_transfer = true;
+        m_master = false;
+        m_received = true;
+        m_incoming = start.byte;
+        m_complete_at = at + start.value;
+        return m_io.value<IO::SerTxRx>();
+    }
+
+    inline void unplug(const int error) noexcept
+    {
+        m_error = error;
+        m_cable = nullptr;
+        if (m_transfer && !m_received) {
+            m_incoming = UNPLUGGED;
+            m_received = true;
+        }
+    }
+
+    inline void reschedule() noexcept
+    {
+        Cycle next = Scheduler::NEVER;
+        if (m_cable)
+            next = m_boundary;
+        if (m_transfer && m_received)
+            next = std::min(next, std::max(m_complete_at, m_scheduler.now()));
+        if (next == Scheduler::NEVER)
+            m_scheduler.cancel(Event::Serial);
+        else
+            m_scheduler.schedule(Event::Serial, next);
+    }
+
+    Scheduler& m_scheduler;
+    Interrupts& m_interrupts;
+    IO::RegisterBank& m_io;
+
+    Peer m_peer{};
+    bool m_instant = false;
+
+    // transfer in progress
+    bool m_transfer = false;
+    bool m_master = false;   // this side's clock runs it
+    bool m_sent = false;     // its Start went out
+    bool m_received = false; // m_incoming is known
+    Data m_outgoing = 0;
+    Data m_incoming = UNPLUGGED;
+    Cycle m_complete_at = 0;
+
+    // cable
+    Link::Cable* m_cable = nullptr;
+    int m_error = 0;
+    Cycle m_quantum = QUANTUM;
+    Cycle m_boundary = 0;
+    std::uint64_t m_sequence = 0;
+    std::vector<Link::Message> m_outbox;
+};
+
+} // namespace LR35902
+
+#endif // LR35902_SERIAL_HPP
@@ -0,0 +1,204 @@
+#ifndef LR35902_TIMER_HPP
+#define LR35902_TIMER_HPP
+
+#include <array>
+#include <cstdint>
+
+#include "types.hpp"
+#include "io.hpp"
+#include "state.hpp"
+#include "scheduler.hpp"
+#include "interrupts.hpp"
+#include "savestate.hpp"
+
+namespace LR35902
+{
+
+/** @brief DIV, TIMA, TMA and TAC derived from the clock instead of counted.
+ * @details
+ * The hardware has one 16 bit counter running at the CPU clock. DIV is its upper byte and
+ * TIMA counts the falling edges of (TAC enable AND the counter bit TAC selects). Here the
+ * counter is just now() - the cycle DIV was last reset, so DIV and TIMA are computed when
+ * the CPU reads them (RegisterBank::derive()) and nothing runs per cycle.
+ *
+ * TIMA is kept as its value at some cycle plus the edges since then. The only thing that
+ * has to happen on time is the overflow: Event::Timer is scheduled once for the cycle TIMA
+ * is reloaded from TMA and the interrupt is requested, RELOAD_DELAY after the increment
+ * that wrapped it (TIMA reads 0 in between). Writes to DIV, TIMA and TAC move that
+ * deadline; TMA is only read at the reload so its writes need nothing.
+ *
+ * Both DMG falling edge glitches are modelled: resetting DIV, or a TAC write that clears
+ * the enable bit or switches to a clock bit that is 0, while the selected bit is 1
+ * increments TIMA once.
+ *
+ * Timing is at instruction granularity like every other component: a write takes effect
+ * at now(), and the single cycle TIMA/TMA write races inside the reload window are not
+ * modelled. CGB double speed is not modelled either.
+ */
+class Timer
+{
+public:
+    static constexpr Cycle RELOAD_DELAY = 4;
+    static constexpr std::array<Cycle, 4> PERIOD { 1024, 16, 64, 256 }; // cycles per TIMA increment by TAC clock
+
+    Timer(Scheduler& scheduler, Interrupts& interrupts, SystemState& system) noexcept
+    : m_scheduler{scheduler}
+    , m_interrupts{interrupts}
+    , m_io{system.io}
+    , m_since{scheduler.now()}
+    {
+        m_io.observe<IO::DIV, &Timer::on_div>(*this);
+        m_io.observe<IO::TIMA, &Timer::on_tima>(*this);
+        m_io.observe<IO::TAC, &Timer::on_tac>(*this);
+        m_io.derive<IO::DIV, &Timer::div>(*this);
+        m_io.derive<IO::TIMA, &Timer::tima>(*this);
+
+        m_count = m_io.value<IO::TIMA>();
+        configure(m_io.value<IO::TAC>());
+        reschedule();
+    }
+
+    Timer(const Timer&) = delete; // observers point at this
+    Timer& operator=(const Timer&) = delete;
+
+    // Event::Timer handler, `at` is the deadline that expired
+    inline void on_event(const Cycle at) noexcept
+    {
+        m_count = m_io.value<IO::TMA>();
+        m_since = at;
+        m_interrupts.request(Interrupt::Timer);
+        reschedule();
+    }
+
+    // The 16 bit system counter
+    [[nodiscard]] inline std::uint16_t counter() const noexcept
+    {
+        return static_cast<std::uint16_t>(m_scheduler.now() - m_origin);
+    }
+
+    [[nodiscard]] inline Data div() const noexcept
+    {
+        return static_cast<Data>(counter() >> 8);
+    }
+
+    [[nodiscard]] inline Data tima() const noexcept
+    {
+        const Cycle now = m_scheduler.now();
+        return static_cast<Data>(m_count + (m_count < OVERFLOWED ? edges(now) : 0));
+    }
+
+    void describe(StateLayout& layout)
+    {
+        layout.regions(m_origin, m_since, m_overflow, m_count, m_enabled, m_period);
+    }
+
+private:
+    static constexpr unsigned OVERFLOWED = 0x100; // TIMA wrapped, reload pending
+
+    // --- register writes ---
+
+    inline void on_div(const Data, const Data) noexcept
+    {
+        const Cycle at = m_scheduler.now();
+        sync(at);
+        if (line(at))
+            increment(at);
+        m_origin = at;
+        reschedule();
+    }
+
+    inline void on_tima(const Data, const Data now) noexcept
+    {
+        sync(m_scheduler.now());
+        m_count = now; // also cancels a pending reload
+        reschedule();
+    }
+
+    inline void on_tac(const Data, const Data now) noexcept
+    {
+        const Cycle at = m_scheduler.now();
+        sync(at);
+        const bool before = line(at);
+        configure(now);
+        if (before && !line(at))
+            increment(at);
+        reschedule();
+    }
+
+    inline void configure(const Data tac) noexcept
+    {
+        m_enabled = IO::TAC::Enable::get(tac);
+        m_period = PERIOD[IO::TAC::Clock::get(tac)];
+    }
+
+    // --- counting ---
+
+    // The signal whose falling edges clock TIMA: enable AND the selected counter bit
+    [[nodiscard]] inline bool line(const Cycle at) const noexcept
+    {
+        return m_enabled && ((at - m_origin) & (m_period / 2));
+    }
+
+    // Falling edges in (m_since, at], one each time the counter passes a multiple of the period
+    [[nodiscard]] inline Cycle edges(const Cycle at) const noexcept
+    {
+        if (!m_enabled)
+            return 0;
+        return (at - m_origin) / m_period - (m_since - m_origin) / m_period;
+    }
+
+    // Cycle of the edge that wraps TIMA
+    [[nodiscard]] inline Cycle overflow() const noexcept
+    {
+        return m_origin + ((m_since - m_origin) / m_period + OVERFLOWED - m_count) * m_period;
+    }
+
+    // Folds the edges up to `at` into m_count
+    inline void sync(const Cycle at) noexcept
+    {
+        if (m_count < OVERFLOWED) {
+            const Cycle edges = this->edges(at);
+            if (m_count + edges >= OVERFLOWED) {
+                m_overflow = overflow();
+                m_count = OVERFLOWED;
+            } else {
+                m_count += static_cast<unsigned>(edges);
+            }
+        }
+        m_since = at;
+    }
+
+    // Glitch increment at `at` (after sync())
+    inline void increment(const Cycle at) noexcept
+    {
+        if (m_count >= OVERFLOWED)
+            return;
+        if (++m_count == OVERFLOWED)
+            m_overflow = at;
+    }
+
+    inline void reschedule() noexcept
+    {
+        if (m_count >= OVERFLOWED)
+            m_scheduler.schedule(Event::Timer, m_overflow + RELOAD_DELAY);
+        else if (m_enabled)
+            m_scheduler.schedule(Event::Timer, overflow() + RELOAD_DELAY);
+        else
+            m_scheduler.cancel(Event::Timer);
+    }
+
+    Scheduler& m_scheduler;
+    Interrupts& m_interrupts;
+    IO::RegisterBank& m_io;
+
+    Cycle m_origin = 0;    // last DIV reset, the counter is 0 here (power on is cycle 0)
+    Cycle m_since;         // TIMA was m_count here
+    Cycle m_overflow = 0;  // valid while m_count == OVERFLOWED
+    unsigned m_count = 0;
+    bool m_enabled = false;
+    Cycle m_period = PERIOD[0];
+};
+
+} // namespace LR35902
+
+#endif // LR35902_TIMER_HPP
@@ -1,9 +1,12 @@
 #ifndef UTILITY_INTERVAL_HPP
 #define UTILITY_INTERVAL_HPP
 
+#include <algorithm>
+#include <cstddef>
 #include <iterator>
 #include <numeric>
 #include <initializer_list>
+#include <type_traits>
 
 
 namespace utility
@@ -27,10 +30,15 @@ struct Interval
     static constexpr T END = EndV;
     static constexpr Boundary LOWER = LeftV;
     static constexpr Boundary UPPER = RightV;
-    static constexpr size_t DISTANCE = max() - min() + 1;
-    
-    static_assert(DISTANCE == 0, "Interval requires members.");
-    static_assert(END < BEGIN,   "Interval over invalid range.");
+
+    // min() and max(), usable in the initializers below
+    static constexpr T MIN = LOWER == Boundary::Inclusive ? BEGIN : static_cast<T>(BEGIN + 1);
+    static constexpr T MAX = UPPER == Boundary::Inclusive ? END : static_cast<T>(END - 1);
+
+    static_assert(BEGIN <= END, "Interval over invalid range.");
+    static_assert(MIN <= MAX,   "Interval requires members.");
+
+    static constexpr std::size_t DISTANCE = static_cast<std::size_t>(MAX - MIN) + 1;
 
     class iterator
     {
@@ -41,28 +49,30 @@ struct Interval
         using pointer =           T*;
         using iterator_category = std::random_access_iterator_tag;
 
+        inline constexpr explicit iterator(const T v) noexcept : v{v} {}
+
         [[nodiscard]] inline constexpr T operator*() const noexcept { return v; }
-        [[nodiscard]] inline constexpr iterator& operator++() noexcept { ++v; return *this; }
-        [[nodiscard]] inline constexpr iterator operator++(int) noexcept { iterator temp = *this; ++(*this); return temp; }
-        [[nodiscard]] inline constexpr iterator& operator--() noexcept { --v; return *this; }
-        [[nodiscard]] inline constexpr iterator operator--(int) noexcept  { iterator temp = *this; --(*this); return temp; }
+        inline constexpr iterator& operator++() noexcept { ++v; return *this; }
+        inline constexpr iterator operator++(int) noexcept { iterator temp = *this; ++(*this); return temp; }
+        inline constexpr iterator& operator--() noexcept { --v; return *this; }
+        inline constexpr iterator operator--(int) noexcept  { iterator temp = *this; --(*this); return temp; }
         [[nodiscard]] inline constexpr iterator operator+(T n) const noexcept { return iterator(v + n); }
         [[nodiscard]] inline constexpr iterator operator-(T n) const noexcept { return iterator(v - n); }
-        [[nodiscard]] inline constexpr iterator& operator+=(T n) noexcept { v += n; return *this; }
-        [[nodiscard]] inline constexpr iterator& operator-=(T n) noexcept { v -= n; return *this; }
+        inline constexpr iterator& operator+=(T n) noexcept { v += n; return *this; }
+        inline constexpr iterator& operator-=(T n) noexcept { v -= n; return *this; }
         [[nodiscard]] inline constexpr difference_type operator-(const iterator& other) const noexcept { return v - other.v; }
 
-        [[nodiscard]] inline constexpr bool operator==(const range_iterator& other) const noexcept { return v == other.v; }
-        [[nodiscard]] inline constexpr bool operator!=(const range_iterator& other) const noexcept { return v != other.v; }
-        [[nodiscard]] inline constexpr bool operator< (const range_iterator& other) const noexcept { return v < other.v; }
-        [[nodiscard]] inline constexpr bool operator<=(const range_iterator& other) const noexcept { return v <= other.v; }
-        [[nodiscard]] inline constexpr bool operator> (const range_iterator& other) const noexcept { return v > other.v; }
-        [[nodiscard]] inline constexpr bool operator>=(const range_iterator& other) const noexcept { return v >= other.v; }
-    
+        [[nodiscard]] inline constexpr bool operator==(const iterator& other) const noexcept { return v == other.v; }
+        [[nodiscard]] inline constexpr bool operator!=(const iterator& other) const noexcept { return v != other.v; }
+        [[nodiscard]] inline constexpr bool operator< (const iterator& other) const noexcept { return v < other.v; }
+        [[nodiscard]] inline constexpr bool operator<=(const iterator& other) const noexcept { return v <= other.v; }
+        [[nodiscard]] inline constexpr bool operator> (const iterator& other) const noexcept { return v > other.v; }
+        [[nodiscard]] inline constexpr bool operator>=(const iterator& other) const noexcept { return v >= other.v; }
+
     private:
         value_type v;
     };
-    
+
     [[nodiscard]] inline static constexpr bool isMember(const T value)
     {
         // range consists of a single value
@@ -73,13 +83,13 @@ struct Interval
             return min() <= value && value <= max();
     }
 
-    [[nodiscard]] inline static constexpr T min() const { return if constexpr (LOWER == Boundary::Inclusive) return BEGIN; else return BEGIN + 1; }
-    [[nodiscard]] inline static constexpr T max() const { return if constexpr (UPPER == Boundary::Inclusive) return END;   else return END - 1;   }
+    [[nodiscard]] inline static constexpr T min() { return MIN; }
+    [[nodiscard]] inline static constexpr T max() { return MAX; }
 
-    [[nodiscard]] inline static constexpr auto begin()   const { return iterator{min()}; }
-    [[nodiscard]] inline static constexpr auto end()     const { return iterator{max()+1}; }
-    [[nodiscard]] inline static constexpr auto rbegin()  const { return std::make_reverse_iterator(end()); }
-    [[nodiscard]] inline static constexpr auto rend()    const { return std::make_reverse_iterator(begin()); }
+    [[nodiscard]] inline static constexpr auto begin()   { return iterator{min()}; }
+    [[nodiscard]] inline static constexpr auto end()     { return iterator{static_cast<T>(max() + 1)}; }
+    [[nodiscard]] inline static constexpr auto rbegin()  { return std::make_reverse_iterator(end()); }
+    [[nodiscard]] inline static constexpr auto rend()    { return std::make_reverse_iterator(begin()); }
 };
 
 
@@ -87,7 +97,7 @@ namespace impl {
 template<typename U>
 inline constexpr U accumulate(std::initializer_list<U> ilist)
 {
-    return std::accumulate(std::begin(ilist()), std::end(ilist), U{});
+    return std::accumulate(std::begin(ilist), std::end(ilist), U{});
 }
 } // namespace impl
 
@@ -96,12 +106,13 @@ template<typename ... Intervals>
 struct MultiInterval
 {
 private:
-    
+    using T = std::common_type_t<decltype(Intervals::min())...>;
+
 public:
-    static constexpr std::size_t DISTANCE = impl::accumulate({Intervals::DISTANCE, ...}); // TODO: is going to be wrong for overlapping intervals
+    static constexpr std::size_t DISTANCE = impl::accumulate({Intervals::DISTANCE...}); // TODO: is going to be wrong for overlapping intervals
     [[nodiscard]] inline static constexpr bool isMember(const T value) { return (Intervals::isMember(value) || ...); }
-    [[nodiscard]] inline static constexpr T min() const { return std::min({Intervals::min(), ...}); }
-    [[nodiscard]] inline static constexpr T max() const { return std::max({Intervals::max(), ...}); }
+    [[nodiscard]] inline static constexpr T min() { return std::min({Intervals::min()...}); }
+    [[nodiscard]] inline static constexpr T max() { return std::max({Intervals::max()...}); }
 };
 
 
@@ -124,4 +135,4 @@ using Span = Interval<T, BEGIN, END, Boundary::Inclusive, Boundary::Exclusive>;
 
 } // namespace utility
 
-#endif // UTILITY_INTERVAL_HPP
\ No newline at end of file
+#endif // UTILITY_INTERVAL_HPP
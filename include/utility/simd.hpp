@@ -0,0 +1,55 @@
+#ifndef UTILITY_SIMD_HPP
+#define UTILITY_SIMD_HPP
+
+#if defined(__x86_64__) || defined(__i386__)
+#define UTILITY_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define UTILITY_SIMD_X86 0
+#endif
+
+/***
+ * Runtime kernel dispatch. SIMD kernels are compiled with __attribute__((target(...)))
+ * inside `#if UTILITY_SIMD_X86`, so the binary runs on any CPU of the architecture, and
+ * the table for the host is picked once at startup:
+ *
+ *   inline const Kernels KERNELS = UTILITY_SIMD_SELECT(scalar, sse2, avx2, utility::cpu().avx2);
+ *
+ * yields `avx2` when the condition holds, else `sse2` (every x86-64 CPU has SSE2), and
+ * `scalar` on other architectures. It is a macro so the SIMD arguments may name kernels
+ * that only exist on x86.
+ */
+
+#if UTILITY_SIMD_X86
+#define UTILITY_SIMD_SELECT(scalar, sse2, avx2, use_avx2) ((use_avx2) ? (avx2) : (sse2))
+#else
+#define UTILITY_SIMD_SELECT(scalar, sse2, avx2, use_avx2) (scalar)
+#endif
+
+namespace utility
+{
+
+struct CpuFeatures
+{
+    bool avx2 = false;
+    bool fma = false;
+};
+
+// What the host CPU supports, read once through CPUID
+[[nodiscard]] inline const CpuFeatures& cpu() noexcept
+{
+    static const CpuFeatures features = [] {
+        CpuFeatures detected;
+#if UTILITY_SIMD_X86
+        __builtin_cpu_init();
+        detected.avx2 = __builtin_cpu_supports("avx2");
+        detected.fma = __builtin_cpu_supports("fma");
+#endif
+        return detected;
+    }();
+    return features;
+}
+
+} // namespace utility
+
+#endif // UTILITY_SIMD_HPP
@@ -0,0 +1,122 @@
+#ifndef UTILITY_SPSC_RING_HPP
+#define UTILITY_SPSC_RING_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <thread>
+#include <type_traits>
+
+namespace utility
+{
+
+// Fixed rather than std::hardware_destructive_interference_size, which is not ABI stable
+inline constexpr std::size_t CACHE_LINE = 64;
+
+/** @brief Bounded lock-free single producer / single consumer ring.
+ * @details
+ * try_push() and try_pop() never wait for the other side; push() spins, yielding, while
+ * the ring is full.
+ *
+ * Head and tail are free running counters on separate cache lines; each side also keeps
+ * a cached copy of the other side's counter so the shared line is only read when the
+ * ring looks full (producer) or empty (consumer).
+ *
+ * Exactly one thread may call the push functions and exactly one other thread the pop
+ * functions.
+ */
+template<typename T, std::size_t CapacityV>
+class SpscRing
+{
+    static_assert(CapacityV && (CapacityV & (CapacityV - 1)) == 0, "SpscRing capacity must be a power of 2.");
+    static_assert(std::is_trivially_copyable_v<T>, "SpscRing elements are copied between threads.");
+
+public:
+    static constexpr std::size_t CAPACITY = CapacityV;
+
+    [[nodiscard]] bool try_push(const T& value) noexcept
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head_cache == CAPACITY) {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+            if (tail - m_head_cache == CAPACITY)
+                return false;
+        }
+        m_slots[tail % CAPACITY] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Spins (yielding) while the ring is full
+    void push(const T& value) noexcept
+    {
+        while (!try_push(value))
+            std::this_thread::yield();
+    }
+
+    [[nodiscard]] std::optional<T> try_pop() noexcept
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail_cache) {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            if (head == m_tail_cache)
+                return std::nullopt;
+        }
+        const T value = m_slots[head % CAPACITY];
+        m_head.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+    // Pushes up to n values, returns how many fit
+    std::size_t try_push(const T* values, const std::size_t n) noexcept
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (CAPACITY - (tail - m_head_cache) < n)
+            m_head_cache = m_head.load(std::memory_order_acquire);
+        const std::size_t count = std::min(n, CAPACITY - (tail - m_head_cache));
+        const std::size_t first = std::min(count, CAPACITY - tail % CAPACITY);
+        std::copy_n(values, first, m_slots.begin() + tail % CAPACITY);
+        std::copy_n(values + first, count - first, m_slots.begin());
+        m_tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    // Pops up to n values, returns how many were available
+    std::size_t try_pop(T* values, const std::size_t n) noexcept
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (m_tail_cache - head < n)
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+        const std::size_t count = std::min(n, m_tail_cache - head);
+        const std::size_t first = std::min(count, CAPACITY - head % CAPACITY);
+        std::copy_n(m_slots.begin() + head % CAPACITY, first, values);
+        std::copy_n(m_slots.begin(), count - first, values + first);
+        m_head.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // Approximate when called concurrently with the other side
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+private:
+    // producer side
+    alignas(CACHE_LINE) std::atomic<std::size_t> m_tail{0};
+    std::size_t m_head_cache = 0;
+
+    // consumer side
+    alignas(CACHE_LINE) std::atomic<std::size_t> m_head{0};
+    std::size_t m_tail_cache = 0;
+
+    alignas(CACHE_LINE) std::array<T, CAPACITY> m_slots{};
+};
+
+} // namespace utility
+
+#endif // UTILITY_SPSC_RING_HPP
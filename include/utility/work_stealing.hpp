@@ -0,0 +1,168 @@
+#ifndef UTILITY_WORK_STEALING_HPP
+#define UTILITY_WORK_STEALING_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "spsc_ring.hpp" // CACHE_LINE
+
+namespace utility
+{
+
+/** @brief Runs a batch of independent jobs on a fixed number of threads, balanced by stealing.
+ * @details
+ * run(jobs, fn) calls fn(worker, job) exactly once for every job in [0, jobs) and returns
+ * once all of them are done. Each worker starts with a contiguous share of the indices
+ * and takes them from the front, in order. A worker that runs dry steals the back half of
+ * the largest share left, so a few long jobs do not leave the other cores idle. Queue
+ * fewer, longer jobs first (longest processing time first) for the tightest finish.
+ *
+ * A share is just two indices behind a lock on its own cache line: taking a job is one
+ * uncontended lock, a steal locks the victim once, and nothing allocates per job.
+ *
+ * `worker` is stable for the thread, so per-worker state (one emulator instance each) can
+ * be indexed by it; allocate it from inside fn so it is local to the core. With `pin`,
+ * worker i is bound to CPU i modulo the CPUs present (Linux only, ignored elsewhere).
+ *
+ * The first exception thrown by fn is rethrown from run() after every worker stopped;
+ * the jobs after it still run.
+ */
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(const std::size_t workers = std::thread::hardware_concurrency(), const bool pin = false)
+    : m_workers{std::max<std::size_t>(workers, 1)}
+    , m_pin{pin}
+    , m_shares{std::make_unique<Share[]>(m_workers)}
+    {}
+
+    [[nodiscard]] std::size_t workers() const noexcept { return m_workers; }
+
+    // Jobs moved between workers by the last run()
+    [[nodiscard]] std::size_t steals() const noexcept { return m_steals.load(std::memory_order_relaxed); }
+
+    template<typename Fn>
+    void run(const std::size_t jobs, Fn&& fn)
+    {
+        for (std::size_t w = 0; w < m_workers; ++w) {
+            m_shares[w].begin = jobs * w / m_workers;
+            m_shares[w].end = jobs * (w + 1) / m_workers;
+        }
+        m_steals.store(0, std::memory_order_relaxed);
+
+        std::exception_ptr error;
+        std::mutex error_lock;
+        std::vector<std::thread> threads;
+        threads.reserve(m_workers);
+        for (std::size_t w = 0; w < m_workers; ++w) {
+            threads.emplace_back([this, w, &fn, &error, &error_lock] {
+                if (m_pin)
+                    pin(w);
+                for (std::size_t job; next(w, job);) {
+                    try {
+                        fn(w, job);
+                    } catch (...) {
+                        const std::lock_guard lock{error_lock};
+                        if (!error)
+                            error = std::current_exception();
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+private:
+    struct alignas(CACHE_LINE) Share
+    {
+        std::mutex lock;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+    };
+
+    // Next job of worker w, stealing when its share is empty; false when no work is left
+    bool next(const std::size_t w, std::size_t& job)
+    {
+        Share& own = m_shares[w];
+        for (;;) {
+            {
+                const std::lock_guard lock{own.lock};
+                if (own.begin < own.end) {
+                    job = own.begin++;
+                    return true;
+                }
+            }
+            if (!steal(w))
+                return false;
+        }
+    }
+
+    bool steal(const std::size_t w)
+    {
+        // the largest share; it may shrink before it is locked again below
+        std::size_t victim = w, largest = 0;
+        for (std::size_t i = 1; i < m_workers; ++i) {
+            const std::size_t v = (w + i) % m_workers;
+            const std::lock_guard lock{m_shares[v].lock};
+            const std::size_t left = m_shares[v].end - m_shares[v].begin;
+            if (left > largest) {
+                largest = left;
+                victim = v;
+            }
+        }
+        if (victim == w)
+            return false;
+
+        std::size_t begin, end;
+        {
+            Share& share = m_shares[victim];
+            const std::lock_guard lock{share.lock};
+            const std::size_t left = share.end - share.begin;
+            if (left == 0)
+                return true; // drained meanwhile, look again
+            end = share.end;
+            begin = share.end - (left + 1) / 2;
+            share.end = begin;
+        }
+        Share& own = m_shares[w];
+        const std::lock_guard lock{own.lock};
+        own.begin = begin;
+        own.end = end;
+        m_steals.fetch_add(end - begin, std::memory_order_relaxed);
+        return true;
+    }
+
+    static void pin([[maybe_unused]] const std::size_t worker) noexcept
+    {
+#if defined(__linux__)
+        const unsigned cpus = std::max(std::thread::hardware_concurrency(), 1u);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(static_cast<int>(worker % cpus), &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+    }
+
+    const std::size_t m_workers;
+    const bool m_pin;
+    std::unique_ptr<Share[]> m_shares;
+    std::atomic<std::size_t> m_steals{0};
+};
+
+} // namespace utility
+
+#endif // UTILITY_WORK_STEALING_HPP
@@ -0,0 +1,252 @@
+#pragma once
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <LR35902/movie.hpp>
+#include <LR35902/savestate.hpp>
+#include <utility/work_stealing.hpp>
+
+#include "machine.hpp"
+
+namespace batch
+{
+
+/** @brief One line of a job file: `<rom> <frames> [<movie or savestate>...]`
+ * @details
+ * Inputs are told apart by their magic ("GBMV" movie, "GBSS" savestate). A savestate is
+ * loaded before the first frame; a movie then supplies the buttons and its hashes are
+ * verified. `frames` caps the run, 0 means the whole movie (and is an error without one).
+ * A movie that starts from a savestate (Movie::Start::State) needs that state in the job.
+ */
+struct Job
+{
+    std::string rom;
+    std::uint64_t frames = 0;
+    std::string movie;
+    std::string state;
+};
+
+enum class Status : std::uint8_t
+{
+    Ok,
+    Desync,     // a movie hash did not match
+    BadRom,     // missing or unreadable
+    BadMovie,   // unreadable, not a movie or not for this ROM
+    BadState,   // unreadable, not a savestate, or another layout
+    WrongState, // not the state the movie starts from
+    NoFrames,   // no frame budget and no movie
+};
+
+[[nodiscard]] constexpr const char* name(const Status status) noexcept
+{
+    switch (status) {
+    case Status::Ok: return "ok";
+    case Status::Desync: return "desync";
+    case Status::BadRom: return "bad-rom";
+    case Status::BadMovie: return "bad-movie";
+    case Status::BadState: return "bad-state";
+    case Status::WrongState: return "wrong-state";
+    case Status::NoFrames: return "no-frames";
+    }
+    return "?";
+}
+
+struct Result
+{
+    Status status = Status::Ok;
+    std::uint64_t frames = 0;
+    std::uint64_t hash = 0;  // Movie::state_hash of the final state
+    double seconds = 0;      // wall time of the run, loading excluded
+    std::size_t worker = 0;
+
+    [[nodiscard]] double fps() const noexcept { return seconds > 0 ? frames / seconds : 0; }
+};
+
+[[nodiscard]] inline std::optional<std::vector<std::byte>> read_file(const std::string& path)
+{
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+        return std::nullopt;
+    std::vector<char> bytes{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    std::vector<std::byte> out(bytes.size());
+    std::memcpy(out.data(), bytes.data(), bytes.size());
+    return out;
+}
+
+// Parses a job file, `#` starts a comment; the line number of the first bad line in `error`
+[[nodiscard]] inline std::vector<Job> parse(std::istream& in, std::size_t& error)
+{
+    std::vector<Job> jobs;
+    std::string line;
+    error = 0;
+    for (std::size_t number = 1; std::getline(in, line); ++number) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream words{line};
+        Job job;
+        if (!(words >> job.rom))
+            continue;
+        // digits only: `>>` into an unsigned takes "-5" as a huge count
+        std::string frames;
+        words >> frames;
+        const char* const last = frames.data() + frames.size();
+        if (const auto [end, ec] = std::from_chars(frames.data(), last, job.frames); frames.empty() || ec != std::errc{} || end != last) {
+            error = number;
+            return jobs;
+        }
+        for (std::string input; words >> input;) {
+            std::array<char, 4> magic{};
+            std::ifstream{input, std::ios::binary}.read(magic.data(), magic.size());
+            if (magic == LR35902::Movie::Recording::MAGIC && job.movie.empty())
+                job.movie = input;
+            else if (magic == LR35902::StateLayout::MAGIC && job.state.empty())
+                job.state = input;
+            else {
+                error = number;
+                return jobs;
+            }
+        }
+        jobs.push_back(std::move(job));
+    }
+    return jobs;
+}
+
+/** @brief Runs every job on a work stealing pool, one Machine per worker.
+ * @details
+ * ROMs, movies and savestates are read once up front, so workers only emulate. Each
+ * worker builds its Machine on first use, on its own thread, and resets it between jobs,
+ * so the instance stays in the cache (and NUMA node) of the core that runs it.
+ */
+class Runner
+{
+public:
+    explicit Runner(const std::size_t workers, const bool pin = false)
+    : m_pool{workers, pin}
+    {}
+
+    [[nodiscard]] std::size_t workers() const noexcept { return m_pool.workers(); }
+    [[nodiscard]] std::size_t steals() const noexcept { return m_pool.steals(); }
+
+    [[nodiscard]] std::vector<Result> run(const std::vector<Job>& jobs)
+    {
+        std::vector<Result> results(jobs.size());
+        std::vector<Inputs> inputs(jobs.size());
+        Roms roms;
+        for (std::size_t i = 0; i < jobs.size(); ++i)
+            inputs[i] = load(jobs[i], roms, results[i].status);
+
+        std::vector<std::unique_ptr<Machine>> machines(m_pool.workers());
+        m_pool.run(jobs.size(), [&](const std::size_t worker, const std::size_t i) {
+            Result& result = results[i];
+            result.worker = worker;
+            if (result.status != Status::Ok)
+                return;
+            std::unique_ptr<Machine>& machine = machines[worker];
+            if (!machine || machine->rom.data() != inputs[i].rom->data())
+                machine = std::make_unique<Machine>(*inputs[i].rom);
+            else
+                machine->reset();
+            result = play(*machine, jobs[i], inputs[i]);
+            result.worker = worker;
+        });
+        return results;
+    }
+
+private:
+    // Path to contents, nullopt when unreadable
+    using Roms = std::map<std::string, std::optional<std::vector<std::uint8_t>>>;
+
+    struct Inputs
+    {
+        const std::vector<std::uint8_t>* rom = nullptr;
+        std::optional<LR35902::Movie::Recording> movie;
+        std::vector<std::byte> state;
+    };
+
+    static Inputs load(const Job& job, Roms& roms, Status& status)
+    {
+        Inputs inputs;
+        auto [rom, added] = roms.try_emplace(job.rom);
+        if (added) {
+            if (const std::optional<std::vector<std::byte>> bytes = read_file(job.rom)) {
+                rom->second.emplace(bytes->size());
+                std::memcpy(rom->second->data(), bytes->data(), bytes->size());
+            }
+        }
+        if (!rom->second) {
+            status = Status::BadRom;
+            return inputs;
+        }
+        inputs.rom = &*rom->second;
+
+        if (!job.state.empty()) {
+            std::optional<std::vector<std::byte>> state = read_file(job.state);
+            if (!state) {
+                status = Status::BadState;
+                return inputs;
+            }
+            inputs.state = std::move(*state);
+        }
+        if (!job.movie.empty()) {
+            const std::optional<std::vector<std::byte>> bytes = read_file(job.movie);
+            LR35902::Movie::Recording movie;
+            if (!bytes || LR35902::Movie::Recording::decode(*bytes, movie) != LR35902::Movie::Error::None
+                || !movie.for_rom(*inputs.rom)) {
+                status = Status::BadMovie;
+                return inputs;
+            }
+            const bool from_state = movie.header().start == LR35902::Movie::Start::State;
+            if (from_state != !inputs.state.empty()
+                || (from_state && LR35902::Movie::state_hash(inputs.state) != movie.header().state_id)) {
+                status = Status::WrongState;
+                return inputs;
+            }
+            inputs.movie = std::move(movie);
+        }
+        else if (job.frames == 0)
+            status = Status::NoFrames;
+        return inputs;
+    }
+
+    static Result play(Machine& machine, const Job& job, const Inputs& inputs)
+    {
+        Result result;
+        if (!inputs.state.empty() && machine.layout.load_state(inputs.state) != LR35902::StateLayout::Error::None) {
+            result.status = Status::BadState;
+            return result;
+        }
+        std::vector<std::byte> scratch;
+        const auto start = std::chrono::steady_clock::now();
+        if (inputs.movie) {
+            LR35902::Movie::Player player{machine.joypad};
+            const LR35902::Movie::Player::Result played = player.play(*inputs.movie,
+                [&] { machine.run_frame(); }, [&] { return machine.hash(scratch); },
+                true, job.frames ? job.frames : UINT64_MAX);
+            result.frames = played.frames;
+            if (played.desynced)
+                result.status = Status::Desync;
+        }
+        else {
+            for (; result.frames < job.frames; ++result.frames)
+                machine.run_frame();
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.hash = machine.hash(scratch);
+        return result;
+    }
+
+    utility::WorkStealingPool m_pool;
+};
+
+} // namespace batch
@@ -0,0 +1,186 @@
+#pragma once
+#include <cstdint>
+#include <array>
+#include <stdexcept>
+
+/** @brief Machine state the DMG boot program leaves behind when it writes 0xFF50.
+ * @details
+ * The boot program only depends on the cartridge header (0x0100-0x014F), so the whole
+ * ~2.5 second logo animation can be evaluated at compile time and instances can start
+ * at 0x0100 from a constinit snapshot instead of executing `rom` through RomComponent.
+ *
+ * io holds 0xFF00-0xFF7F as observed on DMG hardware at PC=0x0100.
+ */
+struct BootState
+{
+    struct Registers
+    {
+        std::uint8_t A, F, B, C, D, E, H, L;
+        std::uint16_t SP, PC;
+    };
+
+    Registers registers;
+    std::array<std::uint8_t, 0x2000> vram; // 0x8000-0x9FFF
+    std::array<std::uint8_t, 0x0080> io;   // 0xFF00-0xFF7F
+    std::uint8_t IE;
+};
+
+using CartridgeHeader = std::array<std::uint8_t, 0x0050>; // 0x0100-0x014F
+
+namespace impl
+{
+
+constexpr std::array<std::uint8_t, 0x80> make_post_boot_io()
+{
+    std::array<std::uint8_t, 0x80> io{};
+    for (auto& reg : io)
+        reg = 0xFF; // unmapped ports read back as 0xFF
+
+    io[0x00] = 0xCF; // P1
+    io[0x01] = 0x00; // SB
+    io[0x02] = 0x7E; // SC
+    io[0x04] = 0xAB; // DIV
+    io[0x05] = 0x00; // TIMA
+    io[0x06] = 0x00; // TMA
+    io[0x07] = 0xF8; // TAC
+    io[0x0F] = 0xE1; // IF
+    io[0x10] = 0x80; // NR10
+    io[0x11] = 0xBF; // NR11
+    io[0x12] = 0xF3; // NR12
+    io[0x13] = 0xFF; // NR13
+    io[0x14] = 0xBF; // NR14
+    io[0x16] = 0x3F; // NR21
+    io[0x17] = 0x00; // NR22
+    io[0x18] = 0xFF; // NR23
+    io[0x19] = 0xBF; // NR24
+    io[0x1A] = 0x7F; // NR30
+    io[0x1B] = 0xFF; // NR31
+    io[0x1C] = 0x9F; // NR32
+    io[0x1D] = 0xFF; // NR33
+    io[0x1E] = 0xBF; // NR34
+    io[0x20] = 0xFF; // NR41
+    io[0x21] = 0x00; // NR42
+    io[0x22] = 0x00; // NR43
+    io[0x23] = 0xBF; // NR44
+    io[0x24] = 0x77; // NR50
+    io[0x25] = 0xF3; // NR51
+    io[0x26] = 0xF1; // NR52
+    io[0x40] = 0x91; // LCDC
+    io[0x41] = 0x85; // STAT
+    io[0x42] = 0x00; // SCY
+    io[0x43] = 0x00; // SCX
+    io[0x44] = 0x00; // LY
+    io[0x45] = 0x00; // LYC
+    io[0x46] = 0xFF; // DMA
+    io[0x47] = 0xFC; // BGP
+    io[0x4A] = 0x00; // WY
+    io[0x4B] = 0x00; // WX
+    return io;
+}
+
+// The logo the boot program compares the cartridge's against, its own copy at $00A8
+inline constexpr std::array<std::uint8_t, 48> LOGO
+{
+    0xCE, 0xED, 0x66, 0x66, 0xCC, 0x0D, 0x00, 0x0B,
+    0x03, 0x73, 0x00, 0x83, 0x00, 0x0C, 0x00, 0x0D,
+    0x00, 0x08, 0x11, 0x1F, 0x88, 0x89, 0x00, 0x0E,
+    0xDC, 0xCC, 0x6E, 0xE6, 0xDD, 0xDD, 0xD9, 0x99,
+    0xBB, 0xBB, 0x67, 0x63, 0x6E, 0x0E, 0xEC, 0xCC,
+    0xDD, 0xDC, 0x99, 0x9F, 0xBB, 0xB9, 0x33, 0x3E,
+};
+
+// "Double up" the upper nibble of v (0x0095): every bit becomes two adjacent bits
+constexpr std::uint8_t double_nibble(const std::uint8_t v)
+{
+    std::uint8_t a = 0;
+    for (int bit = 7; bit >= 4; --bit) {
+        const std::uint8_t b = (v >> bit) & 1;
+        a = static_cast<std::uint8_t>((a << 2) | (b << 1) | b);
+    }
+    return a;
+}
+
+} // namespace impl
+
+/** @brief Evaluates the effects of the DMG boot program against a cartridge header.
+ * @details
+ * Follows `rom` section by section (see rom.cpp for the addresses). A header that would
+ * lock up the real boot program (logo mismatch or bad header checksum) throws, which is
+ * a compile error when evaluated in a constant expression.
+ */
+constexpr BootState boot(const CartridgeHeader& header)
+{
+    const auto cart = [&header](const std::uint16_t addr) { return header[addr - 0x0100]; };
+
+    BootState state{};
+    state.io = impl::make_post_boot_io();
+
+    // INIT RAM ($0000) - VRAM is zeroed, value-initialization already did that
+    auto& vram = state.vram;
+    auto vram_at = [&vram](const std::uint16_t addr) -> std::uint8_t& { return vram[addr - 0x8000]; };
+
+    // SETUP LOGO ($0021) - every logo nibble becomes a doubled byte written to two rows
+    std::uint16_t HL = 0x8010;
+    for (std::uint16_t DE = 0x0104; DE < 0x0134; ++DE) {
+        const std::uint8_t logo = cart(DE);
+        for (const std::uint8_t nibble : {logo, static_cast<std::uint8_t>(logo << 4)}) {
+            const std::uint8_t A = impl::double_nibble(nibble);
+            vram_at(HL) = A; HL += 2;
+            vram_at(HL) = A; HL += 2;
+        }
+    }
+
+    // ($0034) the tile for ® at $00D8
+    constexpr std::array<std::uint8_t, 8> registered { 0x3C, 0x42, 0xB9, 0xA5, 0xB9, 0xA5, 0x42, 0x3C };
+    for (const std::uint8_t row : registered) {
+        vram_at(HL) = row;
+        HL += 2;
+    }
+
+    // ($0040) background tilemap: tile 0x19 at $9910, tiles 0x18-0x0D and 0x0C-0x01 above it
+    vram_at(0x9910) = 0x19;
+    std::uint8_t A = 0x19;
+    std::uint8_t C = 0x0C;
+    HL = 0x992F;
+    while (--A != 0) {
+        vram_at(HL--) = A;
+        if (--C == 0) {
+            HL = (HL & 0xFF00) | 0x0F;
+            C = 0x0C;
+        }
+    }
+
+    // COMPARE LOGO ($00E0) - lock up if the cartridge logo does not match
+    for (std::size_t i = 0; i < impl::LOGO.size(); ++i)
+        if (cart(static_cast<std::uint16_t>(0x0104 + i)) != impl::LOGO[i])
+            throw std::invalid_argument("boot: cartridge logo mismatch, boot rom locks up");
+
+    // CHECKSUM HEADER ($00F1) - A = 0x19 + sum($0134-$014D) must wrap to 0
+    std::uint8_t F = 0;
+    A = 0x19;
+    for (std::uint16_t addr = 0x0134; addr <= 0x014D; ++addr) {
+        const std::uint8_t value = cart(addr);
+        const bool half = ((A & 0x0F) + (value & 0x0F)) > 0x0F;
+        const bool carry = (A + value) > 0xFF;
+        A = static_cast<std::uint8_t>(A + value);
+        F = static_cast<std::uint8_t>((A == 0) << 7 | half << 5 | carry << 4);
+    }
+    if (A != 0)
+        throw std::invalid_argument("boot: header checksum mismatch, boot rom locks up");
+
+    // TURN OFF ROM ($00FC)
+    state.registers = BootState::Registers{
+        .A = 0x01, .F = F,
+        .B = 0x00, .C = 0x13,
+        .D = 0x00, .E = 0xD8,
+        .H = 0x01, .L = 0x4D,
+        .SP = 0xFFFE,
+        .PC = 0x0100,
+    };
+    state.IE = 0x00;
+    return state;
+}
+
+// Snapshot for a cartridge known at compile time: `post_boot<header>`
+template<CartridgeHeader HeaderV>
+inline constinit const BootState post_boot = boot(HeaderV);
@@ -0,0 +1,94 @@
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fork_server
+{
+
+// The descriptors AFL style fuzzers open before they start the target
+inline constexpr int CONTROL_FD = 198; // fuzzer -> server
+inline constexpr int STATUS_FD = CONTROL_FD + 1; // server -> fuzzer
+
+enum class Role : std::uint8_t
+{
+    Child,      // forked for one run: run it and exit
+    Standalone, // no fuzzer attached: run once in this process
+    Parent,     // the fuzzer hung up, every run is done
+    Failed,     // fork() or waitpid() failed, errno is set
+};
+
+/** @brief Hands out runs of an already booted process as copy-on-write forks.
+ * @details
+ * Boot the emulator to the point every run starts from, then call serve(). Each run is
+ * then one fork(): the child shares every page with the server until it writes to it, so
+ * setting a run up costs the pages the run dirties rather than a boot.
+ *
+ * The protocol is the AFL fork server's, all words 4 byte host order integers: the server
+ * says hello on STATUS_FD once it is ready; per run the fuzzer writes a word to
+ * CONTROL_FD (nonzero when it killed the last child on a timeout), the server forks,
+ * replies with the child's pid and, once it exited, with its waitpid() status.
+ *
+ * serve() returns Role::Child in every child, which runs one job and exits; flush stdio
+ * before serve() so children do not repeat buffered output. When STATUS_FD is not open
+ * there is no fuzzer, serve() returns Role::Standalone at once and this process runs the
+ * job itself, so the same command works by hand.
+ */
+class Server
+{
+public:
+    [[nodiscard]] Role serve()
+    {
+        if (!send(HELLO))
+            return Role::Standalone;
+
+        for (;;) {
+            std::uint32_t killed;
+            if (!receive(killed))
+                return Role::Parent;
+
+            const pid_t child = fork();
+            if (child < 0)
+                return Role::Failed;
+            if (child == 0) {
+                close(CONTROL_FD);
+                close(STATUS_FD);
+                return Role::Child;
+            }
+            ++m_runs;
+
+            int status;
+            if (!send(static_cast<std::uint32_t>(child)))
+                return Role::Parent;
+            while (waitpid(child, &status, 0) < 0)
+                if (errno != EINTR)
+                    return Role::Failed;
+            if (!send(static_cast<std::uint32_t>(status)))
+                return Role::Parent;
+        }
+    }
+
+    // Children forked so far
+    [[nodiscard]] std::uint64_t runs() const noexcept { return m_runs; }
+
+private:
+    static constexpr std::uint32_t HELLO = 0;
+
+    static bool send(const std::uint32_t word) noexcept
+    {
+        return write(STATUS_FD, &word, sizeof(word)) == sizeof(word);
+    }
+
+    static bool receive(std::uint32_t& word) noexcept
+    {
+        return read(CONTROL_FD, &word, sizeof(word)) == sizeof(word);
+    }
+
+    std::uint64_t m_runs = 0;
+};
+
+} // namespace fork_server
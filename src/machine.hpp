@@ -0,0 +1,146 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <LR35902/types.hpp>
+#include <LR35902/state.hpp>
+#include <LR35902/scheduler.hpp>
+#include <LR35902/interrupts.hpp>
+#include <LR35902/timer.hpp>
+#include <LR35902/joypad.hpp>
+#include <LR35902/serial.hpp>
+#include <LR35902/savestate.hpp>
+#include <LR35902/movie.hpp>
+#include <LR35902/MMU/Oam.hpp>
+#include <LR35902/PPU/ppu.hpp>
+#include <LR35902/APU/apu.hpp>
+
+#include "boot.hpp"
+
+/** @brief One headless DMG: every component wired to one scheduler and one state layout.
+ * @details
+ * Built for throughput rather than presentation: the PPU only renders on demand and the
+ * APU is muted, so a frame costs only the events that are due in it. The cartridge is
+ * only referenced, so any number of machines can share one loaded ROM.
+ *
+ * The CPU core (Micro) is not wired in yet. Until it is the clock runs as if the CPU were
+ * halted: run_frame() jumps from deadline to deadline and the hardware runs on its own
+ * (PPU modes, timer, DIV, serial). Interrupts stay pending in IF for the CPU to take.
+ * No cartridge code runs, so EXECUTES_CODE is false and the front ends refuse to run.
+ *
+ * Machines hold references between their components, so they are neither copyable nor
+ * movable; they are a few hundred KB (frame buffers), allocate them on the heap.
+ */
+struct Machine
+{
+    using Vram = LR35902::PPU::PixelProcessor::Vram;
+    using Oam = LR35902::MMU::ObjectAttributeMemory;
+
+    static constexpr std::size_t WRAM_SIZE = 0x2000; // 0xC000-0xDFFF
+    static constexpr std::size_t HRAM_SIZE = 0x007F; // 0xFF80-0xFFFE
+
+    // Whether run_frame() executes the cartridge; set once a CPU core is wired in
+    static constexpr bool EXECUTES_CODE = false;
+
+    explicit Machine(const std::span<const std::uint8_t> rom)
+    : rom{rom}
+    {
+        ppu.render_on_demand(true);
+        apu.mute(true);
+
+        // memories before the components that read them
+        scheduler.describe(layout);
+        system.io.describe(layout);
+        interrupts.describe(layout);
+        vram.describe(layout);
+        oam.describe(layout);
+        layout.regions(wram, hram);
+        timer.describe(layout);
+        joypad.describe(layout);
+        serial.describe(layout);
+        ppu.describe(layout);
+        apu.describe(layout);
+
+        m_power_on = layout.save_state();
+    }
+
+    Machine(const Machine&) = delete; // observers point at this
+
+    // Back to the state right after construction
+    void reset() noexcept { (void)layout.load_state(m_power_on); }
+
+    /** @brief Makes the writes the boot program makes before it unmaps itself (0xFF50).
+     * @details
+     * VRAM (logo and tilemap), sound on, palette, scroll and LCDC, in the program's order:
+     * the APU ignores register writes while NR52 is off. The registers in `state` are left
+     * for the CPU core and go nowhere until one is wired in (see EXECUTES_CODE), the
+     * remaining I/O ports already hold their power-on values.
+     */
+    void boot(const BootState& state)
+    {
+        for (std::size_t i = 0; i < state.vram.size(); ++i)
+            vram.write(static_cast<LR35902::Addr>(0x8000 + i), state.vram[i]);
+        // NR52, NR11, NR12, NR51, NR50, BGP, SCY, LCDC
+        for (const LR35902::Addr addr : {0xFF26, 0xFF11, 0xFF12, 0xFF25, 0xFF24, 0xFF47, 0xFF42, 0xFF40})
+            system.io.write(addr, state.io[addr - 0xFF00]);
+        interrupts.write(0xFFFF, state.IE);
+    }
+
+    // One Movie::FRAME_CYCLES long frame
+    void run_frame()
+    {
+        Halted cpu;
+        scheduler.run_until(scheduler.now() + LR35902::Movie::FRAME_CYCLES, cpu,
+            [this](const LR35902::Event event, const LR35902::Cycle at) { dispatch(event, at); });
+    }
+
+    // Movie::state_hash of a snapshot; `scratch` is reused between calls
+    [[nodiscard]] std::uint64_t hash(std::vector<std::byte>& scratch) const
+    {
+        scratch.resize(layout.size());
+        (void)layout.save_state(scratch);
+        return LR35902::Movie::state_hash(scratch);
+    }
+
+    std::span<const std::uint8_t> rom;
+
+    LR35902::Scheduler scheduler;
+    LR35902::SystemState system;
+    LR35902::Interrupts interrupts{scheduler};
+    LR35902::Timer timer{scheduler, interrupts, system};
+    LR35902::Joypad joypad{interrupts, system};
+    LR35902::Serial serial{scheduler, interrupts, system};
+    Vram vram;
+    Oam oam;
+    LR35902::PPU::FrameBuffers frames{};
+    LR35902::PPU::PixelProcessor ppu{scheduler, interrupts, system, vram, oam, frames};
+    LR35902::APU::AudioProcessor apu{scheduler, system};
+    std::array<LR35902::Data, WRAM_SIZE> wram{};
+    std::array<LR35902::Data, HRAM_SIZE> hram{};
+
+    LR35902::StateLayout layout;
+
+private:
+    // Stand-in for the CPU until Micro is wired in
+    struct Halted
+    {
+        [[nodiscard]] constexpr bool halted() const noexcept { return true; }
+        [[nodiscard]] constexpr LR35902::Cycle step() const noexcept { return 4; }
+    };
+
+    void dispatch(const LR35902::Event event, const LR35902::Cycle at)
+    {
+        switch (event) {
+        case LR35902::Event::PPU: ppu.on_event(at); break;
+        case LR35902::Event::Timer: timer.on_event(at); break;
+        case LR35902::Event::DIV: apu.on_event(at); break;
+        case LR35902::Event::Serial: serial.on_event(at); break;
+        default: break; // Interrupt and DMA belong to the CPU
+        }
+    }
+
+    std::vector<std::byte> m_power_on;
+};
@@ -1,6 +1,204 @@
-#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
 
-int main()
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "batch.hpp"
+#include "boot.hpp"
+#include "fork_server.hpp"
+
+namespace
+{
+
+int usage()
+{
+    std::fputs(
+        "usage: GB batch <jobs> [--threads N] [--pin]\n"
+        "  <jobs>  one job per line: <rom> <frames> [<movie.gbmv>] [<state.gbss>]\n"
+        "          frames 0 plays the whole movie, '#' starts a comment\n"
+        "  --threads N  workers (default: every hardware thread)\n"
+        "  --pin        bind worker i to CPU i\n"
+        "prints job,rom,frames,hash,fps,wall_ms,worker,status per job (CSV) on stdout\n"
+        "not available until a CPU core is wired into Machine\n"
+        "\n"
+        "usage: GB fork-server <rom> [<state.gbss>] [--input <file>]\n"
+        "  starts from <state> or right after the boot program, then forks one run per\n"
+        "  request of an AFL style fuzzer (fds 198/199), or runs once without one\n"
+        "  --input <file>  the run's input (default: stdin), one byte of buttons per frame\n"
+        "prints the state hash of every run on stdout\n"
+        "not available until a CPU core is wired into Machine\n",
+        stderr);
+    return EXIT_FAILURE;
+}
+
+int batch_mode(const int argc, char** argv)
+{
+    const char* path = nullptr;
+    std::size_t threads = std::thread::hardware_concurrency();
+    bool pin = false;
+    for (int i = 2; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc)
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--pin")
+            pin = true;
+        else if (!path && !arg.starts_with("--"))
+            path = argv[i];
+        else
+            return usage();
+    }
+    if (!path)
+        return usage();
+    if constexpr (!Machine::EXECUTES_CODE) {
+        std::fputs("GB batch: not available yet, Machine has no CPU core: no cartridge code would run\n"
+            "and every hash would only reflect the hardware running on its own\n", stderr);
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream file{path};
+    if (!file) {
+        std::fprintf(stderr, "%s: cannot open\n", path);
+        return EXIT_FAILURE;
+    }
+    std::size_t error;
+    const std::vector<batch::Job> jobs = batch::parse(file, error);
+    if (error) {
+        std::fprintf(stderr, "%s:%zu: expected <rom> <frames> [<movie>] [<state>]\n", path, error);
+        return EXIT_FAILURE;
+    }
+
+    batch::Runner runner{threads, pin};
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<batch::Result> results = runner.run(jobs);
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::uint64_t frames = 0;
+    std::size_t failed = 0;
+    std::puts("job,rom,frames,hash,fps,wall_ms,worker,status");
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+        const batch::Result& result = results[i];
+        std::printf("%zu,%s,%llu,%016llx,%.0f,%.3f,%zu,%s\n", i, jobs[i].rom.c_str(),
+            static_cast<unsigned long long>(result.frames), static_cast<unsigned long long>(result.hash),
+            result.fps(), result.seconds * 1e3, result.worker, batch::name(result.status));
+        frames += result.frames;
+        failed += result.status != batch::Status::Ok;
+    }
+    std::fprintf(stderr, "%zu jobs (%zu failed) on %zu workers: %llu frames in %.3f s, %.0f fps, %zu jobs stolen\n",
+        jobs.size(), failed, runner.workers(), static_cast<unsigned long long>(frames), wall,
+        wall > 0 ? frames / wall : 0.0, runner.steals());
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// Reads the rest of `fd`
+std::vector<std::uint8_t> read_all(const int fd)
+{
+    std::vector<std::uint8_t> bytes;
+    for (std::size_t size = 0;;) {
+        bytes.resize(size + 4096);
+        const ssize_t got = read(fd, bytes.data() + size, bytes.size() - size);
+        if (got <= 0) {
+            bytes.resize(size);
+            return bytes;
+        }
+        size += static_cast<std::size_t>(got);
+    }
+}
+
+int fork_server_mode(const int argc, char** argv)
+{
+    const char* rom_path = nullptr;
+    const char* state_path = nullptr;
+    const char* input_path = nullptr;
+    for (int i = 2; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--input" && i + 1 < argc)
+            input_path = argv[++i];
+        else if (!rom_path && !arg.starts_with("--"))
+            rom_path = argv[i];
+        else if (!state_path && !arg.starts_with("--"))
+            state_path = argv[i];
+        else
+            return usage();
+    }
+    if (!rom_path)
+        return usage();
+    if constexpr (!Machine::EXECUTES_CODE) {
+        std::fputs("GB fork-server: not available yet, Machine has no CPU core: runs would never execute\n"
+            "the cartridge, so no input could change their outcome\n", stderr);
+        return EXIT_FAILURE;
+    }
+
+    const std::optional<std::vector<std::byte>> bytes = batch::read_file(rom_path);
+    if (!bytes || bytes->size() < 0x0150) {
+        std::fprintf(stderr, "%s: cannot read a cartridge header\n", rom_path);
+        return EXIT_FAILURE;
+    }
+    std::vector<std::uint8_t> rom(bytes->size());
+    std::memcpy(rom.data(), bytes->data(), bytes->size());
+
+    // Everything up to here is paid once, not per run
+    const std::unique_ptr<Machine> machine = std::make_unique<Machine>(rom);
+    if (state_path) {
+        const std::optional<std::vector<std::byte>> state = batch::read_file(state_path);
+        if (!state || machine->layout.load_state(*state) != LR35902::StateLayout::Error::None) {
+            std::fprintf(stderr, "%s: not a savestate of this build\n", state_path);
+            return EXIT_FAILURE;
+        }
+    }
+    else {
+        CartridgeHeader header;
+        std::memcpy(header.data(), rom.data() + 0x0100, header.size());
+        try {
+            machine->boot(boot(header));
+        } catch (const std::invalid_argument& error) {
+            std::fprintf(stderr, "%s: %s\n", rom_path, error.what());
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::fflush(nullptr);
+    fork_server::Server server;
+    const fork_server::Role role = server.serve();
+    if (role == fork_server::Role::Parent) {
+        std::fprintf(stderr, "%llu runs\n", static_cast<unsigned long long>(server.runs()));
+        return EXIT_SUCCESS;
+    }
+    if (role == fork_server::Role::Failed) {
+        std::perror("fork-server");
+        return EXIT_FAILURE;
+    }
+
+    int fd = STDIN_FILENO;
+    if (input_path && (fd = open(input_path, O_RDONLY)) < 0) {
+        std::perror(input_path);
+        std::_Exit(EXIT_FAILURE);
+    }
+    for (const std::uint8_t buttons : read_all(fd)) {
+        machine->joypad.buttons(buttons);
+        machine->run_frame();
+    }
+    std::vector<std::byte> scratch;
+    std::printf("%016llx\n", static_cast<unsigned long long>(machine->hash(scratch)));
+    std::fflush(stdout);
+    // a child leaves the server's copy of the machine to the kernel
+    std::_Exit(EXIT_SUCCESS);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
 {
-    
-}
\ No newline at end of file
+    if (argc >= 2 && std::string_view{argv[1]} == "batch")
+        return batch_mode(argc, argv);
+    if (argc >= 2 && std::string_view{argv[1]} == "fork-server")
+        return fork_server_mode(argc, argv);
+    return usage();
+}
@@ -0,0 +1,371 @@
+// APU: NR52 power off, length and envelope timing, read_channels() routing, and the
+// channels jumping from one level change to the next against stepping one by one.
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <APU/apu.hpp>
+
+#include "run.hpp"
+
+namespace
+{
+
+using namespace LR35902;
+using namespace LR35902::APU;
+
+struct System
+{
+    Scheduler scheduler;
+    SystemState state{};
+    AudioProcessor apu;
+
+    explicit System(const Output output = Output::Stereo)
+    : apu{scheduler, state, CHANNEL_RATE, output}
+    {}
+
+    void run_to(const Cycle end)
+    {
+        run_until(scheduler, end, [this](const Event event, const Cycle at) {
+            if (event == Event::DIV)
+                apu.on_event(at);
+        });
+    }
+
+    [[nodiscard]] bool playing(const unsigned channel) { return state.io.read(0xFF26) >> channel & 1; }
+};
+
+// Changes of level() over `steps` steps of a channel stepped one by one
+template<typename ChannelT>
+std::vector<std::pair<Cycle, Data>> stepped(ChannelT channel, const Cycle steps)
+{
+    std::vector<std::pair<Cycle, Data>> changes;
+    for (Cycle i = 1; i <= steps; ++i) {
+        const Data before = channel.level();
+        channel.step();
+        if (channel.level() != before)
+            changes.emplace_back(i, channel.level());
+    }
+    return changes;
+}
+
+// The same, jumping with holds() and skip()
+template<typename ChannelT>
+std::vector<std::pair<Cycle, Data>> jumped(ChannelT channel, const Cycle steps)
+{
+    std::vector<std::pair<Cycle, Data>> changes;
+    for (Cycle i = 0; i < steps;) {
+        const Cycle next = std::min(steps - i, channel.holds() + 1);
+        const Data before = channel.level();
+        channel.skip(next);
+        i += next;
+        if (channel.level() != before)
+            changes.emplace_back(i, channel.level());
+    }
+    return changes;
+}
+
+} // namespace
+
+TEST(Channels, SquareJumpsToTheNextEdge)
+{
+    for (Data duty = 0; duty < 4; ++duty) {
+        for (Data position = 0; position < 8; ++position) {
+            Square square{.on = true, .dac = true, .duty = duty, .position = position};
+            square.envelope.volume = 9;
+            ASSERT_EQ(jumped(square, 100), stepped(square, 100)) << "duty " << int(duty) << " position " << int(position);
+        }
+    }
+}
+
+TEST(Channels, WaveJumpsOverEqualSamples)
+{
+    std::mt19937 random{13};
+    for (int trial = 0; trial < 200; ++trial) {
+        Wave wave{.on = true, .dac = true};
+        wave.volume = static_cast<Data>(1 + random() % 3);
+        wave.position = static_cast<Data>(random() % 32);
+        // few distinct samples so runs of equal ones are common, and sometimes a flat wave
+        const unsigned values = trial % 10 == 0 ? 1 : 2 + random() % 3;
+        for (Data& byte : wave.ram)
+            byte = static_cast<Data>((random() % values) * 0x11);
+        ASSERT_EQ(jumped(wave, 500), stepped(wave, 500)) << "trial " << trial;
+    }
+}
+
+// Skipping n steps of a silent noise channel lands on the same LFSR state as n steps
+TEST(Channels, NoiseSkipAdvancesTheLfsr)
+{
+    std::mt19937 random{14};
+    for (const Data nr43 : {Data{0x00}, Data{0x08}, Data{0x35}, Data{0x7C}, Data{0xE0}}) {
+        for (int trial = 0; trial < 20; ++trial) {
+            Noise noise{.nr43 = nr43};
+            noise.lfsr = static_cast<std::uint16_t>(random() & 0x7FFF);
+            const Cycle steps = trial < 10 ? random() % 200 : 30000 + random() % 100000;
+            Noise stepped = noise;
+            for (Cycle i = 0; i < steps; ++i)
+                stepped.step();
+            noise.skip(steps);
+            ASSERT_EQ(noise.lfsr, stepped.lfsr) << "nr43 " << int(nr43) << ", " << steps << " steps";
+        }
+    }
+}
+
+TEST(Channels, EnvelopeSkipMatchesClocks)
+{
+    for (Data nrx2 = 0; nrx2 < 0xFF; ++nrx2) {
+        for (std::uint64_t ticks = 0; ticks < 140; ticks += 3) {
+            Envelope clocked, skipped;
+            clocked.reload(nrx2);
+            skipped.reload(nrx2);
+            for (std::uint64_t i = 0; i < ticks; ++i)
+                clocked.clock();
+            skipped.skip(ticks);
+            ASSERT_EQ(skipped.volume, clocked.volume) << "NRx2 " << int(nrx2) << ", " << ticks << " ticks";
+            ASSERT_EQ(skipped.timer, clocked.timer) << "NRx2 " << int(nrx2) << ", " << ticks << " ticks";
+        }
+    }
+}
+
+// Powering off clears every sound register but wave RAM and ignores writes until powered on
+TEST(AudioProcessor, PowerOffClearsTheRegisters)
+{
+    System system;
+    IO::RegisterBank& io = system.state.io;
+    io.write(0xFF26, 0x80);
+    io.write(0xFF30, 0x5A);
+    for (Addr addr = 0xFF10; addr <= 0xFF25; ++addr)
+        io.write(addr, 0xFF);
+    EXPECT_NE(io.read(0xFF26) & 0x0F, 0); // triggered channels play
+
+    io.write(0xFF26, 0x00);
+    EXPECT_EQ(io.read(0xFF26), 0x70);
+    // only the bits that always read back as 1
+    const std::array<Data, 0x16> cleared{
+        0x80, 0x3F, 0x00, 0xFF, 0xBF, 0xFF, 0x3F, 0x00, 0xFF, 0xBF,
+        0x7F, 0xFF, 0x9F, 0xFF, 0xBF, 0xFF, 0xFF, 0x00, 0x00, 0xBF, 0x00, 0x00};
+    for (Addr addr = 0xFF10; addr <= 0xFF25; ++addr)
+        EXPECT_EQ(io.read(addr), cleared[addr - 0xFF10]) << std::hex << addr;
+    EXPECT_EQ(io.read(0xFF30), 0x5A);
+
+    io.write(0xFF12, 0xF0);
+    io.write(0xFF24, 0x77);
+    EXPECT_EQ(io.read(0xFF12), 0x00);
+    EXPECT_EQ(io.read(0xFF24), 0x00);
+    io.write(0xFF26, 0x80);
+    io.write(0xFF24, 0x77);
+    EXPECT_EQ(io.read(0xFF24), 0x77);
+    EXPECT_EQ(io.read(0xFF26), 0xF0);
+}
+
+// Powered on at cycle 0 the sequencer ticks at 8192 * k, lengths on odd k. A full length
+// of 64 runs out on the 64th length tick, tick 127.
+TEST(AudioProcessor, LengthTiming)
+{
+    for (const bool muted : {false, true}) {
+        System system;
+        system.apu.mute(muted);
+        IO::RegisterBank& io = system.state.io;
+        io.write(0xFF26, 0x80);
+        io.write(0xFF17, 0xF0);
+        io.write(0xFF16, 0x00); // length 64
+        io.write(0xFF19, 0xC0); // trigger, length enabled
+
+        system.run_to(127 * SEQUENCER_PERIOD - 1);
+        EXPECT_TRUE(system.playing(1)) << "muted " << muted;
+        system.run_to(127 * SEQUENCER_PERIOD);
+        EXPECT_FALSE(system.playing(1)) << "muted " << muted;
+
+        // length 60 from tick 200: ticks 201, 203, ... the 4th runs it out
+        system.run_to(200 * SEQUENCER_PERIOD);
+        io.write(0xFF16, 60);
+        io.write(0xFF19, 0xC0);
+        system.run_to(207 * SEQUENCER_PERIOD - 1);
+        EXPECT_TRUE(system.playing(1)) << "muted " << muted;
+        system.run_to(207 * SEQUENCER_PERIOD);
+        EXPECT_FALSE(system.playing(1)) << "muted " << muted;
+    }
+}
+
+// NR22 = 0xF1: volume 15 falling one step on every envelope tick (step 7, tick 8k). The
+// peak to peak swing of CH2 in each envelope period drops by the same amount down to silence.
+TEST(AudioProcessor, EnvelopeTiming)
+{
+    System system{Output::Channels};
+    IO::RegisterBank& io = system.state.io;
+    io.write(0xFF26, 0x80);
+    io.write(0xFF24, 0x77);
+    io.write(0xFF25, 0x22);
+    io.write(0xFF17, 0xF1);
+    io.write(0xFF16, 0x80);
+    io.write(0xFF18, 0x00);
+    io.write(0xFF19, 0x87); // 512 Hz
+
+    constexpr Cycle ENVELOPE = 8 * SEQUENCER_PERIOD;
+    std::vector<std::int16_t> planar(8 * 8192);
+    std::array<int, 17> swing{};
+    for (std::size_t period = 0; period < swing.size(); ++period) {
+        // the middle of the period, away from the volume changes
+        system.run_to(period * ENVELOPE + ENVELOPE / 4);
+        system.apu.end_frame();
+        (void)system.apu.read_channels(planar, 8192);
+        system.run_to(period * ENVELOPE + 3 * ENVELOPE / 4);
+        system.apu.end_frame();
+        const std::size_t n = system.apu.read_channels(planar, 8192);
+        ASSERT_GT(n, 400u);
+        const auto [low, high] = std::minmax_element(planar.begin() + 2 * n, planar.begin() + 3 * n);
+        swing[period] = *high - *low;
+    }
+    EXPECT_TRUE(system.playing(1)); // the envelope alone never switches a channel off
+    // one volume step less each period; the first still settles from the trigger
+    EXPECT_GT(swing[0], swing[1]);
+    const double step = (swing[1] - swing[14]) / 13.0;
+    ASSERT_GT(step, 100);
+    for (std::size_t period = 1; period < 14; ++period)
+        EXPECT_NEAR(swing[period] - swing[period + 1], step, 0.1 * step) << "period " << period;
+    EXPECT_GT(swing[14], 0);
+    // silent from then on, only the DC blocker settling
+    EXPECT_LT(swing[15], 0.25 * step);
+    EXPECT_LT(swing[16], 0.05 * step);
+}
+
+// Each channel panned on its own: read_channels() blocks carry exactly the routed streams
+TEST(AudioProcessor, ReadChannelsRouting)
+{
+    System system{Output::Channels};
+    IO::RegisterBank& io = system.state.io;
+    io.write(0xFF26, 0x80);
+    io.write(0xFF24, 0x77);
+    io.write(0xFF25, 0b1000'0011); // CH4 left, CH2 right, CH1 right, CH3 nowhere
+    io.write(0xFF12, 0xF0);
+    io.write(0xFF14, 0x86);
+    io.write(0xFF17, 0xF0);
+    io.write(0xFF19, 0x85);
+    for (Addr addr = 0xFF30; addr < 0xFF40; ++addr)
+        io.write(addr, 0x0F);
+    io.write(0xFF1A, 0x80);
+    io.write(0xFF1C, 0x20);
+    io.write(0xFF1E, 0x84);
+    io.write(0xFF21, 0xF0);
+    io.write(0xFF22, 0x21);
+    io.write(0xFF23, 0x80);
+
+    // CH1 L, CH1 R, CH2 L, CH2 R, CH3 L, CH3 R, CH4 L, CH4 R
+    constexpr std::array<bool, 8> ROUTED{false, true, false, true, false, false, true, false};
+    std::vector<std::int16_t> planar(8 * 2000);
+    std::array<int, 8> peaks{};
+    std::size_t total = 0;
+    for (int frame = 1; frame <= 30; ++frame) {
+        system.run_to(static_cast<Cycle>(frame) * 70224);
+        system.apu.end_frame();
+        const std::size_t n = system.apu.read_channels(planar, 2000);
+        total += n;
+        for (std::size_t stream = 0; stream < 8; ++stream)
+            for (std::size_t i = 0; i < n; ++i)
+                peaks[stream] = std::max(peaks[stream], std::abs(int{planar[stream * n + i]}));
+    }
+    for (std::size_t stream = 0; stream < 8; ++stream) {
+        if (ROUTED[stream])
+            EXPECT_GT(peaks[stream], 1000) << "stream " << stream;
+        else
+            EXPECT_EQ(peaks[stream], 0) << "stream " << stream;
+    }
+    // 30 video frames at CHANNEL_RATE, less what the band limiting holds back
+    EXPECT_NEAR(static_cast<double>(total), 30.0 * 70224 * CHANNEL_RATE / CLOCK_RATE, 64);
+}
+
+// Wave RAM written while CH3 plays a flat wave: the new samples are heard from the next step
+// (at 11 periods) on, not only once a later sequencer tick (at 12) hands the level on
+TEST(AudioProcessor, WaveRamWriteIsHeardAtTheNextStep)
+{
+    System system;
+    IO::RegisterBank& io = system.state.io;
+    io.write(0xFF26, 0x80);
+    io.write(0xFF24, 0x77);
+    io.write(0xFF25, 0x44);
+    for (Addr addr = 0xFF30; addr < 0xFF40; ++addr)
+        io.write(addr, 0x00);
+    io.write(0xFF1A, 0x80);
+    io.write(0xFF1C, 0x20);
+    io.write(0xFF1D, 0x00);
+    io.write(0xFF1E, 0x80); // period 4096 cycles
+
+    constexpr Cycle PERIOD = 4096;
+    std::vector<std::int16_t> stereo(2 * 8192);
+    system.run_to(10 * PERIOD);
+    system.apu.end_frame();
+    (void)system.apu.read(stereo);
+
+    for (Addr addr = 0xFF30; addr < 0xFF40; ++addr)
+        io.write(addr, 0xFF);
+    system.run_to(11 * PERIOD + PERIOD / 2);
+    system.apu.end_frame();
+    const std::size_t n = system.apu.read(stereo);
+    int peak = 0;
+    for (std::size_t i = 0; i < 2 * n; ++i)
+        peak = std::max(peak, std::abs(int{stereo[i]}));
+    EXPECT_GT(peak, 15 * AudioProcessor::SCALE * 4);
+}
+
+// Muting must not change anything the CPU can read: NR52 (channels switched off by lengths
+// and sweep overflow), every sound register and wave RAM, under random writes that include
+// triggers, length loads, sweeps, power cycles and DIV resets. A third APU toggles mute.
+TEST(AudioProcessor, MutedReadsMatch)
+{
+    std::mt19937 random{15};
+    System audible, muted, toggled;
+    muted.apu.mute(true);
+    const std::array<System*, 3> systems{&audible, &muted, &toggled};
+    for (System* system : systems)
+        system->state.io.write(0xFF26, 0x80);
+
+    const auto same = [&](const int step) {
+        for (Addr read = 0xFF10; read < 0xFF40; ++read) {
+            ASSERT_EQ(muted.state.io.read(read), audible.state.io.read(read))
+                << "step " << step << " " << std::hex << read;
+            ASSERT_EQ(toggled.state.io.read(read), audible.state.io.read(read))
+                << "step " << step << " " << std::hex << read;
+        }
+    };
+
+    std::size_t switched_off = 0; // by the sequencer, between writes
+    for (int step = 0; step < 20000; ++step) {
+        const Data playing = audible.state.io.read(0xFF26);
+        const Cycle end = audible.scheduler.now() + random() % 20000;
+        for (System* system : systems)
+            system->run_to(end);
+        switched_off += static_cast<std::size_t>(std::popcount(static_cast<unsigned>(playing & ~audible.state.io.read(0xFF26) & 0x0F)));
+        same(step);
+        if (::testing::Test::HasFatalFailure())
+            return;
+
+        Addr addr;
+        Data data = static_cast<Data>(random());
+        switch (random() % 16) {
+        case 0:  addr = 0xFF26; data = random() % 8 ? 0x80 : 0x00; break;
+        case 1:  addr = 0xFF04; break;
+        case 2:  addr = static_cast<Addr>(0xFF30 + random() % 16); break;
+        // triggers with the length enabled, so lengths run out often
+        case 3:  addr = 0xFF14; data |= 0xC0; break;
+        case 4:  addr = 0xFF19; data |= 0xC0; break;
+        case 5:  addr = 0xFF1E; data |= 0xC0; break;
+        case 6:  addr = 0xFF23; data |= 0xC0; break;
+        default: addr = static_cast<Addr>(0xFF10 + random() % 0x16); break;
+        }
+        if (random() % 64 == 0)
+            toggled.apu.mute(!toggled.apu.muted());
+        for (System* system : systems)
+            system->state.io.write(addr, data);
+        same(step);
+        if (::testing::Test::HasFatalFailure())
+            return;
+    }
+    EXPECT_GT(switched_off, 100u);
+}
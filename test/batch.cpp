@@ -0,0 +1,221 @@
+// batch::parse and batch::Runner: which job lines are accepted, and the status of every
+// job, from plain frame counts and movies to missing and mismatched inputs.
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <batch.hpp>
+
+namespace
+{
+
+using namespace LR35902;
+
+constexpr std::uint64_t FRAMES = 40;
+constexpr std::uint32_t HASH_INTERVAL = 10;
+
+std::vector<std::uint8_t> make_rom(const std::uint16_t checksum)
+{
+    std::vector<std::uint8_t> rom(0x8000);
+    rom[Movie::GLOBAL_CHECKSUM] = static_cast<std::uint8_t>(checksum >> 8);
+    rom[Movie::GLOBAL_CHECKSUM + 1] = static_cast<std::uint8_t>(checksum);
+    return rom;
+}
+
+// Records `frames` frames of changing buttons on `machine`, from its current state
+Movie::Recording record(Machine& machine, const Movie::Start start, const std::uint64_t state_id, const std::uint64_t frames)
+{
+    Movie::Recording movie{Movie::Header{Movie::global_checksum(machine.rom), start, state_id, HASH_INTERVAL}};
+    Movie::Player player{machine.joypad};
+    std::vector<std::byte> scratch;
+    for (std::uint64_t frame = 0; frame < frames; ++frame)
+        player.record(movie, static_cast<Data>(frame / 7 % 3), [&] { machine.run_frame(); },
+            [&] { return machine.hash(scratch); });
+    return movie;
+}
+
+std::uint64_t hash(Machine& machine)
+{
+    std::vector<std::byte> scratch;
+    return machine.hash(scratch);
+}
+
+// ROMs, movies and savestates in a directory of their own
+class BatchTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        m_dir = std::filesystem::temp_directory_path() / ("batch_test_" + std::to_string(getpid()));
+        std::filesystem::create_directories(m_dir);
+
+        const std::vector<std::uint8_t> other = make_rom(0xBEEF);
+        write("game.gb", std::as_bytes(std::span{rom}));
+        write("other.gb", std::as_bytes(std::span{other}));
+
+        auto machine = std::make_unique<Machine>(rom);
+        power_on = record(*machine, Movie::Start::PowerOn, 0, FRAMES);
+        write("power_on.gbm", power_on.encode());
+        end_hash = hash(*machine);
+
+        // from a state: the state after the power on movie, then another movie from it
+        state = machine->layout.save_state();
+        write("state.gss", state);
+        from_state = record(*machine, Movie::Start::State, Movie::state_hash(state), FRAMES);
+        write("from_state.gbm", from_state.encode());
+        from_state_hash = hash(*machine);
+
+        machine->run_frame();
+        write("other.gss", machine->layout.save_state());
+
+        // the same buttons with the timer running: the power on movie's hashes don't match
+        machine->reset();
+        machine->system.io.write(0xFF07, 0x05);
+        write("desync.gbm", record(*machine, Movie::Start::PowerOn, 0, FRAMES).encode());
+    }
+
+    void TearDown() override { std::filesystem::remove_all(m_dir); }
+
+    std::string path(const std::string& name) const { return (m_dir / name).string(); }
+
+    void write(const std::string& name, const std::span<const std::byte> bytes) const
+    {
+        std::ofstream{path(name), std::ios::binary}.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    std::vector<batch::Job> parse(const std::string& text, std::size_t& error) const
+    {
+        std::istringstream in{text};
+        return batch::parse(in, error);
+    }
+
+    const std::vector<std::uint8_t> rom = make_rom(0x1234);
+    Movie::Recording power_on, from_state;
+    std::vector<std::byte> state;
+    std::uint64_t end_hash = 0, from_state_hash = 0;
+
+private:
+    std::filesystem::path m_dir;
+};
+
+} // namespace
+
+TEST_F(BatchTest, ParseAcceptsJobs)
+{
+    std::size_t error = 1;
+    const std::vector<batch::Job> jobs = parse(
+        "# rom frames inputs\n"
+        "\n"
+        + path("game.gb") + " 100\n"
+        "   " + path("game.gb") + " 0 " + path("power_on.gbm") + "   # the whole movie\n"
+        + path("game.gb") + " 5 " + path("from_state.gbm") + " " + path("state.gss") + "\n"
+        + path("other.gb") + "\t7\t" + path("state.gss") + "\n", error);
+    EXPECT_EQ(error, 0u);
+    ASSERT_EQ(jobs.size(), 4u);
+    EXPECT_EQ(jobs[0].rom, path("game.gb"));
+    EXPECT_EQ(jobs[0].frames, 100u);
+    EXPECT_TRUE(jobs[0].movie.empty() && jobs[0].state.empty());
+    EXPECT_EQ(jobs[1].frames, 0u);
+    EXPECT_EQ(jobs[1].movie, path("power_on.gbm"));
+    // told apart by their magic, in any order
+    EXPECT_EQ(jobs[2].movie, path("from_state.gbm"));
+    EXPECT_EQ(jobs[2].state, path("state.gss"));
+    EXPECT_EQ(jobs[3].rom, path("other.gb"));
+    EXPECT_EQ(jobs[3].frames, 7u);
+    EXPECT_TRUE(jobs[3].movie.empty());
+    EXPECT_EQ(jobs[3].state, path("state.gss"));
+}
+
+// The jobs before a bad line are kept and the line number reported
+TEST_F(BatchTest, ParseRejectsBadLines)
+{
+    const std::string good = path("game.gb") + " 10\n";
+    const std::string rom = path("game.gb");
+    for (const std::string& bad : {
+             rom,                                   // no frame count
+             rom + " ten",
+             rom + " -5",                           // not wrapped around
+             rom + " 10frames",
+             rom + " 10 " + path("missing.gbm"),    // unreadable input
+             rom + " 10 " + path("other.gb"),       // neither movie nor savestate
+             rom + " 10 " + path("power_on.gbm") + " " + path("from_state.gbm"), // two movies
+             rom + " 10 " + path("state.gss") + " " + path("other.gss"),          // two states
+         }) {
+        std::size_t error = 0;
+        const std::vector<batch::Job> jobs = parse(good + "# comment\n" + bad + "\n" + good, error);
+        EXPECT_EQ(error, 3u) << bad;
+        EXPECT_EQ(jobs.size(), 1u) << bad;
+    }
+}
+
+TEST_F(BatchTest, RunnerStatuses)
+{
+    std::vector<std::byte> garbage = state;
+    garbage[offsetof(StateLayout::Header, layout)] ^= std::byte{0xFF}; // another layout
+    write("garbage.gss", garbage);
+    const std::vector<std::byte> movie = power_on.encode();
+    write("corrupt.gbm", std::span{movie}.first(12)); // cut inside the header
+
+    const std::string game = path("game.gb");
+    const std::vector<batch::Job> jobs{
+        {game, 3, "", ""},
+        {game, 0, path("power_on.gbm"), ""},
+        {game, 0, path("from_state.gbm"), path("state.gss")},
+        {game, 15, path("power_on.gbm"), ""},                    // stops early
+        {game, 0, path("desync.gbm"), ""},
+        {path("missing.gb"), 3, "", ""},
+        {game, 0, path("missing.gbm"), ""},
+        {game, 0, path("corrupt.gbm"), ""},
+        {path("other.gb"), 0, path("power_on.gbm"), ""},         // for another ROM
+        {game, 3, "", path("missing.gss")},
+        {game, 3, "", path("garbage.gss")},
+        {game, 0, path("from_state.gbm"), ""},                   // needs its state
+        {game, 0, path("from_state.gbm"), path("other.gss")},    // another state
+        {game, 0, path("power_on.gbm"), path("state.gss")},      // starts at power on
+        {game, 0, "", ""},
+        {game, 3, "", ""},                                       // a reused machine
+    };
+    batch::Runner runner{3};
+    const std::vector<batch::Result> results = runner.run(jobs);
+    ASSERT_EQ(results.size(), jobs.size());
+
+    const batch::Status expected[] = {
+        batch::Status::Ok, batch::Status::Ok, batch::Status::Ok, batch::Status::Ok,
+        batch::Status::Desync,
+        batch::Status::BadRom,
+        batch::Status::BadMovie, batch::Status::BadMovie, batch::Status::BadMovie,
+        batch::Status::BadState, batch::Status::BadState,
+        batch::Status::WrongState, batch::Status::WrongState, batch::Status::WrongState,
+        batch::Status::NoFrames,
+        batch::Status::Ok,
+    };
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+        EXPECT_EQ(batch::name(results[i].status), batch::name(expected[i])) << "job " << i;
+        EXPECT_LT(results[i].worker, runner.workers()) << "job " << i;
+    }
+
+    auto machine = std::make_unique<Machine>(rom);
+    for (int frame = 0; frame < 3; ++frame)
+        machine->run_frame();
+    EXPECT_EQ(results[0].frames, 3u);
+    EXPECT_EQ(results[0].hash, hash(*machine));
+    EXPECT_EQ(results[15].hash, results[0].hash);
+
+    EXPECT_EQ(results[1].frames, FRAMES);
+    EXPECT_EQ(results[1].hash, end_hash);
+    EXPECT_EQ(results[2].frames, FRAMES);
+    EXPECT_EQ(results[2].hash, from_state_hash);
+    EXPECT_EQ(results[3].frames, 15u);
+    EXPECT_LT(results[4].frames, FRAMES);
+}
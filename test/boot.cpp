@@ -0,0 +1,98 @@
+// boot(): the DMG boot program evaluated against known cartridge headers, at compile time
+// where it can be, and rejecting headers the real boot program locks up on.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include <boot.hpp>
+
+namespace
+{
+
+// The logo, an empty title and the header checksum byte (0x014D) that makes it pass
+constexpr CartridgeHeader make_header(const std::uint8_t title = 0x00)
+{
+    CartridgeHeader header{};
+    std::copy(impl::LOGO.begin(), impl::LOGO.end(), header.begin() + 0x04);
+    header[0x34] = title; // 0x0134
+    std::uint8_t sum = 0x19;
+    for (std::size_t i = 0x34; i < 0x4D; ++i)
+        sum = static_cast<std::uint8_t>(sum + header[i]);
+    header[0x4D] = static_cast<std::uint8_t>(-sum);
+    return header;
+}
+
+constexpr CartridgeHeader HEADER = make_header();
+constexpr BootState STATE = boot(HEADER);
+
+constexpr std::uint8_t vram(const BootState& state, const std::uint16_t addr)
+{
+    return state.vram[addr - 0x8000];
+}
+
+// The last byte added is the checksum 0xE7: it carries out of both nibbles to reach zero
+static_assert(STATE.registers.A == 0x01 && STATE.registers.F == 0xB0);
+static_assert(STATE.registers.B == 0x00 && STATE.registers.C == 0x13);
+static_assert(STATE.registers.D == 0x00 && STATE.registers.E == 0xD8);
+static_assert(STATE.registers.H == 0x01 && STATE.registers.L == 0x4D);
+static_assert(STATE.registers.SP == 0xFFFE && STATE.registers.PC == 0x0100);
+
+// A header whose checksum byte is 0 adds nothing on the last step: only Z is set
+static_assert(boot(make_header(0xE7)).registers.F == 0x80);
+
+// 0xCE: the upper nibble 1100 doubles to 0xF0, the lower 1110 to 0xFC, each on two rows
+static_assert(vram(STATE, 0x8010) == 0xF0 && vram(STATE, 0x8012) == 0xF0);
+static_assert(vram(STATE, 0x8014) == 0xFC && vram(STATE, 0x8016) == 0xFC);
+static_assert(vram(STATE, 0x8011) == 0x00); // bitplane 1 stays clear
+
+// The ® tile follows the 48 logo tiles
+static_assert(vram(STATE, 0x8190) == 0x3C && vram(STATE, 0x8192) == 0x42 && vram(STATE, 0x819E) == 0x3C);
+
+// Tilemap: ® at 0x9910, logo tiles 0x01-0x0C and 0x0D-0x18 on the two rows above
+static_assert(vram(STATE, 0x9910) == 0x19);
+static_assert(vram(STATE, 0x992F) == 0x18 && vram(STATE, 0x9924) == 0x0D);
+static_assert(vram(STATE, 0x990F) == 0x0C && vram(STATE, 0x9904) == 0x01);
+
+static_assert(STATE.io[0x40] == 0x91 && STATE.io[0x47] == 0xFC && STATE.io[0x26] == 0xF1);
+static_assert(STATE.IE == 0x00);
+
+} // namespace
+
+TEST(Boot, DrawsOnlyTheLogoTiles)
+{
+    std::size_t written = 0;
+    for (std::uint16_t addr = 0x8000; addr < 0x8000 + 0x2000; ++addr)
+        written += vram(STATE, addr) != 0;
+    // nonzero bytes: every tile row of the logo that has pixels, the ® tile and 25 map entries
+    std::size_t expected = 8 + 25;
+    for (const std::uint8_t logo : impl::LOGO)
+        expected += 2 * ((logo >> 4) != 0) + 2 * ((logo & 0x0F) != 0);
+    EXPECT_EQ(written, expected);
+}
+
+TEST(Boot, RejectsAWrongLogo)
+{
+    CartridgeHeader header = HEADER;
+    header[0x04 + 17] ^= 0x01;
+    EXPECT_THROW((void)boot(header), std::invalid_argument);
+}
+
+TEST(Boot, RejectsAWrongChecksum)
+{
+    CartridgeHeader header = HEADER;
+    ++header[0x4D];
+    EXPECT_THROW((void)boot(header), std::invalid_argument);
+    header = HEADER;
+    header[0x40] = 0x42; // inside the summed range 0x0134-0x014C
+    EXPECT_THROW((void)boot(header), std::invalid_argument);
+}
+
+TEST(Boot, PostBootSnapshot)
+{
+    EXPECT_EQ(post_boot<HEADER>.registers.F, STATE.registers.F);
+    EXPECT_EQ(post_boot<HEADER>.vram, STATE.vram);
+}
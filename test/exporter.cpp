@@ -0,0 +1,55 @@
+// Export::Exporter: nothing queued before destruction is lost, a closed reader is EPIPE.
+
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <exporter.hpp>
+
+using namespace LR35902;
+
+TEST(Exporter, WritesEverythingQueuedBeforeDestruction)
+{
+    const std::vector<std::int16_t> samples(1000, 0x1234);
+    for (int run = 0; run < 200; ++run) {
+        std::FILE* file = std::tmpfile();
+        ASSERT_NE(file, nullptr);
+        Export::Options options;
+        options.audio_fd = fileno(file);
+        options.audio = Export::AudioContainer::RawS16;
+        {
+            Export::Exporter exporter{options};
+            for (int chunk = 0; chunk < 8; ++chunk)
+                ASSERT_EQ(exporter.audio(samples), samples.size());
+        }
+        EXPECT_EQ(lseek(fileno(file), 0, SEEK_END), static_cast<off_t>(8 * samples.size() * sizeof(std::int16_t)))
+            << "run " << run;
+        std::fclose(file);
+    }
+}
+
+TEST(Exporter, ClosedReaderIsAnErrorNotASignal)
+{
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    close(fds[0]);
+
+    Export::Options options;
+    options.audio_fd = fds[1];
+    options.audio = Export::AudioContainer::RawS16;
+    Export::Exporter exporter{options};
+    const std::vector<std::int16_t> samples(1000);
+    for (int i = 0; i < 1000 && !exporter.error(); ++i) {
+        exporter.audio(samples);
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    EXPECT_EQ(exporter.error(), EPIPE);
+    close(fds[1]);
+}
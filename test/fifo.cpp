@@ -0,0 +1,218 @@
+// PPU::PixelFifo against Reference::render over random VRAM, OAM and registers, mid-line
+// register writes, and Renderer::Auto switching between the line renderer and the FIFO.
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include <PPU/ppu.hpp>
+
+namespace
+{
+
+using namespace LR35902;
+using namespace LR35902::PPU;
+
+using Vram = MMU::VideoRAM<>;
+
+LineRegisters random_registers(std::mt19937& random)
+{
+    LineRegisters regs{
+        .LCDC = static_cast<Data>(random()),
+        .SCY = static_cast<Data>(random()),
+        .SCX = static_cast<Data>(random()),
+        .LY = static_cast<Data>(random() % HEIGHT),
+        .WY = static_cast<Data>(random() % HEIGHT),
+        .WX = static_cast<Data>(random() % 170),
+        .BGP = static_cast<Data>(random()),
+        .OBP0 = static_cast<Data>(random()),
+        .OBP1 = static_cast<Data>(random()),
+        .window_line = 0,
+    };
+    regs.window_line = static_cast<Data>(random() % (regs.LY + 1));
+    return regs;
+}
+
+// Objects around `ly`, many of them on the line and some overlapping at the same x
+void random_oam(std::mt19937& random, std::array<Data, 0xA0>& oam, const Data ly)
+{
+    for (std::size_t i = 0; i < oam.size(); i += 4) {
+        oam[i] = static_cast<Data>(ly + 16 - random() % 16);
+        oam[i + 1] = static_cast<Data>(random() % 4 ? random() % (WIDTH + 8) : 40);
+        oam[i + 2] = static_cast<Data>(random());
+        oam[i + 3] = static_cast<Data>(random());
+    }
+}
+
+struct System
+{
+    Scheduler scheduler;
+    Interrupts interrupts{scheduler};
+    SystemState state{};
+    std::unique_ptr<PixelProcessor::Vram> vram = std::make_unique<PixelProcessor::Vram>();
+    PixelProcessor::Oam oam{};
+    FrameBuffers output;
+    std::unique_ptr<PixelProcessor> ppu = std::make_unique<PixelProcessor>(scheduler, interrupts, state, *vram, oam, output);
+    Data scx = 0;
+
+    void step()
+    {
+        scheduler.advance(scheduler.next() - scheduler.now());
+        scheduler.fire([this](const Event event, const Cycle at) {
+            if (event == Event::PPU)
+                ppu->on_event(at);
+            else
+                interrupts.acknowledge(interrupts.highest());
+        });
+    }
+
+    // Runs to the end of the next frame, changing SCX once in the middle of mode 3 if asked
+    void frame(const bool mode3_write)
+    {
+        const std::uint64_t frames = ppu->frames();
+        bool written = !mode3_write;
+        while (ppu->frames() == frames) {
+            step();
+            if (!written && ppu->mode() == Mode::Transfer) {
+                scheduler.advance(20);
+                state.io.write(0xFF43, ++scx);
+                written = true;
+            }
+        }
+    }
+};
+
+} // namespace
+
+// Without mid-line writes the FIFO draws what the hardware description says
+TEST(PixelFifo, MatchesReference)
+{
+    std::mt19937 random{6};
+    Vram vram;
+    std::array<Data, 0xA0> oam;
+    for (Addr addr = 0x8000; addr < 0xA000; ++addr)
+        vram.write(addr, static_cast<Data>(random()));
+
+    PixelFifo fifo;
+    for (int line = 0; line < 20000; ++line) {
+        for (int i = random() % 8; i > 0; --i)
+            vram.write(static_cast<Addr>(0x8000 + random() % 0x2000), static_cast<Data>(random()));
+        const LineRegisters regs = random_registers(random);
+        random_oam(random, oam, regs.LY);
+
+        Line expected, actual;
+        Reference::render(vram.bank(0), oam, regs, expected);
+        fifo.begin(vram.bank(0), select_objects(oam, regs.LY, regs.LCDC & LCDCBit::OBJSize), regs);
+        fifo.finish(actual);
+        ASSERT_EQ(expected, actual) << "line " << line;
+    }
+}
+
+// Advancing in pieces is the same as running to the end at once
+TEST(PixelFifo, AdvanceInPieces)
+{
+    std::mt19937 random{7};
+    Vram vram;
+    std::array<Data, 0xA0> oam;
+    for (Addr addr = 0x8000; addr < 0xA000; ++addr)
+        vram.write(addr, static_cast<Data>(random()));
+
+    PixelFifo whole, pieces;
+    for (int line = 0; line < 2000; ++line) {
+        const LineRegisters regs = random_registers(random);
+        random_oam(random, oam, regs.LY);
+        const LineObjects objects = select_objects(oam, regs.LY, regs.LCDC & LCDCBit::OBJSize);
+
+        Line expected, actual;
+        whole.begin(vram.bank(0), objects, regs);
+        whole.finish(expected);
+        pieces.begin(vram.bank(0), objects, regs);
+        while (!pieces.done())
+            pieces.advance(random() % 16);
+        pieces.finish(actual);
+        ASSERT_EQ(expected, actual) << "line " << line;
+    }
+}
+
+// A BGP write part way through mode 3: the pixels left of some x use the old palette and
+// the rest the new one, which maps every color to a different shade
+TEST(PixelFifo, MidLinePaletteWrite)
+{
+    std::mt19937 random{8};
+    Vram vram;
+    std::array<Data, 0xA0> oam;
+    for (Addr addr = 0x8000; addr < 0xA000; ++addr)
+        vram.write(addr, static_cast<Data>(random()));
+
+    PixelFifo fifo;
+    for (int line = 0; line < 2000; ++line) {
+        LineRegisters regs = random_registers(random);
+        regs.LCDC = static_cast<Data>((regs.LCDC | LCDCBit::BGEnable) & ~LCDCBit::OBJEnable);
+        regs.BGP = 0xE4;
+        random_oam(random, oam, regs.LY);
+        const LineRegisters before = regs;
+        LineRegisters after = regs;
+        after.BGP = 0x1B;
+
+        Line old_palette, new_palette, actual;
+        Reference::render(vram.bank(0), oam, before, old_palette);
+        Reference::render(vram.bank(0), oam, after, new_palette);
+
+        fifo.begin(vram.bank(0), select_objects(oam, regs.LY, regs.LCDC & LCDCBit::OBJSize), regs);
+        fifo.advance(TRANSFER_DOTS / 2);
+        regs.BGP = after.BGP;
+        fifo.finish(actual);
+
+        std::size_t split = 0;
+        while (split < WIDTH && actual[split] == old_palette[split])
+            ++split;
+        for (std::size_t x = split; x < WIDTH; ++x)
+            ASSERT_EQ(actual[x], new_palette[x]) << "line " << line << " x " << x << " split " << split;
+        ASSERT_GT(split, 0u) << "line " << line;
+        ASSERT_LT(split, WIDTH) << "line " << line;
+    }
+}
+
+// One mode 3 write switches Auto to the FIFO from the next frame on, and it stays there
+// until FIFO_HOLD_FRAMES frames in a row had none
+TEST(Renderer, AutoHoldsTheFifo)
+{
+    System system;
+    system.state.io.write(0xFF40, 0x93);
+    EXPECT_EQ(system.ppu->active(), Renderer::Line);
+
+    system.frame(false);
+    EXPECT_EQ(system.ppu->active(), Renderer::Line);
+    system.frame(true);
+    EXPECT_EQ(system.ppu->active(), Renderer::Fifo);
+
+    constexpr std::size_t WRITE = 10;
+    for (std::size_t frame = 1; frame < PixelProcessor::FIFO_HOLD_FRAMES; ++frame) {
+        system.frame(frame == WRITE);
+        ASSERT_EQ(system.ppu->active(), Renderer::Fifo) << "frame " << frame;
+    }
+    // the write in frame 10 restarted the count
+    for (std::size_t frame = 0; frame < WRITE; ++frame)
+        system.frame(false);
+    EXPECT_EQ(system.ppu->active(), Renderer::Fifo);
+    system.frame(false);
+    EXPECT_EQ(system.ppu->active(), Renderer::Line);
+}
+
+// A fixed policy never switches
+TEST(Renderer, FixedPolicies)
+{
+    System system;
+    system.ppu->renderer(Renderer::Line);
+    system.state.io.write(0xFF40, 0x93);
+    system.frame(true);
+    EXPECT_EQ(system.ppu->active(), Renderer::Line);
+
+    system.ppu->renderer(Renderer::Fifo);
+    for (std::size_t frame = 0; frame <= PixelProcessor::FIFO_HOLD_FRAMES; ++frame)
+        system.frame(false);
+    EXPECT_EQ(system.ppu->active(), Renderer::Fifo);
+}
@@ -0,0 +1,143 @@
+// fork_server::Server: the AFL protocol over pipes on fds 198/199, with this process as
+// the fuzzer and a forked process as the server.
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <fork_server.hpp>
+
+namespace
+{
+
+// Exit codes of the server process
+constexpr int CHILD = 7;      // every run
+constexpr int STANDALONE = 101;
+constexpr int FAILED = 102;
+
+[[noreturn]] void serve()
+{
+    fork_server::Server server;
+    switch (server.serve()) {
+    case fork_server::Role::Child:      _exit(CHILD);
+    case fork_server::Role::Parent:     _exit(static_cast<int>(server.runs()));
+    case fork_server::Role::Standalone: _exit(STANDALONE);
+    case fork_server::Role::Failed:     _exit(FAILED);
+    }
+    _exit(FAILED);
+}
+
+bool send(const int fd, const std::uint32_t word)
+{
+    return write(fd, &word, sizeof(word)) == sizeof(word);
+}
+
+bool receive(const int fd, std::uint32_t& word)
+{
+    return read(fd, &word, sizeof(word)) == sizeof(word);
+}
+
+int wait_for(const pid_t pid)
+{
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {}
+    return status;
+}
+
+} // namespace
+
+TEST(ForkServer, ForksOneChildPerRun)
+{
+    int control[2], status[2]; // fuzzer -> server, server -> fuzzer
+    ASSERT_EQ(pipe(control), 0);
+    ASSERT_EQ(pipe(status), 0);
+
+    const pid_t server = fork();
+    ASSERT_GE(server, 0);
+    if (server == 0) {
+        if (dup2(control[0], fork_server::CONTROL_FD) < 0 || dup2(status[1], fork_server::STATUS_FD) < 0)
+            _exit(FAILED);
+        close(control[0]);
+        close(control[1]);
+        close(status[0]);
+        close(status[1]);
+        serve();
+    }
+    close(control[0]);
+    close(status[1]);
+
+    std::uint32_t hello = 1;
+    ASSERT_TRUE(receive(status[0], hello));
+    EXPECT_EQ(hello, 0u);
+
+    constexpr int RUNS = 5;
+    std::set<std::uint32_t> pids;
+    for (int run = 0; run < RUNS; ++run) {
+        ASSERT_TRUE(send(control[1], run == 2)); // as if the fuzzer had killed the last child
+        std::uint32_t pid = 0, result = 0;
+        ASSERT_TRUE(receive(status[0], pid));
+        EXPECT_GT(pid, 0u);
+        EXPECT_NE(static_cast<pid_t>(pid), server);
+        pids.insert(pid);
+        ASSERT_TRUE(receive(status[0], result));
+        const int child = static_cast<int>(result);
+        ASSERT_TRUE(WIFEXITED(child)) << "run " << run;
+        EXPECT_EQ(WEXITSTATUS(child), CHILD) << "run " << run;
+    }
+    EXPECT_EQ(pids.size(), static_cast<std::size_t>(RUNS));
+
+    // hanging up ends the server, which counted every run
+    close(control[1]);
+    const int exit = wait_for(server);
+    close(status[0]);
+    ASSERT_TRUE(WIFEXITED(exit));
+    EXPECT_EQ(WEXITSTATUS(exit), RUNS);
+}
+
+// Without a fuzzer the command runs once in the same process
+TEST(ForkServer, StandaloneWithoutAFuzzer)
+{
+    const pid_t server = fork();
+    ASSERT_GE(server, 0);
+    if (server == 0) {
+        close(fork_server::CONTROL_FD);
+        close(fork_server::STATUS_FD);
+        serve();
+    }
+    const int exit = wait_for(server);
+    ASSERT_TRUE(WIFEXITED(exit));
+    EXPECT_EQ(WEXITSTATUS(exit), STANDALONE);
+}
+
+// A fuzzer that hangs up without asking for a run
+TEST(ForkServer, HangUpBeforeTheFirstRun)
+{
+    int control[2], status[2];
+    ASSERT_EQ(pipe(control), 0);
+    ASSERT_EQ(pipe(status), 0);
+    const pid_t server = fork();
+    ASSERT_GE(server, 0);
+    if (server == 0) {
+        dup2(control[0], fork_server::CONTROL_FD);
+        dup2(status[1], fork_server::STATUS_FD);
+        close(control[0]);
+        close(control[1]);
+        close(status[0]);
+        close(status[1]);
+        serve();
+    }
+    close(control[0]);
+    close(status[1]);
+    close(control[1]);
+    const int exit = wait_for(server);
+    close(status[0]);
+    ASSERT_TRUE(WIFEXITED(exit));
+    EXPECT_EQ(WEXITSTATUS(exit), 0);
+}
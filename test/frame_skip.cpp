@@ -0,0 +1,184 @@
+// PixelProcessor frame skip and render on demand: the same deadlines, LY/STAT reads and
+// interrupts as drawing every frame, with only the published frames differing.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include <PPU/ppu.hpp>
+
+namespace
+{
+
+using namespace LR35902;
+using namespace LR35902::PPU;
+
+constexpr Cycle FRAME = LINE_DOTS * LINES;
+
+struct System
+{
+    Scheduler scheduler;
+    Interrupts interrupts{scheduler};
+    SystemState state{};
+    std::unique_ptr<PixelProcessor::Vram> vram = std::make_unique<PixelProcessor::Vram>();
+    PixelProcessor::Oam oam{};
+    FrameBuffers output;
+    std::unique_ptr<PixelProcessor> ppu = std::make_unique<PixelProcessor>(scheduler, interrupts, state, *vram, oam, output);
+    std::array<std::size_t, 5> serviced{}; // per Interrupt
+    std::uint64_t published = 0;
+
+    // The CPU services every interrupt as soon as it is raised
+    void step(const Cycle until)
+    {
+        scheduler.advance(until - scheduler.now());
+        scheduler.fire([this](const Event event, const Cycle at) {
+            if (event == Event::PPU) {
+                ppu->on_event(at);
+            } else if (interrupts.pending()) {
+                const Interrupt interrupt = interrupts.highest();
+                ++serviced[static_cast<std::size_t>(interrupt)];
+                interrupts.acknowledge(interrupt);
+            }
+        });
+        if (output.fresh())
+            published = output.acquire().number + 1;
+    }
+
+    void write(const Addr addr, const Data data)
+    {
+        if (interrupts.for_me(addr))
+            interrupts.write(addr, data);
+        else
+            state.io.write(addr, data);
+    }
+
+    void lcd_on()
+    {
+        write(0xFFFF, 0x1F);
+        write(0xFF41, 0x78); // every STAT source
+        write(0xFF45, 0x40);
+        write(0xFF47, 0xE4);
+        write(0xFF40, 0x93);
+    }
+};
+
+// Runs `frames` frames of random register, VRAM and OAM writes on every system at once and
+// compares them after each event
+void run_together(std::array<System*, 3> systems, const std::uint64_t frames, const bool lcd_toggles)
+{
+    std::mt19937 random{10};
+    System& full = *systems[0];
+    while (full.scheduler.now() < frames * FRAME) {
+        const Cycle next = full.scheduler.next();
+        for (System* system : systems) {
+            ASSERT_EQ(system->scheduler.next(), next) << "at " << full.scheduler.now();
+            system->step(next);
+        }
+        for (System* system : systems) {
+            ASSERT_EQ(system->state.io.read(0xFF44), full.state.io.read(0xFF44)) << "at " << next;
+            ASSERT_EQ(system->state.io.read(0xFF41), full.state.io.read(0xFF41)) << "at " << next;
+            ASSERT_EQ(system->interrupts.read(0xFF0F), full.interrupts.read(0xFF0F)) << "at " << next;
+        }
+
+        // somewhere inside the mode, before the next deadline
+        const Cycle until = full.scheduler.next();
+        if (until > next + 1 && random() % 2) {
+            const Cycle dots = random() % (until - next);
+            for (System* system : systems)
+                system->scheduler.advance(dots);
+        }
+
+        Addr addr = 0;
+        Data data = static_cast<Data>(random());
+        switch (random() % 8) {
+        case 0: addr = 0xFF43; break; // SCX, also during mode 3
+        case 1: addr = 0xFF4B; data = static_cast<Data>(random() % 168); break;
+        case 2: addr = 0xFF45; data = static_cast<Data>(random() % LINES); break;
+        case 3: addr = static_cast<Addr>(0xFE00 + random() % 0xA0); break;
+        case 4: addr = static_cast<Addr>(0x8000 + random() % 0x2000); break;
+        case 5: addr = 0xFF40; data = static_cast<Data>(0x80 | data); break;
+        default: break;
+        }
+        for (System* system : systems) {
+            if (addr >= 0xFE00 && addr < 0xFEA0)
+                system->oam.write(addr, data);
+            else if (addr >= 0x8000 && addr < 0xA000)
+                system->vram->write(addr, data);
+            else if (addr)
+                system->write(addr, data);
+        }
+
+        // the LCD off for a moment restarts the frame at line 0
+        if (lcd_toggles && random() % 2048 == 0) {
+            const Cycle dots = random() % LINE_DOTS;
+            for (System* system : systems) {
+                system->write(0xFF40, 0x13);
+                system->scheduler.advance(dots);
+                system->write(0xFF40, 0x93);
+            }
+        }
+    }
+    for (System* system : systems)
+        EXPECT_EQ(system->serviced, full.serviced);
+    EXPECT_GT(full.serviced[static_cast<std::size_t>(Interrupt::STAT)], frames);
+    EXPECT_GT(full.serviced[static_cast<std::size_t>(Interrupt::VBlank)], frames / 2);
+}
+
+} // namespace
+
+TEST(FrameSkip, TimingMatchesFullRendering)
+{
+    System full, skip, demand;
+    skip.ppu->frame_skip(3);
+    demand.ppu->render_on_demand(true);
+    for (System* system : {&full, &skip, &demand})
+        system->lcd_on();
+
+    run_together({&full, &skip, &demand}, 40, true);
+}
+
+// Mid-line writes run the FIFO on the drawn frames only
+TEST(FrameSkip, TimingMatchesWithTheFifo)
+{
+    System full, skip, demand;
+    for (System* system : {&full, &skip, &demand})
+        system->ppu->renderer(Renderer::Fifo);
+    skip.ppu->frame_skip(1);
+    demand.ppu->render_on_demand(true);
+    for (System* system : {&full, &skip, &demand})
+        system->lcd_on();
+
+    run_together({&full, &skip, &demand}, 20, false);
+}
+
+TEST(FrameSkip, PublishesOnlyDrawnFrames)
+{
+    System full, skip, demand;
+    skip.ppu->frame_skip(3);
+    demand.ppu->render_on_demand(true);
+    for (System* system : {&full, &skip, &demand})
+        system->lcd_on();
+
+    constexpr std::uint64_t FRAMES = 40;
+    std::uint64_t requests = 0, requested = 0;
+    while (full.ppu->frames() < FRAMES) {
+        const Cycle next = full.scheduler.next();
+        for (System* system : {&full, &skip, &demand})
+            system->step(next);
+        // asked for during VBlank of every 8th frame, drawn in the next one
+        const std::uint64_t frames = full.ppu->frames();
+        if (full.state.io.read(0xFF44) == 150 && frames % 8 == 0 && frames != requested && frames + 1 < FRAMES) {
+            demand.ppu->request_frame();
+            requested = frames;
+            ++requests;
+        }
+    }
+    EXPECT_EQ(full.published, FRAMES);
+    EXPECT_EQ(skip.published, FRAMES / 4);
+    EXPECT_EQ(demand.published, requests);
+    EXPECT_GT(requests, 0u);
+}
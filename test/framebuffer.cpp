@@ -0,0 +1,99 @@
+// PPU::FrameBuffers: a producer and a consumer thread, checking every acquired frame is
+// whole and newer than the last, and that frames the consumer missed count as overwritten.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <PPU/framebuffer.hpp>
+
+namespace
+{
+
+using namespace LR35902;
+using namespace LR35902::PPU;
+
+// Every pixel of frame n holds the low byte of n, a mix of two frames shows as torn
+void produce(FrameBuffers& buffers, const std::uint64_t frames)
+{
+    Line line;
+    for (std::uint64_t n = 0; n < frames; ++n) {
+        line.fill(static_cast<Data>(n));
+        for (std::size_t ly = 0; ly < HEIGHT; ++ly)
+            buffers.line(ly, line);
+        buffers.publish();
+    }
+}
+
+bool whole(const FrameView& frame)
+{
+    for (const std::byte pixel : frame.pixels)
+        if (pixel != static_cast<std::byte>(frame.number))
+            return false;
+    return true;
+}
+
+} // namespace
+
+TEST(FrameBuffers, SingleThread)
+{
+    FrameBuffers buffers;
+    EXPECT_FALSE(buffers.fresh());
+
+    produce(buffers, 1);
+    ASSERT_TRUE(buffers.fresh());
+    const FrameView first = buffers.acquire();
+    EXPECT_EQ(first.number, 0u);
+    EXPECT_TRUE(whole(first));
+    EXPECT_FALSE(buffers.fresh());
+    EXPECT_EQ(buffers.acquire().number, 0u); // the same frame again
+
+    // 3 more frames before the consumer looks: it gets the last, the 2 before were overwritten
+    Line line;
+    for (std::uint64_t n = 1; n <= 3; ++n) {
+        line.fill(static_cast<Data>(n));
+        for (std::size_t ly = 0; ly < HEIGHT; ++ly)
+            buffers.line(ly, line);
+        buffers.publish();
+    }
+    const FrameView last = buffers.acquire();
+    EXPECT_EQ(last.number, 3u);
+    EXPECT_TRUE(whole(last));
+    EXPECT_EQ(buffers.overwritten(), 2u);
+}
+
+TEST(FrameBuffers, ProducerAndConsumerThreads)
+{
+    constexpr std::uint64_t FRAMES = 100'000;
+    FrameBuffers buffers;
+    std::atomic<bool> done{false};
+
+    std::thread producer{[&] {
+        produce(buffers, FRAMES);
+        done.store(true, std::memory_order_release);
+    }};
+
+    std::uint64_t acquired = 0, last = 0, torn = 0, stale = 0;
+    bool draining = false;
+    while (!draining) {
+        draining = done.load(std::memory_order_acquire); // one more pass after the producer ended
+        if (!buffers.fresh())
+            continue;
+        const FrameView frame = buffers.acquire();
+        torn += !whole(frame);
+        stale += acquired && frame.number <= last;
+        last = frame.number;
+        ++acquired;
+    }
+    producer.join();
+
+    EXPECT_EQ(torn, 0u);
+    EXPECT_EQ(stale, 0u);
+    EXPECT_EQ(last, FRAMES - 1);
+    EXPECT_FALSE(buffers.fresh());
+    // every published frame was either acquired or overwritten
+    EXPECT_EQ(acquired + buffers.overwritten(), FRAMES);
+}
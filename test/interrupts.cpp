@@ -0,0 +1,146 @@
+// Interrupts and Sleep: HALT and STOP driven through Scheduler::run_until, waking on the
+// interrupts that end them and on interrupts that were already pending.
+
+#include <cstddef>
+
+#include <gtest/gtest.h>
+
+#include <interrupts.hpp>
+
+namespace
+{
+
+using namespace LR35902;
+
+// 4 cycles per instruction, executes HALT or STOP at step `sleep_at`
+struct Cpu
+{
+    Interrupts& interrupts;
+    Sleep sleep{};
+    bool stop = false; // STOP instead of HALT
+    std::size_t sleep_at = 1;
+    std::size_t steps = 0;
+
+    [[nodiscard]] bool halted() const noexcept { return sleep.halted(); }
+
+    Cycle step()
+    {
+        if (++steps == sleep_at) {
+            if (stop)
+                sleep.stop(interrupts);
+            else
+                sleep.halt(interrupts);
+        }
+        return 4;
+    }
+};
+
+struct System
+{
+    Scheduler scheduler;
+    Interrupts interrupts{scheduler};
+    Cpu cpu{interrupts};
+
+    // Event::Timer raises the timer interrupt, DMA stands in for the PPU's VBlank and
+    // DIV for a joypad press
+    void run_until(const Cycle end)
+    {
+        scheduler.run_until(end, cpu, [this](const Event event, Cycle) {
+            switch (event) {
+            case Event::Interrupt: cpu.sleep.wake(interrupts); break;
+            case Event::Timer:     interrupts.request(Interrupt::Timer); break;
+            case Event::DMA:       interrupts.request(Interrupt::VBlank); break;
+            case Event::DIV:       interrupts.request(Interrupt::Joypad); break;
+            default: break;
+            }
+        });
+    }
+};
+
+} // namespace
+
+// With IME off too: HALT ends when the enabled interrupt is requested
+TEST(Sleep, HaltEndsOnAnEnabledInterrupt)
+{
+    System system;
+    system.interrupts.write(0xFFFF, 0x04);
+    system.scheduler.schedule(Event::DMA, 400); // VBlank, not enabled
+    system.scheduler.schedule(Event::Timer, 1000);
+    system.run_until(2000);
+    EXPECT_FALSE(system.cpu.halted());
+    EXPECT_EQ(system.cpu.steps, 1 + (2000 - 1000) / 4);
+}
+
+TEST(Sleep, HaltEndsAtOnceOnAPendingInterrupt)
+{
+    System system;
+    system.interrupts.write(0xFFFF, 0x04);
+    system.interrupts.request(Interrupt::Timer);
+    system.cpu.sleep_at = 10;
+    system.run_until(1000);
+    EXPECT_FALSE(system.cpu.halted());
+    EXPECT_EQ(system.cpu.steps, 250u);
+}
+
+// HALT with nothing scheduled jumps to the end of the run without stepping
+TEST(Sleep, HaltWithoutInterruptsSkipsTheRun)
+{
+    System system;
+    system.cpu.sleep_at = 3;
+    system.run_until(1'000'000);
+    EXPECT_TRUE(system.cpu.halted());
+    EXPECT_EQ(system.cpu.steps, 3u);
+    EXPECT_EQ(system.scheduler.now(), 1'000'000u);
+}
+
+// STOP sleeps through other interrupts, also ones with a higher priority than Joypad
+TEST(Sleep, StopEndsOnlyOnJoypad)
+{
+    System system;
+    system.interrupts.write(0xFFFF, 0x1F);
+    system.cpu.stop = true;
+    system.scheduler.schedule(Event::DMA, 400);
+    system.scheduler.schedule(Event::Timer, 800);
+    system.scheduler.schedule(Event::DIV, 1200);
+    system.run_until(1100);
+    EXPECT_TRUE(system.cpu.halted());
+    EXPECT_TRUE(system.interrupts.pending(Interrupt::VBlank));
+    EXPECT_EQ(system.cpu.steps, 1u);
+
+    system.run_until(2000);
+    EXPECT_FALSE(system.cpu.halted());
+    EXPECT_EQ(system.cpu.steps, 1 + (2000 - 1200) / 4);
+}
+
+TEST(Sleep, StopIgnoresADisabledJoypad)
+{
+    System system;
+    system.interrupts.write(0xFFFF, 0x01);
+    system.cpu.stop = true;
+    system.scheduler.schedule(Event::DIV, 100);
+    system.run_until(1000);
+    EXPECT_TRUE(system.cpu.halted());
+    EXPECT_EQ(system.cpu.steps, 1u);
+}
+
+// An interrupt joining others that are pending is announced again
+TEST(Interrupts, EveryNewRequestIsAnnounced)
+{
+    Scheduler scheduler;
+    Interrupts interrupts{scheduler};
+    interrupts.write(0xFFFF, 0x1F);
+    interrupts.request(Interrupt::VBlank);
+    EXPECT_TRUE(scheduler.scheduled(Event::Interrupt));
+    scheduler.cancel(Event::Interrupt);
+
+    interrupts.request(Interrupt::VBlank); // already pending
+    EXPECT_FALSE(scheduler.scheduled(Event::Interrupt));
+    interrupts.request(Interrupt::Joypad);
+    EXPECT_TRUE(scheduler.scheduled(Event::Interrupt));
+    EXPECT_EQ(interrupts.highest(), Interrupt::VBlank);
+
+    interrupts.acknowledge(Interrupt::VBlank);
+    interrupts.acknowledge(Interrupt::Joypad);
+    EXPECT_FALSE(scheduler.scheduled(Event::Interrupt));
+    EXPECT_FALSE(interrupts.pending());
+}
@@ -0,0 +1,44 @@
+// IO::RegisterBank observer registration.
+
+#include <array>
+#include <cstddef>
+
+#include <gtest/gtest.h>
+
+#include <io.hpp>
+
+namespace
+{
+
+using namespace LR35902;
+
+struct Counter
+{
+    std::size_t calls = 0;
+    void on_write(Data, Data) noexcept { ++calls; }
+};
+
+} // namespace
+
+TEST(RegisterBank, CallsEveryObserver)
+{
+    IO::RegisterBank bank;
+    std::array<Counter, IO::RegisterBank::OBSERVERS> counters{};
+    for (Counter& counter : counters)
+        bank.observe<IO::SCX, &Counter::on_write>(counter);
+
+    bank.write(0xFF43, 0x12);
+    for (const Counter& counter : counters)
+        EXPECT_EQ(counter.calls, 1u);
+}
+
+TEST(RegisterBankDeathTest, TooManyObserversAbort)
+{
+    IO::RegisterBank bank;
+    std::array<Counter, IO::RegisterBank::OBSERVERS + 1> counters{};
+    const auto register_all = [&] {
+        for (Counter& counter : counters)
+            bank.observe<IO::SCX, &Counter::on_write>(counter);
+    };
+    EXPECT_DEATH(register_all(), "");
+}
@@ -0,0 +1,356 @@
+// Lockstep::Engine: random programs run by the vector kernels against the same programs
+// run one lane at a time, and the registers derived from the cycle count.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <lockstep.hpp>
+
+namespace
+{
+
+using namespace LR35902;
+using Engine = Lockstep::Engine<64>;
+
+bool illegal(const Data op)
+{
+    constexpr std::array<Data, 11> ILLEGAL{0xD3, 0xDB, 0xDD, 0xE3, 0xE4, 0xEB, 0xEC, 0xED, 0xF4, 0xFC, 0xFD};
+    return std::find(ILLEGAL.begin(), ILLEGAL.end(), op) != ILLEGAL.end();
+}
+
+// Random code full of short loops that poll and reset the derived registers
+std::vector<std::uint8_t> random_rom(std::mt19937& random)
+{
+    std::vector<std::uint8_t> rom(0x8000);
+    for (std::uint8_t& byte : rom) {
+        Data op = static_cast<Data>(random());
+        if (illegal(op) || ((op == 0x76 || op == 0x10) && random() % 8))
+            op = 0x00;
+        byte = op;
+    }
+    for (int i = 0; i < 400; ++i) {
+        const std::size_t at = 0x100 + random() % 0x2000;
+        rom[at] = static_cast<std::uint8_t>(0x20 + random() % 4 * 8); // JR cc
+        rom[at + 1] = static_cast<std::uint8_t>(0xF0 + random() % 16);
+    }
+    constexpr std::array<std::uint8_t, 4> REGISTERS{0x04, 0x41, 0x44, 0x40};
+    for (int i = 0; i < 200; ++i) {
+        const std::size_t at = 0x100 + random() % 0x2000;
+        rom[at] = random() % 4 ? 0xF0 : 0xE0; // LDH A,(n) or LDH (n),A
+        rom[at + 1] = REGISTERS[random() % REGISTERS.size()];
+    }
+    return rom;
+}
+
+void setup(Engine& engine, const int seed)
+{
+    for (std::size_t lane = 0; lane < Engine::LANES; ++lane) {
+        Engine::Registers regs = engine.registers(lane);
+        regs.A = static_cast<Data>(lane % (1 + seed % 7));
+        regs.F = static_cast<Data>((lane * 3 % 4) << 4);
+        regs.B = static_cast<Data>(lane % 3);
+        regs.SP = 0xDFF0;
+        regs.IME = seed & 1;
+        engine.registers(lane, regs);
+        engine.write(lane, 0xFFFF, 0x1F);
+        engine.buttons(lane, static_cast<Data>(lane * 37));
+    }
+}
+
+void expect_same(const Engine& expected, const Engine& actual, const int seed)
+{
+    for (std::size_t lane = 0; lane < Engine::LANES; ++lane) {
+        const Engine::Registers a = expected.registers(lane), b = actual.registers(lane);
+        ASSERT_EQ(a.PC, b.PC) << "seed " << seed << " lane " << lane;
+        ASSERT_EQ(a.SP, b.SP) << "seed " << seed << " lane " << lane;
+        ASSERT_EQ((std::array{a.A, a.F, a.B, a.C, a.D, a.E, a.H, a.L}), (std::array{b.A, b.F, b.B, b.C, b.D, b.E, b.H, b.L}))
+            << "seed " << seed << " lane " << lane;
+        ASSERT_EQ(a.IME, b.IME) << "seed " << seed << " lane " << lane;
+        ASSERT_EQ(expected.state(lane), actual.state(lane)) << "seed " << seed << " lane " << lane;
+        for (unsigned addr = Engine::RAM_BASE; addr <= 0xFFFF; ++addr)
+            ASSERT_EQ(expected.read(lane, static_cast<Addr>(addr)), actual.read(lane, static_cast<Addr>(addr)))
+                << "seed " << seed << " lane " << lane << " address " << addr;
+    }
+}
+
+void check_kernels(const Engine::Kernels kernels)
+{
+    std::uint64_t lockstep = 0;
+    for (int seed = 0; seed < 12; ++seed) {
+        std::mt19937 random(static_cast<std::mt19937::result_type>(seed));
+        const std::vector<std::uint8_t> rom = random_rom(random);
+        const auto vector = std::make_unique<Engine>(rom, 8, kernels);
+        const auto scalar = std::make_unique<Engine>(rom, Engine::LANES + 1); // no group is large enough
+        setup(*vector, seed);
+        setup(*scalar, seed);
+        for (int frame = 0; frame < 4; ++frame) {
+            vector->run_frame();
+            scalar->run_frame();
+        }
+        expect_same(*scalar, *vector, seed);
+        lockstep += vector->stats().lockstep;
+        EXPECT_EQ(scalar->stats().lockstep, 0u);
+    }
+    EXPECT_GT(lockstep, 0u);
+}
+
+// Waits for line 10, then stores DIV and STAT to 0xC000 and spins
+constexpr std::array<std::uint8_t, 20> POLL_LY{
+    0xF0, 0x44,       // 0x100: LDH A,(LY)
+    0xFE, 0x0A,       //        CP 10
+    0x20, 0xFA,       //        JR NZ,0x100
+    0xF0, 0x04,       //        LDH A,(DIV)
+    0xEA, 0x00, 0xC0, //        LD (0xC000),A
+    0xF0, 0x41,       //        LDH A,(STAT)
+    0xEA, 0x01, 0xC0, //        LD (0xC001),A
+    0x18, 0xFE,       //        JR @
+};
+
+// One instruction sequence (followed by JR @) and the registers before and after it
+struct Case
+{
+    std::vector<std::uint8_t> code;
+    Engine::Registers in;
+    Engine::Registers out; // PC is where the JR @ is
+};
+
+// Lane i runs case i % cases.size() from its own address, grouped (every lane of a case
+// together) and on the scalar path
+void expect_cases(const std::vector<Case>& cases)
+{
+    std::vector<std::uint8_t> rom(0x8000);
+    for (std::size_t i = 0; i < cases.size(); ++i) {
+        const std::size_t at = 0x200 + 0x10 * i;
+        std::copy(cases[i].code.begin(), cases[i].code.end(), rom.begin() + at);
+        rom[at + cases[i].code.size()] = 0x18; // JR @
+        rom[at + cases[i].code.size() + 1] = 0xFE;
+    }
+    for (const Engine::Kernels kernels : {Engine::generic_kernels(), Engine::select_kernels()}) {
+        for (const std::size_t min_group : {std::size_t{1}, Engine::LANES + 1}) {
+            const auto engine = std::make_unique<Engine>(rom, min_group, kernels);
+            for (std::size_t lane = 0; lane < Engine::LANES; ++lane) {
+                Engine::Registers in = cases[lane % cases.size()].in;
+                in.PC = static_cast<std::uint16_t>(0x200 + 0x10 * (lane % cases.size()));
+                engine->registers(lane, in);
+            }
+            engine->run_frame();
+
+            for (std::size_t lane = 0; lane < Engine::LANES; ++lane) {
+                const std::size_t i = lane % cases.size();
+                const Engine::Registers a = engine->registers(lane), e = cases[i].out;
+                const std::string where = "case " + std::to_string(i) + ", min group " + std::to_string(min_group);
+                EXPECT_EQ(a.PC, 0x200 + 0x10 * i + cases[i].code.size()) << where;
+                EXPECT_EQ(a.SP, e.SP) << where;
+                EXPECT_EQ((std::array{a.A, a.F, a.B, a.C, a.D, a.E, a.H, a.L}), (std::array{e.A, e.F, e.B, e.C, e.D, e.E, e.H, e.L}))
+                    << where;
+            }
+            EXPECT_EQ(engine->stats().lockstep > 0, min_group == 1);
+        }
+    }
+}
+
+// Where PC is after one frame of the same instruction over and over, `bytes` long and
+// taking `cycles` each, starting at cycle 0
+constexpr std::uint16_t pc_after_frame(const std::size_t bytes, const std::size_t cycles)
+{
+    return static_cast<std::uint16_t>(0x100 + bytes * ((Engine::FRAME_CYCLES + cycles - 1) / cycles));
+}
+
+} // namespace
+
+TEST(Lockstep, GenericKernelMatchesTheScalarPath)
+{
+    check_kernels(Engine::generic_kernels());
+}
+
+#if UTILITY_SIMD_X86
+TEST(Lockstep, Avx2KernelMatchesTheScalarPath)
+{
+    if (!utility::cpu().avx2)
+        GTEST_SKIP() << "no AVX2";
+    check_kernels(Engine::select_kernels());
+}
+#endif
+
+// Lanes with the LCD on see line 10 during the first frame, the others read LY 0 forever
+TEST(Lockstep, PollingLYEndsWithTheLine)
+{
+    std::vector<std::uint8_t> rom(0x8000);
+    std::copy(POLL_LY.begin(), POLL_LY.end(), rom.begin() + 0x100);
+    for (const std::size_t min_group : {std::size_t{1}, Engine::LANES + 1}) {
+        const auto engine = std::make_unique<Engine>(rom, min_group);
+        for (std::size_t lane = 1; lane < Engine::LANES; lane += 2)
+            engine->write(lane, 0xFF40, 0x00);
+        engine->run_frame();
+
+        for (std::size_t lane = 0; lane < Engine::LANES; ++lane) {
+            if (lane % 2) {
+                EXPECT_LT(engine->registers(lane).PC, 0x106) << "lane " << lane; // still polling
+                continue;
+            }
+            EXPECT_EQ(engine->registers(lane).PC, 0x110) << "lane " << lane;
+            // line 10 starts 20 lines into the frame, which begins with VBlank at line 144
+            const unsigned cycles = 20 * 456;
+            EXPECT_GE(engine->read(lane, 0xC000), cycles >> 8) << "lane " << lane;
+            EXPECT_LE(engine->read(lane, 0xC000), (cycles + 80) >> 8) << "lane " << lane;
+            EXPECT_EQ(engine->read(lane, 0xC001), 0x82) << "lane " << lane; // OAM scan, LYC 0 differs
+        }
+    }
+}
+
+// Writing DIV restarts it, reads between frames see the frame boundary
+TEST(Lockstep, DivCountsFromTheLastWrite)
+{
+    std::vector<std::uint8_t> rom(0x8000);
+    rom[0x100] = 0x18; // JR @
+    rom[0x101] = 0xFE;
+    const auto engine = std::make_unique<Engine>(rom);
+    engine->run_frame();
+    EXPECT_EQ(engine->read(0, 0xFF04), static_cast<Data>(Engine::FRAME_CYCLES >> 8));
+    EXPECT_EQ(engine->read(0, 0xFF44), 144);
+    EXPECT_EQ(engine->read(0, 0xFF41) & 0x03, 1);
+
+    engine->write(0, 0xFF04, 0x55);
+    EXPECT_EQ(engine->read(0, 0xFF04), 0);
+    EXPECT_EQ(engine->read(1, 0xFF04), static_cast<Data>(Engine::FRAME_CYCLES >> 8));
+    engine->run_frame();
+    EXPECT_EQ(engine->read(0, 0xFF04), static_cast<Data>(Engine::FRAME_CYCLES >> 8));
+    EXPECT_EQ(engine->read(1, 0xFF04), static_cast<Data>(2 * Engine::FRAME_CYCLES >> 8));
+}
+
+// DAA corrects for the operation before it: up by 0x06/0x60 after ADD, down after SUB
+TEST(Lockstep, DaaKnownAnswers)
+{
+    // A, B in; A, F out
+    constexpr std::array<std::array<Data, 4>, 6> ADD{{
+        {0x15, 0x27, 0x42, 0x00},
+        {0x99, 0x01, 0x00, 0x90}, // over 0x99: Z and C
+        {0x08, 0x08, 0x16, 0x00}, // half carry from the low digit
+        {0x90, 0x90, 0x80, 0x10}, // binary carry stays
+        {0x50, 0x50, 0x00, 0x90},
+        {0x00, 0x00, 0x00, 0x80},
+    }};
+    constexpr std::array<std::array<Data, 4>, 5> SUB{{
+        {0x42, 0x15, 0x27, 0x40}, // borrow from the low digit
+        {0x15, 0x27, 0x88, 0x50}, // borrow out: C stays set
+        {0x27, 0x27, 0x00, 0xC0},
+        {0x10, 0x01, 0x09, 0x40},
+        {0x00, 0x01, 0x99, 0x50},
+    }};
+    std::vector<Case> cases;
+    for (const auto& [a, b, result, flags] : ADD)
+        cases.push_back({{0x80, 0x27}, {a, 0xF0, b, 0, 0, 0, 0, 0, 0xDFF0, 0, false}, {result, flags, b, 0, 0, 0, 0, 0, 0xDFF0, 0, false}});
+    for (const auto& [a, b, result, flags] : SUB)
+        cases.push_back({{0x90, 0x27}, {a, 0x00, b, 0, 0, 0, 0, 0, 0xDFF0, 0, false}, {result, flags, b, 0, 0, 0, 0, 0, 0xDFF0, 0, false}});
+    expect_cases(cases);
+}
+
+// ADD SP,e8 and LD HL,SP+e8 add the signed operand but take H and C from the unsigned
+// low byte addition, and always clear Z and N
+TEST(Lockstep, SignedSpOffsetFlags)
+{
+    struct Offset
+    {
+        std::uint16_t sp;
+        Data e;
+        std::uint16_t result;
+        Data flags;
+    };
+    constexpr std::array<Offset, 7> OFFSETS{{
+        {0x00FF, 0x01, 0x0100, 0x30},
+        {0x000F, 0x01, 0x0010, 0x20},
+        {0xFFF0, 0x01, 0xFFF1, 0x00},
+        {0x0000, 0xFF, 0xFFFF, 0x00}, // -1, no carry out of the low byte
+        {0x0001, 0xFF, 0x0000, 0x30}, // zero, but Z stays clear
+        {0x1080, 0x80, 0x1000, 0x10}, // -128
+        {0xFFFF, 0x7F, 0x007E, 0x30},
+    }};
+    std::vector<Case> cases;
+    for (const Offset& o : OFFSETS) {
+        const Data h = static_cast<Data>(o.result >> 8), l = static_cast<Data>(o.result);
+        cases.push_back({{0xE8, o.e}, {0, 0xF0, 0, 0, 0, 0, 0x12, 0x34, o.sp, 0, false}, {0, o.flags, 0, 0, 0, 0, 0x12, 0x34, o.result, 0, false}});
+        cases.push_back({{0xF8, o.e}, {0, 0xF0, 0, 0, 0, 0, 0x12, 0x34, o.sp, 0, false}, {0, o.flags, 0, 0, 0, 0, h, l, o.sp, 0, false}});
+    }
+    expect_cases(cases);
+}
+
+// ADD HL,rr: H is the carry out of bit 11, C out of bit 15, Z is kept and N cleared
+TEST(Lockstep, AddHlHalfCarry)
+{
+    expect_cases({
+        {{0x09}, {0, 0x80, 0x00, 0x01, 0, 0, 0x0F, 0xFF, 0xDFF0, 0, false}, {0, 0xA0, 0x00, 0x01, 0, 0, 0x10, 0x00, 0xDFF0, 0, false}},
+        {{0x09}, {0, 0xF0, 0x00, 0x01, 0, 0, 0x00, 0xFF, 0xDFF0, 0, false}, {0, 0x80, 0x00, 0x01, 0, 0, 0x01, 0x00, 0xDFF0, 0, false}},
+        {{0x09}, {0, 0x00, 0x00, 0x01, 0, 0, 0xFF, 0xFF, 0xDFF0, 0, false}, {0, 0x30, 0x00, 0x01, 0, 0, 0x00, 0x00, 0xDFF0, 0, false}},
+        {{0x19}, {0, 0x00, 0, 0, 0x80, 0x00, 0x80, 0x00, 0xDFF0, 0, false}, {0, 0x10, 0, 0, 0x80, 0x00, 0x00, 0x00, 0xDFF0, 0, false}},
+        {{0x29}, {0, 0x40, 0, 0, 0, 0, 0x08, 0x00, 0xDFF0, 0, false}, {0, 0x20, 0, 0, 0, 0, 0x10, 0x00, 0xDFF0, 0, false}},
+        {{0x39}, {0, 0x00, 0, 0, 0, 0, 0x00, 0x01, 0x0FFF, 0, false}, {0, 0x20, 0, 0, 0, 0, 0x10, 0x00, 0x0FFF, 0, false}},
+    });
+}
+
+// The low nibble of F doesn't exist: POP AF drops it
+TEST(Lockstep, PopAfMasksF)
+{
+    expect_cases({
+        {{0xC5, 0xF1}, {0, 0x00, 0x12, 0xFF, 0, 0, 0, 0, 0xDFF0, 0, false}, {0x12, 0xF0, 0x12, 0xFF, 0, 0, 0, 0, 0xDFF0, 0, false}},
+        {{0xC5, 0xF1}, {0, 0xF0, 0xAB, 0x0F, 0, 0, 0, 0, 0xDFF0, 0, false}, {0xAB, 0x00, 0xAB, 0x0F, 0, 0, 0, 0, 0xDFF0, 0, false}},
+        {{0xD5, 0xF1}, {0, 0x00, 0, 0, 0x00, 0xA5, 0, 0, 0xDFF0, 0, false}, {0x00, 0xA0, 0, 0, 0x00, 0xA5, 0, 0, 0xDFF0, 0, false}},
+    });
+}
+
+// Conditional CALL and RET take 24/20 cycles when taken and 12/8 when not. Each program
+// repeats one instruction to the end of the frame, where PC shows how many ran.
+TEST(Lockstep, ConditionalCallAndRetCycles)
+{
+    struct Program
+    {
+        Data op;
+        Data f;
+        std::uint16_t sp;
+        std::size_t bytes;
+        std::size_t cycles;
+    };
+    constexpr std::array<Program, 8> PROGRAMS{{
+        {0xCC, 0x80, 0xE000, 3, 24}, // CALL Z taken, to the next instruction
+        {0xCC, 0x00, 0xE000, 3, 12}, // CALL Z not taken
+        {0xC4, 0x80, 0xE000, 3, 12}, // CALL NZ not taken
+        {0xCD, 0x00, 0xE000, 3, 24}, // CALL
+        {0xC8, 0x80, 0xC000, 1, 20}, // RET Z taken, to the next instruction
+        {0xC8, 0x00, 0xC000, 1, 8},  // RET Z not taken
+        {0xD0, 0x10, 0xC000, 1, 8},  // RET NC not taken
+        {0xC9, 0x00, 0xC000, 1, 16}, // RET
+    }};
+    for (const Program& program : PROGRAMS) {
+        std::vector<std::uint8_t> rom(0x8000);
+        for (std::size_t at = 0x100; at + program.bytes <= 0x7000; at += program.bytes) {
+            rom[at] = program.op;
+            if (program.bytes == 3) {
+                rom[at + 1] = static_cast<std::uint8_t>(at + 3);
+                rom[at + 2] = static_cast<std::uint8_t>((at + 3) >> 8);
+            }
+        }
+        const std::uint16_t expected = pc_after_frame(program.bytes, program.cycles);
+        for (const std::size_t min_group : {std::size_t{1}, Engine::LANES + 1}) {
+            const auto engine = std::make_unique<Engine>(rom, min_group);
+            for (std::size_t lane = 0; lane < Engine::LANES; ++lane) {
+                engine->registers(lane, {0, program.f, 0, 0, 0, 0, 0, 0, program.sp, 0x100, false});
+                // a stack of return addresses to the next RET
+                for (std::uint16_t i = 0; program.bytes == 1 && i < 0x1200; ++i) {
+                    engine->write(lane, static_cast<Addr>(program.sp + 2 * i), static_cast<Data>(0x101 + i));
+                    engine->write(lane, static_cast<Addr>(program.sp + 2 * i + 1), static_cast<Data>((0x101 + i) >> 8));
+                }
+            }
+            engine->run_frame();
+            for (std::size_t lane = 0; lane < Engine::LANES; ++lane)
+                ASSERT_EQ(engine->registers(lane).PC, expected)
+                    << std::hex << "op " << +program.op << " F " << +program.f << " min group " << min_group;
+        }
+    }
+}
@@ -0,0 +1,120 @@
+// APU::Mixer: SIMD kernels against Scalar, and AudioProcessor::read_channels() feeding
+// Mixer::process() with a planar buffer larger than one read.
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <APU/apu.hpp>
+#include <APU/mixer.hpp>
+
+#include "run.hpp"
+
+namespace
+{
+
+using namespace LR35902;
+using namespace LR35902::APU;
+
+// Blocks of varying length so the kernels' vector loops and scalar tails both run
+std::vector<StereoFrame<float>> mix(const MixerKernels kernels)
+{
+    std::mt19937 random{5};
+    Mixer<float> mixer{CHANNEL_RATE, 48000, kernels};
+    const auto ring = std::make_unique<AudioRing<float>>();
+    std::vector<StereoFrame<float>> out, sink(AudioRing<float>::CAPACITY);
+    for (std::size_t block = 0; block < 20; ++block) {
+        const std::size_t frames = 1000 + block * 13;
+        std::vector<std::int16_t> planar(8 * frames);
+        for (std::int16_t& sample : planar)
+            sample = static_cast<std::int16_t>(random());
+        mixer.process(planar, frames, *ring);
+        const std::size_t n = ring->try_pop(sink.data(), sink.size());
+        out.insert(out.end(), sink.begin(), sink.begin() + static_cast<std::ptrdiff_t>(n));
+    }
+    return out;
+}
+
+void check_kernels(const MixerKernels kernels)
+{
+    const auto expected = mix(mixer_kernels<Kernel::Scalar>());
+    const auto actual = mix(kernels);
+    ASSERT_EQ(expected.size(), actual.size());
+    ASSERT_GT(expected.size(), 10000u);
+    // summation order differs, so allow float rounding
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_NEAR(expected[i].left, actual[i].left, 1e-4f) << "frame " << i;
+        ASSERT_NEAR(expected[i].right, actual[i].right, 1e-4f) << "frame " << i;
+    }
+}
+
+} // namespace
+
+#if UTILITY_SIMD_X86
+
+TEST(MixerKernels, SSE2MatchesScalar)
+{
+    check_kernels(mixer_kernels<Kernel::SSE2>());
+}
+
+TEST(MixerKernels, AVX2MatchesScalar)
+{
+    if (!utility::cpu().avx2 || !utility::cpu().fma)
+        GTEST_SKIP() << "no AVX2/FMA";
+    check_kernels(mixer_kernels<Kernel::AVX2>());
+}
+
+#endif
+
+// CH2 panned hard left: every block read into an oversized buffer must keep the right side silent
+TEST(Mixer, ReadsTheBlocksReadChannelsWrote)
+{
+    Scheduler scheduler;
+    SystemState system{};
+    AudioProcessor apu{scheduler, system, CHANNEL_RATE, Output::Channels};
+    Mixer<float> mixer{CHANNEL_RATE, 48000};
+    const auto ring = std::make_unique<AudioRing<float>>();
+
+    system.io.write(0xFF26, 0x80); // power
+    system.io.write(0xFF24, 0x77); // full volume both sides
+    system.io.write(0xFF25, 0x20); // CH2 left only
+    system.io.write(0xFF17, 0xF0);
+    system.io.write(0xFF18, 0xD6);
+    system.io.write(0xFF19, 0x86); // trigger
+
+    std::vector<std::int16_t> planar(8 * 4096);
+    std::vector<StereoFrame<float>> sink(AudioRing<float>::CAPACITY);
+    float left = 0, right = 0;
+    std::size_t made = 0;
+    for (int frame = 0; frame < 30; ++frame) {
+        run_until(scheduler, scheduler.now() + 70224, [&](const Event event, const Cycle at) {
+            if (event == Event::DIV)
+                apu.on_event(at);
+        });
+        apu.end_frame();
+        const std::size_t n = apu.read_channels(planar, 4096);
+        ASSERT_LT(n, 4096u);
+        made += mixer.process(planar, n, *ring);
+        const std::size_t popped = ring->try_pop(sink.data(), sink.size());
+        for (std::size_t i = 0; i < popped; ++i) {
+            left = std::max(left, std::abs(sink[i].left));
+            right = std::max(right, std::abs(sink[i].right));
+        }
+    }
+    EXPECT_GT(made, 20000u);
+    EXPECT_GT(left, 0.05f);
+    EXPECT_EQ(right, 0.0f);
+}
+
+TEST(Mixer, RejectsAShortPlanarBuffer)
+{
+    Mixer<float> mixer{CHANNEL_RATE, 48000};
+    const auto ring = std::make_unique<AudioRing<float>>();
+    const std::vector<std::int16_t> planar(8 * 100 - 1, 1000);
+    EXPECT_EQ(mixer.process(planar, 100, *ring), 0u);
+    EXPECT_EQ(ring->try_pop(), std::nullopt);
+}
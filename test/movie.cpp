@@ -0,0 +1,153 @@
+// Movie: encode/decode round trips, rejection of damaged files, and replays that must
+// reproduce the recorded state hashes.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <joypad.hpp>
+#include <movie.hpp>
+#include <timer.hpp>
+
+#include "run.hpp"
+
+namespace
+{
+
+using namespace LR35902;
+
+// Stand-in for a game: polls the joypad four times a frame and folds it and TIMA into RAM
+struct Machine
+{
+    Scheduler scheduler;
+    SystemState state{};
+    Interrupts interrupts{scheduler};
+    Joypad joypad{interrupts, state};
+    Timer timer{scheduler, interrupts, state};
+    std::array<std::uint8_t, 256> ram{};
+
+    Machine()
+    {
+        interrupts.write(0xFFFF, 0x1F);
+        state.io.write(0xFF07, 0x05);
+    }
+
+    void run_frame()
+    {
+        for (int quarter = 0; quarter < 4; ++quarter) {
+            run_until(scheduler, scheduler.now() + Movie::FRAME_CYCLES / 4, [this](const Event event, const Cycle at) {
+                if (event == Event::Timer)
+                    timer.on_event(at);
+                if (event == Event::Interrupt)
+                    interrupts.write(0xFF0F, 0);
+            });
+            state.io.write(0xFF00, 0x20);
+            const Data dpad = state.io.read(0xFF00);
+            state.io.write(0xFF00, 0x10);
+            const Data buttons = state.io.read(0xFF00);
+            state.io.write(0xFF00, 0x30);
+            const Data tima = state.io.read(0xFF05);
+            ram[(dpad * 7 + buttons + quarter) & 0xFF] += tima ^ dpad;
+            ram[tima] ^= buttons;
+        }
+    }
+
+    [[nodiscard]] std::uint64_t hash() const { return Movie::state_hash(std::as_bytes(std::span{ram})); }
+};
+
+class MovieTest : public ::testing::Test
+{
+protected:
+    static constexpr int FRAMES = 5000;
+
+    void SetUp() override
+    {
+        m_rom[0x14E] = 0xBE;
+        m_rom[0x14F] = 0xEF;
+        m_movie = Movie::Recording{Movie::Header{Movie::global_checksum(m_rom), Movie::Start::PowerOn, 0, 60}};
+        std::mt19937 random{1};
+        Machine machine;
+        Movie::Player player{machine.joypad};
+        Data buttons = 0;
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            if (random() % 8 == 0)
+                buttons = static_cast<Data>(random());
+            player.record(m_movie, buttons, [&] { machine.run_frame(); }, [&] { return machine.hash(); });
+        }
+    }
+
+    Movie::Player::Result replay(const Movie::Recording& movie)
+    {
+        Machine machine;
+        Movie::Player player{machine.joypad};
+        return player.play(movie, [&] { machine.run_frame(); }, [&] { return machine.hash(); });
+    }
+
+    std::array<std::uint8_t, 0x150> m_rom{};
+    Movie::Recording m_movie;
+};
+
+} // namespace
+
+TEST_F(MovieTest, RoundTripsAndReplays)
+{
+    ASSERT_EQ(m_movie.frames(), static_cast<std::uint64_t>(FRAMES));
+    ASSERT_EQ(m_movie.hashes().size(), static_cast<std::size_t>(FRAMES / 60));
+    const std::vector<std::byte> bytes = m_movie.encode();
+    EXPECT_LT(bytes.size(), static_cast<std::size_t>(FRAMES)); // under a byte per frame
+
+    Movie::Recording decoded;
+    ASSERT_EQ(Movie::Recording::decode(bytes, decoded), Movie::Error::None);
+    EXPECT_TRUE(decoded.for_rom(m_rom));
+    EXPECT_EQ(decoded.encode(), bytes);
+
+    const Movie::Player::Result result = replay(decoded);
+    EXPECT_FALSE(result.desynced);
+    EXPECT_EQ(result.frames, static_cast<std::uint64_t>(FRAMES));
+}
+
+TEST_F(MovieTest, ChangedInputDesyncs)
+{
+    // flip one button for the run in the middle of the movie
+    Movie::Recording changed{m_movie.header()};
+    const std::size_t middle = m_movie.runs().size() / 2;
+    for (std::size_t index = 0; index < m_movie.runs().size(); ++index) {
+        const Movie::Run& run = m_movie.runs()[index];
+        for (std::uint32_t frame = 0; frame < run.frames; ++frame)
+            changed.record(index == middle ? static_cast<Data>(run.buttons ^ 0x01) : run.buttons);
+    }
+    for (const std::uint64_t hash : m_movie.hashes())
+        changed.hash(hash);
+
+    const Movie::Player::Result result = replay(changed);
+    EXPECT_TRUE(result.desynced);
+    EXPECT_LT(result.frames, static_cast<std::uint64_t>(FRAMES));
+}
+
+TEST_F(MovieTest, RejectsDamagedFiles)
+{
+    const std::vector<std::byte> bytes = m_movie.encode();
+    for (std::size_t cut = 0; cut < bytes.size(); cut += 1 + cut / 3) {
+        Movie::Recording movie;
+        EXPECT_NE(Movie::Recording::decode(std::span{bytes}.first(cut), movie), Movie::Error::None) << "cut at " << cut;
+    }
+
+    // bit flips must be rejected or decode to something, never read out of bounds
+    std::mt19937 random{2};
+    for (int i = 0; i < 2000; ++i) {
+        std::vector<std::byte> flipped = bytes;
+        flipped[random() % flipped.size()] ^= std::byte{static_cast<unsigned char>(1u << (random() % 8))};
+        Movie::Recording movie;
+        (void)Movie::Recording::decode(flipped, movie);
+    }
+
+    // a movie for another ROM
+    Movie::Recording movie;
+    ASSERT_EQ(Movie::Recording::decode(bytes, movie), Movie::Error::None);
+    EXPECT_FALSE(movie.for_rom(std::array<std::uint8_t, 0x150>{}));
+}
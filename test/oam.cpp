@@ -0,0 +1,89 @@
+// MMU::ObjectAttributeMemory: the per-line object index against a full OAM scan
+// (PPU::select_objects) after random writes, OAM DMAs and both object heights.
+
+#include <array>
+#include <cstddef>
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include <MMU/Oam.hpp>
+
+namespace
+{
+
+using namespace LR35902;
+using Oam = MMU::ObjectAttributeMemory;
+
+// Mostly Y bytes, around and across the visible lines, so objects keep moving between lines
+void random_write(std::mt19937& random, Oam& oam)
+{
+    const std::size_t index = random() % PPU::OBJ_COUNT;
+    const std::size_t byte = random() % 2 ? 0 : random() % 4;
+    const Data data = static_cast<Data>(byte == 0 ? random() % (PPU::HEIGHT + 32) : random());
+    oam.write(static_cast<Addr>(0xFE00 + index * 4 + byte), data);
+}
+
+// Many objects bunched on a few lines, so the 10 object limit matters
+void random_dma(std::mt19937& random, Oam& oam)
+{
+    std::array<Data, Oam::SIZE> source;
+    const Data center = static_cast<Data>(random() % (PPU::HEIGHT + 16));
+    for (std::size_t offset = 0; offset < source.size(); ++offset)
+        source[offset] = static_cast<Data>(offset % 4 == 0 ? center + random() % 24 : random());
+    oam.dma(source);
+}
+
+void expect_scan(const Oam& oam, const bool tall, const int step)
+{
+    for (std::size_t ly = 0; ly < PPU::HEIGHT; ++ly) {
+        const PPU::LineObjects expected = PPU::select_objects(oam.data(), static_cast<Data>(ly), tall);
+        const PPU::LineObjects actual = oam.select(static_cast<Data>(ly), tall);
+        ASSERT_EQ(actual.count, expected.count) << "step " << step << " line " << ly << " tall " << tall;
+        for (std::size_t i = 0; i < expected.count; ++i) {
+            const PPU::Object& a = actual.objects[i];
+            const PPU::Object& e = expected.objects[i];
+            ASSERT_EQ(a.index, e.index) << "step " << step << " line " << ly << " slot " << i;
+            ASSERT_EQ(a.y, e.y);
+            ASSERT_EQ(a.x, e.x);
+            ASSERT_EQ(a.tile, e.tile);
+            ASSERT_EQ(a.attr, e.attr);
+        }
+    }
+}
+
+} // namespace
+
+TEST(Oam, SelectMatchesTheFullScan)
+{
+    std::mt19937 random{9};
+    Oam oam;
+    bool tall = false;
+    for (int step = 0; step < 5000; ++step) {
+        if (random() % 64 == 0)
+            random_dma(random, oam);
+        else
+            random_write(random, oam);
+        if (random() % 16 == 0)
+            tall = !tall; // LCDC.2 toggled between lines
+        expect_scan(oam, tall, step);
+        if (::testing::Test::HasFatalFailure())
+            return;
+    }
+}
+
+// Both heights are kept current at once, whichever one LCDC selects
+TEST(Oam, BothHeightsAfterWrites)
+{
+    Oam oam;
+    oam.write(0xFE00, 16 + 5); // object 0 on lines 5-12, or 5-20 when tall
+    oam.write(0xFE04, 16 + 10);
+    EXPECT_EQ(oam.select(12, false).count, 2u);
+    EXPECT_EQ(oam.select(13, false).count, 1u);
+    EXPECT_EQ(oam.select(20, true).count, 2u);
+    EXPECT_EQ(oam.select(21, true).count, 1u);
+
+    oam.write(0xFE00, 0); // off screen
+    EXPECT_EQ(oam.select(5, true).count, 0u);
+    EXPECT_EQ(oam.select(PPU::HEIGHT, true).count, 0u);
+}
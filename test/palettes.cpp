@@ -0,0 +1,158 @@
+// PPU::ColorPalettes: BGPI/OBPI auto-increment and wraparound, BGPD/OBPD readback, the
+// converted LUTs and resolve() (the AVX2 gather where the CPU has it) against plain lookups.
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+#include <PPU/palettes.hpp>
+
+namespace
+{
+
+using namespace LR35902;
+using namespace LR35902::PPU;
+
+constexpr Addr BGPI = 0xFF68;
+constexpr Addr BGPD = 0xFF69;
+constexpr Addr OBPI = 0xFF6A;
+constexpr Addr OBPD = 0xFF6B;
+
+std::array<Data, 4> bytes(const std::uint32_t rgba)
+{
+    std::array<Data, 4> out;
+    std::memcpy(out.data(), &rgba, 4);
+    return out;
+}
+
+} // namespace
+
+TEST(ColorPalettes, AutoIncrementWrapsAround)
+{
+    for (const auto [index, data] : {std::pair{BGPI, BGPD}, std::pair{OBPI, OBPD}}) {
+        IO::RegisterBank io;
+        ColorPalettes palettes{io};
+
+        io.write(index, 0x80 | 0x3E); // auto-increment from byte 62
+        io.write(data, 0x11);
+        EXPECT_EQ(io.read(index) & 0x3F, 0x3F);
+        io.write(data, 0x22);
+        EXPECT_EQ(io.read(index) & 0x3F, 0x00); // wrapped
+        EXPECT_EQ(io.read(index) & 0x80, 0x80);
+        io.write(data, 0x33);
+        EXPECT_EQ(io.read(index) & 0x3F, 0x01);
+
+        // without auto-increment the index stays
+        io.write(index, 0x3E);
+        EXPECT_EQ(io.read(data), 0x11);
+        io.write(data, 0x44);
+        EXPECT_EQ(io.read(index) & 0x3F, 0x3E);
+        EXPECT_EQ(io.read(data), 0x44);
+
+        io.write(index, 0x3F);
+        EXPECT_EQ(io.read(data), 0x22);
+        io.write(index, 0x00);
+        EXPECT_EQ(io.read(data), 0x33);
+    }
+}
+
+// Every byte reads back through BGPD/OBPD after a run of auto-incremented writes, and the
+// BG and OBJ palette RAMs are separate
+TEST(ColorPalettes, DataReadsBack)
+{
+    std::mt19937 random{11};
+    IO::RegisterBank io;
+    ColorPalettes palettes{io};
+    std::array<Data, 64> bg, obj;
+    for (std::size_t i = 0; i < 64; ++i) {
+        bg[i] = static_cast<Data>(random());
+        obj[i] = static_cast<Data>(random());
+    }
+
+    io.write(BGPI, 0x80);
+    io.write(OBPI, 0x80);
+    for (std::size_t i = 0; i < 64; ++i) {
+        io.write(BGPD, bg[i]);
+        io.write(OBPD, obj[i]);
+    }
+    for (std::size_t i = 0; i < 64; ++i) {
+        io.write(BGPI, static_cast<Data>(i));
+        io.write(OBPI, static_cast<Data>(i));
+        EXPECT_EQ(io.read(BGPD), bg[i]) << "byte " << i;
+        EXPECT_EQ(io.read(OBPD), obj[i]) << "byte " << i;
+    }
+
+    // each entry is two little endian bytes, 0bbbbbgg gggrrrrr
+    for (std::size_t entry = 0; entry < ColorPalettes::ENTRIES; ++entry) {
+        const std::array<Data, 64>& ram = entry < ColorPalettes::OBJ_BASE ? bg : obj;
+        const std::size_t byte = (entry % ColorPalettes::OBJ_BASE) * 2;
+        const unsigned color = ram[byte] | ram[byte + 1] << 8;
+        const unsigned r = color & 0x1F, g = (color >> 5) & 0x1F, b = (color >> 10) & 0x1F;
+        const std::array<Data, 4> rgba = bytes(palettes.rgba()[entry]);
+        EXPECT_EQ(rgba[0], r << 3 | r >> 2) << "entry " << entry;
+        EXPECT_EQ(rgba[1], g << 3 | g >> 2) << "entry " << entry;
+        EXPECT_EQ(rgba[2], b << 3 | b >> 2) << "entry " << entry;
+        EXPECT_EQ(rgba[3], 0xFF);
+    }
+}
+
+// The white palette RAM after power on, and pure channels with and without correction
+TEST(ColorPalettes, Conversion)
+{
+    IO::RegisterBank io;
+    ColorPalettes palettes{io};
+    EXPECT_EQ(bytes(palettes.rgba()[63]), (std::array<Data, 4>{0xFF, 0xFF, 0xFF, 0xFF}));
+    EXPECT_EQ(palettes.rgb565()[0], 0xFFFF);
+    EXPECT_EQ(palettes.gray()[0], 0xFF);
+
+    io.write(BGPI, 0x80);
+    io.write(BGPD, 0x1F); // red
+    io.write(BGPD, 0x00);
+    EXPECT_EQ(bytes(palettes.rgba()[0]), (std::array<Data, 4>{0xFF, 0x00, 0x00, 0xFF}));
+    EXPECT_EQ(palettes.rgb565()[0], 0xF800);
+
+    palettes.correction(true);
+    const std::array<Data, 4> corrected = bytes(palettes.rgba()[0]);
+    EXPECT_LT(corrected[0], 0xFF);
+    EXPECT_EQ(corrected[1], 0x00);
+    EXPECT_GT(corrected[2], 0x00); // red bleeds into blue on the CGB LCD
+}
+
+// Every length up to a line so the 8 pixel gather loop and its scalar tail both run, with
+// index bits above the 64 entries that must be masked off
+TEST(ColorPalettes, ResolveMatchesTheLuts)
+{
+    std::mt19937 random{12};
+    IO::RegisterBank io;
+    ColorPalettes palettes{io};
+    io.write(BGPI, 0x80);
+    io.write(OBPI, 0x80);
+    for (std::size_t i = 0; i < 64; ++i) {
+        io.write(BGPD, static_cast<Data>(random()));
+        io.write(OBPD, static_cast<Data>(random()));
+    }
+
+    std::array<Data, WIDTH + 8> index;
+    for (Data& i : index)
+        i = static_cast<Data>(random());
+    for (const std::size_t offset : {std::size_t{0}, std::size_t{3}}) {
+        for (std::size_t n = 0; n <= WIDTH; ++n) {
+            std::array<std::uint32_t, WIDTH> rgba{};
+            std::array<std::uint16_t, WIDTH> rgb565{};
+            std::array<Data, WIDTH> gray{};
+            palettes.resolve(index.data() + offset, n, rgba.data());
+            palettes.resolve(index.data() + offset, n, rgb565.data());
+            palettes.resolve(index.data() + offset, n, gray.data());
+            for (std::size_t i = 0; i < WIDTH; ++i) {
+                const std::size_t entry = index[offset + i] & (ColorPalettes::ENTRIES - 1);
+                ASSERT_EQ(rgba[i], i < n ? palettes.rgba()[entry] : 0u) << n << " pixels, " << i;
+                ASSERT_EQ(rgb565[i], i < n ? palettes.rgb565()[entry] : 0u) << n << " pixels, " << i;
+                ASSERT_EQ(gray[i], i < n ? palettes.gray()[entry] : 0u) << n << " pixels, " << i;
+            }
+        }
+    }
+}
@@ -0,0 +1,132 @@
+// The SIMD line kernels and the Scanline renderers built on them against the scalar
+// kernel and Reference::render, pixel for pixel.
+
+#include <array>
+#include <cstdint>
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include <PPU/kernels.hpp>
+#include <PPU/scanline.hpp>
+
+namespace
+{
+
+using namespace LR35902;
+using namespace LR35902::PPU;
+
+constexpr std::size_t TILES = 24; // more than a row, every SIMD tail length
+
+template<typename KernelT>
+void check_kernel(std::mt19937& random)
+{
+    std::array<Data, TILES> lo, hi;
+    for (std::size_t t = 0; t < TILES; ++t) {
+        lo[t] = static_cast<Data>(random());
+        hi[t] = static_cast<Data>(random());
+    }
+    for (std::size_t tiles = 0; tiles <= TILES; ++tiles) {
+        std::array<Data, TILES * 8> expected{}, actual{};
+        Kernel::Scalar::decode(lo.data(), hi.data(), tiles, expected.data());
+        KernelT::decode(lo.data(), hi.data(), tiles, actual.data());
+        ASSERT_EQ(expected, actual) << tiles << " tiles";
+    }
+
+    std::array<Data, WIDTH> index, src, mask;
+    for (std::size_t i = 0; i < WIDTH; ++i) {
+        index[i] = static_cast<Data>(random() & 0b11);
+        src[i] = static_cast<Data>(random());
+        mask[i] = random() & 1 ? 0xFF : 0x00;
+    }
+    for (unsigned bgp = 0; bgp < 256; ++bgp) {
+        for (const std::size_t n : {std::size_t{0}, std::size_t{1}, std::size_t{31}, std::size_t{33}, WIDTH}) {
+            Line expected{}, actual{};
+            Kernel::Scalar::palette(index.data(), n, static_cast<Data>(bgp), expected.data());
+            KernelT::palette(index.data(), n, static_cast<Data>(bgp), actual.data());
+            ASSERT_EQ(expected, actual) << "bgp " << bgp << ", " << n << " pixels";
+        }
+    }
+    for (const std::size_t n : {std::size_t{0}, std::size_t{15}, std::size_t{17}, WIDTH}) {
+        Line expected, actual;
+        for (std::size_t i = 0; i < WIDTH; ++i)
+            expected[i] = actual[i] = static_cast<Data>(random());
+        Kernel::Scalar::blend(expected.data(), src.data(), mask.data(), n);
+        KernelT::blend(actual.data(), src.data(), mask.data(), n);
+        ASSERT_EQ(expected, actual) << n << " pixels";
+    }
+}
+
+// Random VRAM, OAM and registers; objects are placed around the line so they show up
+struct Frame
+{
+    explicit Frame(std::mt19937& random)
+    {
+        for (Data& byte : vram)
+            byte = static_cast<Data>(random());
+        regs = LineRegisters{
+            .LCDC = static_cast<Data>(random()),
+            .SCY = static_cast<Data>(random()),
+            .SCX = static_cast<Data>(random()),
+            .LY = static_cast<Data>(random() % HEIGHT),
+            .WY = static_cast<Data>(random() % HEIGHT),
+            .WX = static_cast<Data>(random() % 170),
+            .BGP = static_cast<Data>(random()),
+            .OBP0 = static_cast<Data>(random()),
+            .OBP1 = static_cast<Data>(random()),
+            .window_line = 0,
+        };
+        regs.window_line = static_cast<Data>(random() % (regs.LY + 1));
+        for (std::size_t i = 0; i < oam.size(); i += 4) {
+            oam[i] = static_cast<Data>(regs.LY + 16 - random() % 16);
+            oam[i + 1] = static_cast<Data>(random() % (WIDTH + 8));
+            oam[i + 2] = static_cast<Data>(random());
+            oam[i + 3] = static_cast<Data>(random());
+        }
+    }
+
+    std::array<Data, 0x2000> vram;
+    std::array<Data, 0xA0> oam;
+    LineRegisters regs;
+};
+
+template<typename KernelT>
+void check_scanline(std::mt19937& random)
+{
+    for (int i = 0; i < 2000; ++i) {
+        const Frame frame{random};
+        Line expected, actual;
+        Reference::render(frame.vram, frame.oam, frame.regs, expected);
+        Scanline<KernelT>::render(frame.vram, frame.oam, frame.regs, actual);
+        ASSERT_EQ(expected, actual) << "frame " << i << ", LCDC " << int{frame.regs.LCDC} << ", SCX "
+            << int{frame.regs.SCX} << ", WX " << int{frame.regs.WX};
+    }
+}
+
+} // namespace
+
+TEST(PPUKernels, ScalarMatchesReference)
+{
+    std::mt19937 random{1};
+    check_scanline<Kernel::Scalar>(random);
+}
+
+#if UTILITY_SIMD_X86
+
+TEST(PPUKernels, SSE2MatchesScalar)
+{
+    std::mt19937 random{2};
+    check_kernel<Kernel::SSE2>(random);
+    check_scanline<Kernel::SSE2>(random);
+}
+
+TEST(PPUKernels, AVX2MatchesScalar)
+{
+    if (!utility::cpu().avx2)
+        GTEST_SKIP() << "no AVX2 on this host";
+    std::mt19937 random{3};
+    check_kernel<Kernel::AVX2>(random);
+    check_scanline<Kernel::AVX2>(random);
+}
+
+#endif
@@ -0,0 +1,116 @@
+// PPU::RenderThread: frames drawn on the render thread against the same frames drawn on
+// the emulation thread, with VRAM and OAM changing between lines.
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include <PPU/ppu.hpp>
+
+namespace
+{
+
+using namespace LR35902;
+using namespace LR35902::PPU;
+
+struct System
+{
+    Scheduler scheduler;
+    Interrupts interrupts{scheduler};
+    SystemState state{};
+    std::unique_ptr<PixelProcessor::Vram> vram = std::make_unique<PixelProcessor::Vram>();
+    PixelProcessor::Oam oam{};
+    FrameBuffers output;
+    std::unique_ptr<PixelProcessor> ppu = std::make_unique<PixelProcessor>(scheduler, interrupts, state, *vram, oam, output);
+
+    void lcd_on()
+    {
+        state.io.write(0xFF47, 0xE4);
+        state.io.write(0xFF48, 0xD2);
+        state.io.write(0xFF40, 0x93);
+    }
+
+    void step(const Cycle until)
+    {
+        scheduler.advance(until - scheduler.now());
+        scheduler.fire([this](const Event event, const Cycle at) {
+            if (event == Event::PPU)
+                ppu->on_event(at);
+            else
+                interrupts.acknowledge(interrupts.highest());
+        });
+    }
+};
+
+} // namespace
+
+// Only the VRAM/OAM writes themselves reach the thread, nothing forwards them by hand
+TEST(RenderThread, MatchesTheEmulationThread)
+{
+    System local, offloaded;
+    RenderThread thread{offloaded.output};
+    offloaded.ppu->offload(&thread);
+    local.lcd_on();
+    offloaded.lcd_on();
+
+    std::mt19937 random{3};
+    std::array<Data, PixelProcessor::Oam::SIZE> dma{};
+    std::size_t compared = 0;
+    while (local.scheduler.now() < 100 * 70224ull) {
+        const Cycle next = local.scheduler.next();
+        const std::uint64_t frames = local.ppu->frames();
+        local.step(next);
+        offloaded.step(next);
+
+        if (local.ppu->frames() != frames) {
+            thread.flush();
+            const FrameView expected = local.output.acquire();
+            const FrameView actual = offloaded.output.acquire();
+            ASSERT_EQ(expected.number, actual.number);
+            ASSERT_EQ(std::memcmp(expected.pixels.data(), actual.pixels.data(), expected.pixels.size()), 0)
+                << "frame " << expected.number;
+            ++compared;
+
+            for (Data& byte : dma)
+                byte = static_cast<Data>(random());
+            local.oam.dma(dma);
+            offloaded.oam.dma(dma);
+        }
+        if (local.ppu->mode() == Mode::HBlank) {
+            for (int i = 0; i < 20; ++i) {
+                const Addr addr = static_cast<Addr>(0x8000 + random() % 0x2000);
+                const Data data = static_cast<Data>(random());
+                local.vram->write(addr, data);
+                offloaded.vram->write(addr, data);
+                const Addr object = static_cast<Addr>(0xFE00 + random() % 0xA0);
+                const Data value = static_cast<Data>(random());
+                local.oam.write(object, value);
+                offloaded.oam.write(object, value);
+            }
+        }
+    }
+    EXPECT_GT(compared, 90u);
+}
+
+// Records submitted right before the thread is destroyed are still drawn
+TEST(RenderThread, DrawsEverythingSubmittedBeforeStop)
+{
+    for (int run = 0; run < 200; ++run) {
+        FrameBuffers output;
+        {
+            RenderThread thread{output};
+            LineRegisters regs{};
+            regs.LCDC = 0x91;
+            regs.BGP = 0xE4;
+            for (Data ly = 0; ly < HEIGHT; ++ly) {
+                regs.LY = ly;
+                thread.line(regs);
+            }
+        }
+        ASSERT_TRUE(output.fresh()) << "run " << run;
+    }
+}
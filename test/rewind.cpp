@@ -0,0 +1,151 @@
+// Rewind: the delta kernels against Scalar, and rewinding to exactly the recorded
+// snapshots, including after the budget forced old keyframes out.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <rewind.hpp>
+
+namespace
+{
+
+using namespace LR35902;
+
+// Buffers that differ in runs of every length around MIN_RUN and the vector widths
+template<typename KernelT>
+void check_kernel()
+{
+    std::mt19937 random{6};
+    std::vector<std::byte> a(300), b(300);
+    for (int trial = 0; trial < 20000; ++trial) {
+        for (std::size_t i = 0; i < a.size(); ++i)
+            a[i] = b[i] = static_cast<std::byte>(random());
+        const unsigned changes = random() % 12;
+        for (unsigned c = 0; c < changes; ++c) {
+            const std::size_t at = random() % b.size();
+            const std::size_t length = std::min<std::size_t>(random() % 40, b.size() - at);
+            for (std::size_t i = at; i < at + length; ++i)
+                if (random() % 4)
+                    b[i] ^= static_cast<std::byte>(1 + random() % 255);
+        }
+        const std::size_t offset = random() % 40;
+        const std::size_t n = random() % (a.size() - offset + 1);
+        ASSERT_EQ(KernelT::same(a.data() + offset, b.data() + offset, n), Delta::Kernel::Scalar::same(a.data() + offset, b.data() + offset, n))
+            << "trial " << trial;
+        ASSERT_EQ(KernelT::differ(a.data() + offset, b.data() + offset, n), Delta::Kernel::Scalar::differ(a.data() + offset, b.data() + offset, n))
+            << "trial " << trial;
+    }
+}
+
+// A machine stand-in: a few KB of state, a small working set changes every frame
+struct State
+{
+    std::array<std::byte, 16384> bytes{};
+    StateLayout layout;
+    std::mt19937 random{3};
+
+    State()
+    {
+        layout.region(bytes);
+        for (std::byte& byte : bytes)
+            byte = static_cast<std::byte>(random());
+    }
+
+    void frame()
+    {
+        for (int i = 0; i < 40; ++i)
+            bytes[0x3000 + random() % 512] = static_cast<std::byte>(random());
+        bytes[random() % bytes.size()] = static_cast<std::byte>(random());
+    }
+};
+
+} // namespace
+
+TEST(RewindKernels, ScalarFindsRuns)
+{
+    const std::array<std::byte, 8> a{}, b{std::byte{1}, std::byte{0}, std::byte{0}, std::byte{2}};
+    EXPECT_EQ(Delta::Kernel::Scalar::same(a.data(), b.data(), 8), 0u);
+    EXPECT_EQ(Delta::Kernel::Scalar::same(a.data() + 1, b.data() + 1, 7), 2u);
+    // equal runs shorter than MIN_RUN stay inside the changed bytes
+    EXPECT_EQ(Delta::Kernel::Scalar::differ(a.data(), b.data(), 8), 4u);
+}
+
+#if UTILITY_SIMD_X86
+
+TEST(RewindKernels, SSE2MatchesScalar)
+{
+    check_kernel<Delta::Kernel::SSE2>();
+}
+
+TEST(RewindKernels, AVX2MatchesScalar)
+{
+    if (!utility::cpu().avx2)
+        GTEST_SKIP() << "no AVX2";
+    check_kernel<Delta::Kernel::AVX2>();
+}
+
+#endif
+
+TEST(Rewind, RestoresRecordedFramesExactly)
+{
+    State state;
+    Rewind rewind{state.layout};
+    std::vector<std::vector<std::byte>> recorded;
+    for (int frame = 0; frame < 600; ++frame) {
+        state.frame();
+        rewind.record();
+        recorded.push_back(state.layout.save_state());
+    }
+    EXPECT_EQ(rewind.frames(), recorded.size() - 1);
+
+    std::mt19937 random{4};
+    for (int trial = 0; trial < 50; ++trial) {
+        const std::size_t distance = random() % std::min<std::size_t>(30, rewind.frames() + 1);
+        ASSERT_TRUE(rewind.rewind(distance));
+        recorded.resize(recorded.size() - distance);
+        ASSERT_EQ(state.layout.save_state(), recorded.back()) << "trial " << trial;
+        for (unsigned frame = 0; frame < random() % 5; ++frame) {
+            state.frame();
+            rewind.record();
+            recorded.push_back(state.layout.save_state());
+        }
+    }
+
+    const std::size_t all = rewind.frames();
+    ASSERT_TRUE(rewind.rewind(all));
+    recorded.resize(recorded.size() - all);
+    EXPECT_EQ(state.layout.save_state(), recorded.back());
+}
+
+TEST(Rewind, DropsOldestGroupsWhenFull)
+{
+    State state;
+    Rewind rewind{state.layout, 64 << 10, 60};
+    for (int frame = 0; frame < 500; ++frame) {
+        state.frame();
+        rewind.record();
+    }
+    EXPECT_LE(rewind.used(), std::size_t{64 << 10});
+    EXPECT_LT(rewind.frames(), 499u);
+
+    const std::vector<std::byte> latest = state.layout.save_state();
+    ASSERT_TRUE(rewind.rewind(0));
+    EXPECT_EQ(state.layout.save_state(), latest);
+    EXPECT_TRUE(rewind.rewind(rewind.frames()));
+    EXPECT_FALSE(rewind.rewind(rewind.frames() + 1));
+}
+
+TEST(Rewind, RecordLargerThanTheBudgetIsSkipped)
+{
+    State state;
+    Rewind rewind{state.layout, 1000, 60};
+    rewind.record();
+    EXPECT_EQ(rewind.used(), 0u);
+    EXPECT_FALSE(rewind.rewind(0));
+}
@@ -0,0 +1,25 @@
+// Runs a Scheduler without a CPU: a CPU stub that is always halted makes
+// Scheduler::run_until jump from deadline to deadline, as the real loop does during HALT.
+
+#pragma once
+
+#include <scheduler.hpp>
+
+namespace LR35902
+{
+
+struct HaltedCpu
+{
+    [[nodiscard]] constexpr bool halted() const noexcept { return true; }
+    [[nodiscard]] constexpr Cycle step() const noexcept { return 0; } // never called
+};
+
+// Fires every event due up to `end` through dispatch(Event, Cycle deadline)
+template<typename Dispatch>
+constexpr void run_until(Scheduler& scheduler, const Cycle end, Dispatch&& dispatch)
+{
+    HaltedCpu cpu;
+    scheduler.run_until(end, cpu, dispatch);
+}
+
+} // namespace LR35902
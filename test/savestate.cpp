@@ -0,0 +1,193 @@
+// StateLayout: a machine restored from a snapshot must continue byte for byte like the
+// original, and two machines in the same state must save the same bytes however their
+// memory was initialised (no padding in any region).
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <random>
+#include <span>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <savestate.hpp>
+#include <timer.hpp>
+#include <joypad.hpp>
+#include <serial.hpp>
+#include <PPU/ppu.hpp>
+#include <PPU/palettes.hpp>
+#include <APU/apu.hpp>
+
+#include "run.hpp"
+
+namespace
+{
+
+using namespace LR35902;
+
+struct Machine
+{
+    Scheduler scheduler;
+    SystemState state{};
+    Interrupts interrupts{scheduler};
+    Timer timer{scheduler, interrupts, state};
+    Joypad joypad{interrupts, state};
+    Serial serial{scheduler, interrupts, state};
+    PPU::PixelProcessor::Vram vram;
+    MMU::ObjectAttributeMemory oam;
+    PPU::ColorPalettes palettes{state.io};
+    PPU::FrameBuffers output{};
+    PPU::PixelProcessor ppu{scheduler, interrupts, state, vram, oam, output};
+    APU::AudioProcessor apu{scheduler, state, 48000};
+    std::array<Data, 256> wram{};
+    StateLayout layout;
+
+    Machine()
+    {
+        scheduler.describe(layout);
+        state.io.describe(layout);
+        interrupts.describe(layout);
+        vram.describe(layout);
+        oam.describe(layout);
+        palettes.describe(layout);
+        timer.describe(layout);
+        joypad.describe(layout);
+        serial.describe(layout);
+        ppu.describe(layout);
+        apu.describe(layout);
+        layout.region(wram);
+        interrupts.write(0xFFFF, 0x1F);
+    }
+
+    void run_to(const Cycle end)
+    {
+        run_until(scheduler, end, [this](const Event event, const Cycle at) {
+            switch (event) {
+            case Event::Timer:  timer.on_event(at); break;
+            case Event::PPU:    ppu.on_event(at); break;
+            case Event::DIV:    apu.on_event(at); break;
+            case Event::Serial: serial.on_event(at); break;
+            case Event::Interrupt:
+                if (interrupts.pending()) {
+                    const Interrupt interrupt = interrupts.highest();
+                    ++wram[0x80 + static_cast<int>(interrupt)];
+                    interrupts.acknowledge(interrupt);
+                }
+                break;
+            default: break;
+            }
+        });
+    }
+
+    // Some time, then one random write of the kind a game does
+    void step(std::mt19937& random)
+    {
+        run_to(scheduler.now() + random() % 3000);
+        Data value = static_cast<Data>(random());
+        switch (random() % 10) {
+        case 0: {
+            static constexpr Addr TIMER[] = {0xFF04, 0xFF05, 0xFF06, 0xFF07};
+            state.io.write(TIMER[random() % 4], value);
+            break;
+        }
+        case 1: {
+            // NR52 mostly on, power cycles reset whole channels
+            const Addr addr = static_cast<Addr>(0xFF10 + random() % 0x16);
+            if (addr == 0xFF26)
+                value = random() % 6 ? 0x80 : 0x00;
+            state.io.write(addr, value);
+            break;
+        }
+        case 2: {
+            static constexpr Addr LCD[] = {0xFF40, 0xFF41, 0xFF42, 0xFF43, 0xFF45, 0xFF47, 0xFF4A, 0xFF4B};
+            const Addr addr = LCD[random() % 8];
+            state.io.write(addr, addr == 0xFF40 ? static_cast<Data>(value | 0x80) : value);
+            break;
+        }
+        case 3: vram.write(static_cast<Addr>(0x8000 + random() % 0x2000), value); break;
+        case 4: oam.write(static_cast<Addr>(0xFE00 + random() % 0xA0), value); break;
+        case 5: joypad.buttons(value); break;
+        case 6: state.io.write(0xFF01, value); state.io.write(0xFF02, 0x81); break;
+        case 7: state.io.write(0xFF68, static_cast<Data>(random() % 0x80 | 0x80)); state.io.write(0xFF69, value); break;
+        default:
+            wram[value] ^= static_cast<Data>(state.io.read(0xFF04) + state.io.read(0xFF05) * 3 + state.io.read(0xFF26) * 5
+                + state.io.read(0xFF41) * 7 + state.io.read(0xFF44) + state.io.read(0xFF00));
+            break;
+        }
+    }
+};
+
+// A Machine built in memory filled with `fill`, so padding would hold that byte
+struct Garbage
+{
+    explicit Garbage(const unsigned char fill)
+    : storage{new (std::align_val_t{alignof(Machine)}) std::byte[sizeof(Machine)]}
+    {
+        std::memset(storage, fill, sizeof(Machine));
+        machine = new (storage) Machine;
+    }
+    ~Garbage()
+    {
+        machine->~Machine();
+        ::operator delete[](storage, std::align_val_t{alignof(Machine)});
+    }
+    Garbage(const Garbage&) = delete;
+    Garbage& operator=(const Garbage&) = delete;
+
+    std::byte* storage;
+    Machine* machine;
+};
+
+} // namespace
+
+TEST(SaveState, RestoredMachineContinuesIdentically)
+{
+    for (unsigned seed = 0; seed < 50; ++seed) {
+        const auto original = std::make_unique<Machine>();
+        std::mt19937 before{seed};
+        for (int i = 0; i < 2000; ++i)
+            original->step(before);
+        const std::vector<std::byte> snapshot = original->layout.save_state();
+
+        std::mt19937 after{seed * 7 + 1};
+        for (int i = 0; i < 2000; ++i)
+            original->step(after);
+        const std::vector<std::byte> expected = original->layout.save_state();
+
+        const auto restored = std::make_unique<Machine>();
+        ASSERT_EQ(restored->layout.load_state(snapshot), StateLayout::Error::None);
+        std::mt19937 replay{seed * 7 + 1};
+        for (int i = 0; i < 2000; ++i)
+            restored->step(replay);
+        ASSERT_EQ(restored->layout.save_state(), expected) << "seed " << seed;
+    }
+}
+
+TEST(SaveState, SameStateSavesSameBytes)
+{
+    const Garbage zeros{0x00}, ones{0xFF};
+    std::mt19937 a{9}, b{9};
+    for (int i = 0; i < 3000; ++i) {
+        zeros.machine->step(a);
+        ones.machine->step(b);
+    }
+    EXPECT_EQ(zeros.machine->layout.save_state(), ones.machine->layout.save_state());
+}
+
+TEST(SaveState, RejectsForeignBlobs)
+{
+    const auto machine = std::make_unique<Machine>();
+    const std::vector<std::byte> blob = machine->layout.save_state();
+    auto damaged = [&](const std::size_t at) {
+        std::vector<std::byte> copy = blob;
+        copy[at] ^= std::byte{1};
+        return machine->layout.load_state(copy);
+    };
+    EXPECT_EQ(damaged(0), StateLayout::Error::Magic);
+    EXPECT_EQ(damaged(4), StateLayout::Error::Version);
+    EXPECT_EQ(damaged(8), StateLayout::Error::Layout);
+    EXPECT_EQ(machine->layout.load_state(std::span{blob}.first(100)), StateLayout::Error::Size);
+}
@@ -0,0 +1,176 @@
+// Scheduler: deadline order, cancelling and moving events, and run_until stopping for
+// events an instruction schedules and jumping ahead while the CPU is halted.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <scheduler.hpp>
+
+namespace
+{
+
+using namespace LR35902;
+
+// Takes 4 cycles per instruction and can schedule an event from inside a step
+struct Cpu
+{
+    Scheduler& scheduler;
+    bool halt = false;
+    std::size_t steps = 0;
+    std::size_t raise_at = 0; // step that schedules Event::Interrupt for now(), 0 for none
+
+    [[nodiscard]] bool halted() const noexcept { return halt; }
+
+    Cycle step()
+    {
+        if (++steps == raise_at)
+            scheduler.schedule(Event::Interrupt, scheduler.now());
+        return 4;
+    }
+};
+
+} // namespace
+
+TEST(Scheduler, EqualDeadlinesFireInEventOrder)
+{
+    std::array<Event, EVENT_COUNT> events;
+    for (std::size_t i = 0; i < EVENT_COUNT; ++i)
+        events[i] = static_cast<Event>(i);
+
+    std::mt19937 random{1};
+    for (int trial = 0; trial < 100; ++trial) {
+        std::shuffle(events.begin(), events.end(), random);
+        Scheduler scheduler;
+        for (const Event event : events)
+            scheduler.schedule(event, 100);
+        scheduler.advance(100);
+
+        std::vector<Event> fired;
+        scheduler.fire([&](const Event event, const Cycle at) {
+            EXPECT_EQ(at, 100u);
+            fired.push_back(event);
+        });
+        ASSERT_EQ(fired.size(), EVENT_COUNT);
+        for (std::size_t i = 0; i < EVENT_COUNT; ++i)
+            EXPECT_EQ(fired[i], static_cast<Event>(i)) << "trial " << trial;
+    }
+}
+
+TEST(Scheduler, FiresInDeadlineOrder)
+{
+    std::mt19937 random{2};
+    for (int trial = 0; trial < 1000; ++trial) {
+        Scheduler scheduler;
+        std::array<Cycle, EVENT_COUNT> deadlines;
+        for (std::size_t i = 0; i < EVENT_COUNT; ++i) {
+            deadlines[i] = random() % 16;
+            scheduler.schedule(static_cast<Event>(i), deadlines[i]);
+        }
+        scheduler.advance(16);
+
+        std::pair<Cycle, std::size_t> last{0, 0};
+        std::size_t fired = 0;
+        scheduler.fire([&](const Event event, const Cycle at) {
+            const std::pair<Cycle, std::size_t> key{at, static_cast<std::size_t>(event)};
+            EXPECT_EQ(at, deadlines[key.second]);
+            EXPECT_TRUE(fired == 0 || last < key) << "trial " << trial;
+            last = key;
+            ++fired;
+        });
+        EXPECT_EQ(fired, EVENT_COUNT);
+    }
+}
+
+TEST(Scheduler, CancelAndReschedule)
+{
+    Scheduler scheduler;
+    EXPECT_EQ(scheduler.next(), Scheduler::NEVER);
+    scheduler.cancel(Event::PPU); // not scheduled, nothing happens
+
+    scheduler.schedule(Event::PPU, 10);
+    scheduler.schedule(Event::Timer, 20);
+    scheduler.schedule(Event::DMA, 30);
+    EXPECT_EQ(scheduler.next(), 10u);
+
+    scheduler.cancel(Event::PPU);
+    EXPECT_FALSE(scheduler.scheduled(Event::PPU));
+    EXPECT_EQ(scheduler.deadline(Event::PPU), Scheduler::NEVER);
+    EXPECT_EQ(scheduler.next(), 20u);
+
+    scheduler.schedule(Event::DMA, 5); // earlier
+    EXPECT_EQ(scheduler.next(), 5u);
+    scheduler.schedule(Event::DMA, 40); // later again
+    EXPECT_EQ(scheduler.next(), 20u);
+    EXPECT_EQ(scheduler.deadline(Event::DMA), 40u);
+
+    scheduler.schedule_in(Event::PPU, 25);
+    scheduler.advance(40);
+    std::vector<std::pair<Event, Cycle>> fired;
+    scheduler.fire([&](const Event event, const Cycle at) { fired.emplace_back(event, at); });
+    const std::vector<std::pair<Event, Cycle>> expected{{Event::Timer, 20}, {Event::PPU, 25}, {Event::DMA, 40}};
+    EXPECT_EQ(fired, expected);
+    EXPECT_EQ(scheduler.next(), Scheduler::NEVER);
+}
+
+// The handler may put its own event back, for a periodic event based on the deadline
+TEST(Scheduler, HandlersReschedule)
+{
+    Scheduler scheduler;
+    scheduler.schedule(Event::PPU, 100);
+    scheduler.advance(350);
+    std::vector<Cycle> fired;
+    scheduler.fire([&](const Event event, const Cycle at) {
+        fired.push_back(at);
+        scheduler.schedule(event, at + 100);
+    });
+    EXPECT_EQ(fired, (std::vector<Cycle>{100, 200, 300}));
+    EXPECT_EQ(scheduler.next(), 400u);
+}
+
+// An event scheduled for now() by an instruction fires before the next instruction
+TEST(Scheduler, RunUntilStopsForAnEventScheduledDuringAStep)
+{
+    Scheduler scheduler;
+    scheduler.schedule(Event::Timer, 1000);
+    Cpu cpu{scheduler};
+    cpu.raise_at = 3;
+
+    std::vector<std::pair<Event, std::size_t>> fired;
+    scheduler.run_until(2000, cpu, [&](const Event event, Cycle) { fired.emplace_back(event, cpu.steps); });
+    const std::vector<std::pair<Event, std::size_t>> expected{{Event::Interrupt, 3}, {Event::Timer, 250}};
+    EXPECT_EQ(fired, expected);
+    EXPECT_EQ(scheduler.now(), 2000u);
+    EXPECT_EQ(cpu.steps, 500u);
+}
+
+// Halted, the clock jumps from deadline to deadline and no instruction runs
+TEST(Scheduler, RunUntilJumpsWhileHalted)
+{
+    Scheduler scheduler;
+    scheduler.schedule(Event::Timer, 1000);
+    scheduler.schedule(Event::Serial, 3000);
+    Cpu cpu{scheduler, true};
+
+    std::vector<Cycle> fired;
+    scheduler.run_until(5000, cpu, [&](const Event event, const Cycle at) {
+        EXPECT_EQ(scheduler.now(), at);
+        fired.push_back(at);
+        if (event == Event::Serial)
+            cpu.halt = false; // an interrupt woke the CPU
+    });
+    EXPECT_EQ(fired, (std::vector<Cycle>{1000, 3000}));
+    EXPECT_EQ(cpu.steps, 500u);
+    EXPECT_EQ(scheduler.now(), 5000u);
+
+    // nothing scheduled: straight to the end
+    cpu.halt = true;
+    scheduler.run_until(1'000'000, cpu, [](Event, Cycle) { FAIL(); });
+    EXPECT_EQ(scheduler.now(), 1'000'000u);
+    EXPECT_EQ(cpu.steps, 500u);
+}
@@ -0,0 +1,148 @@
+// Serial and Link::Cable: transfers between two instances in separate processes over both
+// transports, instant transfers to a Peer, and an unplugged port.
+
+#include <cerrno>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <serial.hpp>
+
+#include "run.hpp"
+
+namespace
+{
+
+using namespace LR35902;
+
+struct System
+{
+    Scheduler scheduler;
+    SystemState state{};
+    Interrupts interrupts{scheduler};
+    Serial serial{scheduler, interrupts, state};
+    std::vector<Cycle> completed;
+
+    System() { interrupts.write(0xFFFF, 0x08); }
+
+    void run_to(const Cycle end)
+    {
+        run_until(scheduler, end, [this](const Event event, const Cycle at) {
+            if (event == Event::Serial)
+                serial.on_event(at);
+            if (event == Event::Interrupt) {
+                completed.push_back(scheduler.now());
+                interrupts.acknowledge(Interrupt::Serial);
+            }
+        });
+    }
+
+    void wait_for_transfer()
+    {
+        while (state.io.read(0xFF02) & 0x80)
+            run_to(scheduler.now() + 50);
+    }
+};
+
+constexpr int TRANSFERS = 300;
+
+// The host sends i on its internal clock, the guest always answers 3 * i. Returns failures.
+int side(const Link::Role role, const Link::Transport transport, const std::string& name)
+{
+    Link::Options options;
+    options.name = name;
+    options.role = role;
+    options.transport = transport;
+    Link::Cable cable{options};
+    if (cable.error())
+        return 1;
+
+    System system;
+    system.serial.connect(&cable);
+    int failures = 0;
+    for (int i = 0; i < TRANSFERS; ++i) {
+        if (role == Link::Role::Host) {
+            system.run_to(system.scheduler.now() + 7000 + (i * 37) % 3000);
+            system.state.io.write(0xFF01, static_cast<Data>(i));
+            system.state.io.write(0xFF02, 0x81);
+            const Cycle start = system.scheduler.now();
+            system.wait_for_transfer();
+            failures += system.state.io.read(0xFF01) != static_cast<Data>(i * 3);
+            failures += system.completed.back() - start != 4096; // 8 bits at 8192 Hz
+        } else {
+            system.state.io.write(0xFF01, static_cast<Data>(i * 3));
+            system.state.io.write(0xFF02, 0x80);
+            system.wait_for_transfer();
+            failures += system.state.io.read(0xFF01) != static_cast<Data>(i);
+        }
+    }
+    // keep the quanta going until the other side is done too
+    system.run_to(system.scheduler.now() + 100000);
+    return failures;
+}
+
+void linked(const Link::Transport transport)
+{
+    const std::string name = "lr35902-test-" + std::to_string(getpid());
+    const pid_t guest = fork();
+    ASSERT_GE(guest, 0);
+    if (guest == 0)
+        _exit(side(Link::Role::Guest, transport, name));
+    EXPECT_EQ(side(Link::Role::Host, transport, name), 0);
+    int status;
+    ASSERT_EQ(waitpid(guest, &status, 0), guest);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+} // namespace
+
+TEST(Serial, SharedMemoryLink)
+{
+    linked(Link::Transport::SharedMemory);
+}
+
+TEST(Serial, SocketLink)
+{
+    linked(Link::Transport::Socket);
+}
+
+TEST(Serial, InstantTransferToAPeer)
+{
+    System system;
+    system.serial.instant(true);
+    system.serial.attach(Serial::Peer{nullptr, [](void*, const Data data) -> Data { return static_cast<Data>(data + 1); }});
+    system.state.io.write(0xFF01, 0x41);
+    system.state.io.write(0xFF02, 0x81);
+    EXPECT_EQ(system.state.io.read(0xFF01), 0x42);
+    EXPECT_EQ(system.state.io.read(0xFF02) & 0x80, 0);
+}
+
+TEST(Serial, UnpluggedPortShiftsInOnes)
+{
+    System system;
+    system.state.io.write(0xFF01, 0x41);
+    system.state.io.write(0xFF02, 0x81);
+    system.run_to(4095);
+    EXPECT_NE(system.state.io.read(0xFF02) & 0x80, 0);
+    system.run_to(5000);
+    EXPECT_EQ(system.state.io.read(0xFF01), 0xFF);
+    EXPECT_EQ(system.state.io.read(0xFF02) & 0x80, 0);
+    ASSERT_EQ(system.completed.size(), 1u);
+    EXPECT_EQ(system.completed[0], 4096u);
+}
+
+TEST(Serial, GuestWithoutHostTimesOut)
+{
+    Link::Options options;
+    options.name = "lr35902-test-nobody-" + std::to_string(getpid());
+    options.role = Link::Role::Guest;
+    options.timeout = std::chrono::milliseconds{50};
+    const Link::Cable cable{options};
+    EXPECT_EQ(cable.error(), ETIMEDOUT);
+}
@@ -0,0 +1,121 @@
+// VRAM dirty tracking and the tile cache: cached line rendering against Reference::render
+// while VRAM keeps changing between lines.
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include <MMU/Vram.hpp>
+#include <PPU/scanline.hpp>
+#include <PPU/tile_cache.hpp>
+
+namespace
+{
+
+using namespace LR35902;
+using namespace LR35902::PPU;
+
+using Vram = MMU::VideoRAM<>;
+
+std::size_t dirty_tiles(Vram& vram)
+{
+    std::size_t count = 0;
+    for (const std::uint64_t word : vram.dirty())
+        count += static_cast<std::size_t>(std::popcount(word));
+    return count;
+}
+
+} // namespace
+
+TEST(TileCache, OnlyTileDataWritesMarkTiles)
+{
+    Vram vram;
+    TileCache<> cache;
+    cache.refresh(vram);
+    EXPECT_EQ(dirty_tiles(vram), 0u);
+
+    vram.write(0x8000, 0xFF);  // tile 0
+    vram.write(0x800F, 0xFF);  // tile 0 again
+    vram.write(0x97F0, 0xFF);  // tile 383
+    vram.write(0x9800, 0x01);  // tile map, not tracked
+    EXPECT_EQ(dirty_tiles(vram), 2u);
+    EXPECT_TRUE(vram.dirty()[0] & 1);
+    EXPECT_TRUE(vram.dirty()[383 / 64] & (std::uint64_t{1} << (383 % 64)));
+
+    cache.refresh(vram);
+    EXPECT_EQ(dirty_tiles(vram), 0u);
+    // 0x8000 is row 0's low plane: every pixel has bit 0 set
+    for (unsigned x = 0; x < 8; ++x)
+        EXPECT_EQ(cache.row(0, 0, 0)[x], 1);
+}
+
+TEST(TileCache, FlipsMirrorThePlainTile)
+{
+    std::mt19937 random{4};
+    Vram vram;
+    for (Addr addr = 0x8000; addr < 0x9800; ++addr)
+        vram.write(addr, static_cast<Data>(random()));
+    TileCache<> cache;
+    cache.refresh(vram);
+
+    using Flip = TileCache<>::Flip;
+    for (std::size_t tile = 0; tile < TileCache<>::TILES; ++tile) {
+        for (unsigned y = 0; y < 8; ++y) {
+            const Data lo = vram.read(static_cast<Addr>(0x8000 + tile * 16 + y * 2));
+            const Data hi = vram.read(static_cast<Addr>(0x8000 + tile * 16 + y * 2 + 1));
+            for (unsigned x = 0; x < 8; ++x) {
+                const Data c = pixel(lo, hi, x);
+                ASSERT_EQ(cache.row(0, tile, y, Flip::None)[x], c);
+                ASSERT_EQ(cache.row(0, tile, y, Flip::X)[7 - x], c);
+                ASSERT_EQ(cache.row(0, tile, 7 - y, Flip::Y)[x], c);
+                ASSERT_EQ(cache.row(0, tile, 7 - y, Flip::XY)[7 - x], c);
+            }
+        }
+    }
+}
+
+TEST(TileCache, CachedLinesMatchReferenceWhileVramChanges)
+{
+    std::mt19937 random{5};
+    Vram vram;
+    std::array<Data, 0xA0> oam;
+    for (Addr addr = 0x8000; addr < 0xA000; ++addr)
+        vram.write(addr, static_cast<Data>(random()));
+    TileCache<> cache;
+
+    for (int line = 0; line < 20000; ++line) {
+        // a few writes anywhere in VRAM between lines, as a game would make
+        for (int i = random() % 8; i > 0; --i)
+            vram.write(static_cast<Addr>(0x8000 + random() % 0x2000), static_cast<Data>(random()));
+        cache.refresh(vram);
+
+        LineRegisters regs{
+            .LCDC = static_cast<Data>(random()),
+            .SCY = static_cast<Data>(random()),
+            .SCX = static_cast<Data>(random()),
+            .LY = static_cast<Data>(random() % HEIGHT),
+            .WY = static_cast<Data>(random() % HEIGHT),
+            .WX = static_cast<Data>(random() % 170),
+            .BGP = static_cast<Data>(random()),
+            .OBP0 = static_cast<Data>(random()),
+            .OBP1 = static_cast<Data>(random()),
+            .window_line = 0,
+        };
+        regs.window_line = static_cast<Data>(random() % (regs.LY + 1));
+        for (std::size_t i = 0; i < oam.size(); i += 4) {
+            oam[i] = static_cast<Data>(regs.LY + 16 - random() % 16);
+            oam[i + 1] = static_cast<Data>(random() % (WIDTH + 8));
+            oam[i + 2] = static_cast<Data>(random());
+            oam[i + 3] = static_cast<Data>(random());
+        }
+        const LineObjects objects = select_objects(oam, regs.LY, regs.LCDC & LCDCBit::OBJSize);
+
+        Line expected, actual;
+        Reference::render(vram.bank(0), oam, regs, expected);
+        render_cached_line(cache, vram.bank(0), objects, regs, actual);
+        ASSERT_EQ(expected, actual) << "line " << line;
+    }
+}
@@ -0,0 +1,132 @@
+// Timer: DIV, TIMA and the overflow interrupts against a per cycle model of the 16 bit
+// counter, with random writes to DIV, TIMA, TMA and TAC (falling edge glitches included).
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <timer.hpp>
+
+#include "run.hpp"
+
+namespace
+{
+
+using namespace LR35902;
+
+// Counts every cycle the way the hardware does
+struct Reference
+{
+    std::uint16_t counter = 0;
+    Data tima = 0, tma = 0, tac = 0;
+    int reload = -1; // cycles until TIMA is reloaded from TMA, -1 when none is pending
+    std::vector<Cycle> interrupts;
+    Cycle now = 0;
+
+    [[nodiscard]] bool line() const
+    {
+        static constexpr int BIT[4] = {9, 3, 5, 7};
+        return (tac & 4) && (counter >> BIT[tac & 3] & 1);
+    }
+
+    void increment()
+    {
+        if (++tima == 0)
+            reload = 4;
+    }
+
+    void run_to(const Cycle end)
+    {
+        while (now < end) {
+            const bool before = line();
+            ++counter;
+            ++now;
+            if (reload > 0 && --reload == 0) {
+                tima = tma;
+                interrupts.push_back(now);
+                reload = -1;
+            }
+            if (before && !line())
+                increment();
+        }
+    }
+
+    void write_div()
+    {
+        if (line())
+            increment();
+        counter = 0;
+    }
+
+    void write_tac(const Data value)
+    {
+        const bool before = line();
+        tac = value & 7;
+        if (before && !line())
+            increment();
+    }
+};
+
+struct System
+{
+    Scheduler scheduler;
+    SystemState state{};
+    Interrupts interrupts{scheduler};
+    Timer timer{scheduler, interrupts, state};
+    std::vector<Cycle> fired;
+
+    void run_to(const Cycle end)
+    {
+        run_until(scheduler, end, [this](const Event event, const Cycle at) {
+            if (event == Event::Timer) {
+                fired.push_back(at);
+                timer.on_event(at);
+            }
+        });
+    }
+};
+
+} // namespace
+
+TEST(Timer, MatchesACycleCountingReference)
+{
+    for (unsigned seed = 0; seed < 200; ++seed) {
+        std::mt19937 random{seed};
+        System system;
+        Reference reference;
+        Cycle now = 0;
+        for (int i = 0; i < 400; ++i) {
+            // odd seeds write often enough to land inside reload windows
+            now += random() % (seed % 2 ? 300 : 20000) + 1;
+            system.run_to(now);
+            reference.run_to(now);
+            ASSERT_EQ(system.state.io.read(0xFF04), reference.counter >> 8) << "seed " << seed << " step " << i;
+            ASSERT_EQ(system.state.io.read(0xFF05), reference.tima) << "seed " << seed << " step " << i;
+
+            const Data value = static_cast<Data>(random());
+            switch (random() % 6) {
+            case 0: system.state.io.write(0xFF04, value); reference.write_div(); break;
+            case 1: system.state.io.write(0xFF05, value); reference.tima = value; reference.reload = -1; break;
+            case 2: system.state.io.write(0xFF06, value); reference.tma = value; break;
+            default: system.state.io.write(0xFF07, value); reference.write_tac(value); break;
+            }
+        }
+        ASSERT_EQ(system.fired, reference.interrupts) << "seed " << seed;
+    }
+}
+
+// One event per overflow and none otherwise: nothing is scheduled while TAC is off
+TEST(Timer, SchedulesOnlyOverflows)
+{
+    System system;
+    system.run_to(4194304);
+    EXPECT_TRUE(system.fired.empty());
+
+    system.state.io.write(0xFF06, 0x00);
+    system.state.io.write(0xFF07, 0x05); // 262144 Hz: 256 increments per overflow
+    system.run_to(2 * 4194304);
+    // 1024 overflows, the last one's reload lands RELOAD_DELAY past the end
+    EXPECT_EQ(system.fired.size(), 4194304u / 16 / 256 - 1);
+}
@@ -0,0 +1,124 @@
+// utility::WorkStealingPool: every job runs exactly once on a valid worker, skewed job
+// lengths make the idle workers steal, and the first exception is rethrown after the rest.
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <utility/work_stealing.hpp>
+
+namespace
+{
+
+// One count per job, each on its own cache line so the workers don't contend
+struct Counts
+{
+    struct alignas(utility::CACHE_LINE) Count
+    {
+        std::atomic<int> value{0};
+    };
+
+    explicit Counts(const std::size_t jobs)
+    : counts{std::make_unique<Count[]>(jobs)}
+    , size{jobs}
+    {}
+
+    void add(const std::size_t job) { counts[job].value.fetch_add(1, std::memory_order_relaxed); }
+
+    // The first job not run exactly once, size when there is none
+    [[nodiscard]] std::size_t first_wrong() const
+    {
+        for (std::size_t job = 0; job < size; ++job)
+            if (counts[job].value.load() != 1)
+                return job;
+        return size;
+    }
+
+    std::unique_ptr<Count[]> counts;
+    std::size_t size;
+};
+
+} // namespace
+
+TEST(WorkStealingPool, RunsEveryJobOnce)
+{
+    for (const std::size_t workers : {1, 2, 3, 8}) {
+        utility::WorkStealingPool pool{workers};
+        ASSERT_EQ(pool.workers(), workers);
+        for (const std::size_t jobs : {0, 1, 7, 10000}) {
+            Counts counts{jobs};
+            std::atomic<bool> bad_worker{false};
+            pool.run(jobs, [&](const std::size_t worker, const std::size_t job) {
+                if (worker >= workers)
+                    bad_worker = true;
+                counts.add(job);
+            });
+            EXPECT_EQ(counts.first_wrong(), jobs) << workers << " workers, " << jobs << " jobs";
+            EXPECT_FALSE(bad_worker);
+        }
+    }
+}
+
+TEST(WorkStealingPool, AtLeastOneWorker)
+{
+    utility::WorkStealingPool pool{0};
+    EXPECT_EQ(pool.workers(), 1u);
+    Counts counts{5};
+    pool.run(5, [&](std::size_t, const std::size_t job) { counts.add(job); });
+    EXPECT_EQ(counts.first_wrong(), 5u);
+}
+
+// Worker 0 starts with all the long jobs: the others run out at once and take them over,
+// and every job still runs exactly once
+TEST(WorkStealingPool, StealsUnderSkewedJobs)
+{
+    constexpr std::size_t WORKERS = 4;
+    constexpr std::size_t JOBS = 256;
+    utility::WorkStealingPool pool{WORKERS};
+    Counts counts{JOBS};
+    std::atomic<std::size_t> long_jobs_elsewhere{0};
+    pool.run(JOBS, [&](const std::size_t worker, const std::size_t job) {
+        if (job < JOBS / WORKERS) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            long_jobs_elsewhere += worker != 0;
+        }
+        counts.add(job);
+    });
+    EXPECT_EQ(counts.first_wrong(), JOBS);
+    EXPECT_GT(pool.steals(), 0u);
+    EXPECT_GT(long_jobs_elsewhere.load(), 0u);
+
+    // steals() counts the last run only
+    pool.run(0, [](std::size_t, std::size_t) {});
+    EXPECT_EQ(pool.steals(), 0u);
+}
+
+// The first exception comes out of run() once every other job ran
+TEST(WorkStealingPool, RethrowsTheFirstException)
+{
+    constexpr std::size_t JOBS = 1000;
+    utility::WorkStealingPool pool{4};
+    Counts counts{JOBS};
+    try {
+        pool.run(JOBS, [&](std::size_t, const std::size_t job) {
+            counts.add(job);
+            if (job % 100 == 17)
+                throw std::runtime_error{std::to_string(job)};
+        });
+        FAIL() << "nothing thrown";
+    } catch (const std::runtime_error& error) {
+        EXPECT_EQ(std::stoul(error.what()) % 100, 17u);
+    }
+    EXPECT_EQ(counts.first_wrong(), JOBS);
+
+    // and the pool is usable again
+    Counts again{JOBS};
+    pool.run(JOBS, [&](std::size_t, const std::size_t job) { again.add(job); });
+    EXPECT_EQ(again.first_wrong(), JOBS);
+}